@@ -0,0 +1,79 @@
+/*******************************************************************************
+* File Name: adv_payload.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the advertising payload
+*  service, which updates the ADV and SCAN_RSP data between advertising events.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#if !defined(ADV_PAYLOAD_H)
+#define ADV_PAYLOAD_H
+
+#include <project.h>
+#include <stdbool.h>
+
+
+/***************************************
+*        API Constants
+***************************************/
+
+/* Packets of the payload */
+#define ADV_PAYLOAD_ADV                     (0u)
+#define ADV_PAYLOAD_SCAN_RSP                (1u)
+#define ADV_PAYLOAD_PACKETS                 (2u)
+
+/* The end of each advertising event is signalled by the BLESS interrupt
+ * callback, available from the BLE component v3.10. Set to 0 for older
+ * components, AdvPayloadProcess() then polls the BLESS state instead */
+#define ADV_PAYLOAD_BLESS_CALLBACK          (1u)
+
+/* On air time estimate of one ADV PDU: preamble, access address, header,
+ * advertiser address and CRC take 16 bytes besides the data, at 8 us per
+ * byte, sent on all three advertising channels */
+#define ADV_PAYLOAD_PDU_OVERHEAD            (16u)
+#define ADV_PAYLOAD_US_PER_BYTE             (8u)
+#define ADV_PAYLOAD_CHANNELS                (3u)
+
+
+/***************************************
+*        Data Types
+***************************************/
+
+/* Cost of the payload updates, read with AdvPayloadGetStats() */
+typedef struct
+{
+    uint32 advEvents;       /* Advertising events closed */
+    uint32 updates;         /* Updates passed to the stack */
+    uint32 bytesCopied;     /* Changed bytes copied into the stack data */
+    uint32 wakeups;         /* CPU exits from Sleep or Deep-Sleep, see AdvPayloadCountWakeup() */
+    uint32 latencyEvents;   /* Advertising events from the first write to the update, summed */
+    uint32 maxLatencyEvents;
+    uint32 airTimeUs;       /* Estimated on air time of the ADV PDUs */
+} ADV_PAYLOAD_STATS_T;
+
+
+/***************************************
+*        Function Prototypes
+***************************************/
+
+void AdvPayloadInit(void);
+void AdvPayloadWrite(uint8 packet, uint8 offset, const uint8 *data, uint8 length);
+void AdvPayloadWriteByte(uint8 packet, uint8 offset, uint8 value);
+void AdvPayloadSetLength(uint8 packet, uint8 length);
+bool AdvPayloadIsPending(void);
+uint32 AdvPayloadEventCount(void);
+void AdvPayloadProcess(void);
+void AdvPayloadCountWakeup(void);
+const ADV_PAYLOAD_STATS_T *AdvPayloadGetStats(void);
+
+#endif
+
+/* [] END OF FILE */
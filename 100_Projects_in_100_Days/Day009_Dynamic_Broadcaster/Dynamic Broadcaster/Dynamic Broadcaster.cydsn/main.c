@@ -29,6 +29,7 @@
 *******************************************************************************/
 
 #include <Project.h>
+#include "adv_payload.h"
 
 /***************************************
 *        API Constants
@@ -44,11 +45,6 @@
 
 #if ENABLE_DYNAMIC_ADV
     
-extern CYBLE_GAPP_DISC_MODE_INFO_T cyBle_discoveryModeInfo;
-    
-/* ADV payload dta structure */    
-#define advPayload                                  (cyBle_discoveryModeInfo.advData->advData) 
-    
 #define MANUFACTURER_SPECIFIC_DYNAMIC_DATA_INDEX    (28u) /* index of the dynamic data in the ADV packet */
 #define LOOP_DELAY                                  (1u)  /* How often would you like to update the ADV payload */
     
@@ -68,7 +64,7 @@ void DynamicADVPayloadUpdate(void);
 /***************************************
 *        Global variables
 ***************************************/
-uint16 count = 0;
+uint32 lastUpdateEvent = 0;
 uint8 dynamicPayload = MIN_PAYLOAD_VALUE;
 
 /*******************************************************************************
@@ -183,6 +179,7 @@ void EnterLowPowerMode(void)
         blessState == CYBLE_BLESS_STATE_DEEPSLEEP)
     {
         CySysPmDeepSleep();
+        AdvPayloadCountWakeup();
     }
     else if(blessState != CYBLE_BLESS_STATE_EVENT_CLOSE)
     {
@@ -191,6 +188,7 @@ void EnterLowPowerMode(void)
         CySysClkWriteHfclkDirect(CY_SYS_CLK_HFCLK_ECO);
         CySysClkImoStop();
         CySysPmSleep();
+        AdvPayloadCountWakeup();
         CySysClkImoStart();
         CySysClkWriteHfclkDirect(CY_SYS_CLK_HFCLK_IMO);
     }
@@ -207,7 +205,9 @@ void EnterLowPowerMode(void)
 ********************************************************************************
 *
 * Summary:
-*  This routine dynamically updates the BLE advertisement packet
+*  This routine dynamically updates the BLE advertisement packet. Only the
+*  changed byte is written, the ADV payload service passes it to the stack
+*  once the current advertising event has closed.
 *
 * Parameters:
 *  None
@@ -218,29 +218,24 @@ void EnterLowPowerMode(void)
 *******************************************************************************/
 void DynamicADVPayloadUpdate(void)
 {
-    if(CyBle_GetBleSsState() == CYBLE_BLESS_STATE_EVENT_CLOSE)
+    uint32 advEvents = AdvPayloadEventCount();
+    
+    /* The end of each advertisement (ADV) event, every ADV interval (100ms), is counted by the service.
+     * LOOP_DELAY * ADV interval is the interval after which ADV data is updated in this firmware.*/
+    if((advEvents - lastUpdateEvent) >= LOOP_DELAY)
     {
-        count++; /* Loop counter */
+        lastUpdateEvent = advEvents;
         
-        /* Once the system enters Sleep/Deepsleep mode during advertisement, the source of wake-up is the next  
-         * advertisement interval which has a wakeup interval of 1 advertisement (ADV) interval (100ms). 
-         * LOOP_DELAY * ADV interval is the interval after which ADV data is updated in this firmware.*/
+        /* Dynamic payload will be continuously updated */
+        AdvPayloadWriteByte(ADV_PAYLOAD_ADV, MANUFACTURER_SPECIFIC_DYNAMIC_DATA_INDEX, dynamicPayload++);
         
-        if(count >= LOOP_DELAY)
+        if(dynamicPayload == MAX_PAYLOAD_VALUE)
         {
-            /* Dynamic payload will be continuously updated */
-            advPayload[MANUFACTURER_SPECIFIC_DYNAMIC_DATA_INDEX] = dynamicPayload++;
-            
-            if(dynamicPayload == MAX_PAYLOAD_VALUE)
-            {
-                dynamicPayload = MIN_PAYLOAD_VALUE;
-            }
-            
-            count = 0;
-            
-            CyBle_GapUpdateAdvData(cyBle_discoveryModeInfo.advData, cyBle_discoveryModeInfo.scanRspData);
+            dynamicPayload = MIN_PAYLOAD_VALUE;
         }
     }
+    
+    AdvPayloadProcess();
 }
 
 /*******************************************************************************
@@ -269,6 +264,9 @@ void StackEventHandler(uint32 event, void *eventParam)
         case CYBLE_EVT_GAP_DEVICE_DISCONNECTED:
             /* Start BLE advertisement for 30 seconds and update link
              * status on LEDs */
+#if ENABLE_DYNAMIC_ADV
+            AdvPayloadInit();
+#endif
             CyBle_GappStartAdvertisement(CYBLE_ADVERTISING_FAST);
             Advertising_LED_Write(LED_ON);
           break;
@@ -46,6 +46,7 @@
 #include <project.h>
 #include <stdio.h>
 #include <common.h>
+#include "scan_pipeline.h"
 
 
 
@@ -75,10 +76,6 @@ void StackEventHandler(uint32 event, void* eventParam);
 *******************************************************************************/
 void StackEventHandler(uint32 event, void* eventParam)
 {
-    /*local variables*/
-   CYBLE_GAPC_ADV_REPORT_T advReport;
-   uint8 i;
-     
     switch(event)
     {
         
@@ -99,83 +96,9 @@ void StackEventHandler(uint32 event, void* eventParam)
                 
                 /* scan progress result event occurs 
                  * when it receives any advertisiment packet
-                 * or scan response packet from peer device*/
-                
-
-                advReport=*(CYBLE_GAPC_ADV_REPORT_T *)eventParam;
-
-                printf("CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT:\r\n");
-                 
-                /* Print the Advertising Event details of peer device:*/
-                printf("eventType:");
-                 
-                switch(advReport.eventType)
-                {
-                    case CYBLE_GAPC_CONN_UNDIRECTED_ADV: 
-                        
-                         printf("Connectable undirected advertising\r\n");
-                        break;
-                        
-                    case  CYBLE_GAPC_CONN_DIRECTED_ADV:
-                         
-                         printf("Connectable directed advertising\r\n");
-                        break;
-                    
-                    case  CYBLE_GAPC_SCAN_UNDIRECTED_ADV:
-                        
-                         printf("Scannable undirected advertising\r\n");
-                        break;
-                     
-                    case CYBLE_GAPC_NON_CONN_UNDIRECTED_ADV:
-                        
-                          printf("Non connectable undirected advertising\r\n");
-                        break;
-                     
-                    case CYBLE_GAPC_SCAN_RSP:
-                        
-                          printf("SCAN_RSP\r\n");
-                        break;
-                }
-  
-                
-                /*  PEER addr type  */
-                printf("    peerAddrType: ");
-                
-                if(advReport.peerAddrType==CYBLE_GAP_ADDR_TYPE_PUBLIC)
-                {
-                    printf("PUBLIC\r\n");
-                }
-                else if(advReport.peerAddrType==CYBLE_GAP_ADDR_TYPE_RANDOM)
-                {
-                    printf("RANDOM \r\n");
-                }
-                
-                 /*  PEER Device address type  */
-                printf("    peerBdAddr: %2.2x%2.2x%2.2x%2.2x%2.2x%2.2x \r\n",
-                    advReport.peerBdAddr[5u], advReport.peerBdAddr[4u],
-                    advReport.peerBdAddr[3u], advReport.peerBdAddr[2u],
-                    advReport.peerBdAddr[1u], advReport.peerBdAddr[0u]);
-                
-
-                /*  Advertising or scan response data  */
-                printf("    Peer device adveritsing/scan response data Length: %x \r\n", advReport.dataLen);
-                printf("    advertising/scan response data of peer device: ");
-
-                
-                if(advReport.dataLen!=0)
-                {
-                    for(i = 0u; i < advReport.dataLen; i++)
-                    {
-                        printf("%x", advReport.data[advReport.dataLen-i]);
-                    }
-                
-                }
-                printf("\r\n");
-                
-                /*  RSSI of the received packet from peer Device  */
-                printf("    Rssi: %i \r\n", advReport.rssi);
-                
-                printf("\r\n");
+                 * or scan response packet from peer device.
+                 * Only queue it here, the main loop merges and streams it */
+                ScanReport((CYBLE_GAPC_ADV_REPORT_T *)eventParam);
             break;  
                 
          case  CYBLE_EVT_GAPC_SCAN_START_STOP:
@@ -229,13 +152,16 @@ int main()
     **  to drive the HFCLK */
     CySysClkWriteEcoDiv(CY_SYS_CLK_ECO_DIV8);
     
+    ScanInit();
     CyBle_Start(StackEventHandler);
    
     /*Infinite Loop*/
     for(;;)
     {
+        /* Merge the queued scan reports and feed the capture frames to the UART */
+        ScanProcess();
        
-        if((UART_SpiUartGetTxBufferSize() + UART_GET_TX_FIFO_SR_VALID) == 0)
+        if(((UART_SpiUartGetTxBufferSize() + UART_GET_TX_FIFO_SR_VALID) == 0) && (ScanIsIdle() != 0u))
         {
             
            if(CyBle_GetState() != CYBLE_STATE_INITIALIZING)
@@ -281,10 +207,9 @@ int main()
                 CyExitCriticalSection(InterruptsStatus);
             
             }/*end of if(CyBle_GetState() != CYBLE_STATE_INITIALIZING)*/
-             
-            CyBle_ProcessEvents();
-                        
         }   
+             
+        CyBle_ProcessEvents();
     
     }
     
@@ -0,0 +1,569 @@
+/*******************************************************************************
+* File Name: scan_pipeline.c
+*
+* Version: 1.0
+*
+* Description:
+*  This file collects the advertising and scan response reports. The stack
+*  callback only copies each report into a ring, the main loop merges the
+*  reports of a device into the device table and encodes them as binary
+*  frames which are written to the UART without blocking.
+*
+* Hardware Dependency:
+*  CY8CKIT-042-BLE Bluetooth Low Energy Pioneer Kit
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <project.h>
+#include <string.h>
+#include "scan_pipeline.h"
+
+/* Report ring, the producer only writes ringHead and the consumer ringTail */
+static SCAN_RECORD_T ring[SCAN_RING_SIZE];
+static volatile uint8 ringHead = 0u;
+static volatile uint8 ringTail = 0u;
+
+/* Device table and its open addressing hash, holds the index + 1, 0 for a free slot */
+static SCAN_DEVICE_T devices[SCAN_DEVICE_TABLE_SIZE];
+static uint8 deviceCount = 0u;
+static uint8 hashTable[SCAN_HASH_SIZE];
+
+/* Encoded frames waiting for the UART */
+static uint8 capture[SCAN_CAPTURE_SIZE];
+static uint16 captureHead = 0u;
+static uint16 captureTail = 0u;
+
+/* Table dump in progress, next device to be written */
+static uint8 dumpActive = 0u;
+static uint8 dumpIndex = 0u;
+
+/* Statistics of the current dump period */
+static uint32 received = 0u;
+static uint16 processed = 0u;
+static uint16 ringDropped = 0u;
+static uint16 captureDropped = 0u;
+static uint16 tableFull = 0u;
+
+
+/*******************************************************************************
+* Function Name: AddressHash()
+********************************************************************************
+* Summary:
+* Hashes a Bluetooth device address and its type into the hash table.
+*
+* Parameters:
+* const uint8 *bdAddr: the device address
+* uint8 addrType: public or random address
+*
+* Return:
+* uint8: the first slot to be probed
+*
+*******************************************************************************/
+static uint8 AddressHash(const uint8 *bdAddr, uint8 addrType)
+{
+    uint8 hash = addrType;
+    uint8 i;
+
+    for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
+    {
+        hash = (uint8)((hash * 31u) + bdAddr[i]);
+    }
+
+    return (uint8)((hash ^ (hash >> 4u)) & (SCAN_HASH_SIZE - 1u));
+}
+
+
+/*******************************************************************************
+* Function Name: FindDevice()
+********************************************************************************
+* Summary:
+* Looks up a device in the table and adds it when it is not yet known.
+*
+* Parameters:
+* const SCAN_RECORD_T *record: a report of the device
+*
+* Return:
+* SCAN_DEVICE_T *: the table entry, NULL when the table is full
+*
+*******************************************************************************/
+static SCAN_DEVICE_T *FindDevice(const SCAN_RECORD_T *record)
+{
+    SCAN_DEVICE_T *device;
+    uint8 slot = AddressHash(record->bdAddr, record->addrType);
+
+    while(hashTable[slot] != 0u)
+    {
+        device = &devices[hashTable[slot] - 1u];
+        if((device->addrType == record->addrType) &&
+           (memcmp(device->bdAddr, record->bdAddr, CYBLE_GAP_BD_ADDR_SIZE) == 0))
+        {
+            return device;
+        }
+        slot = (slot + 1u) & (SCAN_HASH_SIZE - 1u);
+    }
+
+    if(deviceCount >= SCAN_DEVICE_TABLE_SIZE)
+    {
+        return NULL;
+    }
+
+    /* The hash has twice the slots of the table, so a free slot was found */
+    device = &devices[deviceCount];
+    memset(device, 0, sizeof(SCAN_DEVICE_T));
+    memcpy(device->bdAddr, record->bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    device->addrType = record->addrType;
+    device->rssiMin = record->rssi;
+    device->rssiMax = record->rssi;
+    deviceCount++;
+    hashTable[slot] = deviceCount;
+
+    return device;
+}
+
+
+/*******************************************************************************
+* Function Name: MergeReport()
+********************************************************************************
+* Summary:
+* Merges a report into the entry of its device. Advertising reports and scan
+* responses of the same address end up in the same entry.
+*
+* Parameters:
+* const SCAN_RECORD_T *record: the report
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void MergeReport(const SCAN_RECORD_T *record)
+{
+    SCAN_DEVICE_T *device = FindDevice(record);
+
+    if(device == NULL)
+    {
+        tableFull++;
+        return;
+    }
+
+    if(record->eventType == CYBLE_GAPC_SCAN_RSP)
+    {
+        device->flags |= SCAN_DEVICE_RSP_SEEN;
+        device->rspCount++;
+    }
+    else
+    {
+        device->flags |= SCAN_DEVICE_ADV_SEEN;
+        if((record->eventType == CYBLE_GAPC_CONN_UNDIRECTED_ADV) ||
+           (record->eventType == CYBLE_GAPC_CONN_DIRECTED_ADV))
+        {
+            device->flags |= SCAN_DEVICE_CONNECTABLE;
+        }
+        device->advCount++;
+    }
+
+    if(record->rssi < device->rssiMin)
+    {
+        device->rssiMin = record->rssi;
+    }
+    if(record->rssi > device->rssiMax)
+    {
+        device->rssiMax = record->rssi;
+    }
+    device->rssiSum += record->rssi;
+}
+
+
+/*******************************************************************************
+* Function Name: CaptureFree()
+********************************************************************************
+* Summary:
+* Returns the free space of the capture buffer.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint16: free bytes
+*
+*******************************************************************************/
+static uint16 CaptureFree(void)
+{
+    return (uint16)(SCAN_CAPTURE_SIZE - (uint16)(captureHead - captureTail));
+}
+
+
+/*******************************************************************************
+* Function Name: CaptureByte()
+********************************************************************************
+* Summary:
+* Appends a byte to the capture buffer and to the CRC of the frame.
+*
+* Parameters:
+* uint8 value: the byte
+* uint16 *crc: the running CRC, NULL for the CRC bytes themselves
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void CaptureByte(uint8 value, uint16 *crc)
+{
+    uint8 bit;
+
+    capture[captureHead & (SCAN_CAPTURE_SIZE - 1u)] = value;
+    captureHead++;
+
+    if(crc != NULL)
+    {
+        *crc ^= (uint16)value << 8u;
+        for(bit = 0u; bit < 8u; bit++)
+        {
+            *crc = ((*crc & 0x8000u) != 0u) ? (uint16)((*crc << 1u) ^ SCAN_CRC_POLY) : (uint16)(*crc << 1u);
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CaptureFrame()
+********************************************************************************
+* Summary:
+* Encodes a frame into the capture buffer. A frame which does not fit is
+* dropped as a whole, so the stream never carries a partial frame.
+*
+* Parameters:
+* uint8 type: frame type
+* const uint8 *header: first part of the payload
+* uint8 headerLen: its length
+* const uint8 *data: second part of the payload, may be NULL
+* uint8 dataLen: its length
+*
+* Return:
+* uint8: 1 if the frame was captured, 0 if it was dropped
+*
+*******************************************************************************/
+static uint8 CaptureFrame(uint8 type, const uint8 *header, uint8 headerLen, const uint8 *data, uint8 dataLen)
+{
+    uint16 crc = SCAN_CRC_INIT;
+    uint8 i;
+
+    if(CaptureFree() < (uint16)(SCAN_FRAME_OVERHEAD + headerLen + dataLen))
+    {
+        captureDropped++;
+        return 0u;
+    }
+
+    CaptureByte(SCAN_FRAME_SYNC, NULL);
+    CaptureByte(type, &crc);
+    CaptureByte((uint8)(headerLen + dataLen), &crc);
+    for(i = 0u; i < headerLen; i++)
+    {
+        CaptureByte(header[i], &crc);
+    }
+    for(i = 0u; i < dataLen; i++)
+    {
+        CaptureByte(data[i], &crc);
+    }
+    CaptureByte(LO8(crc), NULL);
+    CaptureByte(HI8(crc), NULL);
+
+    return 1u;
+}
+
+
+/*******************************************************************************
+* Function Name: CaptureReport()
+********************************************************************************
+* Summary:
+* Encodes a report as a REPORT frame.
+*
+* Parameters:
+* const SCAN_RECORD_T *record: the report
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void CaptureReport(const SCAN_RECORD_T *record)
+{
+    uint8 header[SCAN_REPORT_HEADER_LEN];
+
+    header[0u] = LO8(record->sequence);
+    header[1u] = HI8(record->sequence);
+    header[2u] = record->eventType;
+    header[3u] = record->addrType;
+    memcpy(&header[4u], record->bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    header[10u] = (uint8)record->rssi;
+    header[11u] = record->dataLen;
+
+    (void)CaptureFrame(SCAN_FRAME_REPORT, header, SCAN_REPORT_HEADER_LEN, record->data, record->dataLen);
+}
+
+
+/*******************************************************************************
+* Function Name: CaptureDevice()
+********************************************************************************
+* Summary:
+* Encodes a device table entry as a DEVICE frame.
+*
+* Parameters:
+* const SCAN_DEVICE_T *device: the table entry
+*
+* Return:
+* uint8: 1 if the frame was captured, 0 if the capture buffer is full
+*
+*******************************************************************************/
+static uint8 CaptureDevice(const SCAN_DEVICE_T *device)
+{
+    uint8 payload[SCAN_DEVICE_LEN];
+    uint16 count = device->advCount + device->rspCount;
+
+    if(CaptureFree() < (SCAN_FRAME_OVERHEAD + SCAN_DEVICE_LEN))
+    {
+        return 0u;
+    }
+
+    payload[0u] = device->addrType;
+    memcpy(&payload[1u], device->bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    payload[7u] = device->flags;
+    payload[8u] = LO8(device->advCount);
+    payload[9u] = HI8(device->advCount);
+    payload[10u] = LO8(device->rspCount);
+    payload[11u] = HI8(device->rspCount);
+    payload[12u] = (uint8)device->rssiMin;
+    payload[13u] = (uint8)(int8)(device->rssiSum / (int32)count);
+    payload[14u] = (uint8)device->rssiMax;
+
+    return CaptureFrame(SCAN_FRAME_DEVICE, payload, SCAN_DEVICE_LEN, NULL, 0u);
+}
+
+
+/*******************************************************************************
+* Function Name: CaptureStats()
+********************************************************************************
+* Summary:
+* Encodes the statistics of the dump period as a STATS frame.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint8: 1 if the frame was captured, 0 if the capture buffer is full
+*
+*******************************************************************************/
+static uint8 CaptureStats(void)
+{
+    uint8 payload[SCAN_STATS_LEN];
+
+    if(CaptureFree() < (SCAN_FRAME_OVERHEAD + SCAN_STATS_LEN))
+    {
+        return 0u;
+    }
+
+    payload[0u] = LO8(LO16(received));
+    payload[1u] = HI8(LO16(received));
+    payload[2u] = LO8(HI16(received));
+    payload[3u] = HI8(HI16(received));
+    payload[4u] = LO8(ringDropped);
+    payload[5u] = HI8(ringDropped);
+    payload[6u] = LO8(captureDropped);
+    payload[7u] = HI8(captureDropped);
+    payload[8u] = LO8(tableFull);
+    payload[9u] = HI8(tableFull);
+    payload[10u] = deviceCount;
+
+    return CaptureFrame(SCAN_FRAME_STATS, payload, SCAN_STATS_LEN, NULL, 0u);
+}
+
+
+/*******************************************************************************
+* Function Name: DumpTable()
+********************************************************************************
+* Summary:
+* Writes as much of the device table dump as the capture buffer takes. The
+* STATS frame closes the dump, then the table starts over empty.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void DumpTable(void)
+{
+    while(dumpIndex < deviceCount)
+    {
+        if(CaptureDevice(&devices[dumpIndex]) == 0u)
+        {
+            return;
+        }
+        dumpIndex++;
+    }
+
+    if(CaptureStats() != 0u)
+    {
+        deviceCount = 0u;
+        memset(hashTable, 0, sizeof(hashTable));
+        processed = 0u;
+        ringDropped = 0u;
+        captureDropped = 0u;
+        tableFull = 0u;
+        dumpActive = 0u;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: ScanInit()
+********************************************************************************
+* Summary:
+* Empties the ring, the device table and the capture buffer.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void ScanInit(void)
+{
+    ringHead = 0u;
+    ringTail = 0u;
+    deviceCount = 0u;
+    memset(hashTable, 0, sizeof(hashTable));
+    captureHead = 0u;
+    captureTail = 0u;
+    dumpActive = 0u;
+    received = 0u;
+    processed = 0u;
+    ringDropped = 0u;
+    captureDropped = 0u;
+    tableFull = 0u;
+}
+
+
+/*******************************************************************************
+* Function Name: ScanReport()
+********************************************************************************
+* Summary:
+* Copies a report of the CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT event into the
+* ring. The report is dropped and counted when the ring is full.
+*
+* Parameters:
+* const CYBLE_GAPC_ADV_REPORT_T *report: the report of the event
+*
+* Return:
+* None
+*
+* Theory:
+* Only the producer writes ringHead, after the record is complete, so the
+* function may be called from an interrupt while ScanProcess() runs.
+*
+*******************************************************************************/
+void ScanReport(const CYBLE_GAPC_ADV_REPORT_T *report)
+{
+    SCAN_RECORD_T *record;
+    uint8 head = ringHead;
+
+    received++;
+
+    if((uint8)(head - ringTail) >= SCAN_RING_SIZE)
+    {
+        ringDropped++;
+        return;
+    }
+
+    record = &ring[head & (SCAN_RING_SIZE - 1u)];
+    record->sequence = LO16(received);
+    record->eventType = report->eventType;
+    record->addrType = report->peerAddrType;
+    memcpy(record->bdAddr, report->peerBdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    record->rssi = report->rssi;
+    record->dataLen = (report->dataLen > CYBLE_GAP_MAX_ADV_DATA_LEN) ? CYBLE_GAP_MAX_ADV_DATA_LEN : report->dataLen;
+    memcpy(record->data, report->data, record->dataLen);
+
+    ringHead = head + 1u;
+}
+
+
+/*******************************************************************************
+* Function Name: ScanProcess()
+********************************************************************************
+* Summary:
+* Moves reports from the ring into the device table and the capture buffer,
+* and feeds the capture buffer into the UART TX FIFO. Called from the main
+* loop, never blocks on the UART.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* While the table is dumped the ring is not drained, so the table dumped is
+* the table reset afterwards. Reports arriving meanwhile wait in the ring.
+*
+*******************************************************************************/
+void ScanProcess(void)
+{
+    const SCAN_RECORD_T *record;
+    uint8 count;
+
+    if(dumpActive != 0u)
+    {
+        DumpTable();
+    }
+
+    for(count = 0u; (dumpActive == 0u) && (count < SCAN_REPORTS_PER_CALL) && (ringTail != ringHead); count++)
+    {
+        record = &ring[ringTail & (SCAN_RING_SIZE - 1u)];
+
+        MergeReport(record);
+        #if(SCAN_CAPTURE_REPORTS != 0u)
+            CaptureReport(record);
+        #endif
+
+        ringTail++;
+
+        if(++processed >= SCAN_DUMP_PERIOD)
+        {
+            dumpActive = 1u;
+            dumpIndex = 0u;
+            DumpTable();
+        }
+    }
+
+    while((captureTail != captureHead) && (UART_SpiUartGetTxBufferSize() < SCAN_UART_FIFO_SIZE))
+    {
+        UART_SpiUartWriteTxData(capture[captureTail & (SCAN_CAPTURE_SIZE - 1u)]);
+        captureTail++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: ScanIsIdle()
+********************************************************************************
+* Summary:
+* Tells whether the pipeline has nothing left to do, so the device may sleep.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint8: 1 if the ring and the capture buffer are empty and no dump is pending
+*
+*******************************************************************************/
+uint8 ScanIsIdle(void)
+{
+    return ((ringTail == ringHead) && (captureTail == captureHead) && (dumpActive == 0u)) ? 1u : 0u;
+}
+/* [] END OF FILE */
@@ -0,0 +1,117 @@
+/*******************************************************************************
+* File Name: scan_pipeline.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the scan report pipeline
+*  which collects the advertising reports into a device table and streams
+*  them over the UART as binary frames.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <project.h>
+
+
+/***************************************
+*        API Constants
+***************************************/
+
+/* Reports buffered between the stack callback and the main loop, power of two */
+#define SCAN_RING_SIZE                      (16u)
+
+/* Devices tracked between two table dumps */
+#define SCAN_DEVICE_TABLE_SIZE              (32u)
+
+/* Address hash table, a power of two of at least twice the devices */
+#define SCAN_HASH_SIZE                      (64u)
+
+/* Bytes of encoded frames waiting for the UART, power of two */
+#define SCAN_CAPTURE_SIZE                   (256u)
+
+/* TX FIFO depth of the SCB UART */
+#define SCAN_UART_FIFO_SIZE                 (8u)
+
+/* Reports handled per call of ScanProcess() */
+#define SCAN_REPORTS_PER_CALL               (4u)
+
+/* Reports received between two dumps of the device table */
+#define SCAN_DUMP_PERIOD                    (512u)
+
+/* 1 to stream every report, 0 to stream the device table dumps only */
+#define SCAN_CAPTURE_REPORTS                (1u)
+
+/* Frame format, multi-byte fields are little endian:
+*   SCAN_FRAME_SYNC, type, payload length, payload, CRC-16 over type, length
+*   and payload (CCITT, initial value 0xFFFF).
+*
+*  REPORT payload - uint16 sequence, event type, address type, address,
+*                   int8 RSSI, data length, data
+*  DEVICE payload - address type, address, flags, uint16 advertising reports,
+*                   uint16 scan responses, int8 RSSI min, avg and max
+*  STATS payload  - uint32 reports received, uint16 reports lost in the ring,
+*                   uint16 frames not captured, uint16 devices not tracked,
+*                   devices in this dump
+*/
+#define SCAN_FRAME_SYNC                     (0xA5u)
+#define SCAN_FRAME_REPORT                   (0x01u)
+#define SCAN_FRAME_DEVICE                   (0x02u)
+#define SCAN_FRAME_STATS                    (0x03u)
+#define SCAN_FRAME_OVERHEAD                 (5u)
+#define SCAN_REPORT_HEADER_LEN              (12u)
+#define SCAN_DEVICE_LEN                     (15u)
+#define SCAN_STATS_LEN                      (11u)
+
+/* Flags of a device table entry */
+#define SCAN_DEVICE_ADV_SEEN                (0x01u)
+#define SCAN_DEVICE_RSP_SEEN                (0x02u)
+#define SCAN_DEVICE_CONNECTABLE             (0x04u)
+
+#define SCAN_CRC_INIT                       (0xFFFFu)
+#define SCAN_CRC_POLY                       (0x1021u)
+
+
+/***************************************
+*        Data Types
+***************************************/
+
+/* One advertising or scan response report, as copied from the stack event */
+typedef struct
+{
+    uint16 sequence;
+    uint8  eventType;
+    uint8  addrType;
+    uint8  bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    int8   rssi;
+    uint8  dataLen;
+    uint8  data[CYBLE_GAP_MAX_ADV_DATA_LEN];
+} SCAN_RECORD_T;
+
+/* Everything heard from one device since the last table dump */
+typedef struct
+{
+    uint8  bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    uint8  addrType;
+    uint8  flags;
+    uint16 advCount;
+    uint16 rspCount;
+    int8   rssiMin;
+    int8   rssiMax;
+    int32  rssiSum;
+} SCAN_DEVICE_T;
+
+
+/***************************************
+*        Function Prototypes
+***************************************/
+
+void ScanInit(void);
+void ScanReport(const CYBLE_GAPC_ADV_REPORT_T *report);
+void ScanProcess(void);
+uint8 ScanIsIdle(void);
+/* [] END OF FILE */
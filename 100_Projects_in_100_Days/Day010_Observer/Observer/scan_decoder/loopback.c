@@ -0,0 +1,94 @@
+/*******************************************************************************
+* File Name: loopback.c
+*
+* Description:
+*  Runs the firmware scan pipeline (Observer.cydsn/scan_pipeline.c) on the
+*  host and writes the UART byte stream to stdout, for "make check" to feed
+*  into scan_decoder. LOOPBACK_REPORTS reports from LOOPBACK_DEVICES
+*  addresses, each seen as public and random, are passed to the pipeline, so
+*  the device table is dumped once. The stream
+*  starts with the tail of a frame, as when the decoder joins a running
+*  stream, and one byte of frame LOOPBACK_CORRUPT_FRAME is flipped.
+*
+*******************************************************************************/
+#include <stdio.h>
+#include "scan_pipeline.c"
+
+#define LOOPBACK_REPORTS        (600u)
+#define LOOPBACK_DEVICES        (5u)
+#define LOOPBACK_CORRUPT_FRAME  (100u)
+
+static uint32 framesOut = 0u;
+
+uint32 UART_SpiUartGetTxBufferSize(void)
+{
+    return 0u;
+}
+
+void UART_SpiUartWriteTxData(uint32 txData)
+{
+    static uint32 position = 0u;
+    static uint32 remaining = 0u;
+
+    /* The pipeline only writes whole frames: SYNC, type, length, payload
+     * and CRC */
+    if(remaining == 0u)
+    {
+        framesOut++;
+        position = 0u;
+        remaining = 3u;
+    }
+    position++;
+    remaining--;
+    if(position == 3u)
+    {
+        remaining = txData + 2u;
+    }
+    if((framesOut == LOOPBACK_CORRUPT_FRAME) && (position == 6u))
+    {
+        txData ^= 0x10u;
+    }
+    (void)putchar((int)LO8(txData));
+}
+
+int main(void)
+{
+    static const uint8 tail[] = { 0x12u, SCAN_FRAME_SYNC, 0x34u, 0x56u };
+    uint8 addresses[LOOPBACK_DEVICES][CYBLE_GAP_BD_ADDR_SIZE];
+    uint8 data[CYBLE_GAP_MAX_ADV_DATA_LEN];
+    CYBLE_GAPC_ADV_REPORT_T report;
+    uint32 i;
+
+    for(i = 0u; i < sizeof(tail); i++)
+    {
+        (void)putchar(tail[i]);
+    }
+
+    for(i = 0u; i < LOOPBACK_DEVICES; i++)
+    {
+        memset(addresses[i], (int)(0xA0u + i), CYBLE_GAP_BD_ADDR_SIZE);
+        addresses[i][0] = (uint8)i;
+    }
+    for(i = 0u; i < sizeof(data); i++)
+    {
+        data[i] = (uint8)(SCAN_FRAME_SYNC + i);
+    }
+
+    ScanInit();
+    for(i = 0u; i < LOOPBACK_REPORTS; i++)
+    {
+        report.eventType = (uint8)(i % 5u);
+        report.peerAddrType = (uint8)(i & 1u);
+        report.peerBdAddr = addresses[i % LOOPBACK_DEVICES];
+        report.dataLen = (uint8)(i % (CYBLE_GAP_MAX_ADV_DATA_LEN + 1u));
+        report.data = data;
+        report.rssi = (int8)(-40 - (int32)(i % 50u));
+        ScanReport(&report);
+        do
+        {
+            ScanProcess();
+        } while(ScanIsIdle() == 0u);
+    }
+
+    return 0;
+}
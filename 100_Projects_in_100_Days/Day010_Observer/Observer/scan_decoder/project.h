@@ -0,0 +1,41 @@
+/* Host stand-in for the PSoC Creator project.h, only what scan_pipeline.c uses */
+#if !defined(PROJECT_H)
+#define PROJECT_H
+
+#include <stdint.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   int8;
+typedef int32_t  int32;
+
+#define LO8(x)                      ((uint8) ((x) & 0xFFu))
+#define HI8(x)                      ((uint8) ((uint16)(x) >> 8))
+#define LO16(x)                     ((uint16) ((x) & 0xFFFFu))
+#define HI16(x)                     ((uint16) ((uint32)(x) >> 16))
+
+#define CYBLE_GAP_BD_ADDR_SIZE      (6u)
+#define CYBLE_GAP_MAX_ADV_DATA_LEN  (31u)
+
+#define CYBLE_GAPC_CONN_UNDIRECTED_ADV      (0u)
+#define CYBLE_GAPC_CONN_DIRECTED_ADV        (1u)
+#define CYBLE_GAPC_SCAN_UNDIRECTED_ADV      (2u)
+#define CYBLE_GAPC_NON_CONN_UNDIRECTED_ADV  (3u)
+#define CYBLE_GAPC_SCAN_RSP                 (4u)
+
+typedef struct
+{
+    uint8 eventType;
+    uint8 peerAddrType;
+    uint8 *peerBdAddr;
+    uint8 dataLen;
+    uint8 *data;
+    int8 rssi;
+} CYBLE_GAPC_ADV_REPORT_T;
+
+/* The loopback test sends the UART bytes to stdout */
+uint32 UART_SpiUartGetTxBufferSize(void);
+void UART_SpiUartWriteTxData(uint32 txData);
+
+#endif /* PROJECT_H */
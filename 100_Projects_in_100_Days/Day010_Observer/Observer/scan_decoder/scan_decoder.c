@@ -0,0 +1,375 @@
+/*******************************************************************************
+* File Name: scan_decoder.c
+*
+* Description:
+*  Host decoder of the binary frames which the Observer streams over the UART
+*  (see the frame format in Observer.cydsn/scan_pipeline.h). Frames are found
+*  by their SYNC byte and checked with their CRC, so the decoder locks onto
+*  a stream joined at any point and skips corrupted frames. Each frame is
+*  printed as one line of text.
+*
+* Usage:
+*  scan_decoder [-b baud] [-H] [-q] [input]
+*   input: serial port, e.g. /dev/ttyACM0, or a file of captured bytes.
+*          stdin when omitted.
+*   -b:    baud rate of a serial port, 115200 by default
+*   -H:    the input is hex text (e.g. a terminal log) instead of raw bytes
+*   -q:    do not print the data bytes of the REPORT frames
+*
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+/* Frame format, as in scan_pipeline.h */
+#define SCAN_FRAME_SYNC                     (0xA5u)
+#define SCAN_FRAME_REPORT                   (0x01u)
+#define SCAN_FRAME_DEVICE                   (0x02u)
+#define SCAN_FRAME_STATS                    (0x03u)
+#define SCAN_REPORT_HEADER_LEN              (12u)
+#define SCAN_DEVICE_LEN                     (15u)
+#define SCAN_STATS_LEN                      (11u)
+
+#define SCAN_DEVICE_ADV_SEEN                (0x01u)
+#define SCAN_DEVICE_RSP_SEEN                (0x02u)
+#define SCAN_DEVICE_CONNECTABLE             (0x04u)
+
+#define SCAN_CRC_INIT                       (0xFFFFu)
+#define SCAN_CRC_POLY                       (0x1021u)
+
+#define BD_ADDR_SIZE                        (6u)
+
+/* Decoder state: SYNC, type, length, payload, CRC low, CRC high */
+typedef enum
+{
+    WAIT_SYNC,
+    WAIT_TYPE,
+    WAIT_LENGTH,
+    WAIT_PAYLOAD,
+    WAIT_CRC_LO,
+    WAIT_CRC_HI
+} DECODER_STATE_T;
+
+typedef struct
+{
+    DECODER_STATE_T state;
+    uint8_t type;
+    uint8_t length;
+    uint8_t received;
+    uint8_t payload[255];
+    uint16_t crc;
+    uint16_t frameCrc;
+    unsigned long frames;
+    unsigned long crcErrors;
+    unsigned long formatErrors;
+    unsigned long skipped;
+    int quiet;
+} DECODER_T;
+
+static uint16_t CrcByte(uint16_t crc, uint8_t value)
+{
+    uint8_t bit;
+
+    crc ^= (uint16_t)value << 8u;
+    for(bit = 0u; bit < 8u; bit++)
+    {
+        crc = ((crc & 0x8000u) != 0u) ? (uint16_t)((crc << 1u) ^ SCAN_CRC_POLY) : (uint16_t)(crc << 1u);
+    }
+    return crc;
+}
+
+static uint16_t Le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8u));
+}
+
+/* Addresses are sent as the stack holds them, least significant byte first */
+static void PrintAddress(uint8_t addrType, const uint8_t *bdAddr)
+{
+    int i;
+
+    for(i = BD_ADDR_SIZE - 1; i >= 0; i--)
+    {
+        printf("%02X%s", bdAddr[i], (i != 0) ? ":" : "");
+    }
+    printf(" %s", (addrType == 0u) ? "public" : "random");
+}
+
+static const char *EventName(uint8_t eventType)
+{
+    static const char *const names[] =
+    {
+        "ADV_IND", "ADV_DIRECT_IND", "ADV_SCAN_IND", "ADV_NONCONN_IND", "SCAN_RSP"
+    };
+
+    return (eventType < (sizeof(names) / sizeof(names[0]))) ? names[eventType] : "UNKNOWN";
+}
+
+static void PrintFrame(DECODER_T *decoder)
+{
+    const uint8_t *p = decoder->payload;
+    uint8_t i;
+
+    switch(decoder->type)
+    {
+        case SCAN_FRAME_REPORT:
+            if((decoder->length < SCAN_REPORT_HEADER_LEN) ||
+               (decoder->length != (SCAN_REPORT_HEADER_LEN + p[11])))
+            {
+                break;
+            }
+            printf("REPORT seq=%u %-15s ", Le16(&p[0]), EventName(p[2]));
+            PrintAddress(p[3], &p[4]);
+            printf(" rssi=%d len=%u", (int8_t)p[10], p[11]);
+            if(!decoder->quiet)
+            {
+                printf(" data=");
+                for(i = 0u; i < p[11]; i++)
+                {
+                    printf("%02X", p[SCAN_REPORT_HEADER_LEN + i]);
+                }
+            }
+            printf("\n");
+            return;
+
+        case SCAN_FRAME_DEVICE:
+            if(decoder->length != SCAN_DEVICE_LEN)
+            {
+                break;
+            }
+            printf("DEVICE ");
+            PrintAddress(p[0], &p[1]);
+            printf(" adv=%u rsp=%u rssi=%d/%d/%d%s%s%s\n", Le16(&p[8]), Le16(&p[10]),
+                   (int8_t)p[12], (int8_t)p[13], (int8_t)p[14],
+                   ((p[7] & SCAN_DEVICE_ADV_SEEN) != 0u) ? " adv-seen" : "",
+                   ((p[7] & SCAN_DEVICE_RSP_SEEN) != 0u) ? " rsp-seen" : "",
+                   ((p[7] & SCAN_DEVICE_CONNECTABLE) != 0u) ? " connectable" : "");
+            return;
+
+        case SCAN_FRAME_STATS:
+            if(decoder->length != SCAN_STATS_LEN)
+            {
+                break;
+            }
+            printf("STATS received=%lu ring-lost=%u not-captured=%u not-tracked=%u devices=%u\n",
+                   (unsigned long)Le16(&p[0]) | ((unsigned long)Le16(&p[2]) << 16u),
+                   Le16(&p[4]), Le16(&p[6]), Le16(&p[8]), p[10]);
+            return;
+
+        default:
+            break;
+    }
+
+    decoder->formatErrors++;
+    printf("# frame type 0x%02X with %u bytes not understood\n", decoder->type, decoder->length);
+}
+
+static void DecodeByte(DECODER_T *decoder, uint8_t value);
+
+/* After a bad CRC the search for the next SYNC restarts at the byte after the
+ * SYNC of the bad frame, so a false SYNC, e.g. in the middle of a payload,
+ * cannot hide the frames which follow */
+static void Resync(DECODER_T *decoder)
+{
+    uint8_t replay[259];
+    uint16_t count = 0u;
+    uint16_t i;
+
+    replay[count++] = decoder->type;
+    replay[count++] = decoder->length;
+    memcpy(&replay[count], decoder->payload, decoder->received);
+    count += decoder->received;
+    replay[count++] = (uint8_t)decoder->frameCrc;
+    replay[count++] = (uint8_t)(decoder->frameCrc >> 8u);
+    decoder->state = WAIT_SYNC;
+    for(i = 0u; i < count; i++)
+    {
+        DecodeByte(decoder, replay[i]);
+    }
+}
+
+/* Feeds one byte to the decoder */
+static void DecodeByte(DECODER_T *decoder, uint8_t value)
+{
+    switch(decoder->state)
+    {
+        case WAIT_SYNC:
+            if(value == SCAN_FRAME_SYNC)
+            {
+                decoder->crc = SCAN_CRC_INIT;
+                decoder->state = WAIT_TYPE;
+            }
+            else
+            {
+                decoder->skipped++;
+            }
+            break;
+
+        case WAIT_TYPE:
+            decoder->type = value;
+            decoder->crc = CrcByte(decoder->crc, value);
+            decoder->state = WAIT_LENGTH;
+            break;
+
+        case WAIT_LENGTH:
+            decoder->length = value;
+            decoder->received = 0u;
+            decoder->crc = CrcByte(decoder->crc, value);
+            decoder->state = (value != 0u) ? WAIT_PAYLOAD : WAIT_CRC_LO;
+            break;
+
+        case WAIT_PAYLOAD:
+            decoder->payload[decoder->received++] = value;
+            decoder->crc = CrcByte(decoder->crc, value);
+            if(decoder->received == decoder->length)
+            {
+                decoder->state = WAIT_CRC_LO;
+            }
+            break;
+
+        case WAIT_CRC_LO:
+            decoder->frameCrc = value;
+            decoder->state = WAIT_CRC_HI;
+            break;
+
+        default:
+            decoder->frameCrc |= (uint16_t)value << 8u;
+            if(decoder->frameCrc == decoder->crc)
+            {
+                decoder->frames++;
+                decoder->state = WAIT_SYNC;
+                PrintFrame(decoder);
+                fflush(stdout);
+            }
+            else
+            {
+                decoder->crcErrors++;
+                decoder->skipped++;
+                Resync(decoder);
+            }
+            break;
+    }
+}
+
+static int OpenSerial(const char *path, long baud)
+{
+    struct termios tio;
+    speed_t speed;
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+
+    if(fd < 0)
+    {
+        perror(path);
+        exit(1);
+    }
+    if(!isatty(fd))
+    {
+        return fd;
+    }
+
+    switch(baud)
+    {
+        case 9600:   speed = B9600;   break;
+        case 19200:  speed = B19200;  break;
+        case 38400:  speed = B38400;  break;
+        case 57600:  speed = B57600;  break;
+        case 115200: speed = B115200; break;
+        case 230400: speed = B230400; break;
+        default:
+            fprintf(stderr, "baud rate %ld not supported\n", baud);
+            exit(1);
+    }
+    if(tcgetattr(fd, &tio) != 0)
+    {
+        perror(path);
+        exit(1);
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1u;
+    tio.c_cc[VTIME] = 0u;
+    if(tcsetattr(fd, TCSANOW, &tio) != 0)
+    {
+        perror(path);
+        exit(1);
+    }
+    return fd;
+}
+
+static int HexValue(int c)
+{
+    if(isdigit(c))
+    {
+        return c - '0';
+    }
+    c = tolower(c);
+    return ((c >= 'a') && (c <= 'f')) ? (c - 'a' + 10) : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    static DECODER_T decoder;
+    uint8_t buffer[256];
+    long baud = 115200;
+    int hexInput = 0;
+    int high = -1;
+    int fd = STDIN_FILENO;
+    int option;
+    ssize_t count;
+    ssize_t i;
+
+    while((option = getopt(argc, argv, "b:Hq")) != -1)
+    {
+        switch(option)
+        {
+            case 'b': baud = strtol(optarg, NULL, 10); break;
+            case 'H': hexInput = 1; break;
+            case 'q': decoder.quiet = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-b baud] [-H] [-q] [input]\n", argv[0]);
+                return 2;
+        }
+    }
+    if(optind < argc)
+    {
+        fd = OpenSerial(argv[optind], baud);
+    }
+
+    while((count = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for(i = 0; i < count; i++)
+        {
+            if(!hexInput)
+            {
+                DecodeByte(&decoder, buffer[i]);
+            }
+            else if(HexValue(buffer[i]) >= 0)
+            {
+                if(high < 0)
+                {
+                    high = HexValue(buffer[i]);
+                }
+                else
+                {
+                    DecodeByte(&decoder, (uint8_t)((high << 4) | HexValue(buffer[i])));
+                    high = -1;
+                }
+            }
+            else
+            {
+                high = -1;
+            }
+        }
+    }
+
+    fprintf(stderr, "%lu frames, %lu CRC errors, %lu not understood, %lu bytes skipped\n",
+            decoder.frames, decoder.crcErrors, decoder.formatErrors, decoder.skipped);
+    return 0;
+}
@@ -15,8 +15,8 @@
 
 #include "BLE_Central_Observer.h"
 #include "main.h"
+#include "scan_pipeline.h"
 
-uint8 devIndex;
 uint8 Periph_Selected;
  
 /* 'connHandle' is a varibale of type 'CYBLE_CONN_HANDLE_T' (defined in 
@@ -31,76 +31,7 @@ CYBLE_API_RESULT_T 		    apiResult;
 	
 /* 'connectPeriphDevice' is a varibale of type 'CYBLE_GAP_BD_ADDR_T' (defined in 
 * BLE_StackGap.h) and is used to store address of the connected device. */
-CYBLE_GAP_BD_ADDR_T     connectPeriphDevice[10];
-
-/*******************************************************************************
-* Function Name: Get_Adv_Scan_Packets
-********************************************************************************
-*
-* Summary:
-* This function gets information from Advertisement and Scan Response packets
-*
-* Parameters:  
-* scanReport - Advertisement report received by the Central
-*
-* Return: 
-*  None
-*
-*******************************************************************************/
-
-void Get_Adv_Scan_Packets(CYBLE_GAPC_ADV_REPORT_T* scanReport)
-{
- uint8 RepIndex; //Index for Bytes in Scan Response Packet
-    {
-        if (devIndex < 9)
-        {
-             IsDetected = 1;
-            // Receiving Advertisement Packet
-            if ((scanReport->eventType == CYBLE_GAPC_CONN_UNDIRECTED_ADV)||
-                (scanReport->eventType == CYBLE_GAPC_CONN_DIRECTED_ADV)||
-                (scanReport->eventType == 	CYBLE_GAPC_SCAN_UNDIRECTED_ADV)||
-                (scanReport->eventType == 	CYBLE_GAPC_NON_CONN_UNDIRECTED_ADV))
-            {
-                memcpy(connectPeriphDevice[devIndex].bdAddr, scanReport->peerBdAddr,
-                sizeof(connectPeriphDevice[devIndex].bdAddr));
-                
-                printf ("\n\n");  
-                printf ("Found Device No: %d\r\n",devIndex);
-        		
-        	    printf("RSSI: %d \r\n",scanReport->rssi);
-                printf("peerBdAddr: %x%x%x%x%x%x \r\n",
-                scanReport->peerBdAddr[5u], 
-                scanReport->peerBdAddr[4u], 
-                scanReport->peerBdAddr[3u], 
-                scanReport->peerBdAddr[2u], 
-                scanReport->peerBdAddr[1u], 
-                scanReport->peerBdAddr[0u]);
-
-                printf("Peer device adveritsing data Length: %d \r\n", scanReport->dataLen);
-                devIndex++;
-            }
-            //receiving Scan response Packet
-            else if (scanReport->eventType == CYBLE_GAPC_SCAN_RSP)
-            {
-              printf ("Scan Response Data:  \r\n");
-              if(scanReport->dataLen!=0)
-              {
-                for(RepIndex = 0u; RepIndex < scanReport->dataLen; RepIndex++)
-                {
-                  printf("%x", scanReport->data[RepIndex]);
-                }
-                printf("\r\n");
-                printf ("\n");
-              }
-            }
-        }
-        else
-        {
-            printf ("Device Counts Exceeds 10 \r\n");
-        }
-    }
-		
-}
+CYBLE_GAP_BD_ADDR_T     connectPeriphDevice;
 
 /*******************************************************************************
 * Function Name: StackEventHandler
@@ -118,8 +49,6 @@ void Get_Adv_Scan_Packets(CYBLE_GAPC_ADV_REPORT_T* scanReport)
 *******************************************************************************/
 void StackEventHandler(uint32 event, void *eventParam)
 {
-	CYBLE_GAPC_ADV_REPORT_T advReport;
-
 	switch(event)
 	{
 		case CYBLE_EVT_STACK_ON:
@@ -138,12 +67,12 @@ void StackEventHandler(uint32 event, void *eventParam)
                 CyBle_GapcStartScan(CYBLE_SCANNING_SLOW);
                 GREEN_LED_ON();
              }
+			break;
 			
 		case CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT:
-                /*Get the information from advertisement and scan response packets*/
-             Get_Adv_Scan_Packets((CYBLE_GAPC_ADV_REPORT_T *)eventParam);
-             memcpy(&advReport, eventParam, sizeof(advReport)); 
-
+                /* Only queue the advertisement and scan response packets here, 
+                 * the main loop lists the devices (ScanProcess) */
+             ScanReport((CYBLE_GAPC_ADV_REPORT_T *)eventParam);
 		break;
 			
  		case CYBLE_EVT_GATT_CONNECT_IND:
@@ -153,7 +82,7 @@ void StackEventHandler(uint32 event, void *eventParam)
 			break;
 		
 		case CYBLE_EVT_GAP_DEVICE_CONNECTED:
-             devIndex = 0;
+             ScanInit();
 	         printf("Peripheral connected. Press 'D' for disconnection \r\n");
              BLUE_LED_ON();
              if(CYBLE_ERROR_OK != CyBle_GapcStartScan(CYBLE_SCANNING_FAST))
@@ -216,14 +145,21 @@ void Handle_ble_Central_Observer_State(void)
 	   {
          if(IsSelected)
 		  {
-			apiResult = CyBle_GapcConnectDevice(&connectPeriphDevice[Periph_Selected]);
-			if(CYBLE_ERROR_OK != apiResult )
-			{
-			   printf ("Connection Request to peripheral failed \r\n");
-			}
+            if(0u == ScanGetDevice(Periph_Selected, &connectPeriphDevice))
+            {
+               printf ("Device No %d is no longer listed \r\n", Periph_Selected);
+            }
             else
             {
-               printf ("Connection Request Sent to Peripheral \r\n");
+                apiResult = CyBle_GapcConnectDevice(&connectPeriphDevice);
+                if(CYBLE_ERROR_OK != apiResult )
+                {
+                   printf ("Connection Request to peripheral failed \r\n");
+                }
+                else
+                {
+                   printf ("Connection Request Sent to Peripheral \r\n");
+                }
             }
             IsSelected = 0;
 		  }
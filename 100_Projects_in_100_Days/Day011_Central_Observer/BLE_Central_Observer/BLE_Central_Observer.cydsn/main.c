@@ -49,24 +49,27 @@
 *Broadcasters and displays the information from the Advertisement and Scan 
 *response packets received. The user can initiate a connection with any of
 *the detected devices any time or disconnect an existing connection. The user 
-*enters the input via UART terminal. This example can handle upto 10 peripherals 
-*or broadcastres advetising at the same time.
+*enters the input via UART terminal. This example can handle upto 32 peripherals 
+*or broadcastres advetising at the same time. A device number is selected as 
+*soon as no further digit could make a valid number, else with Enter.
 ******************************************************************************/
 
 #include <project.h>
 #include "stdio.h"
 #include "BLE_Central_Observer.h"
 #include "main.h"
+#include "scan_pipeline.h"
 
 uint32  UartRxDataSim;  // Character Input Received from the UART Terminal for Initiating Connection / Disconnection
-uint8 devIndex;         // Index of the devices detected in Scanning
 uint8 Periph_Selected;  // The Index of the Peropheral which the user wants to connect the Central 
 uint8 IsSelected;       // Whether user has given Periph_Selected
-uint8 IsDetected;       // Whether any device has been detected in Scanning
 uint8 IsConnected;      // Whether the Central is in connected state or not.
 CYBLE_CONN_HANDLE_T			connHandle; // Handle of the device connected.
 CYBLE_API_RESULT_T 		    apiResult;
 
+static uint8 DeviceNumber;      // Device number typed so far
+static uint8 DeviceDigits;      // Whether a digit of the device number has been typed
+
 /*******************************************************************************
 * Function Name: BLE_Central_Observer_init
 ********************************************************************************
@@ -97,6 +100,47 @@ void BLE_Central_Observer_init(void)
 	
 }
 
+/*******************************************************************************
+* Function Name: Select_Device
+********************************************************************************
+*
+* Summary:
+*  Requests the connection to a listed device, after disconnecting the device
+*  connected, if any.
+*
+* Parameters:  
+*  index: number of the device in the list
+*
+* Return: 
+*  None
+
+********************************************************************************/
+
+static void Select_Device(uint8 index)
+{
+    Periph_Selected = index;
+    IsSelected = 1;
+    //Stop the scanning before connecting to the preferred peripheral
+    if(CyBle_GetState() != CYBLE_STATE_CONNECTING)
+    CyBle_GapcStopScan();
+    else
+        printf("Trying to connect to previous device.\r\n");
+    
+    if (IsConnected)
+    {
+      // Disconnect if another connection already exists
+        apiResult =    CyBle_GapDisconnect(connHandle.bdHandle); 
+        if(CYBLE_ERROR_OK != apiResult )
+	    {
+	       printf ("Error. Cannot Disconnect a previous Connection \r\n"); 
+        }
+        else
+        {
+            printf ("Disconnecting Previous Connection and Trying to connect to Device No %d \r\n",Periph_Selected);
+        }
+    } 
+}
+
 /*******************************************************************************
 * Function Name: main
 ********************************************************************************
@@ -118,7 +162,7 @@ int main()
     IsSelected = 0;
     Periph_Selected = 0;
     IsConnected = 0;
-    devIndex = 0;
+    ScanInit();
     
     /* Initialize the system */
 	BLE_Central_Observer_init();
@@ -131,6 +175,9 @@ int main()
 		//Checks the internal task queue in the BLE Stack
 	    CyBle_ProcessEvents();
         
+        //Lists the devices reported while scanning
+        ScanProcess();
+        
         if(UART_SpiUartGetRxBufferSize())
 		{
             UartRxDataSim = UART_UartGetChar();
@@ -140,42 +187,45 @@ int main()
                 printf ("Attempting Disconnection\r\n");
                 CyBle_GapDisconnect(connHandle.bdHandle);
                 IsConnected = 0;
-                devIndex= 0;
+                ScanInit();
+                DeviceDigits = 0;
+            }
+            
+            // Enter selects the device number typed so far
+            else if ((UartRxDataSim == '\r' || UartRxDataSim == '\n') && DeviceDigits)
+            {
+                DeviceDigits = 0;
+                Select_Device(DeviceNumber);
             }
             
             else
             {
-                // Check if a Valid Device index has been received
-                if ((UartRxDataSim - '0' < devIndex) && (IsDetected))  
+                // Check if the digit still makes a Valid Device index
+                if (((uint8)(UartRxDataSim - '0') < 10u) &&
+                    ((uint32)DeviceNumber * 10u + (UartRxDataSim - '0') < ScanDeviceCount()))  
                 {
-                    Periph_Selected = (uint8)(UartRxDataSim - '0');
-                    IsSelected = 1;
-                    //Stop the scanning before connecting to the preferred peripheral
-                    if(CyBle_GetState() != CYBLE_STATE_CONNECTING)
-                    CyBle_GapcStopScan();
-                    else
-                        printf("Trying to connect to previous device.\r\n");
+                    DeviceNumber = (uint8)(DeviceNumber * 10u + (UartRxDataSim - '0'));
+                    DeviceDigits = 1;
                     
-                    if (IsConnected)
+                    // Select at once when a further digit cannot give a valid index
+                    if ((uint32)DeviceNumber * 10u >= ScanDeviceCount())
                     {
-                      // Disconnect if another connection already exists
-                        apiResult =    CyBle_GapDisconnect(connHandle.bdHandle); 
-                        if(CYBLE_ERROR_OK != apiResult )
-    				    {
-    				       printf ("Error. Cannot Disconnect a previous Connection \r\n"); 
-                        }
-                        else
-                        {
-                            printf ("Disconnecting Previous Connection and Trying to connect to Device No %d \r\n",Periph_Selected);
-                        }
-                    } 
+                        DeviceDigits = 0;
+                        Select_Device(DeviceNumber);
+                    }
                 }
                 
-             else
+             else if (UartRxDataSim != '\r' && UartRxDataSim != '\n')
                 {
                     printf ("Invalid Input \r\n");
+                    DeviceDigits = 0;
                 }
             }
+            
+            if (!DeviceDigits)
+            {
+                DeviceNumber = 0;
+            }
 		}
         //Function to handle connection and disconnecton
 		Handle_ble_Central_Observer_State();
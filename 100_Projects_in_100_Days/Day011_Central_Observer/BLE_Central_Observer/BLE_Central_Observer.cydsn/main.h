@@ -15,11 +15,9 @@
 #include "LED.h"	
     
 extern uint8 Periph_Selected;
-extern uint8 devIndex;
 	
 extern uint32  UartRxDataSim;
 extern uint8 IsSelected;
-extern uint8 IsDetected;
 extern uint8 IsConnected;
 extern CYBLE_CONN_HANDLE_T connHandle;
     
@@ -0,0 +1,325 @@
+/******************************************************************************
+* Project Name		: BLE_Central_Observer
+* File Name			: scan_pipeline.c
+* Version 			: 1.0
+* Device Used		: CY8C4247LQI-BL483
+* Software Used		: PSoC Creator 3.1 CP1
+* Compiler    		: ARM GCC 4.8.4, ARM RVDS Generic, ARM MDK Generic
+* Owner				: MADY
+********************************************************************************/
+/******************************************************************************
+*In this file the advertising and scan response reports are collected. The
+*stack callback only copies each report into a ring. The main loop merges the
+*reports of an address into the device table and displays a device when it is
+*first heard and its scan response data when it is first received, so the
+*device numbers stay the same while scanning goes on.
+******************************************************************************/
+
+#include <string.h>
+#include "scan_pipeline.h"
+#include "debug.h"
+
+/* Report ring, the producer only writes ringHead and the consumer ringTail */
+static SCAN_RECORD_T ring[SCAN_RING_SIZE];
+static volatile uint8 ringHead = 0u;
+static volatile uint8 ringTail = 0u;
+static uint16 ringDropped = 0u;
+
+/* Device table and its open addressing hash, holds the index + 1, 0 for a free slot */
+static SCAN_DEVICE_T devices[SCAN_DEVICE_TABLE_SIZE];
+static uint8 deviceCount = 0u;
+static uint8 hashTable[SCAN_HASH_SIZE];
+
+/* Set once the table is full, so the user is told only once */
+static uint8 tableFull = 0u;
+
+/*******************************************************************************
+* Function Name: AddressHash
+********************************************************************************
+*
+* Summary:
+* Hashes a Bluetooth device address and its type into the hash table.
+*
+* Parameters:
+* bdAddr - the device address
+* addrType - public or random address
+*
+* Return:
+* The first slot to be probed
+*
+*******************************************************************************/
+static uint8 AddressHash(const uint8 *bdAddr, uint8 addrType)
+{
+    uint8 hash = addrType;
+    uint8 i;
+
+    for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
+    {
+        hash = (uint8)((hash * 31u) + bdAddr[i]);
+    }
+
+    return (uint8)((hash ^ (hash >> 4u)) & (SCAN_HASH_SIZE - 1u));
+}
+
+/*******************************************************************************
+* Function Name: FindDevice
+********************************************************************************
+*
+* Summary:
+* Looks up the device of a report and adds it when it is not yet known.
+*
+* Parameters:
+* record - a report of the device
+* isNew - set to 1 if the device was added
+*
+* Return:
+* The index of the device, SCAN_DEVICE_TABLE_SIZE when the table is full
+*
+*******************************************************************************/
+static uint8 FindDevice(const SCAN_RECORD_T *record, uint8 *isNew)
+{
+    SCAN_DEVICE_T *device;
+    uint8 slot = AddressHash(record->bdAddr, record->addrType);
+
+    *isNew = 0u;
+
+    while(hashTable[slot] != 0u)
+    {
+        device = &devices[hashTable[slot] - 1u];
+        if((device->addrType == record->addrType) &&
+           (memcmp(device->bdAddr, record->bdAddr, CYBLE_GAP_BD_ADDR_SIZE) == 0))
+        {
+            return (uint8)(hashTable[slot] - 1u);
+        }
+        slot = (slot + 1u) & (SCAN_HASH_SIZE - 1u);
+    }
+
+    if(deviceCount >= SCAN_DEVICE_TABLE_SIZE)
+    {
+        return SCAN_DEVICE_TABLE_SIZE;
+    }
+
+    /* The hash has more than twice the slots of the table, so a free slot was found */
+    device = &devices[deviceCount];
+    memcpy(device->bdAddr, record->bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    device->addrType = record->addrType;
+    device->flags = 0u;
+    deviceCount++;
+    hashTable[slot] = deviceCount;
+    *isNew = 1u;
+
+    return (uint8)(deviceCount - 1u);
+}
+
+/*******************************************************************************
+* Function Name: MergeReport
+********************************************************************************
+*
+* Summary:
+* Merges a report into the entry of its device. A new device is displayed
+* with its number, the scan response data is displayed the first time it is
+* received from a listed device.
+*
+* Parameters:
+* record - the report
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+static void MergeReport(const SCAN_RECORD_T *record)
+{
+    SCAN_DEVICE_T *device;
+    uint8 index;
+    uint8 isNew;
+    uint8 i;
+
+    index = FindDevice(record, &isNew);
+    if(index >= SCAN_DEVICE_TABLE_SIZE)
+    {
+        if(tableFull == 0u)
+        {
+            printf ("Device Counts Exceeds %d, further devices are not listed \r\n", SCAN_DEVICE_TABLE_SIZE);
+            tableFull = 1u;
+        }
+        return;
+    }
+    device = &devices[index];
+
+    if(isNew != 0u)
+    {
+        printf ("\n\n");
+        printf ("Found Device No: %d\r\n", index);
+        printf("RSSI: %d \r\n", record->rssi);
+        printf("peerBdAddr: %2.2x%2.2x%2.2x%2.2x%2.2x%2.2x \r\n",
+            record->bdAddr[5u], record->bdAddr[4u],
+            record->bdAddr[3u], record->bdAddr[2u],
+            record->bdAddr[1u], record->bdAddr[0u]);
+    }
+
+    if(record->eventType == CYBLE_GAPC_SCAN_RSP)
+    {
+        if((device->flags & SCAN_DEVICE_RSP_SEEN) == 0u)
+        {
+            printf ("Scan Response Data of Device No %d: ", index);
+            for(i = 0u; i < record->dataLen; i++)
+            {
+                printf("%2.2x", record->data[i]);
+            }
+            printf("\r\n");
+        }
+        device->flags |= SCAN_DEVICE_RSP_SEEN;
+    }
+    else
+    {
+        if((device->flags & SCAN_DEVICE_ADV_SEEN) == 0u)
+        {
+            printf("Peer device adveritsing data Length: %d \r\n", record->dataLen);
+        }
+        device->flags |= SCAN_DEVICE_ADV_SEEN;
+    }
+}
+
+/*******************************************************************************
+* Function Name: ScanInit
+********************************************************************************
+*
+* Summary:
+* Empties the ring and the device table, the device numbers start over.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+void ScanInit(void)
+{
+    ringHead = 0u;
+    ringTail = 0u;
+    ringDropped = 0u;
+    deviceCount = 0u;
+    memset(hashTable, 0, sizeof(hashTable));
+    tableFull = 0u;
+}
+
+/*******************************************************************************
+* Function Name: ScanReport
+********************************************************************************
+*
+* Summary:
+* Copies a report of the CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT event into the
+* ring. Nothing is displayed here, so the stack callback does not wait for the
+* UART. The report is dropped and counted when the ring is full.
+*
+* Parameters:
+* report - Advertisement report received by the Central
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+void ScanReport(const CYBLE_GAPC_ADV_REPORT_T *report)
+{
+    SCAN_RECORD_T *record;
+    uint8 head = ringHead;
+
+    if((uint8)(head - ringTail) >= SCAN_RING_SIZE)
+    {
+        ringDropped++;
+        return;
+    }
+
+    record = &ring[head & (SCAN_RING_SIZE - 1u)];
+    record->eventType = report->eventType;
+    record->addrType = report->peerAddrType;
+    memcpy(record->bdAddr, report->peerBdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    record->rssi = report->rssi;
+    record->dataLen = (report->dataLen > CYBLE_GAP_MAX_ADV_DATA_LEN) ? CYBLE_GAP_MAX_ADV_DATA_LEN : report->dataLen;
+    memcpy(record->data, report->data, record->dataLen);
+
+    ringHead = head + 1u;
+}
+
+/*******************************************************************************
+* Function Name: ScanProcess
+********************************************************************************
+*
+* Summary:
+* Merges the queued reports into the device table. Called from the main loop,
+* at most SCAN_REPORTS_PER_CALL reports per call so that the user input and
+* the BLE events are still handled between them.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+void ScanProcess(void)
+{
+    uint8 count;
+
+    for(count = 0u; (count < SCAN_REPORTS_PER_CALL) && (ringTail != ringHead); count++)
+    {
+        MergeReport(&ring[ringTail & (SCAN_RING_SIZE - 1u)]);
+        ringTail++;
+    }
+
+    if(ringDropped != 0u)
+    {
+        printf ("%d reports lost \r\n", ringDropped);
+        ringDropped = 0u;
+    }
+}
+
+/*******************************************************************************
+* Function Name: ScanDeviceCount
+********************************************************************************
+*
+* Summary:
+* Returns the number of devices listed.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  Number of devices, device numbers are 0 to the count - 1
+*
+*******************************************************************************/
+uint8 ScanDeviceCount(void)
+{
+    return deviceCount;
+}
+
+/*******************************************************************************
+* Function Name: ScanGetDevice
+********************************************************************************
+*
+* Summary:
+* Gets the address of a listed device, to connect to it.
+*
+* Parameters:
+* index - the device number
+* device - receives the address and its type
+*
+* Return:
+*  1 if the device is listed, 0 otherwise
+*
+*******************************************************************************/
+uint8 ScanGetDevice(uint8 index, CYBLE_GAP_BD_ADDR_T *device)
+{
+    if(index >= deviceCount)
+    {
+        return 0u;
+    }
+
+    memcpy(device->bdAddr, devices[index].bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    device->type = devices[index].addrType;
+
+    return 1u;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,64 @@
+/******************************************************************************
+* Project Name		: BLE_Central_Observer
+* File Name			: scan_pipeline.h
+* Version 			: 1.0
+* Device Used		: CY8C4247LQI-BL483
+* Software Used		: PSoC Creator 3.1 CP1
+* Compiler    		: ARM GCC 4.8.4, ARM RVDS Generic, ARM MDK Generic
+* Owner				: MADY
+********************************************************************************/
+/******************************************************************************
+*Constants and function prototypes of the scan pipeline. The stack callback
+*only queues the advertising and scan response reports, the main loop merges
+*the reports of an address into the device table and lists each device once.
+******************************************************************************/
+#ifndef _SCAN_PIPELINE_H_
+#define _SCAN_PIPELINE_H_
+
+#include "project.h"
+
+/* Reports buffered between the stack callback and the main loop, power of two */
+#define SCAN_RING_SIZE                      (16u)
+
+/* Devices listed for connection, selected by their decimal number */
+#define SCAN_DEVICE_TABLE_SIZE              (32u)
+
+/* Address hash table, a power of two of at least twice the devices */
+#define SCAN_HASH_SIZE                      (64u)
+
+/* Reports handled per call of ScanProcess() */
+#define SCAN_REPORTS_PER_CALL               (4u)
+
+/* Flags of a device table entry */
+#define SCAN_DEVICE_ADV_SEEN                (0x01u)
+#define SCAN_DEVICE_RSP_SEEN                (0x02u)
+
+/* One advertising or scan response report, as copied from the stack event */
+typedef struct
+{
+    uint8  eventType;
+    uint8  addrType;
+    uint8  bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    int8   rssi;
+    uint8  dataLen;
+    uint8  data[CYBLE_GAP_MAX_ADV_DATA_LEN];
+} SCAN_RECORD_T;
+
+/* A device heard since the list was started */
+typedef struct
+{
+    uint8  bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    uint8  addrType;
+    uint8  flags;
+} SCAN_DEVICE_T;
+
+void ScanInit(void);
+void ScanReport(const CYBLE_GAPC_ADV_REPORT_T *report);
+void ScanProcess(void);
+uint8 ScanDeviceCount(void);
+uint8 ScanGetDevice(uint8 index, CYBLE_GAP_BD_ADDR_T *device);
+
+#endif
+
+
+/* [] END OF FILE */
@@ -24,6 +24,7 @@ const uint8 enableNotificationParam[2] = {0x01, 0x00};
 
 volatile static bool peerDeviceFound         = false;
 volatile static bool notificationEnabled     = false;
+static bool          handlesFromCache        = false;   /* Handles taken from the GATT cache, not discovered */
 
 static CYBLE_GAP_BD_ADDR_T      peerAddr;           /* BD address of the peer device */
 static INFO_EXCHANGE_STATE_T    infoExchangeState   = INFO_EXCHANGE_START;
@@ -135,6 +136,9 @@ void HandleBleProcessing(void)
         default:
             break;       
     }
+    
+    /* write the discovered handles to flash once the stack allows it */
+    GattCacheProcess();
 }
 
 
@@ -159,6 +163,8 @@ void AppCallBack(uint32 event, void *eventParam)
     CYBLE_GAPC_ADV_REPORT_T		            *advReport;
     CYBLE_GATTC_FIND_BY_TYPE_RSP_PARAM_T    *findResponse;
     CYBLE_GATTC_FIND_INFO_RSP_PARAM_T       *findInfoResponse;
+    CYBLE_GATTC_ERR_RSP_PARAM_T             *errorResponse;
+    GATT_CACHE_HANDLES_T                    discoveredHandles;
     
     switch (event)
     {
@@ -193,6 +199,7 @@ void AppCallBack(uint32 event, void *eventParam)
             /* RESET all flags */
             peerDeviceFound         = false;
             notificationEnabled     = false;
+            handlesFromCache        = false;
             infoExchangeState       = INFO_EXCHANGE_START;
             
             #ifdef PRINT_MESSAGE_LOG   
@@ -205,6 +212,7 @@ void AppCallBack(uint32 event, void *eventParam)
             UART_SpiUartClearTxBuffer();
             UART_SpiUartClearRxBuffer();
             UART_Start();
+            ClearUartTxPacket();
             
             break;
         
@@ -241,6 +249,15 @@ void AppCallBack(uint32 event, void *eventParam)
                 txCharDescHandle |= findInfoResponse->handleValueList.list[1] << 8;
             
                 infoExchangeState |= TX_CCCD_HANDLE_FOUND;
+                
+                /* discovery complete, remember the handles for the next connection to this peer */
+                discoveredHandles.serviceHandle     = bleUartServiceHandle;
+                discoveredHandles.serviceEndHandle  = bleUartServiceEndHandle;
+                discoveredHandles.txCharHandle      = txCharHandle;
+                discoveredHandles.rxCharHandle      = rxCharHandle;
+                discoveredHandles.txCharDescHandle  = txCharDescHandle;
+                
+                GattCacheStore(&peerAddr, &discoveredHandles);
             }
            
             break;
@@ -292,6 +309,26 @@ void AppCallBack(uint32 event, void *eventParam)
             
             break;    
         
+        case CYBLE_EVT_GATTC_ERROR_RSP:
+            
+            errorResponse = (CYBLE_GATTC_ERR_RSP_PARAM_T *) eventParam;
+            
+            /* the server rejected a cached handle: its database changed, so drop the
+             * entry and reconnect, the MTU exchange is allowed only once per connection */
+            if(handlesFromCache && (txCharDescHandle == errorResponse->attrHandle))
+            {
+                GattCacheRemove(&peerAddr);
+                handlesFromCache = false;
+                
+                #ifdef PRINT_MESSAGE_LOG   
+                    UART_UartPutString("\n\rCached handles stale, reconnecting");
+                #endif
+                
+                CyBle_GapDisconnect(cyBle_connHandle.bdHandle);
+            }
+            
+            break;
+        
         case CYBLE_EVT_GATTC_WRITE_RSP:
             
             notificationEnabled = true;
@@ -334,10 +371,31 @@ void AppCallBack(uint32 event, void *eventParam)
 *******************************************************************************/
 void attrHandleInit()
 {
+    GATT_CACHE_HANDLES_T cachedHandles;
+    
     switch(infoExchangeState)
     {
         case INFO_EXCHANGE_START:        
-            CyBle_GattcDiscoverPrimaryServiceByUuid(cyBle_connHandle, bleUartServiceUuidInfo);
+            /* a known peer needs no discovery, only the MTU exchange */
+            if(GattCacheLookup(&peerAddr, &cachedHandles))
+            {
+                bleUartServiceHandle    = cachedHandles.serviceHandle;
+                bleUartServiceEndHandle = cachedHandles.serviceEndHandle;
+                txCharHandle            = cachedHandles.txCharHandle;
+                rxCharHandle            = cachedHandles.rxCharHandle;
+                txCharDescHandle        = cachedHandles.txCharDescHandle;
+                
+                handlesFromCache        = true;
+                infoExchangeState       = ALL_HANDLES_FOUND;
+                
+                #ifdef PRINT_MESSAGE_LOG   
+                    UART_UartPutString("\n\rAttribute handles restored from cache");
+                #endif
+            }
+            else
+            {
+                CyBle_GattcDiscoverPrimaryServiceByUuid(cyBle_connHandle, bleUartServiceUuidInfo);
+            }
             break;
         
         case BLE_UART_SERVICE_HANDLE_FOUND:
@@ -18,6 +18,7 @@
     
     #include <project.h>
     #include "app_UART.h"
+    #include "app_GattCache.h"
     #include "stdbool.h"
     
     /***************************************
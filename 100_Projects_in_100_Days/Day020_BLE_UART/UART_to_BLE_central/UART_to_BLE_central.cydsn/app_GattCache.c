@@ -0,0 +1,271 @@
+/*******************************************************************************
+* File Name: app_GattCache.c
+*
+* Description:
+*  Flash backed cache of the attribute handles discovered on each peer, so
+*  that a reconnection can skip the service discovery.
+*
+*******************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include "app_GattCache.h"
+
+/* Flash copy of the cache, written with the same API as the bonding data */
+CY_ALIGN(CY_FLASH_SIZEOF_ROW)
+static const GATT_CACHE_ENTRY_T gattCacheFlash[GATT_CACHE_ENTRIES] = {{{0u}}};
+
+/* RAM copy of the cache, used for all lookups */
+static GATT_CACHE_ENTRY_T       gattCache[GATT_CACHE_ENTRIES];
+static bool                     gattCacheDirty = false;
+
+
+/*******************************************************************************
+* Function Name: GattCacheCrc
+********************************************************************************
+*
+* Summary:
+*  Calculates the CRC-16/CCITT of a cache entry.
+*
+* Parameters:
+*  entry - the cache entry
+*
+* Return:
+*  CRC over all fields but the CRC itself.
+*
+*******************************************************************************/
+static uint16 GattCacheCrc(const GATT_CACHE_ENTRY_T *entry)
+{
+    const uint8 *data = (const uint8 *)entry;
+    uint16      crc   = GATT_CACHE_CRC_INIT;
+    uint8       len;
+    uint8       bit;
+
+    for(len = 0; len < offsetof(GATT_CACHE_ENTRY_T, crc); len++)
+    {
+        crc ^= (uint16)data[len] << 8;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (0u != (crc & 0x8000u)) ? (uint16)((crc << 1) ^ GATT_CACHE_CRC_POLY) : (uint16)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+
+/*******************************************************************************
+* Function Name: GattCacheFind
+********************************************************************************
+*
+* Summary:
+*  Finds the valid cache entry of a peer.
+*
+* Parameters:
+*  peer - BD address of the peer device
+*
+* Return:
+*  The entry, or NULL if the peer is not in the cache.
+*
+*******************************************************************************/
+static GATT_CACHE_ENTRY_T *GattCacheFind(const CYBLE_GAP_BD_ADDR_T *peer)
+{
+    uint8 index;
+
+    for(index = 0; index < GATT_CACHE_ENTRIES; index++)
+    {
+        if((gattCache[index].crc == GattCacheCrc(&gattCache[index])) && \
+                (gattCache[index].type == peer->type) && \
+                (0 == memcmp(gattCache[index].bdAddr, peer->bdAddr, CYBLE_GAP_BD_ADDR_SIZE)))
+        {
+            return &gattCache[index];
+        }
+    }
+
+    return NULL;
+}
+
+
+/*******************************************************************************
+* Function Name: GattCacheInit
+********************************************************************************
+*
+* Summary:
+*  Loads the cache from flash. Entries with a wrong CRC, such as those of
+*  the erased flash row, are never matched.
+*
+* Parameters:
+*  None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void GattCacheInit(void)
+{
+    /* Read through a volatile pointer, the flash content is not the initializer */
+    const volatile uint8    *flash  = (const volatile uint8 *)gattCacheFlash;
+    uint8                   *ram    = (uint8 *)gattCache;
+    uint16                  index;
+
+    for(index = 0; index < sizeof(gattCache); index++)
+    {
+        ram[index] = flash[index];
+    }
+
+    gattCacheDirty = false;
+}
+
+
+/*******************************************************************************
+* Function Name: GattCacheLookup
+********************************************************************************
+*
+* Summary:
+*  Returns the cached attribute handles of a peer.
+*
+* Parameters:
+*  peer     - BD address of the peer device
+*  handles  - receives the handles
+*
+* Return:
+*  true if the peer is in the cache.
+*
+*******************************************************************************/
+bool GattCacheLookup(const CYBLE_GAP_BD_ADDR_T *peer, GATT_CACHE_HANDLES_T *handles)
+{
+    GATT_CACHE_ENTRY_T *entry = GattCacheFind(peer);
+
+    if(NULL == entry)
+    {
+        return false;
+    }
+
+    *handles = entry->handles;
+
+    return true;
+}
+
+
+/*******************************************************************************
+* Function Name: GattCacheStore
+********************************************************************************
+*
+* Summary:
+*  Adds or updates the handles of a peer. The least recently stored entry is
+*  replaced when the cache is full. The flash is written by GattCacheProcess().
+*
+* Parameters:
+*  peer     - BD address of the peer device
+*  handles  - the discovered handles
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void GattCacheStore(const CYBLE_GAP_BD_ADDR_T *peer, const GATT_CACHE_HANDLES_T *handles)
+{
+    GATT_CACHE_ENTRY_T  *entry = GattCacheFind(peer);
+    uint8               index;
+
+    if(NULL == entry)
+    {
+        entry = &gattCache[0];
+        for(index = 0; index < GATT_CACHE_ENTRIES; index++)
+        {
+            if(gattCache[index].crc != GattCacheCrc(&gattCache[index]))
+            {
+                entry = &gattCache[index];
+                break;
+            }
+            if(gattCache[index].age > entry->age)
+            {
+                entry = &gattCache[index];
+            }
+        }
+    }
+
+    /* Age all other valid entries */
+    for(index = 0; index < GATT_CACHE_ENTRIES; index++)
+    {
+        if((&gattCache[index] != entry) && (gattCache[index].crc == GattCacheCrc(&gattCache[index])) && \
+                (gattCache[index].age < 0xFF))
+        {
+            gattCache[index].age++;
+            gattCache[index].crc = GattCacheCrc(&gattCache[index]);
+        }
+    }
+
+    memcpy(entry->bdAddr, peer->bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    entry->type     = peer->type;
+    entry->age      = 0;
+    entry->handles  = *handles;
+    entry->crc      = GattCacheCrc(entry);
+
+    gattCacheDirty  = true;
+}
+
+
+/*******************************************************************************
+* Function Name: GattCacheRemove
+********************************************************************************
+*
+* Summary:
+*  Removes a peer whose cached handles turned out to be stale.
+*
+* Parameters:
+*  peer - BD address of the peer device
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void GattCacheRemove(const CYBLE_GAP_BD_ADDR_T *peer)
+{
+    GATT_CACHE_ENTRY_T *entry = GattCacheFind(peer);
+
+    if(NULL != entry)
+    {
+        entry->crc      = (uint16)~GattCacheCrc(entry);
+        gattCacheDirty  = true;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: GattCacheProcess
+********************************************************************************
+*
+* Summary:
+*  Writes the changed cache to flash once the BLE stack allows it.
+*
+* Parameters:
+*  None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void GattCacheProcess(void)
+{
+    CYBLE_API_RESULT_T cyble_api_result;
+
+    if(gattCacheDirty)
+    {
+        /* Not forced: the write is refused while the radio is active and retried on the next call */
+        cyble_api_result = CyBle_StoreAppData((uint8 *)gattCache, (const uint8 *)gattCacheFlash, \
+                                                sizeof(gattCache), 0u);
+
+        if(CYBLE_ERROR_FLASH_WRITE_NOT_PERMITED != cyble_api_result)
+        {
+            gattCacheDirty = false;
+        }
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,64 @@
+/*******************************************************************************
+* File Name: app_GattCache.h
+*
+* Description:
+*  Contains the function prototypes and constants available to the example
+*  project.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#if !defined(APP_GATT_CACHE_H)
+
+    #define APP_GATT_CACHE_H
+
+    #include <project.h>
+    #include "stdbool.h"
+
+    /***************************************
+    *       Constants
+    ***************************************/
+    /* Number of peers remembered, all entries share one flash row */
+    #define GATT_CACHE_ENTRIES          6
+    #define GATT_CACHE_CRC_INIT         0xFFFF
+    #define GATT_CACHE_CRC_POLY         0x1021
+
+    /***************************************
+    *   Enumerated Types and Structs
+    ***************************************/
+    /* Attribute handles of the BLE UART service on one peer */
+    typedef struct
+    {
+        uint16  serviceHandle;
+        uint16  serviceEndHandle;
+        uint16  txCharHandle;
+        uint16  rxCharHandle;
+        uint16  txCharDescHandle;
+    } GATT_CACHE_HANDLES_T;
+
+    /* One cache entry as stored in flash, CRC over all other fields */
+    typedef struct
+    {
+        uint8                   bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+        uint8                   type;
+        uint8                   age;
+        GATT_CACHE_HANDLES_T    handles;
+        uint16                  crc;
+    } GATT_CACHE_ENTRY_T;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void GattCacheInit(void);
+    bool GattCacheLookup(const CYBLE_GAP_BD_ADDR_T *peer, GATT_CACHE_HANDLES_T *handles);
+    void GattCacheStore(const CYBLE_GAP_BD_ADDR_T *peer, const GATT_CACHE_HANDLES_T *handles);
+    void GattCacheRemove(const CYBLE_GAP_BD_ADDR_T *peer);
+    void GattCacheProcess(void);
+
+#endif
+
+/* [] END OF FILE */
@@ -13,6 +13,13 @@
 
 #include "app_UART.h"
 
+/* Packet taken out of the UART RX buffer but not yet accepted by the BLE 
+*  stack. Sized for the largest MTU the stack can negotiate. */
+static uint8    uartTxData[CYBLE_GATT_MTU - 3];
+static uint16   uartTxDataLength = 0;
+
+static uint16 UartGetTxPacket(void);
+
 /*******************************************************************************
 * Function Name: HandleUartRxTraffic
 ********************************************************************************
@@ -45,7 +52,9 @@ void HandleUartRxTraffic(CYBLE_GATTC_HANDLE_VALUE_NTF_PARAM_T *uartRxDataNotific
 *
 * Summary:
 *  This function takes data from UART RX buffer and pushes it to the server 
-*  as Write Without Response command.
+*  as Write Without Response commands. Up to UART_TX_PACKETS_PER_CALL packets 
+*  are queued in the stack per call. A packet the stack cannot take is kept 
+*  and retried on the next call instead of waiting for the stack here.
 *
 * Parameters:
 *  None.
@@ -56,19 +65,13 @@ void HandleUartRxTraffic(CYBLE_GATTC_HANDLE_VALUE_NTF_PARAM_T *uartRxDataNotific
 *******************************************************************************/
 void HandleUartTxTraffic(void)
 {
-    uint8   index;
-    uint8   uartTxData[mtuSize - 3];
-    uint16  uartTxDataLength;
-    
-    static uint16 uartIdleCount = UART_IDLE_TIMEOUT;
+    uint8   packetCount;
     
     CYBLE_API_RESULT_T              bleApiResult;
     CYBLE_GATTC_WRITE_CMD_REQ_T     uartTxDataWriteCmd;
     
-    uartTxDataLength = UART_SpiUartGetRxBufferSize();
-    
     #ifdef FLOW_CONTROL
-        if(uartTxDataLength >= (UART_UART_RX_BUFFER_SIZE - (UART_UART_RX_BUFFER_SIZE/2)))
+        if(UART_SpiUartGetRxBufferSize() >= (UART_UART_RX_BUFFER_SIZE - (UART_UART_RX_BUFFER_SIZE/2)))
         {
             DisableUartRxInt();
         }
@@ -78,53 +81,119 @@ void HandleUartTxTraffic(void)
         }
     #endif
     
-    if((uartTxDataLength != 0))
+    for(packetCount = 0; packetCount < UART_TX_PACKETS_PER_CALL; packetCount++)
     {
-        if(uartTxDataLength >= (mtuSize - 3))
+        if(0 == uartTxDataLength)
         {
-            uartIdleCount       = UART_IDLE_TIMEOUT;
-            uartTxDataLength    = mtuSize - 3;
-        }
-        else
-        {
-            if(--uartIdleCount == 0)
-            {
-                /*uartTxDataLength remains unchanged */;
-            }
-            else
+            uartTxDataLength = UartGetTxPacket();
+            
+            if(0 == uartTxDataLength)
             {
-                uartTxDataLength = 0;
+                break;
             }
         }
         
-        if(0 != uartTxDataLength)
+        uartTxDataWriteCmd.attrHandle = rxCharHandle;
+        uartTxDataWriteCmd.value.len  = uartTxDataLength;
+        uartTxDataWriteCmd.value.val  = uartTxData;
+        
+        bleApiResult = CyBle_GattcWriteWithoutResponse(cyBle_connHandle, &uartTxDataWriteCmd);
+        
+        if((CYBLE_ERROR_MEMORY_ALLOCATION_FAILED == bleApiResult) || \
+                (CYBLE_ERROR_INSUFFICIENT_RESOURCES == bleApiResult))
         {
-            uartIdleCount       = UART_IDLE_TIMEOUT;
-            
-            for(index = 0; index < uartTxDataLength; index++)
-            {
-                uartTxData[index] = (uint8) UART_UartGetByte();
-            }
-            
-            uartTxDataWriteCmd.attrHandle = rxCharHandle;
-            uartTxDataWriteCmd.value.len  = uartTxDataLength;
-            uartTxDataWriteCmd.value.val  = uartTxData;           
-            
-            #ifdef FLOW_CONTROL
-                DisableUartRxInt();
-            #endif
-            
-            do
-            {
-                bleApiResult = CyBle_GattcWriteWithoutResponse(cyBle_connHandle, &uartTxDataWriteCmd);
-                CyBle_ProcessEvents();
-            }
-            while((CYBLE_ERROR_OK != bleApiResult) && (CYBLE_STATE_CONNECTED == cyBle_state));
-            
+            /* stack buffers are full, keep the packet for the next call */
+            break;
+        }
+        else if(CYBLE_ERROR_OK != bleApiResult)
+        {
+            /* the packet can never be sent, drop it */
+            uartTxDataLength = 0;
+            break;
+        }
+        
+        uartTxDataLength = 0;
+        
+        if(CyBle_GattGetBusStatus() == CYBLE_STACK_STATE_BUSY)
+        {
+            break;
         }
     }
 }
 
+/*******************************************************************************
+* Function Name: UartGetTxPacket
+********************************************************************************
+*
+* Summary:
+*  This function moves the next packet from the UART RX buffer to uartTxData. 
+*  A full packet (MTU - 3 bytes) is taken as soon as it is available, a 
+*  shorter one only after UART RX has been idle for UART_IDLE_TIMEOUT calls.
+*
+* Parameters:
+*  None.
+*
+* Return:
+*  uint16 - number of bytes moved, 0 if no packet is ready yet.
+*
+*******************************************************************************/
+static uint16 UartGetTxPacket(void)
+{
+    uint16  index;
+    uint16  packetLength;
+    
+    static uint16 uartIdleCount = UART_IDLE_TIMEOUT;
+    
+    packetLength = (uint16) UART_SpiUartGetRxBufferSize();
+    
+    if(0 == packetLength)
+    {
+        return 0;
+    }
+    
+    if(packetLength >= (mtuSize - 3))
+    {
+        packetLength = mtuSize - 3;
+    }
+    else if(--uartIdleCount != 0)
+    {
+        return 0;
+    }
+    else
+    {
+        /* packetLength remains unchanged */;
+    }
+    
+    uartIdleCount = UART_IDLE_TIMEOUT;
+    
+    for(index = 0; index < packetLength; index++)
+    {
+        uartTxData[index] = (uint8) UART_SpiUartReadRxData();
+    }
+    
+    return packetLength;
+}
+
+/*******************************************************************************
+* Function Name: ClearUartTxPacket
+********************************************************************************
+*
+* Summary:
+*  This function drops the packet kept for the BLE stack. Called on 
+*  disconnection, the packet may not fit the MTU of the next connection.
+*
+* Parameters:
+*  None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void ClearUartTxPacket(void)
+{
+    uartTxDataLength = 0;
+}
+
 /*****************************************************************************************
 * Function Name: DisableUartRxInt
 ******************************************************************************************
@@ -26,6 +26,11 @@
     #define UART_IDLE_TIMEOUT           1000
     #define UART_RX_INTR_MASK     0x00000004
     
+    /* Maximum number of packets handed to the BLE stack per call of 
+    *  HandleUartTxTraffic(). The stack queues them for the next connection 
+    *  event(s) and rejects the extra ones when its buffers are full. */
+    #define UART_TX_PACKETS_PER_CALL    4
+    
     /***************************************
     *       External data references
     ***************************************/
@@ -40,6 +45,7 @@
     void HandleUartRxTraffic(CYBLE_GATTC_HANDLE_VALUE_NTF_PARAM_T *);
     void DisableUartRxInt(void);
     void EnableUartRxInt(void);
+    void ClearUartTxPacket(void);
     
 #endif
 /* [] END OF FILE */
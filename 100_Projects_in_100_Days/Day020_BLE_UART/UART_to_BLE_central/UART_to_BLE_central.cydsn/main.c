@@ -74,6 +74,9 @@ int main()
     
     CyBle_ProcessEvents();
     
+    /* load the attribute handles of known peers */
+    GattCacheInit();
+    
     /***************************************************************************
     * Main polling loop
     ***************************************************************************/
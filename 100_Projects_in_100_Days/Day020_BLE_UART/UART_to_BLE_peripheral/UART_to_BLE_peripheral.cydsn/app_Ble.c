@@ -111,6 +111,7 @@ void AppCallBack(uint32 event, void *eventParam)
             UART_SpiUartClearTxBuffer();
             UART_SpiUartClearRxBuffer();
             UART_Start();
+            ClearUartTxPacket();
             break;
             
         case CYBLE_EVT_GATT_CONNECT_IND:
@@ -68,7 +68,6 @@ typedef struct
 /*******************************************************************************
 * Variables
 *******************************************************************************/
-uint32 totalByteCounter = 0;
 bool charNotificationEnabled = false;
 uint8 userStoppedScan = 0;
 PERIPHERAL_LIST peripherals;
@@ -224,6 +223,7 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
             
         case CYBLE_EVT_GAP_DEVICE_CONNECTED:
             UART_UartPutString("\n\rConnected. ");
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
             /* Once the devices are connected, the Client will not do a service
              * discovery and will assume that the handles of the Server are 
              * known. This is because discovery of custom service is not a part
@@ -247,7 +247,7 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
         case CYBLE_EVT_GAP_DEVICE_DISCONNECTED:
             /* Device disconnected; restart scan */
             charNotificationEnabled = false;
-            totalByteCounter = 0;
+            Throughput_Stop();
             UART_UartPutString("\n\n\rDisconnected. ");
             UART_UartPutString("Scanning again.");
             StartScan();
@@ -261,6 +261,7 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
              */
             charNotificationEnabled = true;
             UART_UartPutString("\n\rCalculating throughput. Please wait... ");
+            Throughput_Start();
             Timer_Enable();
             break;
             
@@ -269,11 +270,24 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
             handleValueNotification = (CYBLE_GATTC_HANDLE_VALUE_NTF_PARAM_T *)eventParam;
             if(handleValueNotification->handleValPair.attrHandle == 0x000E)
             {
-                totalByteCounter += handleValueNotification->handleValPair.value.len;
+                Throughput_AddPacket(handleValueNotification->handleValPair.value.len);
             }
             break;
             
             
+        case CYBLE_EVT_L2CAP_CONN_PARAM_UPDATE_REQ:
+            /* The sender asks for the connection interval it is configured 
+             * for; accept it.
+             */
+            CyBle_L2capLeConnectionParamUpdateResponse(cyBle_connHandle.bdHandle, 0u);
+            break;
+            
+            
+        case CYBLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
+            break;
+            
+            
         default:
             break;
     }
@@ -293,12 +307,9 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 * None
 *
 * Theory:
-* The ISR is fired when the timer reaches terminal count. In the ISR, the total
-* number of bytes received until now is cached locally (to avoid any potential 
-* race conditions) and then the throughput is calculated from it.
-* Since the ISR fires 10 seconds after the timer is started, the total number
-* of bytes is divided by 10. The bytes are converted to kilobytes by dividing 
-* by 1024. It is then converted to kilo bits by multiplying the result by 8.
+* The ISR is fired when the timer reaches terminal count, 10 seconds after the
+* timer is started. The ISR prints the statistics collected since the data 
+* transfer started; see Throughput_Report().
 *
 * Side Effects:
 * None
@@ -306,17 +317,7 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 *******************************************************************************/
 void MyTimerIsr(void)
 {
-    uint32 cachedTotalByteCounter = totalByteCounter;
-    uint32 throughput;
-
-    /* Total bytes received in 10 seconds converted to Kilo bits per second */
-    throughput = (cachedTotalByteCounter >> 7) / 10;
-
-    UART_UartPutString("\n\rThroughput is: ");
-    UART_UartPutChar(HexToDecimal(throughput, 2));
-    UART_UartPutChar(HexToDecimal(throughput, 1));
-    UART_UartPutChar(HexToDecimal(throughput, 0));
-    UART_UartPutString(" kbps.");
+    Throughput_Report();
     
     Timer_ClearInterrupt(Timer_INTR_MASK_TC);
 }
@@ -356,6 +357,7 @@ int main()
     UART_Start();
     Timer_Init();
     TimerInterrupt_StartEx(MyTimerIsr);
+    Throughput_Init();
 
     /* Clear screen and put a welcome message */
     UART_UartPutChar(12);
@@ -43,6 +43,35 @@
 * Included headers
 *******************************************************************************/
 #include <project.h>
+#include <stdbool.h>
+#include "common.h"
+
+
+/*******************************************************************************
+* Structures
+*******************************************************************************/
+typedef struct
+{
+    bool running;
+    uint32 startTime;
+    uint32 lastReportTime;
+    uint32 lastPacketTime;
+    uint32 bytes;
+    uint32 packets;
+    uint32 busyRejections;
+    uint16 connInterval;
+    uint32 interval[THROUGHPUT_INTERVAL_BINS];
+} THROUGHPUT_STATS;
+
+
+/*******************************************************************************
+* Variables
+*******************************************************************************/
+/* Milliseconds since Throughput_Init(), counted by the SysTick interrupt */
+static volatile uint32 throughputTime = 0;
+
+/* Statistics of the current measurement */
+static THROUGHPUT_STATS throughputStats;
 
 
 /*******************************************************************************
@@ -164,4 +193,374 @@ char HexToAscii(uint8 value, uint8 nibble)
 }
 
 
+/*******************************************************************************
+* Function Name: PutDecimal()
+********************************************************************************
+* Summary:
+* Prints a decimal number on the UART.
+*
+* Parameters:
+* uint32 value: Number to be printed, values above 999999 print as 999999
+*
+* Return:
+* None
+*
+* Theory:
+* Prints the number digit-by-digit with HexToDecimal(), skipping leading 
+* zeros.
+*
+*******************************************************************************/
+static void PutDecimal(uint32 value)
+{
+    uint8 digit = 5;
+    
+    if(value > 999999)
+    {
+        value = 999999;
+    }
+    
+    while((digit > 0) && (HexToDecimal(value, digit) == '0'))
+    {
+        digit--;
+    }
+    
+    do
+    {
+        UART_UartPutChar(HexToDecimal(value, digit));
+    } while(digit-- > 0);
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_SysTickIsr()
+********************************************************************************
+* Summary:
+* SysTick callback that keeps the millisecond time base of the statistics.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void Throughput_SysTickIsr(void)
+{
+    throughputTime++;
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_Init()
+********************************************************************************
+* Summary:
+* Starts the time base of the throughput statistics.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* Configures SysTick for an interrupt every millisecond. Needs global 
+* interrupts enabled.
+*
+*******************************************************************************/
+void Throughput_Init(void)
+{
+    CySysTickStart();
+    CySysTickSetCallback(0, Throughput_SysTickIsr);
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_Start()
+********************************************************************************
+* Summary:
+* Clears the statistics and starts a new measurement.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* The connection interval set by Throughput_SetConnectionInterval() is kept.
+*
+*******************************************************************************/
+void Throughput_Start(void)
+{
+    uint8 bin;
+    
+    throughputStats.startTime = throughputTime;
+    throughputStats.lastReportTime = throughputTime;
+    throughputStats.lastPacketTime = throughputTime;
+    throughputStats.bytes = 0;
+    throughputStats.packets = 0;
+    throughputStats.busyRejections = 0;
+    
+    for(bin = 0; bin < THROUGHPUT_INTERVAL_BINS; bin++)
+    {
+        throughputStats.interval[bin] = 0;
+    }
+    
+    throughputStats.running = true;
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_Stop()
+********************************************************************************
+* Summary:
+* Stops the measurement, e.g. on disconnection.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void Throughput_Stop(void)
+{
+    throughputStats.running = false;
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_SetConnectionInterval()
+********************************************************************************
+* Summary:
+* Updates the connection interval used to count connection events.
+*
+* Parameters:
+* uint16 connInterval: Connection interval in 1.25 ms units
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void Throughput_SetConnectionInterval(uint16 connInterval)
+{
+    throughputStats.connInterval = connInterval;
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_RequestConnectionInterval()
+********************************************************************************
+* Summary:
+* Asks the Central for the connection interval set by 
+* THROUGHPUT_CONN_INTERVAL.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* Sends an L2CAP connection parameter update request. Nothing is sent when 
+* THROUGHPUT_CONN_INTERVAL is 0.
+*
+*******************************************************************************/
+void Throughput_RequestConnectionInterval(void)
+{
+#if (THROUGHPUT_CONN_INTERVAL != 0)
+    CYBLE_GAP_CONN_UPDATE_PARAM_T connParameters = 
+    {
+        THROUGHPUT_CONN_INTERVAL,   /* Minimum connection interval */
+        THROUGHPUT_CONN_INTERVAL,   /* Maximum connection interval */
+        0,                          /* Slave latency */
+        500                         /* Supervision timeout - 500 x 10 = 5000 ms */
+    };
+    
+    CyBle_L2capLeConnectionParamUpdateRequest(cyBle_connHandle.bdHandle, &connParameters);
+#endif
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_GetPduSize()
+********************************************************************************
+* Summary:
+* Returns the payload size to be sent in one packet.
+*
+* Parameters:
+* uint16 maxPduSize: Largest payload allowed by the negotiated MTU
+*
+* Return:
+* uint16: maxPduSize limited to THROUGHPUT_PDU_SIZE
+*
+*******************************************************************************/
+uint16 Throughput_GetPduSize(uint16 maxPduSize)
+{
+#if (THROUGHPUT_PDU_SIZE != 0)
+    if(maxPduSize > THROUGHPUT_PDU_SIZE)
+    {
+        maxPduSize = THROUGHPUT_PDU_SIZE;
+    }
+#endif
+
+    return maxPduSize;
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_AddPacket()
+********************************************************************************
+* Summary:
+* Accounts a packet sent or received.
+*
+* Parameters:
+* uint16 length: Payload length of the packet in bytes
+*
+* Return:
+* None
+*
+* Theory:
+* Adds the payload to the byte count and the time since the previous packet
+* to the packet interval histogram.
+*
+*******************************************************************************/
+void Throughput_AddPacket(uint16 length)
+{
+    uint32 now = throughputTime;
+    uint32 elapsed = now - throughputStats.lastPacketTime;
+    uint8 bin = 0;
+    
+    if(throughputStats.running == true)
+    {
+        while((elapsed != 0) && (bin < (THROUGHPUT_INTERVAL_BINS - 1)))
+        {
+            elapsed >>= 1;
+            bin++;
+        }
+        
+        throughputStats.interval[bin]++;
+        throughputStats.lastPacketTime = now;
+        throughputStats.bytes += length;
+        throughputStats.packets++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_AddRejection()
+********************************************************************************
+* Summary:
+* Accounts a packet the BLE stack did not accept because it was busy.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void Throughput_AddRejection(void)
+{
+    if(throughputStats.running == true)
+    {
+        throughputStats.busyRejections++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_Process()
+********************************************************************************
+* Summary:
+* Prints the statistics every THROUGHPUT_REPORT_PERIOD ms.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* To be called from the main loop on devices without a report timer.
+*
+*******************************************************************************/
+void Throughput_Process(void)
+{
+    if((throughputStats.running == true) && 
+       ((throughputTime - throughputStats.lastReportTime) >= THROUGHPUT_REPORT_PERIOD))
+    {
+        throughputStats.lastReportTime += THROUGHPUT_REPORT_PERIOD;
+        Throughput_Report();
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: Throughput_Report()
+********************************************************************************
+* Summary:
+* Prints the statistics of the current measurement on the UART.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* The goodput is the payload received or sent since Throughput_Start(), 
+* converted to kilobits (1024 bits) per second. The number of connection 
+* events is derived from the elapsed time and the connection interval; the 
+* packets per connection event are printed with one decimal.
+*
+*******************************************************************************/
+void Throughput_Report(void)
+{
+    uint32 elapsed = throughputTime - throughputStats.startTime;
+    uint32 connEvents = 0;
+    uint32 value;
+    uint8 bin;
+    
+    if(elapsed == 0)
+    {
+        return;
+    }
+    
+    /* Bytes per ms converted to Kilo bits per second */
+    value = ((throughputStats.bytes >> 7) * 1000) / elapsed;
+    UART_UartPutString("\n\rThroughput is: ");
+    PutDecimal(value);
+    UART_UartPutString(" kbps.");
+    
+    UART_UartPutString("\n\r  Packets: ");
+    PutDecimal(throughputStats.packets);
+    UART_UartPutString(", stack busy rejections: ");
+    PutDecimal(throughputStats.busyRejections);
+    
+    if(throughputStats.connInterval != 0)
+    {
+        connEvents = (elapsed * 4) / (throughputStats.connInterval * 5);
+        
+        UART_UartPutString("\n\r  Connection interval: ");
+        PutDecimal((throughputStats.connInterval * 5) / 4);
+        UART_UartPutString(" ms, packets per connection event: ");
+        
+        value = (connEvents != 0) ? ((throughputStats.packets * 10) / connEvents) : 0;
+        PutDecimal(value / 10);
+        UART_UartPutChar('.');
+        UART_UartPutChar(HexToDecimal(value, 0));
+    }
+    
+    UART_UartPutString("\n\r  Packet interval (ms: packets):");
+    for(bin = 0; bin < THROUGHPUT_INTERVAL_BINS; bin++)
+    {
+        UART_UartPutChar(' ');
+        PutDecimal((bin == 0) ? 0 : (1u << (bin - 1)));
+        UART_UartPutString((bin == (THROUGHPUT_INTERVAL_BINS - 1)) ? "+: " : ": ");
+        PutDecimal(throughputStats.interval[bin]);
+    }
+}
+
+
 /* [] END OF FILE */
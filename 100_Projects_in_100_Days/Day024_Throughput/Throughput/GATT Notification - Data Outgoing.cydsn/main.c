@@ -122,11 +122,19 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 
         case CYBLE_EVT_GAP_DEVICE_CONNECTED:
             UART_UartPutString("\n\rConnected. ");
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
+            Throughput_RequestConnectionInterval();
+            break;
+
+        /* Connection parameters updated by the Central */
+        case CYBLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
             break;
             
         /* Device disconnected; restart advertisement */
         case CYBLE_EVT_GAP_DEVICE_DISCONNECTED:
             charNotificationEnabled = false;
+            Throughput_Stop();
             UART_UartPutString("\n\n\rDisconnected. ");
             UART_UartPutString("\n\rAdvertising again. ");
             UART_UartPutString("Address: ");
@@ -155,6 +163,14 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
                CYBLE_CUSTOM_SERVICE_CUSTOM_CHARACTERISTIC_CLIENT_CHARACTERISTIC_CONFIGURATION_DESC_HANDLE)
             {
                 charNotificationEnabled = writeParam.handleValPair.value.val[0];
+                if(charNotificationEnabled == true)
+                {
+                    Throughput_Start();
+                }
+                else
+                {
+                    Throughput_Stop();
+                }
             }
             CyBle_GattsWriteRsp(cyBle_connHandle);
             break;
@@ -175,18 +191,18 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 * None
 *
 * Return:
-* None
+* CYBLE_API_RESULT_T: CYBLE_ERROR_OK if the stack accepted the packet
 *
 * Theory:
 * The function creates a notification packet for the custom characteristic and 
 * sends it over BLE. The amount of data sent for the characteristic is equal 
-* to (negotiated MTU size - 3) bytes.
+* to (negotiated MTU size - 3) bytes, limited to THROUGHPUT_PDU_SIZE.
 *
 * Side Effects:
 * None
 *
 *******************************************************************************/
-void SendNotification(void)
+CYBLE_API_RESULT_T SendNotification(void)
 {
     /* Create a new notification packet */
     CYBLE_GATTS_HANDLE_VALUE_NTF_T notificationPacket;
@@ -196,10 +212,10 @@ void SendNotification(void)
      */
     notificationPacket.attrHandle = CYBLE_CUSTOM_SERVICE_CUSTOM_CHARACTERISTIC_CHAR_HANDLE;
     notificationPacket.value.val = buffer;
-    notificationPacket.value.len = negotiatedMtu - 3;
+    notificationPacket.value.len = Throughput_GetPduSize(negotiatedMtu - 3);
     
     /* Report data to BLE component */
-    CyBle_GattsNotification(cyBle_connHandle, &notificationPacket);
+    return CyBle_GattsNotification(cyBle_connHandle, &notificationPacket);
 }
 
 
@@ -219,7 +235,9 @@ void SendNotification(void)
 * This is the main function for the application. It does the following -
 * 1. Initializes the BLE component
 * 2. Initializes a buffer from which data is sent out over BLE
-* 3. Sends characteristic notification packets over BLE
+* 3. Sends characteristic notification packets over BLE, up to 
+*    THROUGHPUT_PACKETS_PER_PASS packets per pass of the main loop
+* 4. Prints the throughput statistics every THROUGHPUT_REPORT_PERIOD ms
 *
 * Side Effects:
 * None
@@ -228,6 +246,7 @@ void SendNotification(void)
 int main()
 {
     uint32 counter = 0; 
+    uint8 packet;
 
     /* Enable global interrupts for BLE */
     CyGlobalIntEnable; 
@@ -235,6 +254,7 @@ int main()
     /* Initialize components */
     CyBle_Start(StackEventHandler);
     UART_Start();
+    Throughput_Init();
 
     /* Clear screen and put a welcome message */
     UART_UartPutChar(12);
@@ -253,12 +273,24 @@ int main()
         if(charNotificationEnabled == true)
         {
             /* Send new data only when the previous data has gone out, 
-             * which is indicated by Stack being Free.
+             * which is indicated by Stack being Free. The Stack status is
+             * updated by CyBle_ProcessEvents(), so further packets of this
+             * pass are queued until the stack rejects one.
              */
             if(CyBle_GattGetBusStatus() == CYBLE_STACK_STATE_FREE)
             {
-                SendNotification();
+                for(packet = 0; packet < THROUGHPUT_PACKETS_PER_PASS; packet++)
+                {
+                    if(SendNotification() != CYBLE_ERROR_OK)
+                    {
+                        Throughput_AddRejection();
+                        break;
+                    }
+                    Throughput_AddPacket(Throughput_GetPduSize(negotiatedMtu - 3));
+                }
             }
+            
+            Throughput_Process();
         }
 
         /* Mandatory to process BLE events generated by stack */
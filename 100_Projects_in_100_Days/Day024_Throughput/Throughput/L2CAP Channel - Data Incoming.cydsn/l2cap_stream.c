@@ -0,0 +1,577 @@
+/*******************************************************************************
+* File Name: l2cap_stream.c
+*
+* Version: 1.0
+*
+* Description:
+*  This file implements a streaming layer on top of an L2CAP credit based flow
+*  control (CBFC) channel. Data written by the application is queued and sent
+*  in SDUs as large as the peer device and the available credits allow. 
+*  Received data is queued for the application and credits are given back to 
+*  the peer device only for the space the application has drained.
+*
+* Hardware Dependency:
+*  CY8CKIT-042-BLE
+*
+********************************************************************************
+* Copyright (2015), Cypress Semiconductor Corporation.
+******************************************************************************
+* This software is owned by Cypress Semiconductor Corporation (Cypress) and is
+* protected by and subject to worldwide patent protection (United States and
+* foreign), United States copyright laws and international treaty provisions.
+* Cypress hereby grants to licensee a personal, non-exclusive, non-transferable
+* license to copy, use, modify, create derivative works of, and compile the
+* Cypress Source Code and derivative works for the sole purpose of creating
+* custom software in support of licensee product to be used only in conjunction
+* with a Cypress integrated circuit as specified in the applicable agreement.
+* Any reproduction, modification, translation, compilation, or representation of
+* this software except as specified above is prohibited without the express
+* written permission of Cypress.
+*
+* Disclaimer: CYPRESS MAKES NO WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, WITH
+* REGARD TO THIS MATERIAL, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+* Cypress reserves the right to make changes without further notice to the
+* materials described herein. Cypress does not assume any liability arising out
+* of the application or use of any product or circuit described herein. Cypress
+* does not authorize its products for use as critical components in life-support
+* systems where a malfunction or failure may reasonably be expected to result in
+* significant injury to the user. The inclusion of Cypress' product in a life-
+* support systems application implies that the manufacturer assumes all risk of
+* such use and in doing so indemnifies Cypress against all charges. Use may be
+* limited by and subject to the applicable Cypress software license agreement.
+*******************************************************************************/
+
+
+/*******************************************************************************
+* Included headers
+*******************************************************************************/
+#include <project.h>
+#include <stdbool.h>
+#include <string.h>
+#include "l2cap_stream.h"
+
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+#define TX_BUFFER_MASK              (L2CAP_STREAM_TX_BUFFER_SIZE - 1)
+#define RX_BUFFER_MASK              (L2CAP_STREAM_RX_BUFFER_SIZE - 1)
+
+/* The first LE-frame of an SDU carries the 2 byte SDU length */
+#define SDU_LENGTH_SIZE             (2)
+
+
+/*******************************************************************************
+* Structures
+*******************************************************************************/
+typedef struct
+{
+    bool open;
+    uint16 cid;
+    uint16 peerMtu;
+    uint16 peerMps;
+    
+    /* Credits received from the peer device and not yet used */
+    uint16 txCredits;
+    /* Credits given to the peer device and not yet used, as far as known */
+    uint16 rxCredits;
+    
+    /* Free-running queue indexes: bytes from txTail to txSend are handed to
+     * the stack, bytes from txSend to txHead are waiting to be sent.
+     */
+    uint16 txHead;
+    uint16 txSend;
+    uint16 txTail;
+    uint16 rxHead;
+    uint16 rxTail;
+    
+    bool txFull;
+    bool rxThrottled;
+    
+    /* Lengths of the SDUs handed to the stack, oldest first */
+    uint8 sdusInFlight;
+    uint16 sduLength[L2CAP_STREAM_MAX_SDUS_IN_FLIGHT];
+} L2CAP_STREAM;
+
+
+/*******************************************************************************
+* Variables
+*******************************************************************************/
+static L2CAP_STREAM stream;
+
+/* The SDUs are sent directly from the send queue, so the queue memory is 
+ * released only when the stack confirms the transmission.
+ */
+static uint8 txBuffer[L2CAP_STREAM_TX_BUFFER_SIZE];
+static uint8 rxBuffer[L2CAP_STREAM_RX_BUFFER_SIZE];
+
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+/*******************************************************************************
+* Function Name: L2capStream_Open()
+********************************************************************************
+* Summary:
+* Starts streaming on a newly created L2CAP channel.
+*
+* Parameters:
+* uint16 cid: Local channel ID
+* uint16 peerMtu: MTU of the peer device
+* uint16 peerMps: MPS of the peer device
+* uint16 txCredits: Credits given by the peer device on channel creation
+*
+* Return:
+* None
+*
+* Theory:
+* Empties both queues. The peer device is assumed to hold 
+* L2CAP_STREAM_RX_INITIAL_CREDITS credits, which must be the credits given 
+* in the connection request or response.
+*
+*******************************************************************************/
+void L2capStream_Open(uint16 cid, uint16 peerMtu, uint16 peerMps, uint16 txCredits)
+{
+    memset(&stream, 0, sizeof(stream));
+    
+    stream.cid = cid;
+    stream.peerMtu = peerMtu;
+    stream.peerMps = peerMps;
+    stream.txCredits = txCredits;
+    stream.rxCredits = L2CAP_STREAM_RX_INITIAL_CREDITS;
+    stream.open = true;
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_Close()
+********************************************************************************
+* Summary:
+* Stops streaming when the L2CAP channel or the connection is closed.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* Queued data is discarded on the next L2capStream_Open().
+*
+*******************************************************************************/
+void L2capStream_Close(void)
+{
+    stream.open = false;
+}
+
+
+/*******************************************************************************
+* Function Name: CopyToQueue()
+********************************************************************************
+* Summary:
+* Copies data into a queue at the given free-running index.
+*
+* Parameters:
+* uint8 *queue: Queue buffer, its size being a power of 2
+* uint16 mask: Queue size - 1
+* uint16 index: Free-running index of the first byte to write
+* const uint8 *data: Data to be copied
+* uint16 length: Number of bytes to copy
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void CopyToQueue(uint8 *queue, uint16 mask, uint16 index, const uint8 *data, uint16 length)
+{
+    uint16 offset = index & mask;
+    uint16 firstPart = (mask + 1) - offset;
+    
+    if(firstPart > length)
+    {
+        firstPart = length;
+    }
+    
+    memcpy(&queue[offset], data, firstPart);
+    memcpy(queue, &data[firstPart], length - firstPart);
+}
+
+
+/*******************************************************************************
+* Function Name: CopyFromQueue()
+********************************************************************************
+* Summary:
+* Copies data out of a queue from the given free-running index.
+*
+* Parameters:
+* const uint8 *queue: Queue buffer, its size being a power of 2
+* uint16 mask: Queue size - 1
+* uint16 index: Free-running index of the first byte to read
+* uint8 *data: Destination of the data
+* uint16 length: Number of bytes to copy
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void CopyFromQueue(const uint8 *queue, uint16 mask, uint16 index, uint8 *data, uint16 length)
+{
+    uint16 offset = index & mask;
+    uint16 firstPart = (mask + 1) - offset;
+    
+    if(firstPart > length)
+    {
+        firstPart = length;
+    }
+    
+    memcpy(data, &queue[offset], firstPart);
+    memcpy(&data[firstPart], queue, length - firstPart);
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_Write()
+********************************************************************************
+* Summary:
+* Queues data to be sent on the channel.
+*
+* Parameters:
+* const uint8 *data: Data to be sent
+* uint16 length: Number of bytes to send
+*
+* Return:
+* uint16: Number of bytes queued, less than length when the queue is full
+*
+* Theory:
+* The data is sent by L2capStream_Process(). The application should stop 
+* writing while L2capStream_IsTxFull() returns true.
+*
+*******************************************************************************/
+uint16 L2capStream_Write(const uint8 *data, uint16 length)
+{
+    uint16 space = L2CAP_STREAM_TX_BUFFER_SIZE - (uint16)(stream.txHead - stream.txTail);
+    
+    if(length > space)
+    {
+        length = space;
+    }
+    
+    CopyToQueue(txBuffer, TX_BUFFER_MASK, stream.txHead, data, length);
+    stream.txHead += length;
+    
+    if((uint16)(stream.txHead - stream.txTail) >= L2CAP_STREAM_TX_HIGH_WATERMARK)
+    {
+        stream.txFull = true;
+    }
+    
+    return length;
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_IsTxFull()
+********************************************************************************
+* Summary:
+* Checks whether the application should stop writing data.
+*
+* Parameters:
+* None
+*
+* Return:
+* bool: true from the time the send queue reached the high watermark until it
+*       drained to the low watermark
+*
+*******************************************************************************/
+bool L2capStream_IsTxFull(void)
+{
+    if((stream.txFull == true) && 
+       ((uint16)(stream.txHead - stream.txTail) <= L2CAP_STREAM_TX_LOW_WATERMARK))
+    {
+        stream.txFull = false;
+    }
+    
+    return stream.txFull;
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_Read()
+********************************************************************************
+* Summary:
+* Takes received data out of the receive queue.
+*
+* Parameters:
+* uint8 *data: Destination of the data
+* uint16 length: Maximum number of bytes to read
+*
+* Return:
+* uint16: Number of bytes read
+*
+* Theory:
+* The space freed here is given back to the peer device as credits by 
+* L2capStream_Process(), so the peer device sends only as fast as the 
+* application reads.
+*
+*******************************************************************************/
+uint16 L2capStream_Read(uint8 *data, uint16 length)
+{
+    uint16 count = L2capStream_GetRxCount();
+    
+    if(length > count)
+    {
+        length = count;
+    }
+    
+    CopyFromQueue(rxBuffer, RX_BUFFER_MASK, stream.rxTail, data, length);
+    stream.rxTail += length;
+    
+    return length;
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_GetRxCount()
+********************************************************************************
+* Summary:
+* Returns the number of bytes in the receive queue.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint16: Number of bytes that can be read
+*
+*******************************************************************************/
+uint16 L2capStream_GetRxCount(void)
+{
+    return (uint16)(stream.rxHead - stream.rxTail);
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_AddTxCredits()
+********************************************************************************
+* Summary:
+* Accounts credits received from the peer device.
+*
+* Parameters:
+* uint16 credits: Credits received in CYBLE_EVT_L2CAP_CBFC_TX_CREDIT_IND
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void L2capStream_AddTxCredits(uint16 credits)
+{
+    stream.txCredits += credits;
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_SetRxCredits()
+********************************************************************************
+* Summary:
+* Updates the number of credits the peer device has left.
+*
+* Parameters:
+* uint16 credits: Credits reported in CYBLE_EVT_L2CAP_CBFC_RX_CREDIT_IND
+*
+* Return:
+* None
+*
+* Theory:
+* The local count is an estimate, since the peer device may split SDUs into 
+* more LE-frames than needed; the stack's count replaces it.
+*
+*******************************************************************************/
+void L2capStream_SetRxCredits(uint16 credits)
+{
+    stream.rxCredits = credits;
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_DataWriteComplete()
+********************************************************************************
+* Summary:
+* Releases the oldest SDU handed to the stack.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* To be called on CYBLE_EVT_L2CAP_CBFC_DATA_WRITE_IND.
+*
+*******************************************************************************/
+void L2capStream_DataWriteComplete(void)
+{
+    uint8 sdu;
+    
+    if(stream.sdusInFlight > 0)
+    {
+        stream.txTail += stream.sduLength[0];
+        stream.sdusInFlight--;
+        
+        for(sdu = 0; sdu < stream.sdusInFlight; sdu++)
+        {
+            stream.sduLength[sdu] = stream.sduLength[sdu + 1];
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_DataRead()
+********************************************************************************
+* Summary:
+* Queues an SDU received on the channel.
+*
+* Parameters:
+* const CYBLE_L2CAP_CBFC_RX_PARAM_T *rxParam: Parameter of 
+*                                             CYBLE_EVT_L2CAP_CBFC_DATA_READ
+*
+* Return:
+* None
+*
+* Theory:
+* Each LE-frame of the SDU used one credit of the peer device. Data that does
+* not fit in the receive queue is dropped, which does not happen as long as 
+* the peer device respects the credits.
+*
+*******************************************************************************/
+void L2capStream_DataRead(const CYBLE_L2CAP_CBFC_RX_PARAM_T *rxParam)
+{
+    uint16 length = rxParam->rxDataLength;
+    uint16 frames = (length + SDU_LENGTH_SIZE + L2CAP_STREAM_MPS - 1) / L2CAP_STREAM_MPS;
+    uint16 space = L2CAP_STREAM_RX_BUFFER_SIZE - L2capStream_GetRxCount();
+    
+    if((stream.open == false) || (rxParam->lCid != stream.cid))
+    {
+        return;
+    }
+    
+    stream.rxCredits = (stream.rxCredits > frames) ? (stream.rxCredits - frames) : 0;
+    
+    if(rxParam->result == CYBLE_L2CAP_RESULT_SUCCESS)
+    {
+        if(length > space)
+        {
+            length = space;
+        }
+        
+        CopyToQueue(rxBuffer, RX_BUFFER_MASK, stream.rxHead, rxParam->rxData, length);
+        stream.rxHead += length;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: L2capStream_Process()
+********************************************************************************
+* Summary:
+* Sends the next SDU and gives credits to the peer device.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint16: Length of the SDU handed to the stack, 0 if none was due, 
+*         L2CAP_STREAM_SDU_REJECTED if the stack did not accept it
+*
+* Theory:
+* An SDU is sent when fewer than L2CAP_STREAM_MAX_SDUS_IN_FLIGHT SDUs are 
+* pending and the peer device has given credits. The SDU is the next 
+* contiguous part of the send queue, limited to the peer device's MTU and to 
+* the LE-frames the credits allow, so the stack never holds data the peer 
+* device cannot take yet.
+*
+* Credits are given to the peer device only for free space of the receive 
+* queue which is not covered by credits already given. The credits therefore
+* follow the rate at which the application drains the queue, and are held 
+* back completely between the high and low watermarks.
+*
+*******************************************************************************/
+uint16 L2capStream_Process(void)
+{
+    uint16 length;
+    uint16 offset;
+    uint16 frames;
+    uint16 count;
+    
+    if(stream.open == false)
+    {
+        return 0;
+    }
+    
+    /* Receive side: give credits for the drained space */
+    count = L2capStream_GetRxCount();
+    if(stream.rxThrottled == true)
+    {
+        stream.rxThrottled = (count > L2CAP_STREAM_RX_LOW_WATERMARK);
+    }
+    else
+    {
+        stream.rxThrottled = (count >= L2CAP_STREAM_RX_HIGH_WATERMARK);
+    }
+    
+    if(stream.rxThrottled == false)
+    {
+        frames = (L2CAP_STREAM_RX_BUFFER_SIZE - count) / L2CAP_STREAM_MPS;
+        
+        if(frames >= (stream.rxCredits + L2CAP_STREAM_RX_CREDIT_BATCH))
+        {
+            frames -= stream.rxCredits;
+            if(CyBle_L2capCbfcSendFlowControlCredit(stream.cid, frames) == CYBLE_ERROR_OK)
+            {
+                stream.rxCredits += frames;
+            }
+        }
+    }
+    
+    /* Send side: hand the next SDU to the stack */
+    length = stream.txHead - stream.txSend;
+    if((length == 0) || (stream.txCredits == 0) || 
+       (stream.sdusInFlight >= L2CAP_STREAM_MAX_SDUS_IN_FLIGHT))
+    {
+        return 0;
+    }
+    
+    offset = stream.txSend & TX_BUFFER_MASK;
+    if(length > (L2CAP_STREAM_TX_BUFFER_SIZE - offset))
+    {
+        length = L2CAP_STREAM_TX_BUFFER_SIZE - offset;
+    }
+    
+    if(length > stream.peerMtu)
+    {
+        length = stream.peerMtu;
+    }
+    
+    if(((uint32)stream.txCredits * stream.peerMps) < (uint32)(length + SDU_LENGTH_SIZE))
+    {
+        length = (stream.txCredits * stream.peerMps) - SDU_LENGTH_SIZE;
+    }
+    
+    if(CyBle_L2capChannelDataWrite(cyBle_connHandle.bdHandle, stream.cid, 
+                                   &txBuffer[offset], length) != CYBLE_ERROR_OK)
+    {
+        /* The SDU stays in the send queue and is sent again on the next call */
+        return L2CAP_STREAM_SDU_REJECTED;
+    }
+    
+    frames = (length + SDU_LENGTH_SIZE + stream.peerMps - 1) / stream.peerMps;
+    stream.txCredits -= frames;
+    stream.txSend += length;
+    stream.sduLength[stream.sdusInFlight] = length;
+    stream.sdusInFlight++;
+    
+    return length;
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,108 @@
+/*******************************************************************************
+* File Name: l2cap_stream.h
+*
+* Version: 1.0
+*
+* Description:
+*  This is the header file for the L2CAP channel streaming layer.
+*
+* Hardware Dependency:
+*  CY8CKIT-042-BLE
+*
+********************************************************************************
+* Copyright (2015), Cypress Semiconductor Corporation.
+******************************************************************************
+* This software is owned by Cypress Semiconductor Corporation (Cypress) and is
+* protected by and subject to worldwide patent protection (United States and
+* foreign), United States copyright laws and international treaty provisions.
+* Cypress hereby grants to licensee a personal, non-exclusive, non-transferable
+* license to copy, use, modify, create derivative works of, and compile the
+* Cypress Source Code and derivative works for the sole purpose of creating
+* custom software in support of licensee product to be used only in conjunction
+* with a Cypress integrated circuit as specified in the applicable agreement.
+* Any reproduction, modification, translation, compilation, or representation of
+* this software except as specified above is prohibited without the express
+* written permission of Cypress.
+*
+* Disclaimer: CYPRESS MAKES NO WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, WITH
+* REGARD TO THIS MATERIAL, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+* Cypress reserves the right to make changes without further notice to the
+* materials described herein. Cypress does not assume any liability arising out
+* of the application or use of any product or circuit described herein. Cypress
+* does not authorize its products for use as critical components in life-support
+* systems where a malfunction or failure may reasonably be expected to result in
+* significant injury to the user. The inclusion of Cypress' product in a life-
+* support systems application implies that the manufacturer assumes all risk of
+* such use and in doing so indemnifies Cypress against all charges. Use may be
+* limited by and subject to the applicable Cypress software license agreement.
+*******************************************************************************/
+#if !defined (_L2CAP_STREAM_H)
+#define _L2CAP_STREAM_H
+
+
+/*******************************************************************************
+* Included headers
+*******************************************************************************/
+#include <project.h>
+#include <stdbool.h>
+
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+/* MTU and MPS of the local device for the L2CAP channel */
+#define L2CAP_STREAM_MTU                (512)
+#define L2CAP_STREAM_MPS                (128)
+
+/* Size of the send and the receive queue in bytes; must be a power of 2 */
+#define L2CAP_STREAM_TX_BUFFER_SIZE     (1024)
+#define L2CAP_STREAM_RX_BUFFER_SIZE     (1024)
+
+/* The send queue reports full above the high watermark until it drained 
+ * below the low watermark.
+ */
+#define L2CAP_STREAM_TX_HIGH_WATERMARK  (L2CAP_STREAM_TX_BUFFER_SIZE - L2CAP_STREAM_MTU)
+#define L2CAP_STREAM_TX_LOW_WATERMARK   (L2CAP_STREAM_TX_BUFFER_SIZE / 4)
+
+/* No credits are given to the peer device while the receive queue is above
+ * the high watermark, until it drained below the low watermark.
+ */
+#define L2CAP_STREAM_RX_HIGH_WATERMARK  ((L2CAP_STREAM_RX_BUFFER_SIZE * 3) / 4)
+#define L2CAP_STREAM_RX_LOW_WATERMARK   (L2CAP_STREAM_RX_BUFFER_SIZE / 4)
+
+/* Credits given to the peer device when the channel is created; one credit
+ * per MPS worth of free space in the receive queue.
+ */
+#define L2CAP_STREAM_RX_INITIAL_CREDITS (L2CAP_STREAM_RX_BUFFER_SIZE / L2CAP_STREAM_MPS)
+
+/* Credits are sent to the peer device in batches of at least this size */
+#define L2CAP_STREAM_RX_CREDIT_BATCH    (2)
+
+/* SDUs handed to the stack and not yet confirmed by 
+ * CYBLE_EVT_L2CAP_CBFC_DATA_WRITE_IND
+ */
+#define L2CAP_STREAM_MAX_SDUS_IN_FLIGHT (2)
+
+/* Returned by L2capStream_Process() when the stack did not accept the SDU */
+#define L2CAP_STREAM_SDU_REJECTED       (0xFFFFu)
+
+
+/*******************************************************************************
+* External functions 
+*******************************************************************************/
+extern void L2capStream_Open(uint16 cid, uint16 peerMtu, uint16 peerMps, uint16 txCredits);
+extern void L2capStream_Close(void);
+extern uint16 L2capStream_Write(const uint8 *data, uint16 length);
+extern bool L2capStream_IsTxFull(void);
+extern uint16 L2capStream_Read(uint8 *data, uint16 length);
+extern uint16 L2capStream_GetRxCount(void);
+extern void L2capStream_AddTxCredits(uint16 credits);
+extern void L2capStream_SetRxCredits(uint16 credits);
+extern void L2capStream_DataWriteComplete(void);
+extern void L2capStream_DataRead(const CYBLE_L2CAP_CBFC_RX_PARAM_T *rxParam);
+extern uint16 L2capStream_Process(void);
+
+#endif
+
+/* [] END OF FILE */
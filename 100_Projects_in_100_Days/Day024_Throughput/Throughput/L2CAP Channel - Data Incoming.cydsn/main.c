@@ -47,16 +47,17 @@
 #include <project.h>
 #include <stdbool.h>
 #include "common.h"
+#include "l2cap_stream.h"
 
 
 /*******************************************************************************
 * Macros
 *******************************************************************************/
-#define PEER_DEVICE_TX_CREDITS      (1000)
+#define PEER_DEVICE_TX_CREDITS      (L2CAP_STREAM_RX_INITIAL_CREDITS)
 
 #define LOCAL_DEVICE_PSM            (73)
-#define LOCAL_DEVICE_MTU            (512)
-#define LOCAL_DEVICE_MPS            (512)
+#define LOCAL_DEVICE_MTU            (L2CAP_STREAM_MTU)
+#define LOCAL_DEVICE_MPS            (L2CAP_STREAM_MPS)
 
 
 /*******************************************************************************
@@ -72,7 +73,6 @@ typedef struct
 /*******************************************************************************
 * Variables
 *******************************************************************************/
-uint32 totalByteCounter = 0;
 uint16 l2capCid;
 uint16 peerDevicePsm;
 uint8 userStoppedScan = 0;
@@ -227,6 +227,7 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
             
         case CYBLE_EVT_GAP_DEVICE_CONNECTED:
             UART_UartPutString("\n\rConnected. ");
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
             break;
             
             
@@ -235,7 +236,8 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
             /* The L2CAP channel is disconnected but the PSM is already 
              * registered. Update the state machine.
              */
-            totalByteCounter = 0;
+            L2capStream_Close();
+            Throughput_Stop();
             
             /* Restart scan */
             UART_UartPutString("\n\n\rDisconnected. ");
@@ -256,8 +258,10 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
             peerDevicePsm = cbfcRequest->psm;
             
             CyBle_L2capCbfcConnectRsp(l2capCid, CYBLE_L2CAP_CONNECTION_SUCCESSFUL, &cbfcLocalParameters);
+            L2capStream_Open(l2capCid, cbfcPeerParameters.mtu, cbfcPeerParameters.mps, cbfcPeerParameters.credit);
             UART_UartPutString("\n\rL2CAP connection request received. Request accepted.");
             UART_UartPutString("\n\rCalculating throughput. Please wait... ");
+            Throughput_Start();
             Timer_Enable();
             break;
             
@@ -265,16 +269,32 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
         case CYBLE_EVT_L2CAP_CBFC_DATA_READ:
             /* New data received on the L2CAP channel */
             cbfcRxParameter = (CYBLE_L2CAP_CBFC_RX_PARAM_T *)eventParam;
+            L2capStream_DataRead(cbfcRxParameter);
             if(cbfcRxParameter->result == CYBLE_L2CAP_RESULT_SUCCESS)
             {
-                totalByteCounter += cbfcRxParameter->rxDataLength;
+                Throughput_AddPacket(cbfcRxParameter->rxDataLength);
             }
             break;
             
             
         case CYBLE_EVT_L2CAP_CBFC_RX_CREDIT_IND:
-            /* Peer device exhausted its Tx credits; send more */
-            CyBle_L2capCbfcSendFlowControlCredit(l2capCid, PEER_DEVICE_TX_CREDITS);
+            /* Peer device is running out of Tx credits; the stream sends more
+             * as soon as the received data is drained.
+             */
+            L2capStream_SetRxCredits(((CYBLE_L2CAP_CBFC_LOW_RX_CREDIT_PARAM_T *)eventParam)->credit);
+            break;
+            
+            
+        case CYBLE_EVT_L2CAP_CONN_PARAM_UPDATE_REQ:
+            /* The sender asks for the connection interval it is configured 
+             * for; accept it.
+             */
+            CyBle_L2capLeConnectionParamUpdateResponse(cyBle_connHandle.bdHandle, 0u);
+            break;
+            
+            
+        case CYBLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
             break;
             
             
@@ -297,12 +317,9 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 * None
 *
 * Theory:
-* The ISR is fired when the timer reaches terminal count. In the ISR, the total
-* number of bytes received until now is cached locally (to avoid any potential 
-* race conditions) and then the throughput is calculated from it.
-* Since the ISR fires 10 seconds after the timer is started, the total number
-* of bytes is divided by 10. The bytes are converted to kilobytes by dividing 
-* by 1024. It is then converted to kilo bits by multiplying the result by 8.
+* The ISR is fired when the timer reaches terminal count, 10 seconds after the
+* timer is started. The ISR prints the statistics collected since the data 
+* transfer started; see Throughput_Report().
 *
 * Side Effects:
 * None
@@ -310,17 +327,7 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 *******************************************************************************/
 void MyTimerIsr(void)
 {
-    uint32 cachedTotalByteCounter = totalByteCounter;
-    uint32 throughput;
-
-    /* Total bytes received in 10 seconds converted to Kilo bits per second */
-    throughput = (cachedTotalByteCounter >> 7) / 10;
-
-    UART_UartPutString("\n\rThroughput is: ");
-    UART_UartPutChar(HexToDecimal(throughput, 2));
-    UART_UartPutChar(HexToDecimal(throughput, 1));
-    UART_UartPutChar(HexToDecimal(throughput, 0));
-    UART_UartPutString(" kbps.");
+    Throughput_Report();
     
     Timer_ClearInterrupt(Timer_INTR_MASK_TC);
 }
@@ -342,7 +349,9 @@ void MyTimerIsr(void)
 * This is the main function for the application. It does the following -
 * 1. Initializes the BLE component
 * 2. Registers a Protocol Service Multiplexer (PSM) for the L2CAP channel
-* 3. Handles UART commands for connecting to a device, disconnecting from a 
+* 3. Drains the data received on the L2CAP channel, which lets the L2CAP 
+*    stream give new credits to the peer device
+* 4. Handles UART commands for connecting to a device, disconnecting from a 
 *    device, and refreshing the scan list.
 *
 * Refer Bluetooth 4.1 specification, Volume 3, Part A, section 3.4 for details.
@@ -354,6 +363,7 @@ void MyTimerIsr(void)
 int main()
 {
     uint8 command;
+    uint8 rxData[LOCAL_DEVICE_MPS];
     
     CyGlobalIntEnable; 
     
@@ -362,6 +372,7 @@ int main()
     UART_Start();
     Timer_Init();
     TimerInterrupt_StartEx(MyTimerIsr);
+    Throughput_Init();
 
     /* Clear screen and put a welcome message */
     UART_UartPutChar(12);
@@ -372,6 +383,11 @@ int main()
         /* Mandatory to process BLE events generated by stack */
         CyBle_ProcessEvents();
         
+        /* Consume the received data and give credits for the drained space */
+        while(L2capStream_Read(rxData, sizeof(rxData)) != 0)
+        {
+        }
+        L2capStream_Process();
         
         /* Commands for connecting, disconnecting and restarting scan on the 
          * Central side.
@@ -47,12 +47,49 @@
 #include <project.h>
 
 
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+/* Largest payload sent in one packet in bytes; 0 sends the largest payload
+ * allowed by the negotiated MTU.
+ */
+#define THROUGHPUT_PDU_SIZE             (0)
+
+/* Packets handed to the BLE stack per main loop pass on the sending side */
+#define THROUGHPUT_PACKETS_PER_PASS     (1)
+
+/* Connection interval requested by the sending side in 1.25 ms units;
+ * 0 keeps the interval chosen by the Central.
+ */
+#define THROUGHPUT_CONN_INTERVAL        (0)
+
+/* Time between two statistics reports on the sending side in ms */
+#define THROUGHPUT_REPORT_PERIOD        (10000)
+
+/* Bins of the packet interval histogram. Bin 0 counts packets that followed
+ * the previous one within the same millisecond, bin n counts intervals from
+ * 2^(n-1) ms and the last bin everything above.
+ */
+#define THROUGHPUT_INTERVAL_BINS        (8)
+
+
 /*******************************************************************************
 * External functions 
 *******************************************************************************/
 extern char HexToDecimal(uint32 value, uint8 digit);
 extern char HexToAscii(uint8 value, uint8 nibble);
 
+extern void Throughput_Init(void);
+extern void Throughput_Start(void);
+extern void Throughput_Stop(void);
+extern void Throughput_SetConnectionInterval(uint16 connInterval);
+extern void Throughput_RequestConnectionInterval(void);
+extern uint16 Throughput_GetPduSize(uint16 maxPduSize);
+extern void Throughput_AddPacket(uint16 length);
+extern void Throughput_AddRejection(void);
+extern void Throughput_Process(void);
+extern void Throughput_Report(void);
+
 #endif
 
 /* [] END OF FILE */
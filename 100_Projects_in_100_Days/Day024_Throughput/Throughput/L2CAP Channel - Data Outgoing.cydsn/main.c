@@ -46,17 +46,18 @@
 #include <project.h>
 #include <stdbool.h>
 #include "common.h"
+#include "l2cap_stream.h"
 
 
 /*******************************************************************************
 * Macros
 *******************************************************************************/
 #define PEER_DEVICE_PSM             (73)
-#define PEER_DEVICE_TX_CREDITS      (0)
+#define PEER_DEVICE_TX_CREDITS      (L2CAP_STREAM_RX_INITIAL_CREDITS)
 
 #define LOCAL_DEVICE_PSM            (43)
-#define LOCAL_DEVICE_MTU            (512)
-#define LOCAL_DEVICE_MPS            (512)
+#define LOCAL_DEVICE_MTU            (L2CAP_STREAM_MTU)
+#define LOCAL_DEVICE_MPS            (L2CAP_STREAM_MPS)
 
 #define MAX_MTU_SIZE                (512)
 
@@ -98,10 +99,6 @@ CYBLE_L2CAP_CBFC_CONNECT_PARAM_T cbfcPeerParameters;
 /* Variable to track the state of L2CAP channel creation */
 CHANNEL_STATE channelState = CHANNEL_PSM_NOT_REGISTERED;
 
-/* Variable to track sending the next data only when previous data is 
- * transmitted completely 
- */
-bool previousDataTransmitted = true;
 
 /*******************************************************************************
 * Function Definitions
@@ -163,6 +160,13 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
         
         case CYBLE_EVT_GAP_DEVICE_CONNECTED:
             UART_UartPutString("\n\rConnected. ");
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
+            Throughput_RequestConnectionInterval();
+            break;
+
+        /* Connection parameters updated by the Central */
+        case CYBLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
+            Throughput_SetConnectionInterval(((CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *)eventParam)->connIntv);
             break;
             
         /* Device disconnected */
@@ -171,7 +175,8 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
              * registered. Update the state machine.
              */
             channelState = CHANNEL_PSM_REGISTERED;
-            previousDataTransmitted = true;
+            L2capStream_Close();
+            Throughput_Stop();
             
             /* Restart advertisement */
             UART_UartPutString("\n\n\rDisconnected. ");
@@ -203,6 +208,9 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
                  * is created.
                  */
                 channelState = CHANNEL_CREATED;
+                L2capStream_Open(l2capCid, Throughput_GetPduSize(cbfcPeerParameters.mtu),
+                                 cbfcPeerParameters.mps, cbfcPeerParameters.credit);
+                Throughput_Start();
             }
             break;
         
@@ -212,22 +220,28 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
             {
                 /* L2CAP channel disconnected but the PSM is still registered */
                 channelState = CHANNEL_PSM_REGISTERED;
-                previousDataTransmitted = true;
+                L2capStream_Close();
+                Throughput_Stop();
             }
             break;
             
-        /* Invalid credits received from peer device; initiate disconnect */
+        /* Credits received from peer device; initiate disconnect if invalid */
         case CYBLE_EVT_L2CAP_CBFC_TX_CREDIT_IND:
             if(((CYBLE_L2CAP_CBFC_LOW_TX_CREDIT_PARAM_T *)eventParam)->result != CYBLE_L2CAP_RESULT_SUCCESS)
             {
                 CyBle_L2capDisconnectReq(l2capCid);
                 channelState = CHANNEL_PSM_REGISTERED;
+                L2capStream_Close();
+            }
+            else
+            {
+                L2capStream_AddTxCredits(((CYBLE_L2CAP_CBFC_LOW_TX_CREDIT_PARAM_T *)eventParam)->credit);
             }
             break;
 
         /* Previous data transmission completed */
         case CYBLE_EVT_L2CAP_CBFC_DATA_WRITE_IND:
-            previousDataTransmitted = true;
+            L2capStream_DataWriteComplete();
             break;
             
         default:
@@ -254,10 +268,12 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 * 2. Initializes a buffer from which data is sent out over BLE
 * 3. Registers a Protocol Service Multiplexer (PSM) for the L2CAP channel
 * 4. Sends L2CAP channel request to the peer device once BLE connection is made
-* 5. Once the L2CAP channel is made, starts sending data until credits exhaust
-*    and waits for more credits
-* 6. The data is sent only when the previous data is transmitted completely, 
-*    to avoid packet loss.
+* 5. Once the L2CAP channel is made, keeps the L2CAP stream's send queue 
+*    filled. The stream sends the data as long as credits are available and 
+*    waits for more credits.
+* 6. Up to THROUGHPUT_PACKETS_PER_PASS SDUs are handed to the stack per pass
+*    of the main loop, within the limit of the stream's SDUs in flight.
+* 7. Prints the throughput statistics every THROUGHPUT_REPORT_PERIOD ms
 *
 * Refer Bluetooth 4.1 specification, Volume 3, Part A, section 3.4 for details.
 *
@@ -268,11 +284,14 @@ void StackEventHandler(uint32 eventCode, void * eventParam)
 int main()
 {
     uint32 counter = 0; 
+    uint16 sduSize;
+    uint8 packet;
     
     CyGlobalIntEnable; 
     
     CyBle_Start(StackEventHandler);
     UART_Start();
+    Throughput_Init();
 
     /* Clear screen and put a welcome message */
     UART_UartPutChar(12);
@@ -312,17 +331,32 @@ int main()
                     break;
                     
                 case CHANNEL_CREATED:
-                    /* Keep sending data as long as credits are available.
-                     * Maximum of (peer device's MTU - 2) bytes can be sent in 
-                     * one LE-frame.
-                     * New data is sent only when the previous data is 
-                     * transmitted completely.
+                    /* Keep the send queue filled with test data; the stream 
+                     * segments it into SDUs of up to the peer device's MTU 
+                     * and sends them as long as credits are available.
                      */
-                    if(previousDataTransmitted == true)
+                    if(L2capStream_IsTxFull() == false)
                     {
-                        CyBle_L2capChannelDataWrite(cyBle_connHandle.bdHandle, l2capCid, buffer, cbfcPeerParameters.mtu - 2);
-                        previousDataTransmitted = false;
+                        L2capStream_Write(buffer, MAX_MTU_SIZE);
                     }
+                    
+                    for(packet = 0; packet < THROUGHPUT_PACKETS_PER_PASS; packet++)
+                    {
+                        sduSize = L2capStream_Process();
+                        if(sduSize == L2CAP_STREAM_SDU_REJECTED)
+                        {
+                            /* Stack busy, the SDU is sent on a later pass */
+                            Throughput_AddRejection();
+                            break;
+                        }
+                        if(sduSize == 0)
+                        {
+                            break;
+                        }
+                        Throughput_AddPacket(sduSize);
+                    }
+                    
+                    Throughput_Process();
                     break;
                     
                 default:
@@ -35,6 +35,9 @@ uint16 appExtMemChecksum = 0u;
 
 #if (ENCRYPTION_ENABLED == YES)
     uint8 emiKey[KEY_LENGTH];
+
+    /* MIC of the image written to the external memory */
+    CR_IMAGE_MIC_T appImageMic;
 #endif /*ENCRYPTION_ENABLED == YES*/
 
 #if (CYDEV_BOOTLOADER_ENABLE == 1)
@@ -47,13 +50,29 @@ uint16 appExtMemChecksum = 0u;
     /***************************************
     *     Function Prototypes
     ***************************************/
-    static cystatus BootloaderEmulator_WritePacket(uint8 status, uint8 buffer[], uint16 size);
+    static uint16   BootloaderEmulator_BuildPacket(uint8 status, uint8 buffer[], uint16 size);
     static uint16   BootloaderEmulator_CalcPacketChecksum(const uint8 buffer[], uint16 size);
     static void     BootloaderEmulator_HostLink(uint8 timeOut);
+
+    /* Session state of the packet engine, kept between packets */
+    static CYBIT  communicationState = BootloaderEmulator_COMMUNICATION_STATE_IDLE;
+    static uint16 dataOffset = 0u;
+    static uint8  dataBuffer[BootloaderEmulator_SIZEOF_COMMAND_BUFFER];
 #endif /*(CYDEV_BOOTLOADER_ENABLE == 0)*/
 
 uint8 emiWriteBuffer[EMI_SIZE_OF_WRITE_BUFFER];
 
+/* Read started by EMI_StartRead() and completed by EMI_WaitRead() */
+static uint32 emiReadAddr;
+static uint32 emiReadSize;
+static uint8 *emiReadData;
+static uint8  emiReadPending = 0u;
+
+#if (ENCRYPTION_ENABLED == YES)
+    /* MIC of the last application page written or read */
+    static uint8 emiPageMic[MIC_DATA_LENGTH];
+#endif /* (ENCRYPTION_ENABLED == YES) */
+
 
 /*******************************************************************************
 * Function Name: EMI_Start
@@ -111,7 +130,8 @@ cystatus EMI_SetPointer(uint32 dataAddr)
 *  uint32 dataSize:
 *   Size of input data
 *  uint8 *data:
-*   Pointer to data that is written to external memory
+*   Pointer to data that is written to external memory. Application pages are
+*   encrypted in the write buffer, the data itself is not modified.
 *
 * Return:
 *  Status
@@ -130,24 +150,21 @@ cystatus EMI_WriteData(uint32 dataAddr, uint32 dataSize, uint8 *data)
 	emiWriteBuffer[EMI_DATA_ADDR_MSB_INDX] = (uint8) (dataAddr >> 8u);
 	emiWriteBuffer[EMI_DATA_ADDR_LSB_INDX] = (uint8) dataAddr;
     
+    for (i = 0; i < dataSize; i++)
+    {        
+        emiWriteBuffer[EMI_DATA_INDX + i] = data[i];   
+    }
+
     #if (ENCRYPTION_ENABLED == YES)
         if (dataAddr >= (META_DATA_ADDR + META_DATA_SIZE) && (dataSize>0))
         {
-            uint8 key[KEY_LENGTH] = {0};
-            uint8 nonce[NONCE_LENGTH] = {0};
-            uint8 encrypted[ENC_BUFFER_SIZE] = {0};
-            uint8 out_mic[MIC_DATA_LENGTH];
             CYBLE_API_RESULT_T result;
             
-            CR_ReadKey(key);
-            CR_ReadNonce(nonce);
-            result = CR_Encrypt(data, dataSize, key, nonce, encrypted, out_mic);
+            /* Encrypt the copy in the write buffer with the nonce of this page,
+               the caller's data is left unchanged */
+            result = CR_EncryptPage(dataAddr, &emiWriteBuffer[EMI_DATA_INDX], (uint16) dataSize, emiPageMic);
             
-            if (result == CYBLE_ERROR_OK)
-            {
-                memcpy(data, encrypted, dataSize);
-            }
-            else
+            if (result != CYBLE_ERROR_OK)
             {
                 if (result == CYBLE_ERROR_INVALID_PARAMETER)
                 {
@@ -169,11 +186,6 @@ cystatus EMI_WriteData(uint32 dataAddr, uint32 dataSize, uint8 *data)
         }
     #endif /* (ENCRYPTION_ENABLED == YES) */
     
-    for (i = 0; i < dataSize; i++)
-    {        
-        emiWriteBuffer[EMI_DATA_INDX + i] = data[i];   
-    }
-
 	/* Write memory address bytes alone to initialize the pointer */
 	(void) EMI_I2CM_I2CMasterWriteBuf( i2cAddr,
 							    (uint8 *) emiWriteBuffer,
@@ -202,7 +214,7 @@ cystatus EMI_WriteData(uint32 dataAddr, uint32 dataSize, uint8 *data)
 ********************************************************************************
 *
 * Summary:
-*  Read data from the external memory.
+*  Read data from the external memory. Blocks until the data is available.
 *
 * Parameters:
 *  uint32 dataAddr: The internal pointer value.
@@ -220,67 +232,166 @@ cystatus EMI_WriteData(uint32 dataAddr, uint32 dataSize, uint8 *data)
 *    CYBLE_ERROR_INVALID_PARAMETER - problems with decryption
 *******************************************************************************/
 cystatus EMI_ReadData(uint32 dataAddr, uint32 dataSize, uint8 *data)
+{
+    cystatus status;
+
+    status = EMI_StartRead(dataAddr, dataSize, data);
+
+    if (CYRET_SUCCESS == status)
+    {
+        status = EMI_WaitRead();
+    }
+
+    return (status);
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_StartRead
+********************************************************************************
+*
+* Summary:
+*  Starts reading data from the external memory and returns without waiting
+*  for the transfer to complete. The I2C master receives the data in the
+*  background. EMI_WaitRead() must be called to complete the read before the
+*  data is used or any other external memory function is called. When no
+*  transfer could be started, EMI_WaitRead() returns a failure as well.
+*
+* Parameters:
+*  uint32 dataAddr: The internal pointer value.
+*   
+*  uint32 dataSize: Size of output data
+*   
+*  uint8 *data:     Pointer to data that is read from external memory
+*   
+*
+* Return:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           Successful
+*    Other non-zero          Failure
+*******************************************************************************/
+cystatus EMI_StartRead(uint32 dataAddr, uint32 dataSize, uint8 *data)
 {
     cystatus status;
     uint8 i2cAddr = (dataAddr > EMI_HIGHEST_ADDR_OF_LOW_BLOCK) ?
                         EMI_I2C_SLAVE_ADDR_HIGH_64K :
                         EMI_I2C_SLAVE_ADDR_LOW_64K;
+
+    emiReadPending = 0u;
     status =  EMI_SetPointer(dataAddr);
 
     if (CYRET_SUCCESS == status)
     {
-        /* Read the data from the FRAM into ReadBuf */
-        (void) EMI_I2CM_I2CMasterReadBuf(  i2cAddr,
+        emiReadAddr = dataAddr;
+        emiReadSize = dataSize;
+        emiReadData = data;
+
+        /* Start reading the data from the FRAM into ReadBuf */
+        if (EMI_I2CM_I2C_MSTR_NO_ERROR == EMI_I2CM_I2CMasterReadBuf(  i2cAddr,
                                     (uint8 *) data,
                                     dataSize,
-                                    EMI_I2CM_I2C_MODE_COMPLETE_XFER);
-
-        while(0u == (EMI_I2CM_I2CMasterStatus() & EMI_I2CM_I2C_MSTAT_RD_CMPLT))
+                                    EMI_I2CM_I2C_MODE_COMPLETE_XFER))
         {
-            /* Wait until master complete reading */
+            emiReadPending = 1u;
         }
-
-        if (0u != (EMI_I2CM_I2C_MSTAT_ERR_XFER & EMI_I2CM_I2CMasterStatus()))
+        else
         {
             status = CYRET_UNKNOWN;
         }
+    }
 
-        /* Clear I2C master status */
-        (void) EMI_I2CM_I2CMasterClearStatus();
-        
-        #if (ENCRYPTION_ENABLED == YES)
-        /*Encrypt data except to metadata*/
-        
+    return (status);
+}
 
-        if (dataAddr >= (META_DATA_ADDR + META_DATA_SIZE) && (dataSize>0))
+
+/*******************************************************************************
+* Function Name: EMI_WaitRead
+********************************************************************************
+*
+* Summary:
+*  Waits for the read started by EMI_StartRead() to complete and decrypts the
+*  data if encryption is enabled.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           Successful
+*    CYRET_INVALID_STATE     No read was started
+*    Other non-zero          Failure
+*    CYBLE_ERROR_INVALID_PARAMETER - problems with decryption
+*******************************************************************************/
+cystatus EMI_WaitRead(void)
+{
+    cystatus status = CYRET_SUCCESS;
+
+    if (0u == emiReadPending)
+    {
+        return (CYRET_INVALID_STATE);
+    }
+    emiReadPending = 0u;
+
+    while(0u == (EMI_I2CM_I2CMasterStatus() & EMI_I2CM_I2C_MSTAT_RD_CMPLT))
+    {
+        /* Wait until master complete reading */
+    }
+
+    if (0u != (EMI_I2CM_I2C_MSTAT_ERR_XFER & EMI_I2CM_I2CMasterStatus()))
+    {
+        status = CYRET_UNKNOWN;
+    }
+
+    /* Clear I2C master status */
+    (void) EMI_I2CM_I2CMasterClearStatus();
+    
+    #if (ENCRYPTION_ENABLED == YES)
+    /*Encrypt data except to metadata*/
+    
+
+    if ((CYRET_SUCCESS == status) && (emiReadAddr >= (META_DATA_ADDR + META_DATA_SIZE)) && (emiReadSize>0))
+    {
+        CYBLE_API_RESULT_T result;
+        
+        /* Decrypt in place. The page MIC is kept for EMI_GetPageMic(), the
+           caller checks it as part of the image MIC. */
+        result = CR_DecryptPage(emiReadAddr, emiReadData, (uint16) emiReadSize, emiPageMic);
+        if (result == CYBLE_ERROR_INVALID_PARAMETER)
         {
-            uint8 key[KEY_LENGTH] = {0};
-            uint8 nonce[NONCE_LENGTH] = {0};
-            uint8 decrypted[ENC_BUFFER_SIZE] = {0};
-            uint8 out_mic[MIC_DATA_LENGTH]={0};
-            CYBLE_API_RESULT_T result;
-            
-            CR_ReadKey(key);
-            CR_ReadNonce(nonce);
-            result = CR_Decrypt(data, dataSize, key, nonce, decrypted, out_mic);
-            /* Invalid MIC_AUTH not checked  as it will consume additional memory and 
-               was not required.*/
-            if (result == CYBLE_ERROR_INVALID_PARAMETER)
-            {
-                DBG_PRINT_TEXT("DECRYPTION ERROR: CYBLE_ERROR_INVALID_PARAMETER            \r\n");
-                status = CYBLE_ERROR_INVALID_PARAMETER;
-            }
-            else
-            {
-                memcpy(data, decrypted, dataSize);
-            }                                            
+            DBG_PRINT_TEXT("DECRYPTION ERROR: CYBLE_ERROR_INVALID_PARAMETER            \r\n");
+            status = CYBLE_ERROR_INVALID_PARAMETER;
         }
-    #endif /* (ENCRYPTION_ENABLED == YES) */
     }
+    #endif /* (ENCRYPTION_ENABLED == YES) */
 
     return (status);
 }
 
+#if (ENCRYPTION_ENABLED == YES)
+/*******************************************************************************
+* Function Name: EMI_GetPageMic
+********************************************************************************
+*
+* Summary:
+*  Returns the MIC of the last application page written to or read from the
+*  external memory.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  Pointer to the page MIC (MIC_DATA_LENGTH bytes)
+*
+*******************************************************************************/
+const uint8 * EMI_GetPageMic(void)
+{
+    return (emiPageMic);
+}
+#endif /* (ENCRYPTION_ENABLED == YES) */
+
+
 /*******************************************************************************
 * Function Name: EMI_EraseAll
 ********************************************************************************
@@ -365,45 +476,7 @@ static uint16 BootloaderEmulator_CalcPacketChecksum(const uint8 buffer[], uint16
 {
     #if(0u != BootloaderEmulator_PACKET_CHECKSUM_CRC)
 
-        uint16 CYDATA crc = BootloaderEmulator_CRC_CCITT_INITIAL_VALUE;
-        uint16 CYDATA tmp;
-        uint8  CYDATA i;
-        uint16 CYDATA tmpIndex = size;
-
-        if(0u == size)
-        {
-            crc = ~crc;
-        }
-        else
-        {
-            do
-            {
-                tmp = buffer[tmpIndex - size];
-
-                for (i = 0u; i < 8u; i++)
-                {
-                    if (0u != ((crc & 0x0001u) ^ (tmp & 0x0001u)))
-                    {
-                        crc = (crc >> 1u) ^ BootloaderEmulator_CRC_CCITT_POLYNOMIAL;
-                    }
-                    else
-                    {
-                        crc >>= 1u;
-                    }
-
-                    tmp >>= 1u;
-                }
-
-                size--;
-            }
-            while(0u != size);
-
-            crc = ~crc;
-            tmp = crc;
-            crc = ( uint16 )(crc << 8u) | (tmp >> 8u);
-        }
-
-        return(crc);
+        return(Crc_CalcPacketCrc(buffer, size));
 
     #else
 
@@ -640,21 +713,10 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
 {
     uint16    CYDATA numberRead;
     uint16    CYDATA rspSize;
-    uint8     CYDATA ackCode;
-    uint16    CYDATA pktChecksum;
     cystatus  CYDATA readStat;
-    uint16    CYDATA pktSize    = 0u;
-    uint16    CYDATA dataOffset = 0u;
     uint8     CYDATA timeOutCnt = 10u;
 
-    #if(0u != BootloaderEmulator_FAST_APP_VALIDATION)
-        uint8 CYDATA clearedMetaData = 0u;
-    #endif  /* (0u != BootloaderEmulator_FAST_APP_VALIDATION) */
-
-    CYBIT     communicationState = BootloaderEmulator_COMMUNICATION_STATE_IDLE;
-
     uint8     packetBuffer[BootloaderEmulator_SIZEOF_COMMAND_BUFFER];
-    uint8     dataBuffer  [BootloaderEmulator_SIZEOF_COMMAND_BUFFER];
 
     /* Initialize communications channel. */
     CyBLE_CyBtldrCommStart();
@@ -664,8 +726,6 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
 
     do
     {
-        ackCode = CYRET_SUCCESS;
-
         do
         {
             readStat = CyBLE_CyBtldrCommRead(packetBuffer,
@@ -685,470 +745,558 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
             continue;
         }
 
-        if((numberRead < BootloaderEmulator_MIN_PKT_SIZE) ||
-           (packetBuffer[BootloaderEmulator_SOP_ADDR] != BootloaderEmulator_SOP))
+        rspSize = BootloaderEmulator_ProcessPacket(packetBuffer, numberRead);
+
+        if(0u != rspSize)
+        {
+            /* Reply with acknowledge or not acknowledge packet */
+            (void) CyBLE_CyBtldrCommWrite(packetBuffer, rspSize, &rspSize, 150u);
+        }
+
+    } while ((0u == timeOut) || (BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState));
+}
+
+
+/*******************************************************************************
+* Function Name: BootloaderEmulator_ProcessPacket
+********************************************************************************
+*
+* Summary:
+*  Checks the framing of one host packet, executes the command and builds the
+*  response packet in place. The function does not touch the communication
+*  interface, so any transport that delivers whole packets can drive it.
+*
+* Parameters:
+*  packetBuffer:
+*   The received packet. It is overwritten with the response, so it must be
+*   BootloaderEmulator_SIZEOF_COMMAND_BUFFER bytes long.
+*  numberRead:
+*   The number of bytes received.
+*
+* Return:
+*   The number of response bytes to send back. 0 if no response is expected.
+*
+*******************************************************************************/
+uint16 BootloaderEmulator_ProcessPacket(uint8 packetBuffer[], uint16 numberRead)
+{
+    uint16    CYDATA rspSize;
+    uint8     CYDATA ackCode = CYRET_SUCCESS;
+    uint16    CYDATA pktChecksum;
+    uint16    CYDATA pktSize    = 0u;
+
+    #if(0u != BootloaderEmulator_FAST_APP_VALIDATION)
+        uint8 CYDATA clearedMetaData = 0u;
+    #endif  /* (0u != BootloaderEmulator_FAST_APP_VALIDATION) */
+
+    if((numberRead < BootloaderEmulator_MIN_PKT_SIZE) ||
+       (packetBuffer[BootloaderEmulator_SOP_ADDR] != BootloaderEmulator_SOP))
+    {
+        ackCode = BootloaderEmulator_ERR_DATA;
+    }
+    else
+    {
+        pktSize = ((uint16)((uint16)packetBuffer[BootloaderEmulator_SIZE_ADDR + 1u] << 8u)) |
+                           packetBuffer[BootloaderEmulator_SIZE_ADDR];
+
+        if((pktSize + BootloaderEmulator_MIN_PKT_SIZE) > numberRead)
+        {
+            ackCode = BootloaderEmulator_ERR_LENGTH;
+        }
+        else if(packetBuffer[BootloaderEmulator_EOP_ADDR(pktSize)] != BootloaderEmulator_EOP)
         {
             ackCode = BootloaderEmulator_ERR_DATA;
         }
         else
         {
-            pktSize = ((uint16)((uint16)packetBuffer[BootloaderEmulator_SIZE_ADDR + 1u] << 8u)) |
-                               packetBuffer[BootloaderEmulator_SIZE_ADDR];
-
             pktChecksum = ((uint16)((uint16)packetBuffer[BootloaderEmulator_CHK_ADDR(pktSize) + 1u] << 8u)) |
                                    packetBuffer[BootloaderEmulator_CHK_ADDR(pktSize)];
 
-            if((pktSize + BootloaderEmulator_MIN_PKT_SIZE) > numberRead)
-            {
-                ackCode = BootloaderEmulator_ERR_LENGTH;
-            }
-            else if(packetBuffer[BootloaderEmulator_EOP_ADDR(pktSize)] != BootloaderEmulator_EOP)
-            {
-                ackCode = BootloaderEmulator_ERR_DATA;
-            }
-            else if(pktChecksum != BootloaderEmulator_CalcPacketChecksum(packetBuffer,
-                                                                        pktSize + BootloaderEmulator_DATA_ADDR))
+            if(pktChecksum != BootloaderEmulator_CalcPacketChecksum(packetBuffer,
+                                                                    pktSize + BootloaderEmulator_DATA_ADDR))
             {
                 ackCode = BootloaderEmulator_ERR_CHECKSUM;
             }
-            else
-            {
-                /* Empty section */
-            }
         }
+    }
+
+    rspSize = 0u;
+    if(ackCode == CYRET_SUCCESS)
+    {
+        uint8 CYDATA btldrData = packetBuffer[BootloaderEmulator_DATA_ADDR];
 
-        rspSize = 0u;
-        if(ackCode == CYRET_SUCCESS)
+        ackCode = BootloaderEmulator_ERR_DATA;
+        switch(packetBuffer[BootloaderEmulator_CMD_ADDR])
         {
-            uint8 CYDATA btldrData = packetBuffer[BootloaderEmulator_DATA_ADDR];
 
-            ackCode = BootloaderEmulator_ERR_DATA;
-            switch(packetBuffer[BootloaderEmulator_CMD_ADDR])
+        /***************************************************************************
+        *   Verify checksum
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_CHECKSUM:
+
+            if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 0u))
             {
+                packetBuffer[BootloaderEmulator_DATA_ADDR] =
+                        (uint8)(BootloaderEmulator_ValidateBootloadable() == CYRET_SUCCESS);
+
+                DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                DBG_PRINT_TEXT("\tVerify Checksum Command:\r\n");
+                DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
+                DBG_PRINT_TEXT("\r\n");
 
-            /***************************************************************************
-            *   Verify checksum
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_CHECKSUM:
+                rspSize = 1u;
+                ackCode = CYRET_SUCCESS;
+            }
+            break;
 
-                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 0u))
+
+        /***************************************************************************
+        *   Get flash size
+        ***************************************************************************/
+
+        #if(0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL)
+
+            case BootloaderEmulator_COMMAND_REPORT_SIZE:
+
+                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 1u))
                 {
-                    packetBuffer[BootloaderEmulator_DATA_ADDR] =
-                            (uint8)(BootloaderEmulator_ValidateBootloadable() == CYRET_SUCCESS);
+                    packetBuffer[BootloaderEmulator_DATA_ADDR]      = LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
+                    packetBuffer[BootloaderEmulator_DATA_ADDR + 1u] = HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
+
+                    packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] =
+                                LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
+
+                    packetBuffer[BootloaderEmulator_DATA_ADDR + 3u] =
+                                HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
+
+                    rspSize = 4u;
+                    ackCode = CYRET_SUCCESS;
 
                     DBG_PRINT_TEXT("\r\n");
                     DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                    DBG_PRINT_TEXT("\tVerify Checksum Command:\r\n");
-                    DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
+                    DBG_PRINT_TEXT("\tGet Flash Size:\r\n");
+
+                    DBG_PRINT_TEXT("\t\tFirst Available Row in Array: 0x");
+                    DBG_PRINT_HEX(HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
+                    DBG_PRINT_HEX(LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
+                    DBG_PRINT_TEXT("\r\n");
+
+                    DBG_PRINT_TEXT("\t\tLast Available Row in Array: 0x");
+                    DBG_PRINT_HEX(HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
+                    DBG_PRINT_HEX(LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
+                    DBG_PRINT_TEXT("\r\n");
                     DBG_PRINT_TEXT("\r\n");
 
-                    rspSize = 1u;
-                    ackCode = CYRET_SUCCESS;
                 }
                 break;
 
+        #endif  /* (0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL) */
 
-            /***************************************************************************
-            *   Get flash size
-            ***************************************************************************/
 
-            #if(0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL)
+        /***************************************************************************
+        *   Program / Erase row
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_PROGRAM:
 
-                case BootloaderEmulator_COMMAND_REPORT_SIZE:
+        /* The btldrData variable holds Flash Array ID */
 
-                    if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 1u))
-                    {
-                        packetBuffer[BootloaderEmulator_DATA_ADDR]      = LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
-                        packetBuffer[BootloaderEmulator_DATA_ADDR + 1u] = HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
+    #if (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL)
 
-                        packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] =
-                                    LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
+        case BootloaderEmulator_COMMAND_ERASE:
+            if (BootloaderEmulator_COMMAND_ERASE == packetBuffer[BootloaderEmulator_CMD_ADDR])
+            {
+                if ((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
+                {
+                    /* Size of FLASH row (no ECC available) */
+                    dataOffset = BootloaderEmulator_FROW_SIZE;
 
-                        packetBuffer[BootloaderEmulator_DATA_ADDR + 3u] =
-                                    HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
+                    (void) memset(dataBuffer, 0, (uint32) dataOffset);
+                }
+                else
+                {
+                    break;
+                }
+            }
 
-                        rspSize = 4u;
-                        ackCode = CYRET_SUCCESS;
+    #endif  /* (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL) */
 
-                        DBG_PRINT_TEXT("\r\n");
-                        DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                        DBG_PRINT_TEXT("\tGet Flash Size:\r\n");
+    #if (0u != BootloaderEmulator_CMD_COPY_ROW_AVAIL)
 
-                        DBG_PRINT_TEXT("\t\tFirst Available Row in Array: 0x");
-                        DBG_PRINT_HEX(HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
-                        DBG_PRINT_HEX(LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
-                        DBG_PRINT_TEXT("\r\n");
+        case BootloaderEmulator_COMMAND_COPY_ROW:
+            /* Delta update: the host sends only the changed rows and copies
+             * the unchanged ones from the application that is running now.
+             */
+            if (BootloaderEmulator_COMMAND_COPY_ROW == packetBuffer[BootloaderEmulator_CMD_ADDR])
+            {
+                uint32 copyRow = ((uint32) btldrData * BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY) +
+                                 (((uint32) packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] << 8u) |
+                                  packetBuffer[BootloaderEmulator_DATA_ADDR + 1u]);
 
-                        DBG_PRINT_TEXT("\t\tLast Available Row in Array: 0x");
-                        DBG_PRINT_HEX(HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
-                        DBG_PRINT_HEX(LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
-                        DBG_PRINT_TEXT("\r\n");
-                        DBG_PRINT_TEXT("\r\n");
+                if ((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u) &&
+                    (0u == dataOffset) && (copyRow < CY_FLASH_NUMBER_ROWS))
+                {
+                    (void) memcpy(dataBuffer,
+                                  (const void *) (CY_FLASH_BASE + (copyRow * CY_FLASH_SIZEOF_ROW)),
+                                  CY_FLASH_SIZEOF_ROW);
 
-                    }
+                    dataOffset = CY_FLASH_SIZEOF_ROW;
+                }
+                else
+                {
+                    ackCode = BootloaderEmulator_ERR_ROW;
                     break;
+                }
+            }
 
-            #endif  /* (0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL) */
-
-
-            /***************************************************************************
-            *   Program / Erase row
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_PROGRAM:
-
-            /* The btldrData variable holds Flash Array ID */
-
-        #if (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL)
+    #endif  /* (0u != BootloaderEmulator_CMD_COPY_ROW_AVAIL) */
 
-            case BootloaderEmulator_COMMAND_ERASE:
-                if (BootloaderEmulator_COMMAND_ERASE == packetBuffer[BootloaderEmulator_CMD_ADDR])
+            if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize >= 3u))
+            {
+                if((dataOffset + (pktSize - 3u)) > BootloaderEmulator_SIZEOF_COMMAND_BUFFER)
                 {
-                    if ((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
-                    {
-                        /* Size of FLASH row (no ECC available) */
-                        dataOffset = BootloaderEmulator_FROW_SIZE;
-
-                        (void) memset(dataBuffer, 0, (uint32) dataOffset);
-                    }
-                    else
-                    {
-                        break;
-                    }
+                    /* The row does not fit the buffer, drop the data queued so far */
+                    dataOffset = 0u;
+                    ackCode = BootloaderEmulator_ERR_LENGTH;
+                    break;
                 }
 
-        #endif  /* (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL) */
+                /* The command may be sent along with the last block of data, to program the row. */
+                (void) memcpy(&dataBuffer[dataOffset],
+                            &packetBuffer[BootloaderEmulator_DATA_ADDR + 3u],
+                            (uint32) pktSize - 3u);
 
-                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize >= 3u))
-                {
-                    /* The command may be sent along with the last block of data, to program the row. */
-                    (void) memcpy(&dataBuffer[dataOffset],
-                                &packetBuffer[BootloaderEmulator_DATA_ADDR + 3u],
-                                (uint32) pktSize - 3u);
+                dataOffset += (pktSize - 3u);
 
-                    dataOffset += (pktSize - 3u);
+                /* Size of FLASH row (no ECC available) */
+                pktSize = CY_FLASH_SIZEOF_ROW;
 
-                    /* Size of FLASH row (no ECC available) */
-                    pktSize = CY_FLASH_SIZEOF_ROW;
 
+                /* Check if we have all data to program */
+                if(dataOffset == pktSize)
+                {
+                    uint16 row;
+                    uint32 size = CY_FLASH_SIZEOF_ROW;
 
-                    /* Check if we have all data to program */
-                    if(dataOffset == pktSize)
+                    /* Save 1st bootloadable application flash row number to the metadata in external memory */
+                    if (appSizeInRows == 0u)
                     {
-                        uint16 row;
-                        uint32 size = CY_FLASH_SIZEOF_ROW;
-
-                        /* Save 1st bootloadable application flash row number to the metadata in external memory */
-                        if (appSizeInRows == 0u)
-                        {
-                            /* Get Flash row number inside of the array */
-                            dataOffset = ((uint16)((uint16)packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] << 8u)) |
-                                                  packetBuffer[BootloaderEmulator_DATA_ADDR + 1u];
-
-                            /* btldrData  - holds flash array Id sent by host */
-                            /* dataOffset - holds flash row Id sent by host   */
-                            row = (uint16)(btldrData * BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY) + dataOffset;
-
-                            /* Save number of the bootloadable application first flash row */
-                            appFirstRowNum = row;
-                        }
-
-                        /* Erase metadata row */
-                        if (appSizeInRows == 0u)
-                        {
-                            /* Ersase content of the external memory */
-                            uint8  erase[CY_FLASH_SIZEOF_ROW] = {0u};
-                            #if (DEBUG_UART_ENABLED == YES)
-                                uint8  tmp[CY_FLASH_SIZEOF_ROW];
-                            #endif /* #if (DEBUG_UART_ENABLED == YES) */
-
-                            #if (DEBUG_UART_ENABLED == YES)
-                                (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
-                            #endif /* #if (DEBUG_UART_ENABLED == YES) */
-                            DBG_PRINT_TEXT("\t\t Metadata Row Before Erase: ");
-                            DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
-                            DBG_PRINT_TEXT("\r\n");
-
-                            (void) EMI_WriteData(EMI_MD_BASE_ADDR , CY_FLASH_SIZEOF_ROW, erase);
-
-                            #if (DEBUG_UART_ENABLED == YES)
-                                (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
-                            #endif /* #if (DEBUG_UART_ENABLED == YES) */
-                            DBG_PRINT_TEXT("\t\t Metadata Row After Erase: ");
-                            DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
-                            DBG_PRINT_TEXT("\r\n");
-                        }
-
-
-                        /* External memory application checksum calculation */
-                        while (size > 0u)
-                        {
-                            size--;
-                            appExtMemChecksum += dataBuffer[size];
-                        }
-
-
-                        /* Write row to the external memory */
-                        (void) EMI_WriteData(EMI_APP_ABS_ADDR(appSizeInRows), CY_FLASH_SIZEOF_ROW, dataBuffer);
-                        appSizeInRows++;
+                        /* Get Flash row number inside of the array */
+                        dataOffset = ((uint16)((uint16)packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] << 8u)) |
+                                              packetBuffer[BootloaderEmulator_DATA_ADDR + 1u];
 
+                        /* btldrData  - holds flash array Id sent by host */
+                        /* dataOffset - holds flash row Id sent by host   */
+                        row = (uint16)(btldrData * BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY) + dataOffset;
 
-                        DBG_PRINT_TEXT("\r\n");
-                        DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                        DBG_PRINT_TEXT("\tProgram Row Command:\r\n");
-                        DBG_PRINT_TEXT("\t\tEMI Address: 0x");
-                        DBG_PRINT_HEX(EMI_APP_ABS_ADDR(appSizeInRows - 1u));
-                        DBG_PRINT_TEXT("\r\n");
+                        /* Save number of the bootloadable application first flash row */
+                        appFirstRowNum = row;
+                    }
 
-                        DBG_PRINT_TEXT("\t\tnumOfTxedRows = 0x");
-                        DBG_PRINT_HEX(appSizeInRows - 1u);
+                    /* Erase metadata row */
+                    if (appSizeInRows == 0u)
+                    {
+                        /* Ersase content of the external memory */
+                        uint8  erase[CY_FLASH_SIZEOF_ROW] = {0u};
+                        #if (DEBUG_UART_ENABLED == YES)
+                            uint8  tmp[CY_FLASH_SIZEOF_ROW];
+                        #endif /* #if (DEBUG_UART_ENABLED == YES) */
+
+                        #if (DEBUG_UART_ENABLED == YES)
+                            (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
+                        #endif /* #if (DEBUG_UART_ENABLED == YES) */
+                        DBG_PRINT_TEXT("\t\t Metadata Row Before Erase: ");
+                        DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
                         DBG_PRINT_TEXT("\r\n");
 
-                        ackCode = CYRET_SUCCESS;
+                        (void) EMI_WriteData(EMI_MD_BASE_ADDR , CY_FLASH_SIZEOF_ROW, erase);
 
+                        #if (DEBUG_UART_ENABLED == YES)
+                            (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
+                        #endif /* #if (DEBUG_UART_ENABLED == YES) */
+                        DBG_PRINT_TEXT("\t\t Metadata Row After Erase: ");
+                        DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
+                        DBG_PRINT_TEXT("\r\n");
                     }
-                    else
+
+
+                    /* External memory application checksum calculation */
+                    while (size > 0u)
                     {
-                        ackCode = BootloaderEmulator_ERR_LENGTH;
+                        size--;
+                        appExtMemChecksum += dataBuffer[size];
                     }
 
-                    dataOffset = 0u;
-                }
-                break;
 
+                    /* Write row to the external memory */
+                    (void) EMI_WriteData(EMI_APP_ABS_ADDR(appSizeInRows), CY_FLASH_SIZEOF_ROW, dataBuffer);
 
-            /***************************************************************************
-            *   Sync bootloader
-            ***************************************************************************/
-            #if(0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL)
+                    #if (ENCRYPTION_ENABLED == YES)
+                        CR_ImageMicUpdate(&appImageMic, EMI_GetPageMic());
+                    #endif /* (ENCRYPTION_ENABLED == YES) */
 
-            case BootloaderEmulator_COMMAND_SYNC:
+                    appSizeInRows++;
 
-                if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
-                {
-                    /* If something failed the host would send this command to reset the bootloader. */
-                    dataOffset = 0u;
-
-                    /* Don't acknowledge the packet, just get ready to accept the next one */
-                    continue;
-                }
-                break;
 
-            #endif  /* (0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL) */
+                    DBG_PRINT_TEXT("\r\n");
+                    DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                    DBG_PRINT_TEXT("\tProgram Row Command:\r\n");
+                    DBG_PRINT_TEXT("\t\tEMI Address: 0x");
+                    DBG_PRINT_HEX(EMI_APP_ABS_ADDR(appSizeInRows - 1u));
+                    DBG_PRINT_TEXT("\r\n");
 
+                    DBG_PRINT_TEXT("\t\tnumOfTxedRows = 0x");
+                    DBG_PRINT_HEX(appSizeInRows - 1u);
+                    DBG_PRINT_TEXT("\r\n");
 
-            /***************************************************************************
-            *   Send data
-            ***************************************************************************/
-            #if (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL)
+                    ackCode = CYRET_SUCCESS;
 
-                case BootloaderEmulator_COMMAND_DATA:
-                    if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
-                    {
-                        /*  Make sure that dataOffset is valid before copying the data */
-                        if((dataOffset + pktSize) <= BootloaderEmulator_SIZEOF_COMMAND_BUFFER)
-                        {
-                            ackCode = CYRET_SUCCESS;
-
-                            #if(CY_PSOC3)
-                                (void) memcpy(&dataBuffer[dataOffset],
-                                              &packetBuffer[BootloaderEmulator_DATA_ADDR],
-                                              ( int16 )pktSize);
-                            #else
-                                (void) memcpy(&dataBuffer[dataOffset],
-                                              &packetBuffer[BootloaderEmulator_DATA_ADDR],
-                                              (uint32) pktSize);
-                            #endif  /* (CY_PSOC3) */
-
-                            dataOffset += pktSize;
-                        }
-                        else
-                        {
-                            ackCode = BootloaderEmulator_ERR_LENGTH;
-                        }
-                    }
+                }
+                else
+                {
+                    ackCode = BootloaderEmulator_ERR_LENGTH;
+                }
 
-                    break;
+                dataOffset = 0u;
+            }
+            break;
 
-            #endif  /* (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL) */
 
+        /***************************************************************************
+        *   Sync bootloader
+        ***************************************************************************/
+        #if(0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL)
 
-            /***************************************************************************
-            *   Enter bootloader
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_ENTER:
+        case BootloaderEmulator_COMMAND_SYNC:
 
-                if(pktSize == 0u)
-                {
-                    uint32 i;
+            if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
+            {
+                /* If something failed the host would send this command to reset the bootloader. */
+                dataOffset = 0u;
 
-                    BootloaderEmulator_ENTER CYDATA BtldrVersion =
-                        {CYDEV_CHIP_JTAG_ID, CYDEV_CHIP_REV_EXPECT, BootloaderEmulator_VERSION};
+                /* Don't acknowledge the packet, just get ready to accept the next one */
+                return (0u);
+            }
+            break;
 
-                    communicationState = BootloaderEmulator_COMMUNICATION_STATE_ACTIVE;
+        #endif  /* (0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL) */
 
-                    rspSize = sizeof(BootloaderEmulator_ENTER);
 
-                    (void) memcpy(&packetBuffer[BootloaderEmulator_DATA_ADDR],
-                                &BtldrVersion,
-                                (uint32) rspSize);
+        /***************************************************************************
+        *   Send data
+        ***************************************************************************/
+        #if (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL)
 
+            case BootloaderEmulator_COMMAND_DATA:
+                if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
+                {
+                    /*  Make sure that dataOffset is valid before copying the data */
+                    if((dataOffset + pktSize) <= BootloaderEmulator_SIZEOF_COMMAND_BUFFER)
+                    {
+                        ackCode = CYRET_SUCCESS;
 
-                    /* Perform initializations */
-                    appSizeInRows = 0u;
-                    appExtMemChecksum = 0u;
-                    for (i = 0u; i < CY_FLASH_SIZEOF_ROW; i++ )
+                        #if(CY_PSOC3)
+                            (void) memcpy(&dataBuffer[dataOffset],
+                                          &packetBuffer[BootloaderEmulator_DATA_ADDR],
+                                          ( int16 )pktSize);
+                        #else
+                            (void) memcpy(&dataBuffer[dataOffset],
+                                          &packetBuffer[BootloaderEmulator_DATA_ADDR],
+                                          (uint32) pktSize);
+                        #endif  /* (CY_PSOC3) */
+
+                        dataOffset += pktSize;
+                    }
+                    else
                     {
-                        metadata[i] = 0u;
+                        ackCode = BootloaderEmulator_ERR_LENGTH;
                     }
-
-
-                    DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                    DBG_PRINT_TEXT("\tEnter bootloader:\r\n");
-                    DBG_PRINT_TEXT("\r\n");
-
-                    #if (ENCRYPTION_ENABLED == YES)
-                        /*Generate key*/
-                        CR_GenerateKey(emiKey);
-                        DBG_PRINT_TEXT("Generated Key: ");
-                        DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
-                        DBG_PRINT_TEXT("\r\n");
-                        CR_WriteKey(emiKey);
-                        CR_ReadKey(emiKey);
-                        DBG_PRINT_TEXT("Read Key     : ");
-                        DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
-                        DBG_PRINT_TEXT("\r\n");
-                        
-                    #endif /*(ENCRYPTION_ENABLED == YES)*/
-                    
-                    ackCode = CYRET_SUCCESS;
                 }
-                break;
 
+                break;
 
-            /***************************************************************************
-            *   Verify row
-            ***************************************************************************/
-            #if (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL)
+        #endif  /* (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL) */
 
-            case BootloaderEmulator_COMMAND_VERIFY:
 
-                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
-                {
-                    uint8 CYDATA checksum;
+        /***************************************************************************
+        *   Enter bootloader
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_ENTER:
 
-                    checksum = BootloaderEmulator_Calc8BitSum(appSizeInRows - 1u);
+            if(pktSize == 0u)
+            {
+                uint32 i;
 
-                    packetBuffer[BootloaderEmulator_DATA_ADDR] = (uint8)1u + (uint8)(~checksum);
-                    ackCode = CYRET_SUCCESS;
-                    rspSize = 1u;
+                BootloaderEmulator_ENTER CYDATA BtldrVersion =
+                    {CYDEV_CHIP_JTAG_ID, CYDEV_CHIP_REV_EXPECT, BootloaderEmulator_VERSION};
 
-                    DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                    DBG_PRINT_TEXT("\tVerify Row:\r\n");
-                    DBG_PRINT_TEXT("\t\tRow Checksum: 0x");
-                    DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
-                    DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("\r\n");
-                }
-                break;
+                communicationState = BootloaderEmulator_COMMUNICATION_STATE_ACTIVE;
 
-            #endif /* (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL) */
+                rspSize = sizeof(BootloaderEmulator_ENTER);
 
+                (void) memcpy(&packetBuffer[BootloaderEmulator_DATA_ADDR],
+                            &BtldrVersion,
+                            (uint32) rspSize);
 
-            /***************************************************************************
-            *   Exit bootloader
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_EXIT:
 
-                if(CYRET_SUCCESS == BootloaderEmulator_ValidateBootloadable())
+                /* Perform initializations */
+                appSizeInRows = 0u;
+                appExtMemChecksum = 0u;
+                for (i = 0u; i < CY_FLASH_SIZEOF_ROW; i++ )
                 {
-                    BootloaderEmulator_SET_RUN_TYPE(BootloaderEmulator_SCHEDULE_BTLDR);
+                    metadata[i] = 0u;
+                }
 
+
+                DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                DBG_PRINT_TEXT("\tEnter bootloader:\r\n");
+                DBG_PRINT_TEXT("\r\n");
+
+                #if (ENCRYPTION_ENABLED == YES)
+                    /*Generate key*/
+                    CR_GenerateKey(emiKey);
+                    DBG_PRINT_TEXT("Generated Key: ");
+                    DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
                     DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                    DBG_PRINT_TEXT("\tExit Bootloader:\r\n");
-                    DBG_PRINT_TEXT("\t\tBootloadable Application is valid.\r\n");
-                    metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_VALID;
-                    metadata[EMI_MD_ENCRYPTION_STATUS_ADDR] = ENCRYPTION_ENABLED;
-                }
-                else
-                {
+                    CR_WriteKey(emiKey);
+                    CR_ReadKey(emiKey);
+                    DBG_PRINT_TEXT("Read Key     : ");
+                    DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
                     DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                    DBG_PRINT_TEXT("\tExit Bootloader:\r\n");
-                    DBG_PRINT_TEXT("\t\tBootloadable Application is invalid.\r\n");
-                    metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_INVALID;
-                }
 
-                /* Update metadata section and save it to the external memory */
+                    CR_ImageMicStart(&appImageMic);
+                    
+                #endif /*(ENCRYPTION_ENABLED == YES)*/
                 
-                metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR      ]    = LO8(appSizeInRows);
-                metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR + 1u ]    = HI8(appSizeInRows);
-                metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR     ]    = LO8(appFirstRowNum);
-                metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR + 1u]    = HI8(appFirstRowNum);
-                appExtMemChecksum = ( uint16 )1u + ( uint16 )(~appExtMemChecksum);
-                metadata[EMI_MD_APP_EM_CHECKSUM_ADDR     ]      = LO8(appExtMemChecksum);
-                metadata[EMI_MD_APP_EM_CHECKSUM_ADDR + 1u]      = HI8(appExtMemChecksum);
-                metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR] = EMI_EXTERNAL_MEMORY_PAGE_SIZE;
+                ackCode = CYRET_SUCCESS;
+            }
+            break;
 
 
-                (void) EMI_WriteData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, metadata);
+        /***************************************************************************
+        *   Verify row
+        ***************************************************************************/
+        #if (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL)
 
+        case BootloaderEmulator_COMMAND_VERIFY:
 
-                DBG_PRINT_TEXT("\t\tApplication Status: 0x");
-                DBG_PRINT_HEX(metadata[EMI_MD_APP_STATUS_ADDR]);
-                DBG_PRINT_TEXT("\r\n");
+            if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
+            {
+                uint8 CYDATA checksum;
 
-                DBG_PRINT_TEXT("\t\tSize Application in Rows: 0x");
-                DBG_PRINT_HEX(appSizeInRows);
-                DBG_PRINT_TEXT("\r\n");
+                checksum = BootloaderEmulator_Calc8BitSum(appSizeInRows - 1u);
 
-                DBG_PRINT_TEXT("\t\tFirst Flash Row Number: 0x");
-                DBG_PRINT_HEX(appFirstRowNum);
-                DBG_PRINT_TEXT("\r\n");
+                packetBuffer[BootloaderEmulator_DATA_ADDR] = (uint8)1u + (uint8)(~checksum);
+                ackCode = CYRET_SUCCESS;
+                rspSize = 1u;
 
-                DBG_PRINT_TEXT("\t\tExternal Memory Page Size: 0x");
-                DBG_PRINT_HEX(metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR]);
-                DBG_PRINT_TEXT(" KB");
                 DBG_PRINT_TEXT("\r\n");
-
+                DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                DBG_PRINT_TEXT("\tVerify Row:\r\n");
+                DBG_PRINT_TEXT("\t\tRow Checksum: 0x");
+                DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
                 DBG_PRINT_TEXT("\r\n");
                 DBG_PRINT_TEXT("\r\n");
-                DBG_PRINT_TEXT("===============================================================================\r\n");
-                DBG_PRINT_TEXT("=    BLE_External_Memory_Bootloadable Application Performs Software Reset     =\r\n");
-                DBG_PRINT_TEXT("===============================================================================\r\n");
+            }
+            break;
+
+        #endif /* (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL) */
+
+
+        /***************************************************************************
+        *   Exit bootloader
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_EXIT:
+
+            if(CYRET_SUCCESS == BootloaderEmulator_ValidateBootloadable())
+            {
+                BootloaderEmulator_SET_RUN_TYPE(BootloaderEmulator_SCHEDULE_BTLDR);
+
                 DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                DBG_PRINT_TEXT("\tExit Bootloader:\r\n");
+                DBG_PRINT_TEXT("\t\tBootloadable Application is valid.\r\n");
+                metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_VALID;
+                metadata[EMI_MD_ENCRYPTION_STATUS_ADDR] = ENCRYPTION_ENABLED;
+            }
+            else
+            {
                 DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                DBG_PRINT_TEXT("\tExit Bootloader:\r\n");
+                DBG_PRINT_TEXT("\t\tBootloadable Application is invalid.\r\n");
+                metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_INVALID;
+            }
 
-                CySoftwareReset();
+            /* Update metadata section and save it to the external memory */
+            
+            metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR      ]    = LO8(appSizeInRows);
+            metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR + 1u ]    = HI8(appSizeInRows);
+            metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR     ]    = LO8(appFirstRowNum);
+            metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR + 1u]    = HI8(appFirstRowNum);
+            appExtMemChecksum = ( uint16 )1u + ( uint16 )(~appExtMemChecksum);
+            metadata[EMI_MD_APP_EM_CHECKSUM_ADDR     ]      = LO8(appExtMemChecksum);
+            metadata[EMI_MD_APP_EM_CHECKSUM_ADDR + 1u]      = HI8(appExtMemChecksum);
+            metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR] = EMI_EXTERNAL_MEMORY_PAGE_SIZE;
 
-                /* Will never get here */
-                break;
 
+            #if (ENCRYPTION_ENABLED == YES)
+                CR_ImageMicFinish(&appImageMic, &metadata[EMI_MD_APP_MIC_ADDR]);
+            #endif /* (ENCRYPTION_ENABLED == YES) */
 
-            /***************************************************************************
-            *   Unsupported command
-            ***************************************************************************/
-            default:
-                ackCode = BootloaderEmulator_ERR_CMD;
-                break;
-            }
-        }
+            (void) EMI_WriteData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, metadata);
 
-        /* Reply with acknowledge or not acknowledge packet */
-        (void) BootloaderEmulator_WritePacket(ackCode, packetBuffer, rspSize);
 
-    } while ((0u == timeOut) || (BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState));
+            DBG_PRINT_TEXT("\t\tApplication Status: 0x");
+            DBG_PRINT_HEX(metadata[EMI_MD_APP_STATUS_ADDR]);
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\t\tSize Application in Rows: 0x");
+            DBG_PRINT_HEX(appSizeInRows);
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\t\tFirst Flash Row Number: 0x");
+            DBG_PRINT_HEX(appFirstRowNum);
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\t\tExternal Memory Page Size: 0x");
+            DBG_PRINT_HEX(metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR]);
+            DBG_PRINT_TEXT(" KB");
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("===============================================================================\r\n");
+            DBG_PRINT_TEXT("=    BLE_External_Memory_Bootloadable Application Performs Software Reset     =\r\n");
+            DBG_PRINT_TEXT("===============================================================================\r\n");
+            DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("\r\n");
+
+            CySoftwareReset();
+
+            /* Will never get here */
+            break;
+
+
+        /***************************************************************************
+        *   Unsupported command
+        ***************************************************************************/
+        default:
+            ackCode = BootloaderEmulator_ERR_CMD;
+            break;
+        }
+    }
+
+    return (BootloaderEmulator_BuildPacket(ackCode, packetBuffer, rspSize));
 }
 
 
 /*******************************************************************************
-* Function Name: BootloaderEmulator_WritePacket
+* Function Name: BootloaderEmulator_BuildPacket
 ********************************************************************************
 *
 * Summary:
-*  Creates a bootloader response packet and transmits it back to the bootloader
-*  host application over the already established communications protocol.
+*  Creates a bootloader response packet in place. The caller transmits it back
+*  to the bootloader host application.
 *
 * Parameters:
 *  status:
@@ -1159,10 +1307,10 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
 *      The number of bytes contained within the buffer to pass back
 *
 * Return:
-*   CYRET_SUCCESS if successful. Any other non-zero value if failure occurred.
+*   The number of bytes in the response packet.
 *
 *******************************************************************************/
-static cystatus BootloaderEmulator_WritePacket(uint8 status, uint8 buffer[], uint16 size)
+static uint16 BootloaderEmulator_BuildPacket(uint8 status, uint8 buffer[], uint16 size)
 {
     uint16 CYDATA checksum;
 
@@ -1179,8 +1327,7 @@ static cystatus BootloaderEmulator_WritePacket(uint8 status, uint8 buffer[], uin
     buffer[BootloaderEmulator_CHK_ADDR(1u + size)] = HI8(checksum);
     buffer[BootloaderEmulator_EOP_ADDR(size)]     = BootloaderEmulator_EOP;
 
-    /* Start packet transmit. */
-    return(CyBLE_CyBtldrCommWrite(buffer, size + BootloaderEmulator_MIN_PKT_SIZE, &size, 150u));
+    return(size + BootloaderEmulator_MIN_PKT_SIZE);
 }
 #endif /* (CYDEV_BOOTLOADER_ENABLE == 0) */
 
@@ -55,6 +55,177 @@ void CR_Initialization(void)
 }
 
 
+/*******************************************************************************
+* Function Name: CR_AesEncryptBlock
+********************************************************************************
+*
+* Summary:
+*  Encrypts one block with AES-128. This is the only platform dependent part of
+*  the CCM implementation below. Input and output may be the same buffer.
+*
+* Parameters:
+*  uint8 * key:         Pointer to the 16-byte key.
+*  uint8 * in:          Pointer to the 16-byte block to encrypt.
+*  uint8 * out:         Pointer to the 16-byte encrypted block.
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+static void CR_AesEncryptBlock(uint8 * key, uint8 * in, uint8 * out)
+{
+    uint8 block[CR_AES_BLOCK_SIZE];
+
+    (void) CyBle_AesEncrypt(in, key, block);
+    memcpy(out, block, CR_AES_BLOCK_SIZE);
+}
+
+
+/*******************************************************************************
+* Function Name: CR_CcmStart
+********************************************************************************
+*
+* Summary:
+*  Starts AES-CCM encryption or decryption of a message of the given length.
+*  The data is then passed to CR_CcmUpdate() in pieces of any size and the MIC
+*  is produced by CR_CcmFinish(). Prefix CR stands for en/decryption to show
+*  that it is part of encryption module.
+*
+* Parameters:
+*  CR_CCM_CTX_T * ctx:  Pointer to the operation state.
+*  uint8 * key:         Pointer to the 16-byte key.
+*  uint8 * nonce:       Pointer to the 13-byte nonce. A nonce must never be
+*                       used twice with the same key.
+*  uint16 length:       Total length of the message, in Bytes.
+*  uint8 mode:          CR_CCM_ENCRYPT or CR_CCM_DECRYPT.
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_CcmStart(CR_CCM_CTX_T * ctx, const uint8 * key, const uint8 * nonce,
+    uint16 length, uint8 mode)
+{
+    memcpy(ctx->key, key, KEY_LENGTH);
+
+    /* B0: flags, nonce and message length. There is no associated data. */
+    ctx->mac[0u] = (uint8) ((((MIC_DATA_LENGTH - 2u) / 2u) << 3u) | (CR_CCM_LENGTH_SIZE - 1u));
+    memcpy(&ctx->mac[1u], nonce, NONCE_LENGTH);
+    ctx->mac[CR_AES_BLOCK_SIZE - 2u] = HI8(length);
+    ctx->mac[CR_AES_BLOCK_SIZE - 1u] = LO8(length);
+    CR_AesEncryptBlock(ctx->key, ctx->mac, ctx->mac);
+
+    /* A0: flags, nonce and block counter. A0 encrypts the MIC, the data is
+    * encrypted starting from A1. */
+    ctx->ctr[0u] = CR_CCM_LENGTH_SIZE - 1u;
+    memcpy(&ctx->ctr[1u], nonce, NONCE_LENGTH);
+    ctx->ctr[CR_AES_BLOCK_SIZE - 2u] = 0u;
+    ctx->ctr[CR_AES_BLOCK_SIZE - 1u] = 0u;
+
+    ctx->offset = 0u;
+    ctx->mode = mode;
+}
+
+
+/*******************************************************************************
+* Function Name: CR_CcmUpdate
+********************************************************************************
+*
+* Summary:
+*  Encrypts or decrypts the next piece of the message started by CR_CcmStart().
+*  Input and output may be the same buffer. Prefix CR stands for en/decryption
+*  to show that it is part of encryption module.
+*
+* Parameters:
+*  CR_CCM_CTX_T * ctx:  Pointer to the operation state.
+*  uint8 * in:          Pointer to the input data.
+*  uint8 * out:         Pointer to an array of size 'size' for the output data.
+*  uint16 size:         Size of the piece, in Bytes.
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_CcmUpdate(CR_CCM_CTX_T * ctx, const uint8 * in, uint8 * out, uint16 size)
+{
+    uint16 i;
+    uint8 plain;
+
+    for (i = 0u; i < size; i++)
+    {
+        if (0u == ctx->offset)
+        {
+            /* Generate key stream of the next block */
+            ctx->ctr[CR_AES_BLOCK_SIZE - 1u]++;
+            if (0u == ctx->ctr[CR_AES_BLOCK_SIZE - 1u])
+            {
+                ctx->ctr[CR_AES_BLOCK_SIZE - 2u]++;
+            }
+            CR_AesEncryptBlock(ctx->key, ctx->ctr, ctx->stream);
+        }
+
+        if (CR_CCM_ENCRYPT == ctx->mode)
+        {
+            plain = in[i];
+            out[i] = plain ^ ctx->stream[ctx->offset];
+        }
+        else
+        {
+            plain = in[i] ^ ctx->stream[ctx->offset];
+            out[i] = plain;
+        }
+
+        /* The MIC is always calculated over the plain text */
+        ctx->mac[ctx->offset] ^= plain;
+        ctx->offset++;
+
+        if (CR_AES_BLOCK_SIZE == ctx->offset)
+        {
+            CR_AesEncryptBlock(ctx->key, ctx->mac, ctx->mac);
+            ctx->offset = 0u;
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CR_CcmFinish
+********************************************************************************
+*
+* Summary:
+*  Completes the operation started by CR_CcmStart() and outputs the MIC. Prefix
+*  CR stands for en/decryption to show that it is part of encryption module.
+*
+* Parameters:
+*  CR_CCM_CTX_T * ctx:  Pointer to the operation state.
+*  uint8 * mic:         Pointer to an array of bytes (4 Bytes) to store the
+*                       MIC of the message.
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_CcmFinish(CR_CCM_CTX_T * ctx, uint8 * mic)
+{
+    uint8 i;
+
+    /* The last block is padded with zeros */
+    if (0u != ctx->offset)
+    {
+        CR_AesEncryptBlock(ctx->key, ctx->mac, ctx->mac);
+    }
+
+    ctx->ctr[CR_AES_BLOCK_SIZE - 2u] = 0u;
+    ctx->ctr[CR_AES_BLOCK_SIZE - 1u] = 0u;
+    CR_AesEncryptBlock(ctx->key, ctx->ctr, ctx->stream);
+
+    for (i = 0u; i < MIC_DATA_LENGTH; i++)
+    {
+        mic[i] = ctx->mac[i] ^ ctx->stream[i];
+    }
+}
+
+
 /*******************************************************************************
 * Function Name: CR_Encrypt
 ********************************************************************************
@@ -94,12 +265,7 @@ CYBLE_API_RESULT_T CR_Encrypt(
     uint8 * encrypted, 
     uint8 * out_mic)
 {
-    CYBLE_API_RESULT_T retval = CYBLE_ERROR_OK;
-    uint16 blockLeft;
-    uint16 blockLength = 0;
-    uint16 offset = 0;
-    uint8 inBuf[EBCRYPTION_BLOCK_LENGTH];
-    uint8 outBuf[EBCRYPTION_BLOCK_LENGTH];
+    CR_CCM_CTX_T ccm;
     
     /*Input parameters check*/
     if ((plain == NULL) || (key == NULL) || (nonce == NULL) || \
@@ -117,23 +283,11 @@ CYBLE_API_RESULT_T CR_Encrypt(
         }
     #endif /*(CYDEV_BOOTLOADER_ENABLE == 1)*/
     
-    /* Split plain text in to acceptable number of blocks */  
-    for(offset=0;offset<length;offset+=EBCRYPTION_BLOCK_LENGTH)
-    {
+    CR_CcmStart(&ccm, key, nonce, length, CR_CCM_ENCRYPT);
+    CR_CcmUpdate(&ccm, plain, encrypted, length);
+    CR_CcmFinish(&ccm, out_mic);
 
-        blockLeft = length - offset;
-        blockLength = blockLeft < EBCRYPTION_BLOCK_LENGTH ? blockLeft : EBCRYPTION_BLOCK_LENGTH;
-        memcpy(inBuf, plain+offset, blockLength);
-        retval = CyBle_AesCcmEncrypt(key, nonce, inBuf, blockLength, outBuf, out_mic);
-        
-        /*Do not store MIC and check MIC authorization, due to memory consumption*/
-        if (retval == CYBLE_ERROR_OK || retval == CYBLE_ERROR_MIC_AUTH_FAILED)
-        {
-            memcpy(encrypted+offset, outBuf, blockLength);
-        }
-        
-    }
-    return (retval);
+    return (CYBLE_ERROR_OK);
 }
 
 
@@ -178,12 +332,8 @@ CYBLE_API_RESULT_T CR_Decrypt(uint8 * encrypted,
     uint8 * decrypted , 
     uint8 * out_mic)
 {
-    CYBLE_API_RESULT_T retval = CYBLE_ERROR_OK;
-    uint16 blockLeft;
-    uint16 blockLength = 0;
-    uint16 offset = 0; 
-    uint8 inBuf[EBCRYPTION_BLOCK_LENGTH];
-    uint8 outBuf[EBCRYPTION_BLOCK_LENGTH];
+    CR_CCM_CTX_T ccm;
+    uint8 mic[MIC_DATA_LENGTH];
     
     /*Input parameters check*/
     if ((encrypted == NULL) || (key == NULL) || (nonce == NULL) || \
@@ -201,24 +351,16 @@ CYBLE_API_RESULT_T CR_Decrypt(uint8 * encrypted,
         }
     #endif /*(CYDEV_BOOTLOADER_ENABLE == 1)*/
     
-    /* Split plain text in to acceptable number of blocks */
+    CR_CcmStart(&ccm, key, nonce, length, CR_CCM_DECRYPT);
+    CR_CcmUpdate(&ccm, encrypted, decrypted, length);
+    CR_CcmFinish(&ccm, mic);
 
-    for(offset=0;offset<length;offset+=EBCRYPTION_BLOCK_LENGTH)
+    if (0 != memcmp(mic, out_mic, MIC_DATA_LENGTH))
     {
-
-        blockLeft = length - offset;
-        blockLength = blockLeft < EBCRYPTION_BLOCK_LENGTH ? blockLeft : EBCRYPTION_BLOCK_LENGTH;
-        
-        memcpy(inBuf, encrypted+offset, blockLength);
-        
-        retval = CyBle_AesCcmDecrypt(key, nonce, inBuf, blockLength, outBuf, out_mic);
-        
-        if (retval != CYBLE_ERROR_INVALID_PARAMETER)
-        {
-            memcpy(decrypted+offset, outBuf, blockLength);;
-        }
+        return (CYBLE_ERROR_MIC_AUTH_FAILED);
     }
-    return (retval);
+
+    return (CYBLE_ERROR_OK);
 }
 
 
@@ -383,6 +525,216 @@ void CR_ReadKey(uint8 * key)
 }
 
 
+/*******************************************************************************
+* Function Name: CR_MakePageNonce
+********************************************************************************
+*
+* Summary:
+*  Builds the nonce of the external memory page at the given address, so that
+*  no two pages of an image share a key stream. Prefix CR stands for
+*  en/decryption to show that it is part of encryption module.
+*
+* Parameters:
+*   uint32 address: External memory address of the page.
+*   uint8 * nonce:  Pointer to an array of bytes for the nonce output. The
+*                   array length to be allocated by the application is 13 Bytes.
+* 
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_MakePageNonce(uint32 address, uint8 * nonce)
+{
+    CR_ReadNonce(nonce);
+
+    nonce[NONCE_LENGTH - 4u] = (uint8) (address >> 24u);
+    nonce[NONCE_LENGTH - 3u] = (uint8) (address >> 16u);
+    nonce[NONCE_LENGTH - 2u] = (uint8) (address >> 8u);
+    nonce[NONCE_LENGTH - 1u] = (uint8) address;
+}
+
+
+/*******************************************************************************
+* Function Name: CR_CryptPage
+********************************************************************************
+*
+* Summary:
+*  Encrypts or decrypts an external memory page in place with the stored key
+*  and the nonce of the page.
+*
+* Parameters:
+*   uint32 address: External memory address of the page.
+*   uint8 * data:   Pointer to the page data.
+*   uint16 length:  Length of the page data, in Bytes.
+*   uint8 * mic:    Pointer to an array of bytes (4 Bytes) to store the MIC of
+*                   the page.
+*   uint8 mode:     CR_CCM_ENCRYPT or CR_CCM_DECRYPT.
+*
+* Return:
+*   CYBLE_API_RESULT_T: Return value indicates if the function succeeded or
+*   failed. Following are the possible error codes.
+*       CYBLE_ERROR_OK                    On successful operation.
+*       CYBLE_ERROR_INVALID_PARAMETER     One of the inputs is a null pointer.
+*
+*******************************************************************************/
+static CYBLE_API_RESULT_T CR_CryptPage(uint32 address, uint8 * data, uint16 length,
+    uint8 * mic, uint8 mode)
+{
+    CR_CCM_CTX_T ccm;
+    uint8 key[KEY_LENGTH];
+    uint8 nonce[NONCE_LENGTH];
+
+    if ((data == NULL) || (mic == NULL))
+    {
+        return (CYBLE_ERROR_INVALID_PARAMETER);
+    }
+
+    #if (CYDEV_BOOTLOADER_ENABLE == 1)
+        if (!encryptionEnabled)
+        {
+            memset(mic, 0, MIC_DATA_LENGTH);
+            return (CYBLE_ERROR_OK);
+        }
+    #endif /*(CYDEV_BOOTLOADER_ENABLE == 1)*/
+
+    CR_ReadKey(key);
+    CR_MakePageNonce(address, nonce);
+
+    CR_CcmStart(&ccm, key, nonce, length, mode);
+    CR_CcmUpdate(&ccm, data, data, length);
+    CR_CcmFinish(&ccm, mic);
+
+    return (CYBLE_ERROR_OK);
+}
+
+
+/*******************************************************************************
+* Function Name: CR_EncryptPage
+********************************************************************************
+*
+* Summary:
+*  Encrypts an external memory page in place. Prefix CR stands for
+*  en/decryption to show that it is part of encryption module.
+*
+* Parameters:
+*   uint32 address: External memory address of the page.
+*   uint8 * data:   Pointer to the page data.
+*   uint16 length:  Length of the page data, in Bytes.
+*   uint8 * mic:    Pointer to an array of bytes (4 Bytes) to store the MIC of
+*                   the page.
+*
+* Return:
+*   The same as CR_CryptPage().
+*
+*******************************************************************************/
+CYBLE_API_RESULT_T CR_EncryptPage(uint32 address, uint8 * data, uint16 length, uint8 * mic)
+{
+    return (CR_CryptPage(address, data, length, mic, CR_CCM_ENCRYPT));
+}
+
+
+/*******************************************************************************
+* Function Name: CR_DecryptPage
+********************************************************************************
+*
+* Summary:
+*  Decrypts an external memory page in place. The MIC of the page is output
+*  for the caller to chain into the image MIC. Prefix CR stands for
+*  en/decryption to show that it is part of encryption module.
+*
+* Parameters:
+*   uint32 address: External memory address of the page.
+*   uint8 * data:   Pointer to the page data.
+*   uint16 length:  Length of the page data, in Bytes.
+*   uint8 * mic:    Pointer to an array of bytes (4 Bytes) to store the MIC of
+*                   the page.
+*
+* Return:
+*   The same as CR_CryptPage().
+*
+*******************************************************************************/
+CYBLE_API_RESULT_T CR_DecryptPage(uint32 address, uint8 * data, uint16 length, uint8 * mic)
+{
+    return (CR_CryptPage(address, data, length, mic, CR_CCM_DECRYPT));
+}
+
+
+/*******************************************************************************
+* Function Name: CR_ImageMicStart
+********************************************************************************
+*
+* Summary:
+*  Starts calculation of the image MIC. The image MIC is a CBC-MAC over the
+*  MICs of the image pages taken in order. Prefix CR stands for en/decryption
+*  to show that it is part of encryption module.
+*
+* Parameters:
+*   CR_IMAGE_MIC_T * imageMic: Pointer to the image MIC state.
+* 
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_ImageMicStart(CR_IMAGE_MIC_T * imageMic)
+{
+    memset(imageMic->mac, 0, CR_AES_BLOCK_SIZE);
+}
+
+
+/*******************************************************************************
+* Function Name: CR_ImageMicUpdate
+********************************************************************************
+*
+* Summary:
+*  Chains the MIC of the next image page into the image MIC. Prefix CR stands
+*  for en/decryption to show that it is part of encryption module.
+*
+* Parameters:
+*   CR_IMAGE_MIC_T * imageMic: Pointer to the image MIC state.
+*   uint8 * pageMic:           Pointer to the MIC of the page (4 Bytes).
+* 
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_ImageMicUpdate(CR_IMAGE_MIC_T * imageMic, const uint8 * pageMic)
+{
+    uint8 key[KEY_LENGTH];
+    uint8 i;
+
+    for (i = 0u; i < MIC_DATA_LENGTH; i++)
+    {
+        imageMic->mac[i] ^= pageMic[i];
+    }
+
+    CR_ReadKey(key);
+    CR_AesEncryptBlock(key, imageMic->mac, imageMic->mac);
+}
+
+
+/*******************************************************************************
+* Function Name: CR_ImageMicFinish
+********************************************************************************
+*
+* Summary:
+*  Outputs the image MIC. Prefix CR stands for en/decryption to show that it is
+*  part of encryption module.
+*
+* Parameters:
+*   CR_IMAGE_MIC_T * imageMic: Pointer to the image MIC state.
+*   uint8 * mic:               Pointer to an array of bytes (4 Bytes) to store
+*                              the image MIC.
+* 
+* Return:
+*  None
+*
+*******************************************************************************/
+void CR_ImageMicFinish(const CR_IMAGE_MIC_T * imageMic, uint8 * mic)
+{
+    memcpy(mic, imageMic->mac, MIC_DATA_LENGTH);
+}
+
+
 /* Function created based on CyFlash.c ver. 4.20 
 *  Modified: comand in in SF_WriteUserSFlashRow to work with SFlash, removed 
 *  unused defines.
@@ -36,13 +36,35 @@ extern uint8 encryptionEnabled;
     #define NONCE_LENGTH        (13)  
     #define NONCE_INIT_VECTOR   {17,18,19,20,21,22,23,24,25,26,27,28,29}
     #define KEY_LENGTH          (16)
-    #define EBCRYPTION_BLOCK_LENGTH (27)
     #define MIC_DATA_LENGTH     (4)
+    #define CR_AES_BLOCK_SIZE   (16u)
+    #define CR_CCM_LENGTH_SIZE  (15u - NONCE_LENGTH)
+
+    /* Direction of CR_CcmStart() */
+    #define CR_CCM_ENCRYPT      (0u)
+    #define CR_CCM_DECRYPT      (1u)
     
     #define SFASH_START_ROW     (4)
 
     #include "cytypes.h"
 
+    /* State of an AES-CCM operation, see CR_CcmStart() */
+    typedef struct
+    {
+        uint8 key[KEY_LENGTH];
+        uint8 mac[CR_AES_BLOCK_SIZE];       /* CBC-MAC of the processed data */
+        uint8 ctr[CR_AES_BLOCK_SIZE];       /* Counter block of the current block */
+        uint8 stream[CR_AES_BLOCK_SIZE];    /* Key stream of the current block */
+        uint8 offset;                       /* Bytes used of the current block */
+        uint8 mode;                         /* CR_CCM_ENCRYPT or CR_CCM_DECRYPT */
+    } CR_CCM_CTX_T;
+
+    /* State of the image MIC, see CR_ImageMicStart() */
+    typedef struct
+    {
+        uint8 mac[CR_AES_BLOCK_SIZE];
+    } CR_IMAGE_MIC_T;
+
     void CR_Initialization(void);
     CYBLE_API_RESULT_T CR_Encrypt(uint8 * plain, uint16 length, uint8 * key, \
         uint8 * nonce, uint8 * encrypted, uint8 * out_mic);
@@ -53,6 +75,16 @@ extern uint8 encryptionEnabled;
     void CR_ReadNonce(uint8 * nonce);
     uint32 CR_WriteKey(uint8 * key);
     void CR_ReadKey(uint8 * key);
+    void CR_CcmStart(CR_CCM_CTX_T * ctx, const uint8 * key, const uint8 * nonce, \
+        uint16 length, uint8 mode);
+    void CR_CcmUpdate(CR_CCM_CTX_T * ctx, const uint8 * in, uint8 * out, uint16 size);
+    void CR_CcmFinish(CR_CCM_CTX_T * ctx, uint8 * mic);
+    void CR_MakePageNonce(uint32 address, uint8 * nonce);
+    CYBLE_API_RESULT_T CR_EncryptPage(uint32 address, uint8 * data, uint16 length, uint8 * mic);
+    CYBLE_API_RESULT_T CR_DecryptPage(uint32 address, uint8 * data, uint16 length, uint8 * mic);
+    void CR_ImageMicStart(CR_IMAGE_MIC_T * imageMic);
+    void CR_ImageMicUpdate(CR_IMAGE_MIC_T * imageMic, const uint8 * pageMic);
+    void CR_ImageMicFinish(const CR_IMAGE_MIC_T * imageMic, uint8 * mic);
 
 
     #define CR_SILICON_ID_REG              (*(reg32 *) CYREG_SFLASH_SILICON_ID)
@@ -34,7 +34,27 @@ uint16 rowIdx;
 uint16 flashRowTotal;
 
 
-static uint16 CI_CalcExtMemAppChecksum(void);
+/* Row prefetched from the external memory. Two buffers are used while the
+* image checksum is calculated, one while the image is copied. */
+static uint8  ciRowBuffer[2u][CY_FLASH_SIZEOF_ROW];
+
+/* Sum of the image rows copied to the internal flash so far */
+static uint16 ciCopySum;
+
+/* Status of the external memory read of the row to be programmed next */
+static cystatus ciReadStatus;
+
+#if (ENCRYPTION_ENABLED == YES)
+    /* MIC of the image rows read so far, checked against the metadata */
+    static CR_IMAGE_MIC_T ciImageMic;
+#endif /* (ENCRYPTION_ENABLED == YES) */
+
+#if (CI_VERIFY_ON_COPY_ONLY == NO)
+    static cystatus CI_CalcExtMemAppChecksum(uint16 *checksum);
+#endif /* (CI_VERIFY_ON_COPY_ONLY == NO) */
+static uint16 CI_SumRow(const uint8 row[], uint16 sum);
+static void CI_StartCopy(void);
+static cystatus CI_CheckImageMic(void);
 static cystatus CI_WritePacket(uint8 status, uint8 buffer[], uint16 size);
 
 
@@ -57,6 +77,9 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
     cystatus rspCode  = CYRET_UNKNOWN;
     uint32 rspSize = 0u;
     uint16 appExtMemChecksum;
+#if (CI_VERIFY_ON_COPY_ONLY == NO)
+    uint16 calcChecksum;
+#endif /* (CI_VERIFY_ON_COPY_ONLY == NO) */
     
     
     buffer = buffer;
@@ -106,12 +129,16 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
         DBG_PRINT_TEXT("\r\n");
         encryptionEnabled = metadata[EMI_MD_ENCRYPTION_STATUS_ADDR];
 
-        /* Check application checksum in the external memory */
-        if (CI_CalcExtMemAppChecksum() != appExtMemChecksum)
+    #if (CI_VERIFY_ON_COPY_ONLY == NO)
+        /* Check application checksum and MIC in the external memory. The
+        * image MIC is calculated by CI_CalcExtMemAppChecksum(). */
+        if ((CYRET_SUCCESS != CI_CalcExtMemAppChecksum(&calcChecksum)) ||
+            (calcChecksum != appExtMemChecksum) || (CYRET_SUCCESS != CI_CheckImageMic()))
         {
             /* Mark application as invalid when checksum verification failed */
             metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_INVALID;
         }
+    #endif /* (CI_VERIFY_ON_COPY_ONLY == NO) */
 
 
         if(metadata[EMI_MD_APP_STATUS_ADDR] == EMI_MD_APP_STATUS_VALID)
@@ -124,8 +151,9 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
             rspSize = CI_COMMAND_ENTER_PACKET_DATA_SIZE;
             rspCode = CYRET_SUCCESS;
 
-            /* Perform custom interface initial initializations */
-            rowIdx = 0u;
+            /* Perform custom interface initial initializations and prefetch the
+            * first row */
+            CI_StartCopy();
 
             DBG_PRINT_TEXT("\r\n");
             DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
@@ -159,8 +187,9 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
                 rspSize = CI_COMMAND_ENTER_PACKET_DATA_SIZE;
                 rspCode = CYRET_SUCCESS;
 
-                /* Perform custom interface initial initializations */
-                rowIdx = 0u;
+                /* Perform custom interface initial initializations and prefetch the
+                * first row */
+                CI_StartCopy();
 
                 DBG_PRINT_TEXT("\r\n");
                 DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
@@ -215,10 +244,19 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
         if (CI_COMMUNICATION_STATE_ACTIVE == communicationState)
         {
 
-            if (flashRowTotal >= rowIdx)
+            /* Take the row prefetched with the previous command. If it could
+            * not be read, the copy is aborted below instead of programming
+            * stale data. */
+            if ((flashRowTotal >= rowIdx) && (CYRET_SUCCESS == ciReadStatus))
+            {
+                ciReadStatus = EMI_WaitRead();
+            }
+
+            if ((flashRowTotal >= rowIdx) && (CYRET_SUCCESS == ciReadStatus))
             {
                 /* Generate Program Row Command */
                 uint16 appFirstRowNumInArray;
+                uint16 i;
 
                 if (appFirstRowNum > CI_FLASH_ROWS_IN_ARRAY)
                 {
@@ -233,7 +271,23 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
                 buffer[CI_DATA_ADDR     ] = CY_FLASH_GET_MACRO_FROM_ROW(appFirstRowNum);
                 buffer[CI_DATA_ADDR + 1u] = LO8(appFirstRowNumInArray);
                 buffer[CI_DATA_ADDR + 2u] = HI8(appFirstRowNumInArray);
-                (void) EMI_ReadData(EMI_APP_ABS_ADDR(rowIdx), CY_FLASH_SIZEOF_ROW, (uint8 *) (buffer + CI_DATA_ADDR + 3u));
+
+                /* Start reading the next row, so that the external memory read
+                * runs while this row is programmed. The row is added to the
+                * image checksum on the way. */
+                for (i = 0u; i < CY_FLASH_SIZEOF_ROW; i++)
+                {
+                    buffer[CI_DATA_ADDR + 3u + i] = ciRowBuffer[0u][i];
+                }
+
+                if (rowIdx < flashRowTotal)
+                {
+                    ciCopySum = CI_SumRow(ciRowBuffer[0u], ciCopySum);
+                #if (ENCRYPTION_ENABLED == YES)
+                    CR_ImageMicUpdate(&ciImageMic, EMI_GetPageMic());
+                #endif /* (ENCRYPTION_ENABLED == YES) */
+                    ciReadStatus = EMI_StartRead(EMI_APP_ABS_ADDR(rowIdx + 1u), CY_FLASH_SIZEOF_ROW, ciRowBuffer[0u]);
+                }
 
                 if((flashRowTotal - 1u)  == rowIdx)
                 {
@@ -266,9 +320,33 @@ cystatus CyBtldrCommRead(uint8* buffer, uint16 size, uint16* count, uint8 timeOu
             {
                 /* Schedule Bootloadable application */
 
-                /* Mark bootloadable application as loaded */
+                /* Mark bootloadable application as loaded if all rows were read and
+                * the copied rows match the image checksum and MIC, else mark it
+                * as invalid */
+                if (CYRET_SUCCESS != ciReadStatus)
+                {
+                    DBG_PRINT_TEXT("\r\n");
+                    DBG_PRINT_TEXT("CustomInterface:\r\n");
+                    DBG_PRINT_TEXT("\tCyBtldrCommRead():\r\n");
+                    DBG_PRINT_TEXT("\t\tExternal memory read failed, copy aborted at rowIdx: 0x");
+                    DBG_PRINT_HEX(rowIdx);
+                    DBG_PRINT_TEXT("\r\n");
+                }
+
                 (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW , metadata);
-                metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_LOADED;
+                appExtMemChecksum = ((uint16)((uint16)metadata[EMI_MD_APP_EM_CHECKSUM_ADDR + 1u] << 8u)) |
+                                                metadata[EMI_MD_APP_EM_CHECKSUM_ADDR];
+
+                if ((CYRET_SUCCESS == ciReadStatus) &&
+                    (appExtMemChecksum == (( uint16 )1u + ( uint16 )(~ciCopySum))) &&
+                    (CYRET_SUCCESS == CI_CheckImageMic()))
+                {
+                    metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_LOADED;
+                }
+                else
+                {
+                    metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_INVALID;
+                }
                 (void) EMI_WriteData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW , metadata);
 
                 /* Generate Exit Bootloader Command */
@@ -419,45 +497,7 @@ static uint16 CI_CalcPacketChecksum(const uint8 buffer[], uint16 size)
 {
     #if(0u != CI_PACKET_CHECKSUM_CRC)
 
-        uint16 crc = CI_CRC_CCITT_INITIAL_VALUE;
-        uint16 tmp;
-        uint8  i;
-        uint16 tmpIndex = size;
-
-        if(0u == size)
-        {
-            crc = ~crc;
-        }
-        else
-        {
-            do
-            {
-                tmp = buffer[tmpIndex - size];
-
-                for (i = 0u; i < 8u; i++)
-                {
-                    if (0u != ((crc & 0x0001u) ^ (tmp & 0x0001u)))
-                    {
-                        crc = (crc >> 1u) ^ CI_CRC_CCITT_POLYNOMIAL;
-                    }
-                    else
-                    {
-                        crc >>= 1u;
-                    }
-
-                    tmp >>= 1u;
-                }
-
-                size--;
-            }
-            while(0u != size);
-
-            crc = ~crc;
-            tmp = crc;
-            crc = ( uint16 )(crc << 8u) | (tmp >> 8u);
-        }
-
-        return(crc);
+        return(Crc_CalcPacketCrc(buffer, size));
 
     #else
 
@@ -554,32 +594,167 @@ static cystatus CI_WritePacket(uint8 status, uint8 buffer[], uint16 size)
 }
 
 
-static uint16 CI_CalcExtMemAppChecksum(void)
+/*******************************************************************************
+* Function Name: CI_StartCopy
+********************************************************************************
+*
+* Summary:
+*  Prepares copying of the image from the external memory and starts reading
+*  its first row.
+*
+* Parameters:
+*  None
+*
+* Returns:
+*  None
+*
+*******************************************************************************/
+static void CI_StartCopy(void)
 {
-    uint8  extMemRow[CY_FLASH_SIZEOF_ROW];
+    rowIdx = 0u;
+    ciCopySum = 0u;
+    #if (ENCRYPTION_ENABLED == YES)
+        CR_ImageMicStart(&ciImageMic);
+    #endif /* (ENCRYPTION_ENABLED == YES) */
+
+    ciReadStatus = EMI_StartRead(EMI_APP_ABS_ADDR(0u), CY_FLASH_SIZEOF_ROW, ciRowBuffer[0u]);
+}
+
+
+/*******************************************************************************
+* Function Name: CI_SumRow
+********************************************************************************
+*
+* Summary:
+*  Adds the bytes of one flash row to the image checksum.
+*
+* Parameters:
+*  row:
+*     Flash row data
+*  sum:
+*     Sum of the preceding rows
+*
+* Returns:
+*  Updated sum
+*
+*******************************************************************************/
+static uint16 CI_SumRow(const uint8 row[], uint16 sum)
+{
+    uint16 size = CY_FLASH_SIZEOF_ROW;
+
+    while (size > 0u)
+    {
+        size--;
+        sum += row[size];
+    }
+
+    return (sum);
+}
+
+
+/*******************************************************************************
+* Function Name: CI_CheckImageMic
+********************************************************************************
+*
+* Summary:
+*  Compares the MIC of the image rows read from the external memory with the
+*  image MIC stored in the metadata. The metadata is expected to be read.
+*
+* Parameters:
+*  None
+*
+* Returns:
+*  CYRET_SUCCESS if the MICs match or the image is not encrypted
+*  CYRET_BAD_DATA otherwise
+*
+*******************************************************************************/
+static cystatus CI_CheckImageMic(void)
+{
+    cystatus status = CYRET_SUCCESS;
+
+    #if (ENCRYPTION_ENABLED == YES)
+        uint8 mic[MIC_DATA_LENGTH];
+
+        if (0u != encryptionEnabled)
+        {
+            CR_ImageMicFinish(&ciImageMic, mic);
+
+            if (0 != memcmp(mic, &metadata[EMI_MD_APP_MIC_ADDR], MIC_DATA_LENGTH))
+            {
+                DBG_PRINT_TEXT("\t\tImage MIC check failed.\r\n");
+                status = CYRET_BAD_DATA;
+            }
+        }
+    #endif /* (ENCRYPTION_ENABLED == YES) */
+
+    return (status);
+}
+
+
+#if (CI_VERIFY_ON_COPY_ONLY == NO)
+/*******************************************************************************
+* Function Name: CI_CalcExtMemAppChecksum
+********************************************************************************
+*
+* Summary:
+*  Calculates the checksum of the image in the external memory. The next row
+*  is read while the current one is summed.
+*
+* Parameters:
+*  checksum: Image checksum
+*
+* Returns:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           All rows were read
+*    Other non-zero          A row could not be read, the checksum is not valid
+*
+*******************************************************************************/
+static cystatus CI_CalcExtMemAppChecksum(uint16 *checksum)
+{
+    cystatus status = CYRET_SUCCESS;
     uint16 extMemRowIdx;
     uint16 extMemAppRowsTotal;
     uint16 appExtMemChecksum = 0u;
-    uint16 size;
+    uint8  bufIdx = 0u;
 
     /* Get total number of the written flash rows to the external memory */
     (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW , metadata);
     extMemAppRowsTotal = ((uint16)((uint16)metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR + 1u] << 8u)) |
                                       metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR];
 
-    for (extMemRowIdx = 0u; extMemRowIdx < extMemAppRowsTotal; extMemRowIdx++)
+    #if (ENCRYPTION_ENABLED == YES)
+        CR_ImageMicStart(&ciImageMic);
+    #endif /* (ENCRYPTION_ENABLED == YES) */
+
+    if (0u != extMemAppRowsTotal)
     {
-        (void) EMI_ReadData(EMI_APP_ABS_ADDR(extMemRowIdx), CY_FLASH_SIZEOF_ROW, extMemRow);
+        status = EMI_StartRead(EMI_APP_ABS_ADDR(0u), CY_FLASH_SIZEOF_ROW, ciRowBuffer[0u]);
+    }
 
-        size = CY_FLASH_SIZEOF_ROW;
-        while (size > 0u)
+    for (extMemRowIdx = 0u; (extMemRowIdx < extMemAppRowsTotal) && (CYRET_SUCCESS == status); extMemRowIdx++)
+    {
+        status = EMI_WaitRead();
+        if (CYRET_SUCCESS != status)
         {
-            size--;
-            appExtMemChecksum += extMemRow[size];
+            break;
+        }
+    #if (ENCRYPTION_ENABLED == YES)
+        CR_ImageMicUpdate(&ciImageMic, EMI_GetPageMic());
+    #endif /* (ENCRYPTION_ENABLED == YES) */
+
+        if ((extMemRowIdx + 1u) < extMemAppRowsTotal)
+        {
+            status = EMI_StartRead(EMI_APP_ABS_ADDR(extMemRowIdx + 1u), CY_FLASH_SIZEOF_ROW,
+                                   ciRowBuffer[bufIdx ^ 1u]);
         }
+
+        appExtMemChecksum = CI_SumRow(ciRowBuffer[bufIdx], appExtMemChecksum);
+        bufIdx ^= 1u;
     }
 
     appExtMemChecksum = ( uint16 )1u + ( uint16 )(~appExtMemChecksum);
+    *checksum = appExtMemChecksum;
 
     DBG_PRINT_TEXT("\r\n");
     DBG_PRINT_TEXT("CustomInterface:\r\n");
@@ -590,8 +765,9 @@ static uint16 CI_CalcExtMemAppChecksum(void)
     DBG_PRINT_HEX(appExtMemChecksum);
     DBG_PRINT_TEXT("\r\n");
 
-    return(appExtMemChecksum);
+    return(status);
 }
+#endif /* (CI_VERIFY_ON_COPY_ONLY == NO) */
 
 
 /* [] END OF FILE */
@@ -31,6 +31,7 @@
 #include "CyFlash.h"
 #include "OTAMandatory.h"
 #include "OTAOptional.h"
+#include "Crc.h"
 
 
 void CyBtldrCommStart(void);
@@ -42,14 +43,6 @@ cystatus CyBtldrCommRead (uint8* buffer, uint16 size, uint16* count, uint8 timeO
 
 extern uint8 encryptionEnabled;
 
-/*******************************************************************************
-* Bootloader_CalcPacketChecksum()
-*******************************************************************************/
-#if(0u != CI_PACKET_CHECKSUM_CRC)
-    #define CI_CRC_CCITT_POLYNOMIAL       (0x8408u)       /* x^16 + x^12 + x^5 + 1 */
-    #define CI_CRC_CCITT_INITIAL_VALUE    (0xffffu)
-#endif /* (0u != CI_PACKET_CHECKSUM_CRC) */
-
 
 #define CI_COMMUNICATION_STATE_IDLE   (0u)
 #define CI_COMMUNICATION_STATE_ACTIVE (1u)
@@ -26,6 +26,7 @@
 #include "cytypes.h"
 #include "CyFlash.h"
 #include "OTAOptional.h"
+#include "Crc.h"
 
 #define BootloaderEmulator_activeApp      (BootloaderEmulator_MD_BTLDB_ACTIVE_0)
 
@@ -38,9 +39,13 @@ cystatus EMI_SetPointer(uint32 dataAddr);
 cystatus EMI_EraseAll(void);
 cystatus EMI_WriteData(uint32 dataAddr, uint32 dataSize, uint8 *data);
 cystatus EMI_ReadData (uint32 dataAddr, uint32 dataSize, uint8 *data);
+cystatus EMI_StartRead(uint32 dataAddr, uint32 dataSize, uint8 *data);
+cystatus EMI_WaitRead (void);
+#if (ENCRYPTION_ENABLED == YES)
+    const uint8 * EMI_GetPageMic(void);
+#endif /* (ENCRYPTION_ENABLED == YES) */
 
 
-#define ENC_BUFFER_SIZE (300)
 #define META_DATA_SIZE  (128)
 #define META_DATA_ADDR  (0)
 
@@ -76,6 +81,7 @@ cystatus EMI_ReadData (uint32 dataAddr, uint32 dataSize, uint8 *data);
 /*******************************************************************************
 * External Memory Metadata
 *******************************************************************************/
+#define EMI_MD_APP_MIC_ADDR                     (EMI_MD_BASE_ADDR + 0x18u)
 #define EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR   (EMI_MD_BASE_ADDR + 0x14u)
 #define EMI_MD_APP_FIRST_ROW_NUM_ADDR           (EMI_MD_BASE_ADDR + 0x10u)
 #define EMI_MD_APP_SIZE_IN_ROWS_ADDR            (EMI_MD_BASE_ADDR + 0x0Cu)
@@ -126,6 +132,7 @@ cystatus EMI_ReadData (uint32 dataAddr, uint32 dataSize, uint8 *data);
 #define BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL  (0u)
 #define BootloaderEmulator_CMD_SEND_DATA_AVAIL        (1u)
 #define BootloaderEmulator_CMD_GET_METADATA           (0u)  /* Not supported  */
+#define BootloaderEmulator_CMD_COPY_ROW_AVAIL         (1u)  /* Delta update   */
 
 
 /*******************************************************************************
@@ -150,6 +157,7 @@ cystatus EMI_ReadData (uint32 dataAddr, uint32 dataSize, uint8 *data);
 void     BootloaderEmulator_Start(void);
 cystatus BootloaderEmulator_ValidateBootloadable(void);
 uint32   BootloaderEmulator_Calc8BitSum(uint32 addr);
+uint16   BootloaderEmulator_ProcessPacket(uint8 packetBuffer[], uint16 numberRead);
 
 
 #endif /* BootloaderEmulator_H */
@@ -207,6 +215,7 @@ typedef struct
 #define BootloaderEmulator_COMMAND_VERIFY       (0x3Au)    /* Compute flash row checksum for verification        */
 #define BootloaderEmulator_COMMAND_EXIT         (0x3Bu)    /* Exits the bootloader & resets the chip             */
 #define BootloaderEmulator_COMMAND_GET_METADATA (0x3Cu)    /* Reports the metadata for a selected application    */
+#define BootloaderEmulator_COMMAND_COPY_ROW     (0x3Du)    /* Program the row from the running application       */
 
 
 /*******************************************************************************
@@ -241,15 +250,6 @@ typedef struct
 #define BootloaderEmulator_COMMUNICATION_STATE_ACTIVE (1u)
 
 
-/*******************************************************************************
-* BootloaderEmulator_CalcPacketChecksum()
-*******************************************************************************/
-#if(0u != BootloaderEmulator_PACKET_CHECKSUM_CRC)
-    #define BootloaderEmulator_CRC_CCITT_POLYNOMIAL       (0x8408u)       /* x^16 + x^12 + x^5 + 1 */
-    #define BootloaderEmulator_CRC_CCITT_INITIAL_VALUE    (0xffffu)
-#endif /* (0u != BootloaderEmulator_PACKET_CHECKSUM_CRC) */
-
-
 #define BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY                ((uint16)(CY_FLASH_SIZEOF_ARRAY/CY_FLASH_SIZEOF_ROW))
 #define BootloaderEmulator_FIRST_ROW_IN_ARRAY                     (0u)
 
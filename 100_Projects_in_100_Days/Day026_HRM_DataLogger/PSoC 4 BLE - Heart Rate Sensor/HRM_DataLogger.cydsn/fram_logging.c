@@ -13,93 +13,463 @@
 #include "common.h"
 #include "fram_logging.h"
 
-/* Attribute CY_NOINIT puts SRAM variable in memory section which is retained in low power modes */
-uint32 addr;
+#define FRAM_LOG_CRC_LEN            (FRAM_LOG_RECORD_SIZE - 2)
+#define FRAM_LOG_CRC_INIT           (0xFFFFu)
+#define FRAM_LOG_CRC_POLY           (0x1021u)
 
-uint8 WriteFRAMData(uint16 addr_buf, uint8* write_buf, uint16 len)
+/* Sequence number of the oldest record in the log and of the next record to be written */
+static uint32 oldestSeq;
+static uint32 nextSeq;
+/* Records before this sequence number have been written to FRAM */
+static uint32 flushedSeq;
+
+/* Two batch buffers: one is filled while the other one is written by the I2C master.
+*  Each buffer starts with the FRAM address followed by the records. The batch
+*  being written starts at flushedSeq and is kept until its write completes. */
+static uint8 batchBuf[2][ADDR_SIZE + (FRAM_LOG_BATCH_RECORDS * FRAM_LOG_RECORD_SIZE)];
+static uint8 batchFill;
+static uint8 batchCount;
+static uint8 writeCount;
+static uint8 writeBusy;
+
+
+/*******************************************************************************
+* Function Name: FramLogCrc16
+********************************************************************************
+*
+* Summary:
+*   Updates a CRC-16/CCITT over a block of data.
+*
+* Parameters:
+*   crc  - CRC of the preceding data, 0xFFFF to start
+*   data - data to be added
+*   len  - number of bytes
+*
+* Return:
+*   The updated CRC.
+*
+*******************************************************************************/
+uint16 FramLogCrc16(uint16 crc, const uint8* data, uint16 len)
 {
-	uint8 err;
-	uint8 temp_buf[len+ADDR_SIZE];
-	
-	temp_buf[0] = (addr_buf & 0x000000ff);
-	temp_buf[1] = ((addr_buf >> 8) & 0x000000ff);
-    temp_buf[2] = ((addr_buf >> 16) & 0x000000ff);
-    temp_buf[3] = ((addr_buf >> 24) & 0x000000ff);
-    
-	memcpy(&temp_buf[4], write_buf, len);
-	
-	err = I2C_M_I2CMasterWriteBuf(FRAM_SLAVE_ADDR, temp_buf, len+ADDR_SIZE, I2C_M_I2C_MODE_COMPLETE_XFER);	
-	
-	while(0u == (I2C_M_I2CMasterStatus() & I2C_M_I2C_MSTAT_WR_CMPLT))
-	{
-	/* Wait until master complete write */
-	}
-	/* Clear I2C master status */
-	(void) I2C_M_I2CMasterClearStatus();
-	
-	return(err);
+    uint8 bit;
+
+    while(len-- != 0u)
+    {
+        crc ^= (uint16)(*data++) << 8;
+        for(bit = 0u; bit < 8u; bit++)
+        {
+            crc = (0u != (crc & 0x8000u)) ? (uint16)((crc << 1) ^ FRAM_LOG_CRC_POLY) : (uint16)(crc << 1);
+        }
+    }
+
+    return(crc);
+}
+
+/*******************************************************************************
+* Function Name: FramIsRecordValid
+********************************************************************************
+*
+* Summary:
+*   Checks the CRC and the length of a record read from FRAM.
+*
+*******************************************************************************/
+static uint8 FramIsRecordValid(const FRAM_LOG_RECORD_T* record)
+{
+    uint16 crc = FramLogCrc16(FRAM_LOG_CRC_INIT, (const uint8 *)record, FRAM_LOG_CRC_LEN);
+
+    return((record->length <= FRAM_LOG_MAX_PAYLOAD) &&
+           (record->crc[0] == (uint8)crc) && (record->crc[1] == (uint8)(crc >> 8)));
+}
+
+/*******************************************************************************
+* Function Name: FramWaitWrite
+********************************************************************************
+*
+* Summary:
+*   Waits until the batch write in progress, if any, is complete.
+*
+*******************************************************************************/
+static void FramWaitWrite(void)
+{
+    while(0u != writeBusy)
+    {
+        FramLogProcess();
+    }
+}
+
+/*******************************************************************************
+* Function Name: FramStartWrite
+********************************************************************************
+*
+* Summary:
+*   Starts the I2C transaction of the batch being written. If the I2C master
+*   does not accept it, the batch is kept and started again by FramLogFlush().
+*
+*******************************************************************************/
+static void FramStartWrite(void)
+{
+    uint32 addr = (flushedSeq % FRAM_LOG_RECORDS) * FRAM_LOG_RECORD_SIZE;
+    uint8* buf = batchBuf[batchFill ^ 1u];
+
+    buf[0] = (uint8)(addr >> 8);
+    buf[1] = (uint8)addr;
+
+    if(I2C_M_I2C_MSTR_NO_ERROR == I2C_M_I2CMasterWriteBuf(FRAM_SLAVE_ADDR | (uint8)((addr >> 16) & 0x01),
+                                      buf, ADDR_SIZE + ((uint32)writeCount * FRAM_LOG_RECORD_SIZE),
+                                      I2C_M_I2C_MODE_COMPLETE_XFER))
+    {
+        writeBusy = 1u;
+    }
 }
 
-uint8 ReadFRAMData(uint16 addr_buf, uint8* read_buf, uint16 len)
+/*******************************************************************************
+* Function Name: ReadFRAMData
+********************************************************************************
+*
+* Summary:
+*   Reads a block of FRAM. The block must not cross a bank boundary.
+*   Blocks until the data is read.
+*
+*******************************************************************************/
+static uint8 ReadFRAMData(uint32 addr_buf, uint8* read_buf, uint16 len)
 {
 	uint8 err;
+    uint8 addr[ADDR_SIZE];
+    uint8 slave = FRAM_SLAVE_ADDR | (uint8)((addr_buf >> 16) & 0x01);
+
+    addr[0] = (uint8)(addr_buf >> 8);
+    addr[1] = (uint8)addr_buf;
+
+	err = I2C_M_I2CMasterWriteBuf(slave, addr, ADDR_SIZE, I2C_M_I2C_MODE_COMPLETE_XFER);
 
-    
-	err = I2C_M_I2CMasterWriteBuf(FRAM_SLAVE_ADDR, (uint8 *)&addr_buf, ADDR_SIZE, I2C_M_I2C_MODE_COMPLETE_XFER);	
-	
 	while(0u == (I2C_M_I2CMasterStatus() & I2C_M_I2C_MSTAT_WR_CMPLT))
 	{
 	/* Wait until master complete write */
 	}
 	/* Clear I2C master status */
 	(void) I2C_M_I2CMasterClearStatus();
-	
-	err = I2C_M_I2CMasterReadBuf(FRAM_SLAVE_ADDR, &read_buf[0], len, I2C_M_I2C_MODE_COMPLETE_XFER);
-				
+
+	err |= I2C_M_I2CMasterReadBuf(slave, &read_buf[0], len, I2C_M_I2C_MODE_COMPLETE_XFER);
+
 	while(0u == (I2C_M_I2CMasterStatus() & I2C_M_I2C_MSTAT_RD_CMPLT))
 	{
 	/* Wait until master complete reading */
 	}
-	
+
 	/* Clear I2C master status */
 	(void) I2C_M_I2CMasterClearStatus();
-	
+
 	return(err);
 }
 
+/*******************************************************************************
+* Function Name: FramReadSlot
+********************************************************************************
+*
+* Summary:
+*   Reads the sequence number of the record in a slot. Returns 0 if the slot
+*   does not hold a valid record.
+*
+*******************************************************************************/
+static uint8 FramReadSlot(uint32 slot, uint32* sequence)
+{
+    FRAM_LOG_RECORD_T record;
+
+    if((I2C_M_I2C_MSTR_NO_ERROR != ReadFRAMData(slot * FRAM_LOG_RECORD_SIZE, (uint8 *)&record, FRAM_LOG_RECORD_SIZE)) ||
+       !FramIsRecordValid(&record) || ((record.sequence % FRAM_LOG_RECORDS) != slot))
+    {
+        return(0u);
+    }
+
+    *sequence = record.sequence;
+    return(1u);
+}
+
+/*******************************************************************************
+* Function Name: FramLogInit
+********************************************************************************
+*
+* Summary:
+*   Recovers the head and tail of the log after reset.
+*
+* Theory:
+*   The record with sequence number n is stored in slot n % FRAM_LOG_RECORDS,
+*   so slot 0 always holds the first record of the newest pass over the FRAM.
+*   The slots following it hold consecutive sequence numbers up to the newest
+*   record, which is found by binary search. The slot after the newest record
+*   holds the oldest one, unless the log has not wrapped yet or the write of
+*   that slot was interrupted.
+*
+*******************************************************************************/
+void FramLogInit(void)
+{
+    uint32 first;
+    uint32 seq;
+    uint32 low;
+    uint32 high;
+    uint32 mid;
+
+    if(0u == FramReadSlot(0u, &first))
+    {
+        /* Slot 0 is empty or was being written; the newest record, if any, is in the last slot */
+        nextSeq = (0u == FramReadSlot(FRAM_LOG_RECORDS - 1u, &seq)) ? 0u : (seq + 1u);
+        oldestSeq = (nextSeq > (FRAM_LOG_RECORDS - 1u)) ? (nextSeq - (FRAM_LOG_RECORDS - 1u)) : 0u;
+    }
+    else
+    {
+        /* Slot low holds first + low, slot high does not hold first + high */
+        low = 0u;
+        high = FRAM_LOG_RECORDS;
+        while((high - low) > 1u)
+        {
+            mid = (low + high) >> 1;
+            if((0u != FramReadSlot(mid, &seq)) && (seq == (first + mid)))
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        nextSeq = first + low + 1u;
+        oldestSeq = 0u;
+        if(nextSeq > FRAM_LOG_RECORDS)
+        {
+            oldestSeq = nextSeq - FRAM_LOG_RECORDS;
+            if((0u == FramReadSlot(oldestSeq % FRAM_LOG_RECORDS, &seq)) || (seq != oldestSeq))
+            {
+                oldestSeq++;
+            }
+        }
+    }
+
+    flushedSeq = nextSeq;
+    batchCount = 0u;
+    writeCount = 0u;
+    writeBusy = 0u;
+
+    printf("FRAM log recovered, records %lu to %lu \r\n", oldestSeq, nextSeq);
+}
+
+/*******************************************************************************
+* Function Name: FramLogProcess
+********************************************************************************
+*
+* Summary:
+*   Completes the batch write in progress. To be called from the main loop.
+*   The records of the batch count as stored only if the write succeeded,
+*   otherwise the batch is kept for the next FramLogFlush().
+*
+*******************************************************************************/
+void FramLogProcess(void)
+{
+    uint32 status;
+
+    if(0u != writeBusy)
+    {
+        status = I2C_M_I2CMasterStatus();
+        if(0u != (status & I2C_M_I2C_MSTAT_WR_CMPLT))
+        {
+            /* Clear I2C master status */
+            (void) I2C_M_I2CMasterClearStatus();
+            writeBusy = 0u;
+
+            if(0u == (status & I2C_M_I2C_MSTAT_ERR_XFER))
+            {
+                flushedSeq += writeCount;
+                writeCount = 0u;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: FramLogFlush
+********************************************************************************
+*
+* Summary:
+*   Starts writing the records collected in RAM to FRAM in one I2C transaction
+*   and returns without waiting for the transaction to complete. A batch whose
+*   write failed is started again first; the records collected meanwhile stay
+*   in RAM until it is written.
+*
+*******************************************************************************/
+void FramLogFlush(void)
+{
+    FramWaitWrite();
+
+    if(0u != writeCount)
+    {
+        FramStartWrite();
+        return;
+    }
+
+    if(0u == batchCount)
+    {
+        return;
+    }
+
+    writeCount = batchCount;
+    batchCount = 0u;
+    batchFill ^= 1u;
+    FramStartWrite();
+}
+
+/*******************************************************************************
+* Function Name: DataLogging
+********************************************************************************
+*
+* Summary:
+*   Appends a record to the log. When the log is full, the oldest record is
+*   overwritten. The record is dropped, without using a sequence number, when
+*   its batch cannot be started because the previous batch is still not written.
+*
+* Parameters:
+*   len      - length of the data, at most FRAM_LOG_MAX_PAYLOAD bytes
+*   data_buf - data to be logged
+*
+*******************************************************************************/
 void DataLogging(uint8 len, uint8* data_buf)
 {
-    uint8 read_buf[20];
-    uint8 temp;
-    uint16 temp1;
-    
-    if((addr + len) < FRAM_SIZE)
-    {
-        addr = addr + len;
-        WriteFRAMData(addr, data_buf, len);
-        printf("Data logged successfully \r\n");
-	    ReadFRAMData(addr, read_buf, len);
-	    printf("Data read back: ");
-        for(temp=0; temp<len; temp++)
+    FRAM_LOG_RECORD_T record;
+    uint16 crc;
+
+    /* A batch must not cross a bank boundary or wrap around the end of the FRAM */
+    if((0u != batchCount) &&
+       ((FRAM_LOG_BATCH_RECORDS == batchCount) || (0u == (nextSeq % FRAM_LOG_BANK_RECORDS))))
+    {
+        FramLogFlush();
+        if(0u != batchCount)
         {
-	        PrintHex(read_buf[temp]);
-	        UART_UartPutString(" ");
+            printf("FRAM write failed, record dropped \r\n");
+            return;
         }
-        UART_UartPutString("\r\n");
     }
-    else
+
+    if(len > FRAM_LOG_MAX_PAYLOAD)
+    {
+        len = FRAM_LOG_MAX_PAYLOAD;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.sequence = nextSeq;
+    record.length = len;
+    memcpy(record.payload, data_buf, len);
+    crc = FramLogCrc16(FRAM_LOG_CRC_INIT, (const uint8 *)&record, FRAM_LOG_CRC_LEN);
+    record.crc[0] = (uint8)crc;
+    record.crc[1] = (uint8)(crc >> 8);
+
+    memcpy(&batchBuf[batchFill][ADDR_SIZE + ((uint32)batchCount * FRAM_LOG_RECORD_SIZE)], &record, FRAM_LOG_RECORD_SIZE);
+    batchCount++;
+    nextSeq++;
+    if((nextSeq - oldestSeq) > FRAM_LOG_RECORDS)
+    {
+        oldestSeq = nextSeq - FRAM_LOG_RECORDS;
+    }
+
+    if(FRAM_LOG_BATCH_RECORDS == batchCount)
     {
-        temp = (uint8)UART_UartGetChar();
-        if(temp == 'r' || temp == 'R')
+        FramLogFlush();
+    }
+
+    printf("Data logged, record %lu \r\n", record.sequence);
+}
+
+/*******************************************************************************
+* Function Name: FramLogGetOldest
+********************************************************************************
+*
+* Summary:
+*   Returns the sequence number of the oldest record in the log.
+*
+*******************************************************************************/
+uint32 FramLogGetOldest(void)
+{
+    return(oldestSeq);
+}
+
+/*******************************************************************************
+* Function Name: FramLogGetNext
+********************************************************************************
+*
+* Summary:
+*   Returns the sequence number following the newest record written to FRAM.
+*   Waits for the batch write in progress. Records still collected in RAM and
+*   a batch whose write failed are not included; see FramLogFlush().
+*
+*******************************************************************************/
+uint32 FramLogGetNext(void)
+{
+    FramWaitWrite();
+    return(flushedSeq);
+}
+
+/*******************************************************************************
+* Function Name: FramLogRead
+********************************************************************************
+*
+* Summary:
+*   Reads consecutive records from the log, e.g. to offload them over BLE.
+*
+* Parameters:
+*   sequence - sequence number of the first record
+*   records  - buffer for the records
+*   count    - maximum number of records to read
+*
+* Return:
+*   The number of valid records read. Reading stops at the newest record
+*   written to FRAM and at the first corrupted record.
+*
+* Theory:
+*   Consecutive records are read in one I2C transaction per FRAM bank.
+*
+*******************************************************************************/
+uint16 FramLogRead(uint32 sequence, FRAM_LOG_RECORD_T* records, uint16 count)
+{
+    uint16 done = 0u;
+    uint16 chunk;
+    uint16 index;
+    uint32 slot;
+
+    FramWaitWrite();
+
+    if((sequence < oldestSeq) || (sequence >= flushedSeq))
+    {
+        return(0u);
+    }
+    if((flushedSeq - sequence) < count)
+    {
+        count = (uint16)(flushedSeq - sequence);
+    }
+
+    while(done < count)
+    {
+        slot = (sequence + done) % FRAM_LOG_RECORDS;
+        chunk = (uint16)(FRAM_LOG_BANK_RECORDS - (slot % FRAM_LOG_BANK_RECORDS));
+        if(chunk > (count - done))
         {
-            printf("Address reset\r\n");
-            addr = 0;
+            chunk = count - done;
         }
-        else
+
+        if(I2C_M_I2C_MSTR_NO_ERROR != ReadFRAMData(slot * FRAM_LOG_RECORD_SIZE, (uint8 *)&records[done],
+                                                   chunk * FRAM_LOG_RECORD_SIZE))
         {
-            printf("Memory full. Press r or R to reset the memory.\r\n");
+            break;
+        }
+
+        for(index = 0u; index < chunk; index++)
+        {
+            if(!FramIsRecordValid(&records[done]) || (records[done].sequence != (sequence + done)))
+            {
+                return(done);
+            }
+            done++;
         }
     }
+
+    return(done);
 }
 
 /* [] END OF FILE */
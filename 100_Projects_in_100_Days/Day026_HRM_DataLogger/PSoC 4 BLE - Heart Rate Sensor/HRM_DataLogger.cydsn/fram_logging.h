@@ -15,12 +15,42 @@
 
 #define FRAM_SLAVE_ADDR			 	 0x50
 #define TIMER_VALUE				   450000
-#define ADDR_SIZE						4
+#define ADDR_SIZE						2
 #define FRAM_SIZE                  131072
-	
-uint8 WriteFRAMData(uint16, uint8*, uint16);
-uint8 ReadFRAMData(uint16, uint8*, uint16);
+/* The 17th address bit is sent in the slave address, so no transfer may cross a bank */
+#define FRAM_BANK_SIZE              65536
+
+/* The log is a circular array of fixed-size records. Every record carries a
+*  sequence number which also selects its slot, so the head of the log can be
+*  found by binary search on boot.
+*/
+#define FRAM_LOG_RECORD_SIZE        32
+#define FRAM_LOG_MAX_PAYLOAD        (FRAM_LOG_RECORD_SIZE - 7)
+#define FRAM_LOG_RECORDS            (FRAM_SIZE / FRAM_LOG_RECORD_SIZE)
+#define FRAM_LOG_BANK_RECORDS       (FRAM_BANK_SIZE / FRAM_LOG_RECORD_SIZE)
+/* Records collected in RAM and written to FRAM in one I2C transaction. Until
+*  the batch is full or FramLogFlush() is called, up to FRAM_LOG_BATCH_RECORDS - 1
+*  records exist only in RAM and are lost on a reset.
+*/
+#define FRAM_LOG_BATCH_RECORDS      4
+
+/* Log record as stored in FRAM, CRC-16 over all other fields */
+typedef struct
+{
+    uint32 sequence;
+    uint8  length;
+    uint8  payload[FRAM_LOG_MAX_PAYLOAD];
+    uint8  crc[2];
+} FRAM_LOG_RECORD_T;
+
+void FramLogInit(void);
+void FramLogProcess(void);
+void FramLogFlush(void);
+uint32 FramLogGetOldest(void);
+uint32 FramLogGetNext(void);
+uint16 FramLogRead(uint32 sequence, FRAM_LOG_RECORD_T* records, uint16 count);
+uint16 FramLogCrc16(uint16 crc, const uint8* data, uint16 len);
 void DataLogging(uint8 len, uint8* data_buf);
-	
+
 #endif
 /* [] END OF FILE */
@@ -20,6 +20,8 @@
 *******************************************************************************/
 
 #include "hrss.h"
+#include "fram_logging.h"
+#include "offload.h"
 
 volatile uint32 mainTimer = 0;
 CYBLE_API_RESULT_T apiResult;
@@ -42,6 +44,7 @@ void AppCallBack(uint32 event, void* eventParam)
 #ifdef DEBUG_OUT    
     DebugOut(event, eventParam);
 #endif
+    OffloadCallBack(event, eventParam);
 
     switch(event)
     {
@@ -132,6 +135,9 @@ int main()
     UART_Start();               /* Start communication component */
     printf("BLE Heart Rate Sensor Example Project \r\n");
     
+    /* Find the head and tail of the heart rate log in FRAM */
+    FramLogInit();
+    
     Disconnect_LED_Write(LED_OFF);
     Advertising_LED_Write(LED_OFF);
 
@@ -155,6 +161,7 @@ int main()
     
     /* Services initialization */
     HrsInit();
+    OffloadInit();
     
     WDT_Start();
     
@@ -182,6 +189,16 @@ int main()
             }
         }
         
+        /*******************************************************************
+        *  Complete the FRAM write of logged records in the background
+        *******************************************************************/
+        FramLogProcess();
+        
+        /*******************************************************************
+        *  Send the next chunks of a log offload to the Client
+        *******************************************************************/
+        OffloadProcess();
+        
         /*******************************************************************
         *  Process all pending BLE events in the stack
         *******************************************************************/
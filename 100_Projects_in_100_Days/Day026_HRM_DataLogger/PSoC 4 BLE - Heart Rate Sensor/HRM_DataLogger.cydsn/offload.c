@@ -0,0 +1,457 @@
+/*******************************************************************************
+* File Name: offload.c
+*
+* Version 1.0
+*
+* Description:
+*  This file contains the Log Offload service, which streams the records of
+*  the FRAM log to the Client in notification bursts.
+*
+* Hardware Dependency:
+*  CY8CKIT-042 BLE
+*
+********************************************************************************
+* Copyright 2014, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include "offload.h"
+
+/* Negotiated MTU and Data notification state */
+static uint16 offloadMtu = OFFLOAD_DEFAULT_MTU;
+static uint8 offloadNtfEnabled = DISABLED;
+static uint8 offloadActive = DISABLED;
+
+/* Window: chunks up to ackedChunk were received, nextChunk is sent next */
+static uint16 nextChunk;
+static uint16 ackedChunk;
+static uint8 offloadWindow;
+
+/* Stream position: stream header, then the byte recordPos of record streamSeq */
+static uint8 streamHeader[OFFLOAD_STREAM_HEADER_LEN];
+static uint8 headerPos;
+static uint32 streamSeq;
+static uint32 streamEnd;
+static uint8 recordPos;
+static uint8 streamDone;
+
+/* Records read ahead from FRAM */
+static FRAM_LOG_RECORD_T cache[OFFLOAD_READ_RECORDS];
+static uint32 cacheSeq;
+static uint16 cacheCount;
+
+/* Chunk built but not accepted by the stack yet */
+static uint8 chunkBuf[OFFLOAD_MAX_CHUNK];
+static uint16 chunkLen;
+
+
+/*******************************************************************************
+* Function Name: PutUint32
+********************************************************************************
+*
+* Summary:
+*  Stores a 32-bit value in little endian byte order.
+*
+*******************************************************************************/
+static void PutUint32(uint8* buf, uint32 value)
+{
+    buf[0u] = LO8(LO16(value));
+    buf[1u] = HI8(LO16(value));
+    buf[2u] = LO8(HI16(value));
+    buf[3u] = HI8(HI16(value));
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadStart
+********************************************************************************
+*
+* Summary:
+*  Starts a new transfer of the log.
+*
+* Parameters:
+*  sequence - first record to send, OFFLOAD_SEQ_OLDEST for the oldest one
+*  window   - number of chunks the Client accepts without acknowledgement
+*
+* Theory:
+*  The end of the transfer is the newest record at the time of the request, so
+*  records logged during the transfer are left for the next one. A Client
+*  resumes an interrupted transfer by starting at the record after the last
+*  one it received completely.
+*
+*******************************************************************************/
+static void OffloadStart(uint32 sequence, uint8 window)
+{
+    FramLogFlush();
+    streamEnd = FramLogGetNext();
+    if((OFFLOAD_SEQ_OLDEST == sequence) || (sequence < FramLogGetOldest()))
+    {
+        sequence = FramLogGetOldest();
+    }
+    if(sequence > streamEnd)
+    {
+        sequence = streamEnd;
+    }
+
+    streamSeq = sequence;
+    PutUint32(&streamHeader[0u], streamSeq);
+    PutUint32(&streamHeader[4u], streamEnd);
+    headerPos = 0u;
+    recordPos = 0u;
+    streamDone = DISABLED;
+    cacheCount = 0u;
+    chunkLen = 0u;
+
+    nextChunk = 0u;
+    ackedChunk = 0u;
+    if(0u == window)
+    {
+        window = OFFLOAD_DEFAULT_WINDOW;
+    }
+    offloadWindow = (window < OFFLOAD_MAX_WINDOW) ? window : OFFLOAD_MAX_WINDOW;
+    offloadActive = ENABLED;
+
+#if (OFFLOAD_CONN_INTERVAL != 0u)
+    {
+        CYBLE_GAP_CONN_UPDATE_PARAM_T connParameters =
+        {
+            OFFLOAD_CONN_INTERVAL,  /* Minimum connection interval */
+            OFFLOAD_CONN_INTERVAL,  /* Maximum connection interval */
+            0u,                     /* Slave latency */
+            500u                    /* Supervision timeout - 500 x 10 = 5000 ms */
+        };
+
+        (void)CyBle_L2capLeConnectionParamUpdateRequest(cyBle_connHandle.bdHandle, &connParameters);
+    }
+#endif /* (OFFLOAD_CONN_INTERVAL != 0u) */
+
+    printf("Offload of records %lu to %lu started \r\n", streamSeq, streamEnd);
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadControl
+********************************************************************************
+*
+* Summary:
+*  Executes a command written to the Control Point characteristic.
+*
+* Parameters:
+*  value - the written value
+*
+* Return:
+*  CYBLE_GATT_ERR_NONE if the command is valid.
+*
+*******************************************************************************/
+static CYBLE_GATT_ERR_CODE_T OffloadControl(const CYBLE_GATT_VALUE_T* value)
+{
+    const uint8* cmd = value->val;
+    uint16 ack;
+
+    if(0u == value->len)
+    {
+        return(CYBLE_GATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    switch(cmd[0u])
+    {
+        case OFFLOAD_CMD_START:
+            if(OFFLOAD_CMD_START_LEN != value->len)
+            {
+                return(CYBLE_GATT_ERR_INVALID_ATTRIBUTE_LEN);
+            }
+            OffloadStart(((uint32)cmd[4u] << 24u) | ((uint32)cmd[3u] << 16u) |
+                         ((uint32)cmd[2u] << 8u) | (uint32)cmd[1u], cmd[5u]);
+            break;
+
+        case OFFLOAD_CMD_ACK:
+            if(OFFLOAD_CMD_ACK_LEN != value->len)
+            {
+                return(CYBLE_GATT_ERR_INVALID_ATTRIBUTE_LEN);
+            }
+            /* Only chunks already sent can be acknowledged */
+            ack = CyBle_Get16ByPtr(&cmd[1u]);
+            if((uint16)(ack - ackedChunk) <= (uint16)(nextChunk - ackedChunk))
+            {
+                ackedChunk = ack;
+            }
+            break;
+
+        case OFFLOAD_CMD_STOP:
+            offloadActive = DISABLED;
+            break;
+
+        default:
+            return(CYBLE_GATT_ERR_REQUEST_NOT_SUPPORTED);
+    }
+
+    return(CYBLE_GATT_ERR_NONE);
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadFillChunk
+********************************************************************************
+*
+* Summary:
+*  Copies the next bytes of the stream into a chunk.
+*
+* Parameters:
+*  buf  - destination
+*  room - maximum number of bytes
+*
+* Return:
+*  The number of bytes copied.
+*
+* Theory:
+*  Records are read from FRAM OFFLOAD_READ_RECORDS at a time. The stream also
+*  ends early at a record that was overwritten or is corrupted, which the
+*  Client detects from the end sequence in the stream header.
+*
+*******************************************************************************/
+static uint16 OffloadFillChunk(uint8* buf, uint16 room)
+{
+    uint16 len = 0u;
+    const FRAM_LOG_RECORD_T* record;
+
+    while((headerPos < OFFLOAD_STREAM_HEADER_LEN) && (len < room))
+    {
+        buf[len++] = streamHeader[headerPos++];
+    }
+
+    while((len < room) && (DISABLED == streamDone))
+    {
+        if((streamSeq - cacheSeq) >= cacheCount)
+        {
+            cacheSeq = streamSeq;
+            cacheCount = 0u;
+            if(streamSeq < streamEnd)
+            {
+                cacheCount = FramLogRead(streamSeq, cache, ((streamEnd - streamSeq) < OFFLOAD_READ_RECORDS) ?
+                                         (uint16)(streamEnd - streamSeq) : OFFLOAD_READ_RECORDS);
+            }
+            if(0u == cacheCount)
+            {
+                buf[len++] = OFFLOAD_STREAM_END;
+                streamDone = ENABLED;
+                break;
+            }
+        }
+
+        /* Byte 0 of a record is its length, followed by the payload */
+        record = &cache[streamSeq - cacheSeq];
+        if(0u == recordPos)
+        {
+            buf[len++] = record->length;
+            recordPos++;
+        }
+        while((len < room) && (recordPos <= record->length))
+        {
+            buf[len++] = record->payload[recordPos - 1u];
+            recordPos++;
+        }
+        if(recordPos > record->length)
+        {
+            recordPos = 0u;
+            streamSeq++;
+        }
+    }
+
+    return(len);
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadInit
+********************************************************************************
+*
+* Summary:
+*  Initializes the Log Offload service state.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  None.
+*
+*******************************************************************************/
+void OffloadInit(void)
+{
+    offloadMtu = OFFLOAD_DEFAULT_MTU;
+    offloadNtfEnabled = DISABLED;
+    offloadActive = DISABLED;
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadCallBack
+********************************************************************************
+*
+* Summary:
+*  Handles the BLE events of the Log Offload service. Called from the
+*  application event callback.
+*
+* Parameters:
+*  event - the event code
+*  *eventParam - the event parameters
+*
+* Return:
+*  None.
+*
+*******************************************************************************/
+void OffloadCallBack(uint32 event, void* eventParam)
+{
+    CYBLE_GATTS_WRITE_REQ_PARAM_T *writeReqParam;
+    CYBLE_GATTS_ERR_PARAM_T errParam;
+    CYBLE_GATT_ERR_CODE_T errorCode;
+
+    switch(event)
+    {
+        case CYBLE_EVT_GAP_DEVICE_DISCONNECTED:
+            OffloadInit();
+            break;
+
+        case CYBLE_EVT_GATTS_XCNHG_MTU_REQ:
+            offloadMtu = (((CYBLE_GATT_XCHG_MTU_PARAM_T *)eventParam)->mtu < CYBLE_GATT_MTU) ?
+                         ((CYBLE_GATT_XCHG_MTU_PARAM_T *)eventParam)->mtu : CYBLE_GATT_MTU;
+            break;
+
+        case CYBLE_EVT_GATTS_WRITE_CMD_REQ:
+            writeReqParam = (CYBLE_GATTS_WRITE_REQ_PARAM_T *)eventParam;
+            if(OFFLOAD_CONTROL_HANDLE == writeReqParam->handleValPair.attrHandle)
+            {
+                (void)OffloadControl(&writeReqParam->handleValPair.value);
+            }
+            break;
+
+        case CYBLE_EVT_GATTS_WRITE_REQ:
+            writeReqParam = (CYBLE_GATTS_WRITE_REQ_PARAM_T *)eventParam;
+            if(OFFLOAD_CONTROL_HANDLE == writeReqParam->handleValPair.attrHandle)
+            {
+                errorCode = OffloadControl(&writeReqParam->handleValPair.value);
+            }
+            else if(OFFLOAD_DATA_CCCD_HANDLE == writeReqParam->handleValPair.attrHandle)
+            {
+                errorCode = CyBle_GattsWriteAttributeValue(&writeReqParam->handleValPair, 0u,
+                                                           &cyBle_connHandle, CYBLE_GATT_DB_PEER_INITIATED);
+                if(CYBLE_GATT_ERR_NONE == errorCode)
+                {
+                    offloadNtfEnabled = (0u != (writeReqParam->handleValPair.value.val[0u] &
+                                                OFFLOAD_CCCD_NOTIFICATION)) ? ENABLED : DISABLED;
+                }
+            }
+            else
+            {
+                /* Not an attribute of this service */
+                break;
+            }
+
+            if(CYBLE_GATT_ERR_NONE == errorCode)
+            {
+                CyBle_GattsWriteRsp(cyBle_connHandle);
+            }
+            else
+            {
+                errParam.opcode = CYBLE_GATT_WRITE_REQ;
+                errParam.attrHandle = writeReqParam->handleValPair.attrHandle;
+                errParam.errorCode = errorCode;
+                (void)CyBle_GattsErrorRsp(cyBle_connHandle, &errParam);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadProcess
+********************************************************************************
+*
+* Summary:
+*  Sends the next chunks of an active transfer. Called from the main loop.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  None.
+*
+* Theory:
+*  Up to OFFLOAD_CHUNKS_PER_CALL notifications of (MTU - 3) bytes are queued
+*  while the window is open, so several of them go out in one connection
+*  event. A chunk the stack does not accept is kept and sent on the next call.
+*
+*******************************************************************************/
+void OffloadProcess(void)
+{
+    CYBLE_GATTS_HANDLE_VALUE_NTF_T ntf;
+    uint16 crc;
+    uint8 count;
+
+    if((ENABLED != offloadActive) || (ENABLED != offloadNtfEnabled) ||
+       (CYBLE_STACK_STATE_FREE != CyBle_GattGetBusStatus()))
+    {
+        return;
+    }
+
+    for(count = 0u; count < OFFLOAD_CHUNKS_PER_CALL; count++)
+    {
+        if(0u == chunkLen)
+        {
+            if((DISABLED != streamDone) || ((uint16)(nextChunk - ackedChunk) >= offloadWindow))
+            {
+                break;
+            }
+
+            chunkBuf[0u] = LO8(nextChunk);
+            chunkBuf[1u] = HI8(nextChunk);
+            chunkLen = OFFLOAD_CHUNK_HEADER_LEN + OffloadFillChunk(&chunkBuf[OFFLOAD_CHUNK_HEADER_LEN],
+                           offloadMtu - 3u - OFFLOAD_CHUNK_HEADER_LEN - OFFLOAD_CHUNK_CRC_LEN);
+            crc = FramLogCrc16(0xFFFFu, chunkBuf, chunkLen);
+            chunkBuf[chunkLen++] = LO8(crc);
+            chunkBuf[chunkLen++] = HI8(crc);
+        }
+
+        ntf.attrHandle = OFFLOAD_DATA_HANDLE;
+        ntf.value.val = chunkBuf;
+        ntf.value.len = chunkLen;
+        if(CYBLE_ERROR_OK != CyBle_GattsNotification(cyBle_connHandle, &ntf))
+        {
+            break;
+        }
+        chunkLen = 0u;
+        nextChunk++;
+    }
+
+    if((DISABLED != streamDone) && (0u == chunkLen) && (ackedChunk == nextChunk))
+    {
+        offloadActive = DISABLED;
+        printf("Offload complete, %u chunks \r\n", nextChunk);
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: OffloadIsActive
+********************************************************************************
+*
+* Summary:
+*  Returns whether a transfer is in progress.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  ENABLED while a transfer is in progress, DISABLED otherwise.
+*
+*******************************************************************************/
+uint8 OffloadIsActive(void)
+{
+    return(offloadActive);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,75 @@
+/*******************************************************************************
+* File Name: offload.h
+*
+* Version 1.0
+*
+* Description:
+*  Log Offload service related code header.
+*
+********************************************************************************
+* Copyright 2014, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <project.h>
+#include "common.h"
+#include "fram_logging.h"
+
+/***************************************
+*        Constant definitions
+***************************************/
+/* Log Offload custom service of the BLE component, UUID 0003D0A0-0000-1000-8000-00805F9B0131:
+*   Data           - 0003D0A1-..., Notify, with Client Characteristic Configuration
+*   Control Point  - 0003D0A2-..., Write, Write Without Response
+*/
+#define OFFLOAD_DATA_HANDLE             CYBLE_LOG_OFFLOAD_DATA_CHAR_HANDLE
+#define OFFLOAD_DATA_CCCD_HANDLE        CYBLE_LOG_OFFLOAD_DATA_CLIENT_CHARACTERISTIC_CONFIGURATION_DESC_HANDLE
+#define OFFLOAD_CONTROL_HANDLE          CYBLE_LOG_OFFLOAD_CONTROL_POINT_CHAR_HANDLE
+
+/* Control Point commands, multi-byte fields are little endian:
+*   START  - opcode, uint32 first sequence, uint8 window (chunks)
+*   ACK    - opcode, uint16 index of the next chunk expected
+*   STOP   - opcode
+*/
+#define OFFLOAD_CMD_START               (0x01u)
+#define OFFLOAD_CMD_ACK                 (0x02u)
+#define OFFLOAD_CMD_STOP                (0x03u)
+#define OFFLOAD_CMD_START_LEN           (6u)
+#define OFFLOAD_CMD_ACK_LEN             (3u)
+/* START from this sequence begins at the oldest record in the log */
+#define OFFLOAD_SEQ_OLDEST              (0xFFFFFFFFu)
+
+/* Each notification is one chunk: uint16 chunk index, stream bytes, CRC-16
+*  over index and stream bytes. The stream is the first and end sequence
+*  (uint32 each) followed by the records as length and payload, ended by
+*  OFFLOAD_STREAM_END.
+*/
+#define OFFLOAD_CHUNK_HEADER_LEN        (2u)
+#define OFFLOAD_CHUNK_CRC_LEN           (2u)
+#define OFFLOAD_STREAM_HEADER_LEN       (8u)
+#define OFFLOAD_STREAM_END              (0xFFu)
+
+#define OFFLOAD_CCCD_NOTIFICATION       (0x01u)
+#define OFFLOAD_DEFAULT_MTU             (23u)
+#define OFFLOAD_MAX_CHUNK               (CYBLE_GATT_MTU - 3u)
+#define OFFLOAD_DEFAULT_WINDOW          (8u)
+#define OFFLOAD_MAX_WINDOW              (32u)
+/* Records fetched from FRAM in one I2C transaction */
+#define OFFLOAD_READ_RECORDS            (8u)
+/* Notifications queued per call of OffloadProcess() */
+#define OFFLOAD_CHUNKS_PER_CALL         (4u)
+/* Connection interval requested for the transfer in 1.25 ms units, 0 to keep the current one */
+#define OFFLOAD_CONN_INTERVAL           (6u)
+
+
+/***************************************
+*        Function Prototypes
+***************************************/
+void OffloadInit(void);
+void OffloadCallBack(uint32 event, void* eventParam);
+void OffloadProcess(void);
+uint8 OffloadIsActive(void);
+
+/* [] END OF FILE */
@@ -45,6 +45,7 @@
 *******************************************************************************/
 #include <project.h>
 #include "common.h"
+#include "scheduler.h"
 #include "stdio.h"
 
 /*MACROS*/
@@ -97,6 +98,7 @@ void StackEventHandler(uint32 event,void* eventparam)
 {
     /*Declaring local variables*/   
     uint8 i,j;
+    uint8 peer;
     
     switch(event)
     {
@@ -106,6 +108,8 @@ void StackEventHandler(uint32 event,void* eventparam)
                 printf("Press 'r' followed by the device number to remove device from bonded list\r\n");
                 printf("Press 'a' to add new peripheral.\r\n");
                 CyBle_GapGetBondedDevicesList(&bondedDeviceList);
+                SchedulerUpdate(&bondedDeviceList);
+                nextDevice=SchedulerNext();
                 /*Set scanning timeout as infinite*/
                 cyBle_discoveryInfo.scanTo=0;
                 
@@ -133,9 +137,16 @@ void StackEventHandler(uint32 event,void* eventparam)
                     advReport= *(CYBLE_GAPC_ADV_REPORT_T *)eventparam;                         
                     newDevice=TRUE;
                     
+                    /*A bonded device which advertises is present, let the scheduler know*/
+                    peer=SchedulerFind(advReport.peerBdAddr);
+                    if(peer!=SCHED_NO_PEER)
+                    {
+                        SchedulerSeen(peer,advReport.rssi);
+                    }
+                    
                     /*If received advertisement packet is from "nextDevice" in the bonded 
                      *devices list and not adding new peripheral then connect to this device*/
-                    if(AddressCompare(bondedDeviceList.bdAddrList[nextDevice],advReport.peerBdAddr) &&  addPeripheral==FALSE)
+                    if(peer==nextDevice &&  addPeripheral==FALSE)
                     {
                         connectCommand=TRUE;                        
                         CyBle_GapcStopScan();                      
@@ -159,17 +170,10 @@ void StackEventHandler(uint32 event,void* eventparam)
                             ++devicesNearBy;
                             
                             printf("Device %d-->:", devicesNearBy);
-                            if(bondedDeviceList.count!=0)
+                            /*Check if the received advertising packet is from bonded device list or not*/
+                            if(peer!=SCHED_NO_PEER)
                             {
-                                /*Check if the received advertising packet is from bonded device list or not*/
-                                for(i=0;i<bondedDeviceList.count;i++)
-                                {
-                                   if(AddressCompare(bondedDeviceList.bdAddrList[i],advReport.peerBdAddr)==TRUE)
-                                    {
-                                        inWhitelist=TRUE;
-                                        break;
-                                    }
-                                }
+                                inWhitelist=TRUE;
                             }
                             /*Display the address of the received advertising packet*/
                             for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
@@ -233,6 +237,10 @@ void StackEventHandler(uint32 event,void* eventparam)
                 deviceN=0;
                 devicesNearBy=0;                                
                 connectCommand=FALSE;   
+                if(addPeripheral==FALSE)
+                {
+                    SchedulerPolled(nextDevice);
+                }
                 CyBle_GapAuthReq(cyBle_connHandle.bdHandle,&cyBle_authInfo);
             break;
                 
@@ -240,6 +248,7 @@ void StackEventHandler(uint32 event,void* eventparam)
                 Connection_LED_Write(LED_OFF); 
                 state=DISCONNECTED;                
                 CyBle_GapGetBondedDevicesList(&bondedDeviceList);
+                SchedulerUpdate(&bondedDeviceList);
                 
                 if(bondedDeviceList.count!=0 && addPeripheral==FALSE)
                 {   /*Enable whitelist*/
@@ -362,6 +371,7 @@ int main()
                     }
                     /*enable whitelist*/                                      
                     CyBle_GapGetBondedDevicesList(&bondedDeviceList);                                      
+                    SchedulerUpdate(&bondedDeviceList);
                 }                               
             }
             
@@ -373,12 +383,7 @@ int main()
                 /*If number of bonded devices not zero*/
                 if(bondedDeviceList.count!=0)
                 {
-                    ++nextDevice;
-                    /*nextDevice value should be less than number of bonded devices-1*/
-                    if(nextDevice>bondedDeviceList.count-1)
-                    {
-                        nextDevice=0;
-                    }
+                    SchedulerTick();
                     
                     if(bondedDeviceList.count>1 && addPeripheral==FALSE && removebondedDevice==FALSE)/*Connected to alteast one device*/
                     {   
@@ -391,28 +396,24 @@ int main()
                         {         
                             printf("Device missing: ");
                             
-                            if(nextDevice==0)
-                            {  /*Dispaly address of missing bonded device*/
-                                for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
-                                {                                    
-                                    UART_UartPutChar(HexToAscii(bondedDeviceList.bdAddrList[bondedDeviceList.count-1].bdAddr[CYBLE_GAP_BD_ADDR_SIZE-i - 1], 1));
-                                    UART_UartPutChar(HexToAscii(bondedDeviceList.bdAddrList[bondedDeviceList.count-1].bdAddr[CYBLE_GAP_BD_ADDR_SIZE-i - 1], 0));
-                                    UART_UartPutChar(' ');                                                               
-                                } 
-                            }
-                            else if(nextDevice < (bondedDeviceList.count))
-                            {
-                              for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
-                                {                                    
-                                    UART_UartPutChar(HexToAscii(bondedDeviceList.bdAddrList[nextDevice-1].bdAddr[CYBLE_GAP_BD_ADDR_SIZE-i - 1], 1));
-                                    UART_UartPutChar(HexToAscii(bondedDeviceList.bdAddrList[nextDevice-1].bdAddr[CYBLE_GAP_BD_ADDR_SIZE-i - 1], 0));
-                                    UART_UartPutChar(' ');                                                               
-                                }   
+                            /*Dispaly address of missing bonded device*/
+                            for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
+                            {                                    
+                                UART_UartPutChar(HexToAscii(bondedDeviceList.bdAddrList[nextDevice].bdAddr[CYBLE_GAP_BD_ADDR_SIZE-i - 1], 1));
+                                UART_UartPutChar(HexToAscii(bondedDeviceList.bdAddrList[nextDevice].bdAddr[CYBLE_GAP_BD_ADDR_SIZE-i - 1], 0));
+                                UART_UartPutChar(' ');                                                               
                             }
                            printf("\r\n");
+                           
+                           /*Skip the missing device for a while*/
+                           SchedulerMissed(nextDevice);
+                           
                            /*Stop Discovery*/
                            CyBle_GapcStopDiscovery();                                                                                                
                         } 
+                        
+                        /*Discovery is restarted by the stack events, for the device selected here*/
+                        nextDevice=SchedulerNext();
                     }
                     else if(bondedDeviceList.count==1 && state==SCANNING && addPeripheral==FALSE)
                     {
@@ -424,6 +425,7 @@ int main()
                             UART_UartPutChar(' ');                                                               
                         }
                         printf("\r\n");
+                        SchedulerMissed(nextDevice);
                     }
                 }
             }
@@ -525,6 +527,7 @@ int main()
                                 else
                                 {
                                     printf("\r\nMutliplexing process Started\r\n");
+                                    nextDevice=SchedulerNext();
                                 }
                             
                                 /*Start Discovery*/
@@ -598,6 +601,7 @@ void DisplayBondedlist()
 {
     uint8 j,i;    
     CyBle_GapGetBondedDevicesList(&bondedDeviceList);
+    SchedulerUpdate(&bondedDeviceList);
     
     if(bondedDeviceList.count!=0)
     {  /*If there is at least one bonded device*/
@@ -0,0 +1,361 @@
+/*******************************************************************************
+* File Name: scheduler.c
+*
+* Version: 1.0
+*
+* Description:
+*  This file selects the bonded peripheral to be polled next. Peripherals seen
+*  advertising are polled first, the others in the order of their last poll.
+*  Peripherals which were missing are skipped with an exponential backoff.
+*
+* Hardware Dependency:
+*  CY8CKIT-042 BLE
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <project.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "scheduler.h"
+
+/* State of the peers, in the order of the bonded list */
+static SCHED_PEER_T peers[CYBLE_GAP_MAX_BONDED_DEVICE];
+static uint8 peerCount = 0u;
+
+/* Open addressing hash table, holds the peer index + 1, 0 for a free slot */
+static uint8 hashTable[SCHED_HASH_SIZE];
+
+/* Tick counter and poll statistics of the current report period */
+static uint32 ticks = 0u;
+static uint16 polls = 0u;
+static uint16 missed = 0u;
+
+
+/*******************************************************************************
+* Function Name: AddressHash()
+********************************************************************************
+* Summary:
+* Hashes a Bluetooth device address into the hash table.
+*
+* Parameters:
+* const uint8 *bdAddr: the device address
+*
+* Return:
+* uint8: the first slot to be probed
+*
+*******************************************************************************/
+static uint8 AddressHash(const uint8 *bdAddr)
+{
+    uint8 hash = 0u;
+    uint8 i;
+
+    for(i = 0u; i < CYBLE_GAP_BD_ADDR_SIZE; i++)
+    {
+        hash = (uint8)((hash * 31u) + bdAddr[i]);
+    }
+
+    return (uint8)((hash ^ (hash >> 4u)) & (SCHED_HASH_SIZE - 1u));
+}
+
+
+/*******************************************************************************
+* Function Name: FindPeer()
+********************************************************************************
+* Summary:
+* Looks up a device address through the hash table.
+*
+* Parameters:
+* const SCHED_PEER_T *table: the peers the hash table was built from
+* const uint8 *bdAddr: the device address
+*
+* Return:
+* uint8: index in the table, SCHED_NO_PEER if not found
+*
+*******************************************************************************/
+static uint8 FindPeer(const SCHED_PEER_T *table, const uint8 *bdAddr)
+{
+    uint8 slot = AddressHash(bdAddr);
+    uint8 probes;
+
+    for(probes = 0u; (probes < SCHED_HASH_SIZE) && (hashTable[slot] != 0u); probes++)
+    {
+        if(memcmp(table[hashTable[slot] - 1u].bdAddr, bdAddr, CYBLE_GAP_BD_ADDR_SIZE) == 0)
+        {
+            return (uint8)(hashTable[slot] - 1u);
+        }
+        slot = (slot + 1u) & (SCHED_HASH_SIZE - 1u);
+    }
+
+    return SCHED_NO_PEER;
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerUpdate()
+********************************************************************************
+* Summary:
+* Takes over a new bonded device list.
+*
+* Parameters:
+* const CYBLE_GAP_BONDED_DEV_ADDR_LIST_T *list: the bonded device list
+*
+* Return:
+* None
+*
+* Theory:
+* The state of peers which stay in the list is kept, so the function is called
+* whenever the bonded list is read again. Added peers are due immediately.
+*
+*******************************************************************************/
+void SchedulerUpdate(const CYBLE_GAP_BONDED_DEV_ADDR_LIST_T *list)
+{
+    SCHED_PEER_T oldPeers[CYBLE_GAP_MAX_BONDED_DEVICE];
+    uint8 i;
+    uint8 old;
+    uint8 slot;
+
+    memcpy(oldPeers, peers, sizeof(peers));
+
+    for(i = 0u; i < list->count; i++)
+    {
+        old = FindPeer(oldPeers, list->bdAddrList[i].bdAddr);
+        if(old != SCHED_NO_PEER)
+        {
+            peers[i] = oldPeers[old];
+        }
+        else
+        {
+            memset(&peers[i], 0, sizeof(peers[i]));
+            memcpy(peers[i].bdAddr, list->bdAddrList[i].bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+            peers[i].skipUntil = ticks;
+        }
+    }
+    peerCount = list->count;
+
+    memset(hashTable, 0, sizeof(hashTable));
+    for(i = 0u; i < peerCount; i++)
+    {
+        slot = AddressHash(peers[i].bdAddr);
+        while(hashTable[slot] != 0u)
+        {
+            slot = (slot + 1u) & (SCHED_HASH_SIZE - 1u);
+        }
+        hashTable[slot] = i + 1u;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerFind()
+********************************************************************************
+* Summary:
+* Looks up a device address in the bonded list.
+*
+* Parameters:
+* const uint8 *bdAddr: the device address
+*
+* Return:
+* uint8: index in the bonded list, SCHED_NO_PEER if not bonded
+*
+*******************************************************************************/
+uint8 SchedulerFind(const uint8 *bdAddr)
+{
+    return FindPeer(peers, bdAddr);
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerSeen()
+********************************************************************************
+* Summary:
+* Records an advertising packet of a bonded peer. The peer is present, so its
+* backoff ends and it is preferred at the next selection.
+*
+* Parameters:
+* uint8 peer: index in the bonded list
+* int8 rssi: RSSI of the packet
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void SchedulerSeen(uint8 peer, int8 rssi)
+{
+    if(peer < peerCount)
+    {
+        peers[peer].rssi = rssi;
+        peers[peer].lastSeen = ticks;
+        peers[peer].dataPending = TRUE;
+        peers[peer].misses = 0u;
+        peers[peer].skipUntil = ticks;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerPolled()
+********************************************************************************
+* Summary:
+* Records a connection to a bonded peer.
+*
+* Parameters:
+* uint8 peer: index in the bonded list
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void SchedulerPolled(uint8 peer)
+{
+    if(peer < peerCount)
+    {
+        peers[peer].lastPolled = ticks;
+        peers[peer].dataPending = FALSE;
+        peers[peer].misses = 0u;
+        polls++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerMissed()
+********************************************************************************
+* Summary:
+* Records a poll slot in which the peer did not advertise. The peer is skipped
+* for 2^misses ticks, up to SCHED_MAX_BACKOFF ticks.
+*
+* Parameters:
+* uint8 peer: index in the bonded list
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void SchedulerMissed(uint8 peer)
+{
+    uint32 backoff;
+
+    if(peer < peerCount)
+    {
+        if(peers[peer].misses < 8u)
+        {
+            peers[peer].misses++;
+        }
+        backoff = (uint32)1u << peers[peer].misses;
+        if(backoff > SCHED_MAX_BACKOFF)
+        {
+            backoff = SCHED_MAX_BACKOFF;
+        }
+        peers[peer].skipUntil = ticks + backoff;
+        peers[peer].dataPending = FALSE;
+        missed++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerNext()
+********************************************************************************
+* Summary:
+* Selects the bonded peer to be polled in the next slot.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint8: index in the bonded list
+*
+* Theory:
+* Among the peers not in backoff, one seen advertising wins, then the one
+* polled longest ago, then the one with the stronger RSSI. When all peers are
+* in backoff, the one whose backoff ends first is selected.
+*
+*******************************************************************************/
+uint8 SchedulerNext(void)
+{
+    uint8 best = 0u;
+    uint8 bestReady = FALSE;
+    uint8 ready;
+    uint8 i;
+    SCHED_PEER_T *peer;
+
+    for(i = 0u; i < peerCount; i++)
+    {
+        peer = &peers[i];
+        ready = ((int32)(ticks - peer->skipUntil) >= 0) ? TRUE : FALSE;
+
+        if(i == 0u)
+        {
+            bestReady = ready;
+        }
+        else if(ready != bestReady)
+        {
+            if(ready == TRUE)
+            {
+                best = i;
+                bestReady = TRUE;
+            }
+        }
+        else if(ready == FALSE)
+        {
+            if((int32)(peer->skipUntil - peers[best].skipUntil) < 0)
+            {
+                best = i;
+            }
+        }
+        else if(peer->dataPending != peers[best].dataPending)
+        {
+            if(peer->dataPending == TRUE)
+            {
+                best = i;
+            }
+        }
+        else if(peer->lastPolled != peers[best].lastPolled)
+        {
+            if((int32)(peer->lastPolled - peers[best].lastPolled) < 0)
+            {
+                best = i;
+            }
+        }
+        else if(peer->rssi > peers[best].rssi)
+        {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+
+/*******************************************************************************
+* Function Name: SchedulerTick()
+********************************************************************************
+* Summary:
+* Advances the scheduler time by one poll slot, called from the WDT timeout.
+* Prints the poll statistics every SCHED_REPORT_PERIOD ticks.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void SchedulerTick(void)
+{
+    ticks++;
+
+    if((ticks % SCHED_REPORT_PERIOD) == 0u)
+    {
+        printf("Polls in last %u s: %u connected, %u missing\r\n", SCHED_REPORT_PERIOD, polls, missed);
+        polls = 0u;
+        missed = 0u;
+    }
+}
+/* [] END OF FILE */
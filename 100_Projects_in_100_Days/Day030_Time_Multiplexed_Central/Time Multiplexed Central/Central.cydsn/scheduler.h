@@ -0,0 +1,70 @@
+/*******************************************************************************
+* File Name: scheduler.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the scheduler which
+*  selects the bonded peripheral to be polled next.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#if !defined(SCHEDULER_H)
+#define SCHEDULER_H
+
+#include <project.h>
+
+
+/***************************************
+*        API Constants
+***************************************/
+
+/* Returned when an address is not in the bonded list */
+#define SCHED_NO_PEER                       (0xFFu)
+
+/* Address hash table, a power of two of at least twice the bonded devices */
+#define SCHED_HASH_SIZE                     (16u)
+
+/* A missed peer is skipped for 2^misses ticks, up to this many */
+#define SCHED_MAX_BACKOFF                   (32u)
+
+/* Ticks between two reports of the poll statistics */
+#define SCHED_REPORT_PERIOD                 (60u)
+
+
+/***************************************
+*        Data Types
+***************************************/
+
+/* Scheduling state of one bonded peripheral */
+typedef struct
+{
+    uint8  bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    int8   rssi;            /* RSSI of the last advertising packet */
+    uint8  dataPending;     /* Seen advertising since the last poll */
+    uint8  misses;          /* Polls missed in a row */
+    uint32 lastSeen;        /* Tick of the last advertising packet */
+    uint32 lastPolled;      /* Tick of the last connection */
+    uint32 skipUntil;       /* Not polled before this tick */
+} SCHED_PEER_T;
+
+
+/***************************************
+*        Function Prototypes
+***************************************/
+
+void SchedulerUpdate(const CYBLE_GAP_BONDED_DEV_ADDR_LIST_T *list);
+uint8 SchedulerFind(const uint8 *bdAddr);
+void SchedulerSeen(uint8 peer, int8 rssi);
+void SchedulerPolled(uint8 peer);
+void SchedulerMissed(uint8 peer);
+uint8 SchedulerNext(void);
+void SchedulerTick(void);
+
+#endif /* SCHEDULER_H */
+
+/* [] END OF FILE */
@@ -49,8 +49,35 @@ short AC1, AC2, AC3, B1, B2, MC, MD; //Variables to store calibration coefficien
 unsigned short AC4, AC5, AC6; //Variables to store calibration coefficients
 long UT, UP; //Variables to store uncompensated temperature and pressure data
 long Temperature, Pressure, Altitude; //Variables to store the true temperature, pressure and altitude data
-double PressureAtSeaLevel = 101325.0; //Pressure at sea level in Pascal
 uint8 CalibrationDataAvailable = FALSE; //This flag is to whether the calibration data is available
+
+/* Altitude in 1/16 m for every 512 Pa from ALTITUDE_TABLE_MIN_PRESSURE, generated as
+ * 16 * 44330 * (1 - (p / PRESSURE_AT_SEA_LEVEL)^(1 / 5.255)). Linear interpolation
+ * between the entries stays within 0.25 m of the formula over the whole table, and
+ * within 0.75 m once rounded to whole meters. */
+static const long AltitudeTable[ALTITUDE_TABLE_SIZE] =
+{
+    146642, 144828, 143037, 141271, 139527, 137806, 136107, 134429,
+    132772, 131134, 129516, 127917, 126337, 124774, 123229, 121701,
+    120190, 118696, 117217, 115754, 114306, 112872, 111454, 110049,
+    108658, 107281, 105918, 104567, 103229, 101903, 100590, 99288,
+    97998, 96720, 95453, 94197, 92952, 91717, 90493, 89279,
+    88075, 86881, 85696, 84522, 83356, 82199, 81052, 79913,
+    78784, 77662, 76549, 75445, 74348, 73260, 72179, 71106,
+    70041, 68983, 67933, 66889, 65853, 64824, 63802, 62787,
+    61779, 60777, 59782, 58793, 57811, 56835, 55865, 54901,
+    53943, 52991, 52045, 51104, 50170, 49240, 48317, 47399,
+    46486, 45579, 44677, 43780, 42888, 42001, 41119, 40242,
+    39370, 38503, 37640, 36783, 35930, 35081, 34237, 33397,
+    32562, 31731, 30905, 30082, 29264, 28451, 27641, 26835,
+    26034, 25236, 24442, 23652, 22866, 22084, 21306, 20531,
+    19760, 18993, 18229, 17469, 16712, 15959, 15210, 14463,
+    13720, 12981, 12245, 11512, 10782, 10056, 9333, 8613,
+    7896, 7182, 6472, 5764, 5059, 4358, 3659, 2963,
+    2271, 1581, 894, 209, -472, -1151, -1827, -2500,
+    -3171, -3839, -4504, -5166, -5826, -6484, -7139, -7791,
+    -8441, -9088, -9733, -10375, -11015, -11653, -12288
+};
 /***********************************************************************************************************************/
 
 /*************************************************************************************************************************
@@ -191,6 +218,9 @@ void ReadUncompensatedPressure(void)
 *************************************************************************************************************************/
 void ReadAndCalculateSensorData(void)
 {
+    long UncompensatedPressure[PRESSURE_SAMPLES]; //Pressure conversions of this reading
+    uint8 Sample;
+    
     /* Read the sensor calibration data if not already available */
 	if(!CalibrationDataAvailable)
     {
@@ -198,40 +228,140 @@ void ReadAndCalculateSensorData(void)
     }
     
     ReadUncompensatedTemperature(); //Read the uncompensated temperature value
-    ReadUncompensatedPressure(); //Read the uncompensated pressure value
+    for(Sample = 0; Sample < PRESSURE_SAMPLES; Sample++)
+    {
+        ReadUncompensatedPressure(); //Read the uncompensated pressure value
+        UncompensatedPressure[Sample] = UP;
+    }
     
+    CalculateTemperature(); //Calculate the true temperature and the pressure coefficients
+    Pressure = CalculatePressure(UncompensatedPressure, PRESSURE_SAMPLES); //Calculate the true pressure
+    Altitude = CalculateAltitude(Pressure); //Calculate the true altitude
+}
+/***********************************************************************************************************************/
+
+/*************************************************************************************************************************
+* Function Name: CalculateTemperature
+**************************************************************************************************************************
+* Summary: This function converts the uncompensated temperature into true temperature using the
+* algorithm given in the sensor datasheet. It also calculates the temperature dependent coefficients
+* B3 and B4 that CalculatePressure uses for all pressure samples of the reading. Divisions by
+* powers of 2 are done with shifts, so no floating point is needed.
+*
+* Parameters:
+*  void
+*
+* Return:
+*  void
+*
+*************************************************************************************************************************/
+void CalculateTemperature(void)
+{
     /* Calculate the true temperature as described in sensor datasheet */
-    X1 = (UT - AC6) * AC5 / pow(2, 15);
-    X2 = MC * pow(2, 11) / (X1 + MD);
+    X1 = ((UT - AC6) * AC5) >> 15;
+    X2 = ((long)MC << 11) / (X1 + MD);
     B5 = X1 + X2;
-    Temperature = (B5 + 8) / pow(2, 4);
+    Temperature = (B5 + 8) >> 4;
     
-    /* Calculate the true barometric pressure as described in sensor datasheet */
+    /* Calculate the pressure coefficients as described in sensor datasheet */
     B6 = B5 - 4000;
-    X1 = (B2 * (B6 * B6 / pow(2, 12))) / pow(2, 11);
-    X2 = AC2 * B6 / pow(2, 11);
+    X1 = (B2 * ((B6 * B6) >> 12)) >> 11;
+    X2 = (AC2 * B6) >> 11;
     X3 = X1 + X2;
-    B3 = (((AC1 * 4 + X3) << OSS) + 2) / 4;
-    X1 = AC3 * B6 / pow(2, 13);
-    X2 = (B1 * (B6 * B6 / pow(2, 12))) / pow(2, 16);
-    X3 = ((X1 + X2) + 2) / pow(2, 2);
-    B4 = (AC4 * (unsigned long)(X3 + 32768)) / pow(2, 15);
-    B7 = ((unsigned long)UP - B3) * (50000 >> OSS);
-    if(B7 < 0x80000000)
+    B3 = (((AC1 * 4 + X3) << OSS) + 2) >> 2;
+    X1 = (AC3 * B6) >> 13;
+    X2 = (B1 * ((B6 * B6) >> 12)) >> 16;
+    X3 = ((X1 + X2) + 2) >> 2;
+    B4 = (AC4 * (unsigned long)(X3 + 32768)) >> 15;
+}
+/***********************************************************************************************************************/
+
+/*************************************************************************************************************************
+* Function Name: CalculatePressure
+**************************************************************************************************************************
+* Summary: This function converts uncompensated pressure samples into true pressure using the
+* algorithm given in the sensor datasheet and returns their average. CalculateTemperature must
+* be called first for the temperature the samples were taken at.
+*
+* Parameters:
+*  UncompensatedPressure: Uncompensated pressure samples
+*  Samples: Number of samples, at least one
+*
+* Return:
+*  long: Average true pressure in Pascal
+*
+*************************************************************************************************************************/
+long CalculatePressure(const long UncompensatedPressure[], uint8 Samples)
+{
+    long TruePressure;
+    long Sum = 0;
+    uint8 Sample;
+    
+    for(Sample = 0; Sample < Samples; Sample++)
+    {
+        B7 = ((unsigned long)UncompensatedPressure[Sample] - B3) * (50000 >> OSS);
+        if(B7 < 0x80000000)
+        {
+            TruePressure = (B7 *2) / B4;
+        }
+        else 
+        {
+            TruePressure = (B7 / B4) *2;
+        }
+        X1 = (TruePressure >> 8) * (TruePressure >> 8);
+        X1 = (X1 * 3038) >> 16;
+        X2 = (-7357 * TruePressure) >> 16;
+        Sum += TruePressure + ((X1 + X2 + 3791) >> 4);
+    }
+    
+    return (Sum + (Samples >> 1)) / Samples;
+}
+/***********************************************************************************************************************/
+
+/*************************************************************************************************************************
+* Function Name: CalculateAltitude
+**************************************************************************************************************************
+* Summary: This function calculates the altitude for the pressure at sea level PRESSURE_AT_SEA_LEVEL
+* by interpolating AltitudeTable, instead of evaluating the barometric formula in floating point.
+*
+* Parameters:
+*  TruePressure: Pressure in Pascal
+*
+* Return:
+*  long: Altitude in meters, rounded to the nearest meter and within 0.75 m of the formula.
+*  Pressure outside of the sensor range
+*  is limited to the range.
+*
+*************************************************************************************************************************/
+long CalculateAltitude(long TruePressure)
+{
+    long Offset;
+    long Index;
+    long Altitude16;
+    
+    Offset = TruePressure - ALTITUDE_TABLE_MIN_PRESSURE;
+    if(Offset < 0)
     {
-        Pressure = (B7 *2) / B4;
+        Offset = 0;
     }
-    else 
+    else if(Offset >= ((ALTITUDE_TABLE_SIZE - 1) << ALTITUDE_TABLE_STEP_SHIFT))
     {
-        Pressure = (B7 / B4) *2;
+        Offset = ((ALTITUDE_TABLE_SIZE - 1) << ALTITUDE_TABLE_STEP_SHIFT) - 1;
     }
-    X1 = (Pressure / pow(2, 8)) * (Pressure / pow(2, 8));
-    X1 = (X1 * 3038) / pow(2, 16);
-    X2 = (-7357 * Pressure) / pow(2, 16);
-    Pressure = Pressure + (X1 + X2 + 3791) / pow(2, 4);
     
-    /* Calculate the true altitude based on pressure at sea level as described in sensor datasheet */
-    Altitude = 44330 * (1 - (pow(Pressure/PressureAtSeaLevel, 1/5.255)));
+    Index = Offset >> ALTITUDE_TABLE_STEP_SHIFT;
+    Offset &= (1 << ALTITUDE_TABLE_STEP_SHIFT) - 1;
+    
+    /* Table is decreasing, interpolate from the entry below the pressure */
+    Altitude16 = AltitudeTable[Index] -
+        (((AltitudeTable[Index] - AltitudeTable[Index + 1]) * Offset) >> ALTITUDE_TABLE_STEP_SHIFT);
+    
+    /* Round to the nearest meter, division truncates toward zero */
+    if(Altitude16 >= 0)
+    {
+        return (Altitude16 + 8) / 16;
+    }
+    return -((8 - Altitude16) / 16);
 }
 /***********************************************************************************************************************/
 
@@ -43,11 +43,15 @@
 #define I2CMASTER
 
 #include <common.h>
-#include "math.h"
 
 /*************************Macro Definition**********************************/
 #define I2CSlaveAddress 0x77 //BMP180 Pressure Sensor I2C address
 #define OSS 0x03 //Oversampling setting for ultra high resolution
+#define PRESSURE_SAMPLES 0x01 //Number of pressure conversions averaged per reading
+#define PRESSURE_AT_SEA_LEVEL 101325 //Pressure at sea level in Pascal, AltitudeTable is generated for it
+#define ALTITUDE_TABLE_MIN_PRESSURE 30000 //Pressure of the first altitude table entry in Pascal
+#define ALTITUDE_TABLE_STEP_SHIFT 0x09 //Altitude table entries are 512 Pascal apart
+#define ALTITUDE_TABLE_SIZE 159 //Altitude table covers the sensor range of 300 to 1100 hPa
 /*****************************************************************************/
 
 /*************************Function Prototypes*******************************/
@@ -55,6 +59,9 @@ void ReadSensorCalibrationData(void);
 void ReadUncompensatedTemperature(void);
 void ReadUncompensatedPressure(void);
 void ReadAndCalculateSensorData(void);
+void CalculateTemperature(void);
+long CalculatePressure(const long UncompensatedPressure[], uint8 Samples);
+long CalculateAltitude(long TruePressure);
 /*****************************************************************************/
 #endif
 /* [] END OF FILE */
@@ -25,11 +25,24 @@ uint8 hrsNotification = 0;
 /* Heart Rate Measurement characteristic data structure */
 CYBLE_HRS_HRM_T hrsHeartRate;
 
+/* Measurements received but not yet processed by the main loop. The HRS
+ * callback is the only writer of hrscHrmHead and HrscProcessMeasurements() the
+ * only writer of hrscHrmTail, so the queue needs no locking.
+ */
+static CYBLE_HRS_HRM_T hrscHrmQueue[HRSC_HRM_QUEUE_SIZE];
+static volatile uint8 hrscHrmHead = 0u;
+static volatile uint8 hrscHrmTail = 0u;
+uint16 hrscHrmDropped = 0u;
+
+/* Rolling HRV statistics over the last HRSC_HRV_WINDOW RR-Intervals */
+static HRSC_HRV_T hrscHrv;
+
+static void HrscHrvAddRRInterval(uint16 rrInterval);
+static uint16 HrscSqrt(uint32 value);
+
 /* Heart Rate Service callback */
 void HeartRateCallBack(uint32 event, void* eventParam)
 {
-    uint16 rrInt;
-    uint16 i;
     uint16 attrValue;
 
     switch(event)
@@ -82,31 +95,9 @@ void HeartRateCallBack(uint32 event, void* eventParam)
             break;
 
         case CYBLE_EVT_HRSC_NOTIFICATION:
-            printf("Heart Rate Notification: ");
-            
+            /* Only parse here, the measurement is reported by HrscProcessMeasurements() */
             HrscUnPackHrm(((CYBLE_HRS_CHAR_VALUE_T*)eventParam)->value);
 
-            if(!HrscIsSensorContactSupported() || HrscIsSensorContactDetected())
-            {
-                printf("Heart Rate: %d    ", (int) HrscGetHeartRate());
-                printf("EnergyExpended: %d", (int) HrscGetEnergyExpended());
-
-                for(i = 0; i < CYBLE_HRS_HRM_RRSIZE; i++)
-                {
-                    rrInt = HrscGetRRInterval(i);
-                    if(0u != rrInt)
-                    {
-                        printf("    RR-Interval %d: %d", (int) i, (int) HrscGetRRInterval(i));
-                    }
-                }
-
-                printf("\r\n");
-            }
-            else
-            {
-                printf("Sensor Contact is supported but not detected \r\n");
-            }
-
             if(2u == hrsNotification)
             {
                 hrsNotification = 1u;
@@ -199,6 +190,15 @@ void HrsInit(void)
         hrsHeartRate.rrInterval[i] = 0u;
     }
     
+    hrscHrmHead = 0u;
+    hrscHrmTail = 0u;
+    hrscHrmDropped = 0u;
+    hrscHrv.head = 0u;
+    hrscHrv.count = 0u;
+    hrscHrv.sum = 0u;
+    hrscHrv.sumSq = 0u;
+    hrscHrv.sumSqDiff = 0u;
+    
     CyBle_HrsRegisterAttrCallback(HeartRateCallBack);
 }
 
@@ -240,29 +240,26 @@ CYBLE_API_RESULT_T HrscConfigHeartRateNtf(uint16 configuration)
 
 
 /*******************************************************************************
-* Function Name: CyBle_HrscConfigHeartRateNtf
+* Function Name: HrscUnPackHrm
 ********************************************************************************
 *
 * Summary:
-*   Modifies the Heart Rate Measurument characteristic configuration descriptor.
+*   Parses the Heart Rate Measurement characteristic value into hrsHeartRate
+*   and queues a copy for HrscProcessMeasurements().
 *
 * Parameters:
-*  uint16 configuration:   Notification flag, can be either:
-*                   CYBLE_HRS_HRM_NTF_ENABLE or
-*                   CYBLE_HRS_HRM_NTF_DISABLE
+*   CYBLE_GATT_VALUE_T* value: The notified characteristic value.
 *
 * Return:
-*   CYBLE_API_RESULT_T: API result will state if API succeeded
-*                               (CYBLE_ERROR_OK) or
-*                               failed with error codes:
-*   CYBLE_ERROR_OK - The request is sent successfully;
-*   CYBLE_ERROR_INVALID_PARAMETER - Validation of input parameter is failed.
+*   None.
+*
 *******************************************************************************/
 void HrscUnPackHrm(CYBLE_GATT_VALUE_T* value)
 {
     uint8 nextPtr;
     uint8 rrInt;
     uint8 i;
+    uint8 head;
     uint8 * pdu;
 
     pdu = value->val;
@@ -297,7 +294,7 @@ void HrscUnPackHrm(CYBLE_GATT_VALUE_T* value)
     if((hrsHeartRate.flags & CYBLE_HRS_HRM_RRINT) != 0u)
     {
         /* Calculate how many RR-Intervals are in this pdu */
-        rrInt = (uint8)(((uint8)(value->len) - nextPtr) >> 1);
+        rrInt = (value->len > nextPtr) ? (uint8)(((uint8)(value->len) - nextPtr) >> 1) : 0u;
 
         for(i = 0u; i < CYBLE_HRS_HRM_RRSIZE; i++)
         {
@@ -314,6 +311,241 @@ void HrscUnPackHrm(CYBLE_GATT_VALUE_T* value)
             }
         }
     }
+
+    head = (hrscHrmHead + 1u) & (HRSC_HRM_QUEUE_SIZE - 1u);
+    if(head != hrscHrmTail)
+    {
+        hrscHrmQueue[hrscHrmHead] = hrsHeartRate;
+        hrscHrmHead = head;
+    }
+    else
+    {
+        /* Main loop did not keep up, the measurement is lost */
+        hrscHrmDropped++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: HrscProcessMeasurements
+********************************************************************************
+*
+* Summary:
+*   Reports all measurements queued since the previous call and updates the
+*   HRV statistics with their RR-Intervals. Called from the main loop.
+*
+* Parameters:
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void HrscProcessMeasurements(void)
+{
+    CYBLE_HRS_HRM_T * hrm;
+    uint8 i;
+
+    while(hrscHrmTail != hrscHrmHead)
+    {
+        hrm = &hrscHrmQueue[hrscHrmTail];
+
+        printf("Heart Rate Notification: ");
+
+        if((0u == (hrm->flags & CYBLE_HRS_HRM_SC_SPRT)) || (0u != (hrm->flags & CYBLE_HRS_HRM_SC_STAT)))
+        {
+            printf("Heart Rate: %d    ", (int) hrm->heartRateValue);
+            printf("EnergyExpended: %d", (int) hrm->energyExpendedValue);
+
+            if((hrm->flags & CYBLE_HRS_HRM_RRINT) != 0u)
+            {
+                for(i = 0; i < CYBLE_HRS_HRM_RRSIZE; i++)
+                {
+                    if(0u != hrm->rrInterval[i])
+                    {
+                        printf("    RR-Interval %d: %d", (int) i, (int) hrm->rrInterval[i]);
+                        HrscHrvAddRRInterval(hrm->rrInterval[i]);
+                    }
+                }
+
+                if(hrscHrv.count > 1u)
+                {
+                    printf("    RMSSD: %d ms    SDNN: %d ms", (int) HrscGetRmssd(), (int) HrscGetSdnn());
+                }
+            }
+
+            printf("\r\n");
+        }
+        else
+        {
+            printf("Sensor Contact is supported but not detected \r\n");
+        }
+
+        hrscHrmTail = (hrscHrmTail + 1u) & (HRSC_HRM_QUEUE_SIZE - 1u);
+    }
+
+    if(0u != hrscHrmDropped)
+    {
+        printf("Heart Rate Measurements dropped: %d \r\n", (int) hrscHrmDropped);
+        hrscHrmDropped = 0u;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: HrscHrvAddRRInterval
+********************************************************************************
+*
+* Summary:
+*   Adds an RR-Interval to the HRV window. The running sums are updated with
+*   the new interval and the one that leaves the window, so the cost does not
+*   depend on the window size. Intervals outside of HRSC_RR_MIN..HRSC_RR_MAX
+*   are artifacts and are ignored.
+*
+* Parameters:
+*   uint16 rrInterval: RR-Interval in 1/1024 s.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void HrscHrvAddRRInterval(uint16 rrInterval)
+{
+    uint8 oldest;
+    uint16 newest;     /* Reused for the interval next to the oldest one */
+    uint32 diff;
+
+    if((rrInterval < HRSC_RR_MIN) || (rrInterval > HRSC_RR_MAX))
+    {
+        return;
+    }
+
+    oldest = (hrscHrv.head + HRSC_HRV_WINDOW - hrscHrv.count) % HRSC_HRV_WINDOW;
+
+    if(HRSC_HRV_WINDOW == hrscHrv.count)
+    {
+        /* Drop the oldest interval and its difference to the next one */
+        newest = hrscHrv.rr[(oldest + 1u) % HRSC_HRV_WINDOW];
+        diff = (newest > hrscHrv.rr[oldest]) ? (newest - hrscHrv.rr[oldest]) : (hrscHrv.rr[oldest] - newest);
+        hrscHrv.sumSqDiff -= diff * diff;
+        hrscHrv.sum -= hrscHrv.rr[oldest];
+        hrscHrv.sumSq -= (uint32) hrscHrv.rr[oldest] * hrscHrv.rr[oldest];
+        hrscHrv.count--;
+    }
+
+    if(0u != hrscHrv.count)
+    {
+        newest = hrscHrv.rr[(hrscHrv.head + HRSC_HRV_WINDOW - 1u) % HRSC_HRV_WINDOW];
+        diff = (rrInterval > newest) ? (rrInterval - newest) : (newest - rrInterval);
+        hrscHrv.sumSqDiff += diff * diff;
+    }
+
+    hrscHrv.rr[hrscHrv.head] = rrInterval;
+    hrscHrv.head = (hrscHrv.head + 1u) % HRSC_HRV_WINDOW;
+    hrscHrv.sum += rrInterval;
+    hrscHrv.sumSq += (uint32) rrInterval * rrInterval;
+    hrscHrv.count++;
+}
+
+
+/*******************************************************************************
+* Function Name: HrscGetRmssd
+********************************************************************************
+*
+* Summary:
+*   Gets the root mean square of the successive RR-Interval differences
+*   over the HRV window.
+*
+* Parameters:
+*   None.
+*
+* Return:
+*   uint16 RMSSD in ms, 0 if less than two RR-Intervals were received.
+*
+*******************************************************************************/
+uint16 HrscGetRmssd(void)
+{
+    uint16 retVal = 0u;
+
+    if(hrscHrv.count > 1u)
+    {
+        retVal = HRSC_RR_TO_MS(HrscSqrt(hrscHrv.sumSqDiff / (hrscHrv.count - 1u)));
+    }
+
+    return (retVal);
+}
+
+
+/*******************************************************************************
+* Function Name: HrscGetSdnn
+********************************************************************************
+*
+* Summary:
+*   Gets the standard deviation of the RR-Intervals over the HRV window.
+*
+* Parameters:
+*   None.
+*
+* Return:
+*   uint16 SDNN in ms, 0 if less than two RR-Intervals were received.
+*
+*******************************************************************************/
+uint16 HrscGetSdnn(void)
+{
+    uint32 sumSquared;
+    uint16 retVal = 0u;
+
+    if(hrscHrv.count > 1u)
+    {
+        /* sum * sum / count split so that no intermediate result overflows */
+        sumSquared = ((hrscHrv.sum / hrscHrv.count) * hrscHrv.sum) +
+                     (((hrscHrv.sum % hrscHrv.count) * hrscHrv.sum) / hrscHrv.count);
+        retVal = HRSC_RR_TO_MS(HrscSqrt((hrscHrv.sumSq - sumSquared) / hrscHrv.count));
+    }
+
+    return (retVal);
+}
+
+
+/*******************************************************************************
+* Function Name: HrscSqrt
+********************************************************************************
+*
+* Summary:
+*   Calculates the integer square root.
+*
+* Parameters:
+*   uint32 value: Value to calculate the square root of.
+*
+* Return:
+*   uint16 The largest integer whose square is not greater than value.
+*
+*******************************************************************************/
+static uint16 HrscSqrt(uint32 value)
+{
+    uint32 root = 0u;
+    uint32 bit = 1uL << 30u;
+
+    while(bit > value)
+    {
+        bit >>= 2u;
+    }
+
+    while(0u != bit)
+    {
+        if(value >= (root + bit))
+        {
+            value -= root + bit;
+            root = (root >> 1u) + bit;
+        }
+        else
+        {
+            root >>= 1u;
+        }
+        bit >>= 2u;
+    }
+
+    return ((uint16) root);
 }
 
 
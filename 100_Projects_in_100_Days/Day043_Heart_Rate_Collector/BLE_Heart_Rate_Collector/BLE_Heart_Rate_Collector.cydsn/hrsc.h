@@ -35,6 +35,15 @@
 #define CYBLE_HRS_HRM_NTF_ENABLE        CYBLE_CCCD_NOTIFICATION
 #define CYBLE_HRS_HRM_NTF_DISABLE       (0x0000u)
 
+/* Measurements queued between main loop passes, must be a power of 2 */
+#define HRSC_HRM_QUEUE_SIZE             (8u)
+
+/* HRV statistics window and the accepted RR-Interval range, in 1/1024 s */
+#define HRSC_HRV_WINDOW                 (32u)
+#define HRSC_RR_MIN                     (205u)      /* 200 ms, 300 bpm */
+#define HRSC_RR_MAX                     (3072u)     /* 3 s, 20 bpm */
+#define HRSC_RR_TO_MS(rr)               ((uint16)(((uint32)(rr) * 1000u) >> 10u))
+
 
 /***************************************
 *            Data Types
@@ -48,6 +57,17 @@ typedef struct
     uint16 rrInterval[CYBLE_HRS_HRM_RRSIZE];
 }CYBLE_HRS_HRM_T;
 
+/* Rolling HRV statistics data structure type */
+typedef struct
+{
+    uint16 rr[HRSC_HRV_WINDOW];
+    uint8 head;
+    uint8 count;
+    uint32 sum;
+    uint32 sumSq;
+    uint32 sumSqDiff;
+}HRSC_HRV_T;
+
 /* Body Sensor Location characteristic value type */
 typedef enum
 {
@@ -69,6 +89,9 @@ void HrsInit(void);
 CYBLE_API_RESULT_T HrscConfigHeartRateNtf(uint16 configuration);
 void HrscUnPackHrm(CYBLE_GATT_VALUE_T* value);
 uint16 HrscGetRRInterval(uint8 rrIntervalNumber);
+void HrscProcessMeasurements(void);
+uint16 HrscGetRmssd(void);
+uint16 HrscGetSdnn(void);
 CYBLE_API_RESULT_T HrscResetEnergyExpendedCounter(void);
 
 
@@ -197,6 +220,7 @@ CYBLE_API_RESULT_T HrscResetEnergyExpendedCounter(void);
 ***************************************/
 extern CYBLE_HRS_HRM_T hrsHeartRate;     
 extern uint8 hrsNotification;
+extern uint16 hrscHrmDropped;
 
 
 /* [] END OF FILE */
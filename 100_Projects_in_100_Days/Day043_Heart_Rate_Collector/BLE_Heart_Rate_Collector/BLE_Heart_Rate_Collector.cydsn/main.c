@@ -216,6 +216,9 @@ int main()
         *  Processes all pending BLE events in the stack
         *******************************************************************/        
         CyBle_ProcessEvents();
+        
+        /* Report the heart rate measurements received during event processing */
+        HrscProcessMeasurements();
     }
 }
 
@@ -60,6 +60,7 @@
 #define UART_DEBUG_EN          (0)
 #define OPAMP_TRIM_EN          (1)
 #define FIR_FILTER_EN          (1)
+#define ADAPTIVE_THRESHOLD_EN  (1)
 #define HRM_EN                 (1)
 #define BATTERY_EN             (1)
 #define DEEP_SLEEP_EN          (1)
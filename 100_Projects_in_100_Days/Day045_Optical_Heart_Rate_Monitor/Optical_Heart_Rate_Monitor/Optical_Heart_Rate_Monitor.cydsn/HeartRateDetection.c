@@ -80,6 +80,9 @@
 *****************************************************************************/
 #define SIGNAL_THRESHOLD                 (5000)
 #define SIGNAL_HYSTERESIS                (SIGNAL_THRESHOLD - 500)
+#define SIGNAL_THRESHOLD_MIN             (3000)
+#define SIGNAL_THRESHOLD_MAX             (20000)
+#define SIGNAL_THRESHOLD_DECAY_TIME      (1500)
 #define NOISE_THRESHOLD                  (1500)
 #define NEGATIVE_NOISE_THRESHOLD         (1500)
 #define LOW_BASELINE_RESET               (25)
@@ -91,6 +94,9 @@
 
 #define SAMPLES_TAKEN_FOR_HRS            (40)
 
+/* IIR filter: 7/8 of previous + 1/8 of new sample */
+#define IIR_FILTER_SHIFT                 (3)
+
 
 /*****************************************************************************
 * Global variables
@@ -105,6 +111,14 @@ static uint8 autoResetCounter = 0;
 static uint8 lowBaselineResetCounter = 0;
 static uint16 baseline = 0;
 static uint16 signalCount = 0;
+static uint16 signalThreshold = SIGNAL_THRESHOLD;
+static uint16 signalHysteresis = SIGNAL_HYSTERESIS;
+
+#if (ADAPTIVE_THRESHOLD_EN)
+static uint16 beatPeak = 0;
+static uint16 beatPeakAverage = (SIGNAL_THRESHOLD << 1);
+static uint32 thresholdTimestamp = 0;
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
 
 
 /*****************************************************************************
@@ -149,6 +163,91 @@ static void Print16BitValue(uint16 value)
 #endif  /* #if (UART_DEBUG_EN) */ 
 
 
+/*****************************************************************************
+* Function Name: HeartRate_UpdateThreshold()
+******************************************************************************
+* Summary:
+* Adapts the signal threshold to the amplitude of the detected beats.
+*
+* Parameters:
+* uint16 peak - the largest signal delta of the beat that just ended
+*
+* Return:
+* None
+*
+* Theory:
+* Keeps a running average of the beat peaks (3/4 of previous + 1/4 of new)
+* and places the signal threshold at half of it, so that weak signals are
+* still detected and noise on strong signals is not. The threshold is
+* limited to SIGNAL_THRESHOLD_MIN..SIGNAL_THRESHOLD_MAX and the hysteresis
+* is kept at 1/8 of the threshold. A peak of 0 is passed when no beat was
+* detected for SIGNAL_THRESHOLD_DECAY_TIME ms, which lowers the threshold
+* step by step until a weaker signal is detected again.
+*
+* Side Effects:
+* None
+*
+* Note:
+*
+*****************************************************************************/
+#if (ADAPTIVE_THRESHOLD_EN)
+static void HeartRate_UpdateThreshold(uint16 peak)
+{
+    uint16 threshold;
+    
+    beatPeakAverage = beatPeakAverage - (beatPeakAverage >> 2) + (peak >> 2);
+    threshold = beatPeakAverage >> 1;
+    
+    if(threshold < SIGNAL_THRESHOLD_MIN)
+    {
+        threshold = SIGNAL_THRESHOLD_MIN;
+    }
+    else if(threshold > SIGNAL_THRESHOLD_MAX)
+    {
+        threshold = SIGNAL_THRESHOLD_MAX;
+    }
+    
+    signalThreshold = threshold;
+    signalHysteresis = threshold - (threshold >> 3);
+    thresholdTimestamp = WatchdogTimer_GetTimestamp();
+}
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
+
+
+/*****************************************************************************
+* Function Name: HeartRate_ResetThreshold()
+******************************************************************************
+* Summary:
+* Restores the initial signal threshold and hysteresis.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* Called when the baseline is reset or the finger is removed, so that the
+* peaks learned on the previous signal do not affect the next one.
+*
+* Side Effects:
+* None
+*
+* Note:
+*
+*****************************************************************************/
+#if (ADAPTIVE_THRESHOLD_EN)
+static void HeartRate_ResetThreshold(void)
+{
+    beatPeak = 0;
+    beatPeakAverage = (SIGNAL_THRESHOLD << 1);
+    signalThreshold = SIGNAL_THRESHOLD;
+    signalHysteresis = SIGNAL_HYSTERESIS;
+    thresholdTimestamp = WatchdogTimer_GetTimestamp();
+}
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
+
+
 /*****************************************************************************
 * Function Name: HeartRate_ProcessOutput()
 ******************************************************************************
@@ -206,7 +305,7 @@ static void HeartRate_ProcessOutput(uint16 sample)
             {
                 signalCount = difference;
                 
-                if(signalCount >= SIGNAL_THRESHOLD)
+                if(signalCount >= signalThreshold)
                 {
                     if(debounceEnable)
                     {
@@ -229,9 +328,12 @@ static void HeartRate_ProcessOutput(uint16 sample)
                         autoResetCounter = 0;
                         validBeat = false;
                         debounceEnable = true;
+#if (ADAPTIVE_THRESHOLD_EN)
+                        HeartRate_ResetThreshold();
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
                     }
                 }
-                else if((signalCount >= SIGNAL_HYSTERESIS) && (true == validBeat))
+                else if((signalCount >= signalHysteresis) && (true == validBeat))
                 {
                     autoResetCounter++;
                     
@@ -243,6 +345,9 @@ static void HeartRate_ProcessOutput(uint16 sample)
                         autoResetCounter = 0;
                         validBeat = false;
                         debounceEnable = true;
+#if (ADAPTIVE_THRESHOLD_EN)
+                        HeartRate_ResetThreshold();
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
                     }
                 }
                 else
@@ -280,6 +385,9 @@ static void HeartRate_ProcessOutput(uint16 sample)
                 {
                     baseline = sample;
                     lowBaselineResetCounter = 0;
+#if (ADAPTIVE_THRESHOLD_EN)
+                    HeartRate_ResetThreshold();
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
                 }
             }
             else
@@ -291,6 +399,26 @@ static void HeartRate_ProcessOutput(uint16 sample)
         }
         
     }
+
+#if (ADAPTIVE_THRESHOLD_EN)
+    if(validBeat)
+    {
+        if(signalCount > beatPeak)
+        {
+            beatPeak = signalCount;
+        }
+    }
+    else if(beatPeak != 0)
+    {
+        HeartRate_UpdateThreshold(beatPeak);
+        beatPeak = 0;
+    }
+    else if((WatchdogTimer_GetTimestamp() - thresholdTimestamp) > SIGNAL_THRESHOLD_DECAY_TIME)
+    {
+        /* No beat, the signal may be weaker than the learned threshold */
+        HeartRate_UpdateThreshold(0);
+    }
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
 }
 
 
@@ -333,17 +461,18 @@ static void HeartRate_ProcessOutput(uint16 sample)
 *****************************************************************************/
 void HeartRate_Measure(void)
 {
-    uint8 loopCounter = 0;
+    uint8 newestBeat = 0;
     uint16 adcOut = 0;
     uint16 firstFilteredOut = 0;
+    uint16 secondFilteredOut = 0;
     uint32 xBeatTime = 0;
-    uint32 sumOutput = 0;
 
     static bool beatStatus = false;
     static uint8 hrPreviousSample0 = 0;
     static uint8 hrPreviousSample1 = 0;
     static uint8 beatCount = 1;
-    static uint16 secondFilteredOut = 0;
+    static uint8 oldestBeat = 0;
+    static uint32 secondFilterSum = 0;
     static uint32 beatTime[SAMPLES_TAKEN_FOR_HRS];
     static uint32 lastBeatTimestamp;
 
@@ -361,10 +490,11 @@ void HeartRate_Measure(void)
         
         /*
          * IIR filter on top of the FIR filtered output.
-         * 6/7 of Previous + 1/7 of new sample.
+         * 7/8 of Previous + 1/8 of new sample. The sum is kept scaled by 8
+         * so that no precision is lost and no division is needed.
          */
-        sumOutput = ((uint32)secondFilteredOut * 6) + (uint32)firstFilteredOut;
-        secondFilteredOut = (uint16)(sumOutput / 7);
+        secondFilterSum = secondFilterSum - (secondFilterSum >> IIR_FILTER_SHIFT) + (uint32)firstFilteredOut;
+        secondFilteredOut = (uint16)(secondFilterSum >> IIR_FILTER_SHIFT);
         
         /* Calculate baseline and identify a beat */
         HeartRate_ProcessOutput(secondFilteredOut);
@@ -394,8 +524,13 @@ void HeartRate_Measure(void)
                  * Rising edge on ADC detected - this indicates a new beat. 
                  * Start timing measurements 
                  */
-                beatTime[beatCount - 1] = lastBeatTimestamp;
-                xBeatTime = beatTime[beatCount - 1] - beatTime[0];
+                newestBeat = oldestBeat + beatCount - 1;
+                if(newestBeat >= SAMPLES_TAKEN_FOR_HRS)
+                {
+                    newestBeat -= SAMPLES_TAKEN_FOR_HRS;
+                }
+                beatTime[newestBeat] = lastBeatTimestamp;
+                xBeatTime = beatTime[newestBeat] - beatTime[oldestBeat];
                 if(xBeatTime)
                 {
                     heartRateUnfiltered = (uint8)((uint32)60000 * (beatCount - 1) / xBeatTime);
@@ -412,10 +547,14 @@ void HeartRate_Measure(void)
                 }
                 else
                 {
-                    /* Roll the window after the complete window is populated */
-                    for(loopCounter = 1; loopCounter < SAMPLES_TAKEN_FOR_HRS; loopCounter++)
+                    /* 
+                     * Roll the window after the complete window is populated.
+                     * beatTime is a ring, dropping the oldest entry is enough.
+                     */
+                    oldestBeat++;
+                    if(oldestBeat >= SAMPLES_TAKEN_FOR_HRS)
                     {
-                        beatTime[loopCounter - 1] = beatTime[loopCounter];
+                        oldestBeat = 0;
                     }
                 }
                 
@@ -459,14 +598,22 @@ void HeartRate_Measure(void)
             /* Prepare for next rising edge to detect next beat */
             beatStatus = false;
 
-            /* Reset heart rate measurement 3 seconds after detection stops */
-            if((WatchdogTimer_GetTimestamp() - lastBeatTimestamp) > 3000)
+            /* 
+             * Reset heart rate measurement 3 seconds after detection stops.
+             * beatCount is 1 only when the measurement is already reset.
+             */
+            if(((WatchdogTimer_GetTimestamp() - lastBeatTimestamp) > 3000) && (beatCount > 1))
             {
                 heartRateUnfiltered = 0;
                 heartRateFiltered = 0;
                 hrPreviousSample0 = 0;
                 hrPreviousSample1 = 0;
                 beatCount = 1;
+                oldestBeat = 0;
+#if (ADAPTIVE_THRESHOLD_EN)
+                /* Finger removed, start over from the initial threshold */
+                HeartRate_ResetThreshold();
+#endif  /* #if (ADAPTIVE_THRESHOLD_EN) */
             }
         }
     }
@@ -4,7 +4,7 @@
 * Version: 1.0
 *
 * Description:
-* This file defines the function to implement the FIR filter.
+* This file defines the functions to implement the FIR filter.
 *
 * Note:
 * 
@@ -63,6 +63,8 @@
 *****************************************************************************/
 #define FIR_ORDER               (FIR_TAPS - 1)
 #define COEFFICIENT_SHIFT       (15)
+/* Samples per chunk of FirFilter_Block(), the chunk is kept on the stack */
+#define FIR_BLOCK_SIZE          (32)
 
 /* 
  * Original coefficients shifted left by COEFFICIENT_SHIFT places so that we
@@ -75,6 +77,15 @@ const uint32 coefficient[FIR_TAPS >> 1] =
     2199,   3234,    4054,    4591
 };
 
+/*
+ * Input history as a circular buffer. Every sample is stored twice, FIR_TAPS
+ * entries apart, so the last FIR_TAPS samples are always contiguous starting
+ * at historyHead (newest first) and no shifting or wrapping is needed.
+ */
+static uint32 history[FIR_TAPS << 1];
+static uint32 historyHead = 0;
+
+
 /*****************************************************************************
 * Function Name: FirFilter()
 ******************************************************************************
@@ -89,8 +100,8 @@ const uint32 coefficient[FIR_TAPS >> 1] =
 *
 * Theory:
 * This function performs the following in order:
-*   1. Cache a shift register as per the number of taps required. On every
-*      call, shift the register by 1 position and accomodate the new signal.
+*   1. Cache the input in a circular buffer as per the number of taps
+*      required. On every call, only the new signal is written.
 *   2. Perform the signal convolution with the coefficients designed. Since
 *      the number of taps is even and the taps are symmetric, the function
 *      optimizes the convolution as visible in the code.
@@ -109,30 +120,133 @@ const uint32 coefficient[FIR_TAPS >> 1] =
 *****************************************************************************/
 uint16 FirFilter(uint16 input)
 {
-    static uint32 previousInput[FIR_TAPS];
-    uint32 product = 0;
+    const uint32 *window;
     uint32 sum = 0;
     uint32 loopCounter;
     
-    /* Shift previous data by 1 each */
-    for(loopCounter = FIR_ORDER; loopCounter != 0; loopCounter--)
+    historyHead = (historyHead == 0) ? FIR_ORDER : (historyHead - 1);
+    history[historyHead] = (uint32)input;
+    history[historyHead + FIR_TAPS] = (uint32)input;
+    window = &history[historyHead];
+    
+    for(loopCounter = (FIR_TAPS >> 1); loopCounter != 0;)
     {
-        previousInput[loopCounter] = previousInput[loopCounter - 1];
+        loopCounter--;
+        sum += (window[loopCounter] + window[FIR_ORDER - loopCounter]) * coefficient[loopCounter];
     }
-    previousInput[loopCounter] = (uint32)input;
 
-    /* Optimized convolution for even number of taps
-     * since coefficients are symmetrical */
-    for(loopCounter = (FIR_TAPS >> 1); loopCounter != 0;)
+    /* Compensate for the shift in coefficients beforehand */
+    return (uint16)(sum >> COEFFICIENT_SHIFT);
+}
+
+
+/*****************************************************************************
+* Function Name: FirFilter_Block()
+******************************************************************************
+* Summary:
+* Filters a block of samples.
+*
+* Parameters:
+* input: The input signal to be filtered.
+* output: Filtered output, may be the same array as input.
+* count: Number of samples in the block.
+*
+* Return:
+* None
+*
+* Theory:
+* Gives the same output as calling FirFilter() for every sample of the block
+* in order, and the history is shared with FirFilter(), so both may be mixed
+* on one signal. The block is filtered in chunks of FIR_BLOCK_SIZE samples:
+*   1. The last FIR_ORDER samples and the chunk are placed in one linear
+*      buffer, oldest first, so the windows need no circular indexing.
+*   2. Two outputs are calculated per pass over the coefficients. Each
+*      coefficient is loaded once for both and the pair of windows is one
+*      sample apart, which halves the coefficient loads and loop overhead.
+*   3. The last FIR_ORDER samples are moved to the front for the next chunk,
+*      and the circular history is rewritten once at the end of the block.
+*
+* Side Effects:
+* None
+*
+* Note:
+* Same input limits as FirFilter().
+*
+*****************************************************************************/
+void FirFilter_Block(const uint16 input[], uint16 output[], uint32 count)
+{
+    uint32 samples[FIR_ORDER + FIR_BLOCK_SIZE];
+    const uint32 *window;
+    uint32 chunk;
+    uint32 index;
+    uint32 loopCounter;
+    uint32 sum0;
+    uint32 sum1;
+    
+    if(count == 0)
     {
-        loopCounter--;
-        product = (previousInput[loopCounter] + previousInput[FIR_ORDER - loopCounter]) * coefficient[loopCounter];
-        sum += product;
+        return;
     }
+    
+    /* Previous samples, oldest first */
+    for(loopCounter = 0; loopCounter < FIR_ORDER; loopCounter++)
+    {
+        samples[loopCounter] = history[historyHead + FIR_ORDER - 1 - loopCounter];
+    }
+    
+    while(count != 0)
+    {
+        chunk = (count < FIR_BLOCK_SIZE) ? count : FIR_BLOCK_SIZE;
+        for(index = 0; index < chunk; index++)
+        {
+            samples[FIR_ORDER + index] = (uint32)input[index];
+        }
         
-    /* Compensate for the shift in coefficients beforehand */  
-    sum >>= COEFFICIENT_SHIFT;       
-    return (uint16)sum;
+        /* Output n uses samples[n] to samples[n + FIR_ORDER] */
+        for(index = 0; (index + 1) < chunk; index += 2)
+        {
+            window = &samples[index];
+            sum0 = 0;
+            sum1 = 0;
+            for(loopCounter = (FIR_TAPS >> 1); loopCounter != 0;)
+            {
+                loopCounter--;
+                sum0 += (window[FIR_ORDER - loopCounter] + window[loopCounter]) * coefficient[loopCounter];
+                sum1 += (window[FIR_TAPS - loopCounter] + window[loopCounter + 1]) * coefficient[loopCounter];
+            }
+            output[index] = (uint16)(sum0 >> COEFFICIENT_SHIFT);
+            output[index + 1] = (uint16)(sum1 >> COEFFICIENT_SHIFT);
+        }
+        if(index < chunk)
+        {
+            window = &samples[index];
+            sum0 = 0;
+            for(loopCounter = (FIR_TAPS >> 1); loopCounter != 0;)
+            {
+                loopCounter--;
+                sum0 += (window[FIR_ORDER - loopCounter] + window[loopCounter]) * coefficient[loopCounter];
+            }
+            output[index] = (uint16)(sum0 >> COEFFICIENT_SHIFT);
+        }
+        
+        for(loopCounter = 0; loopCounter < FIR_ORDER; loopCounter++)
+        {
+            samples[loopCounter] = samples[chunk + loopCounter];
+        }
+        input += chunk;
+        output += chunk;
+        count -= chunk;
+    }
+    
+    /* The front of the buffer now holds the last FIR_ORDER samples */
+    historyHead = 0;
+    for(loopCounter = 0; loopCounter < FIR_ORDER; loopCounter++)
+    {
+        history[loopCounter] = samples[FIR_ORDER - 1 - loopCounter];
+        history[loopCounter + FIR_TAPS] = history[loopCounter];
+    }
+    history[FIR_ORDER] = 0;
+    history[FIR_ORDER + FIR_TAPS] = 0;
 }
 
 
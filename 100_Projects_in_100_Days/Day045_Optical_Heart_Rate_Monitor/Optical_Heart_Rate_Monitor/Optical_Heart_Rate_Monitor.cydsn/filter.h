@@ -4,7 +4,7 @@
 * Version: 1.0
 *
 * Description:
-* This file declares the function to implement the FIR filter.
+* This file declares the functions to implement the FIR filter.
 *
 * Note:
 * 
@@ -65,6 +65,7 @@
 * Function declarations
 *****************************************************************************/
 extern uint16 FirFilter(uint16 input);
+extern void FirFilter_Block(const uint16 input[], uint16 output[], uint32 count);
 
 #endif  /* #if !defined (_FILTER_H) */
 
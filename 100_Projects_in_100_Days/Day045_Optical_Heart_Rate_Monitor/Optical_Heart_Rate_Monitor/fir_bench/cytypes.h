@@ -0,0 +1,12 @@
+/* Host stand-in for the PSoC Creator cytypes.h, only the types filter.c uses */
+#if !defined(CYTYPES_H)
+#define CYTYPES_H
+
+#include <stdint.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t  int32;
+
+#endif /* CYTYPES_H */
@@ -0,0 +1,380 @@
+/*****************************************************************************
+* File Name: fir_bench.c
+*
+* Description:
+* Host check and benchmark of the FIR filter in filter.c. The firmware
+* source is included directly so that its history can be reset between runs.
+*
+* The following are compared, sample for sample, on every trace:
+*   1. The shift register filter from the original project (reference).
+*   2. FirFilter(), one call per sample.
+*   3. FirFilter_Block(), with several block sizes and in place.
+*   4. A host SIMD kernel (AVX2, SSE4.1 or NEON, else scalar) with the same
+*      symmetric fixed-point arithmetic.
+* Any difference fails the run. The throughput of 2 to 4 is then printed in
+* million samples per second.
+*
+* Usage:
+* fir_bench [trace]
+*   trace: optional recorded ADC trace, one decimal sample per line. The
+*          synthetic traces are always run.
+*
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "filter.c"
+
+#if !defined(FIR_BENCH_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_NAME   "AVX2"
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define SIMD_NAME   "SSE4.1"
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_NAME   "NEON"
+#endif
+#endif
+#if !defined(SIMD_NAME)
+#define SIMD_NAME   "scalar"
+#endif
+
+#define SYNTHETIC_LENGTH        (1u << 20)
+#define BENCH_MIN_SECONDS       (0.2)
+
+
+/* Reference: the shift register filter of the original project */
+static uint32 refInput[FIR_TAPS];
+
+static uint16 RefFilter(uint16 input)
+{
+    uint32 sum = 0;
+    uint32 i;
+
+    for(i = FIR_ORDER; i != 0; i--)
+    {
+        refInput[i] = refInput[i - 1];
+    }
+    refInput[0] = input;
+    for(i = 0; i < (FIR_TAPS >> 1); i++)
+    {
+        sum += (refInput[i] + refInput[FIR_ORDER - i]) * coefficient[i];
+    }
+    return (uint16)(sum >> COEFFICIENT_SHIFT);
+}
+
+
+/*
+ * SIMD kernel. x holds FIR_ORDER previous samples followed by count new
+ * samples, oldest first, and output n uses x[n] to x[n + FIR_ORDER].
+ */
+static void SimdFilter(const uint32 *x, uint16 *y, size_t count)
+{
+    size_t n = 0;
+    uint32 k;
+
+#if defined(__AVX2__) && !defined(FIR_BENCH_NO_SIMD)
+    for(; (n + 8) <= count; n += 8)
+    {
+        __m256i sum = _mm256_setzero_si256();
+        for(k = 0; k < (FIR_TAPS >> 1); k++)
+        {
+            __m256i pair = _mm256_add_epi32(
+                _mm256_loadu_si256((const __m256i *)&x[n + k]),
+                _mm256_loadu_si256((const __m256i *)&x[n + FIR_ORDER - k]));
+            sum = _mm256_add_epi32(sum,
+                _mm256_mullo_epi32(pair, _mm256_set1_epi32((int)coefficient[k])));
+        }
+        sum = _mm256_srli_epi32(sum, COEFFICIENT_SHIFT);
+        /* Values fit in 16 bits, pack without saturating */
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(sum),
+                                          _mm256_extracti128_si256(sum, 1));
+        _mm_storeu_si128((__m128i *)&y[n], packed);
+    }
+#elif defined(__SSE4_1__) && !defined(FIR_BENCH_NO_SIMD)
+    for(; (n + 4) <= count; n += 4)
+    {
+        __m128i sum = _mm_setzero_si128();
+        for(k = 0; k < (FIR_TAPS >> 1); k++)
+        {
+            __m128i pair = _mm_add_epi32(
+                _mm_loadu_si128((const __m128i *)&x[n + k]),
+                _mm_loadu_si128((const __m128i *)&x[n + FIR_ORDER - k]));
+            sum = _mm_add_epi32(sum,
+                _mm_mullo_epi32(pair, _mm_set1_epi32((int)coefficient[k])));
+        }
+        sum = _mm_srli_epi32(sum, COEFFICIENT_SHIFT);
+        _mm_storel_epi64((__m128i *)&y[n], _mm_packus_epi32(sum, sum));
+    }
+#elif defined(__ARM_NEON) && !defined(FIR_BENCH_NO_SIMD)
+    for(; (n + 4) <= count; n += 4)
+    {
+        uint32x4_t sum = vdupq_n_u32(0);
+        for(k = 0; k < (FIR_TAPS >> 1); k++)
+        {
+            uint32x4_t pair = vaddq_u32(vld1q_u32(&x[n + k]),
+                                        vld1q_u32(&x[n + FIR_ORDER - k]));
+            sum = vmlaq_n_u32(sum, pair, coefficient[k]);
+        }
+        vst1_u16(&y[n], vmovn_u32(vshrq_n_u32(sum, COEFFICIENT_SHIFT)));
+    }
+#endif
+    for(; n < count; n++)
+    {
+        uint32 sum = 0;
+        for(k = 0; k < (FIR_TAPS >> 1); k++)
+        {
+            sum += (x[n + k] + x[n + FIR_ORDER - k]) * coefficient[k];
+        }
+        y[n] = (uint16)(sum >> COEFFICIENT_SHIFT);
+    }
+}
+
+
+static void ResetFilters(void)
+{
+    memset(history, 0, sizeof(history));
+    historyHead = 0;
+    memset(refInput, 0, sizeof(refInput));
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static int Compare(const char *trace, const char *path, const uint16 *expected,
+                   const uint16 *actual, size_t count)
+{
+    size_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        if(expected[i] != actual[i])
+        {
+            printf("FAIL %s, %s: sample %zu is %u, expected %u\n",
+                   trace, path, i, actual[i], expected[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Filters with FirFilter_Block() in blocks of blockSize, in place if asked */
+static void RunBlock(const uint16 *input, uint16 *output, size_t count,
+                     size_t blockSize, int inPlace)
+{
+    size_t done;
+    size_t chunk;
+
+    if(inPlace)
+    {
+        memcpy(output, input, count * sizeof(uint16));
+    }
+    for(done = 0; done < count; done += chunk)
+    {
+        chunk = ((count - done) < blockSize) ? (count - done) : blockSize;
+        FirFilter_Block(inPlace ? &output[done] : &input[done], &output[done],
+                        (uint32)chunk);
+    }
+}
+
+static int RunTrace(const char *name, const uint16 *input, size_t count)
+{
+    static const size_t blockSizes[] = {1, 2, 7, 31, 32, 33, 64, 1000};
+    uint16 *expected = malloc(count * sizeof(uint16));
+    uint16 *output = malloc(count * sizeof(uint16));
+    uint32 *linear = calloc(count + FIR_ORDER, sizeof(uint32));
+    int failed = 0;
+    size_t i;
+    size_t b;
+    size_t iterations;
+    double start;
+    double elapsed;
+    char path[32];
+
+    if((expected == NULL) || (output == NULL) || (linear == NULL))
+    {
+        printf("FAIL %s: out of memory\n", name);
+        exit(1);
+    }
+
+    ResetFilters();
+    for(i = 0; i < count; i++)
+    {
+        expected[i] = RefFilter(input[i]);
+        linear[i + FIR_ORDER] = input[i];
+    }
+
+    ResetFilters();
+    for(i = 0; i < count; i++)
+    {
+        output[i] = FirFilter(input[i]);
+    }
+    failed |= Compare(name, "FirFilter", expected, output, count);
+
+    for(b = 0; b < (sizeof(blockSizes) / sizeof(blockSizes[0])); b++)
+    {
+        ResetFilters();
+        RunBlock(input, output, count, blockSizes[b], (int)(b & 1u));
+        snprintf(path, sizeof(path), "FirFilter_Block/%zu%s", blockSizes[b],
+                 (b & 1u) ? " in place" : "");
+        failed |= Compare(name, path, expected, output, count);
+    }
+
+    /* Block and per-sample calls mixed on one signal */
+    ResetFilters();
+    for(i = 0; i < count; i += 37)
+    {
+        size_t chunk = ((count - i) < 37) ? (count - i) : 37;
+        output[i] = FirFilter(input[i]);
+        if(chunk > 1)
+        {
+            FirFilter_Block(&input[i + 1], &output[i + 1], (uint32)(chunk - 1));
+        }
+    }
+    failed |= Compare(name, "mixed", expected, output, count);
+
+    SimdFilter(linear, output, count);
+    failed |= Compare(name, SIMD_NAME, expected, output, count);
+
+    if(failed)
+    {
+        free(expected);
+        free(output);
+        free(linear);
+        return 1;
+    }
+
+    printf("%-12s %8zu samples, Msample/s:", name, count);
+
+    iterations = 0;
+    start = Now();
+    do
+    {
+        for(i = 0; i < count; i++)
+        {
+            output[i] = FirFilter(input[i]);
+        }
+        iterations++;
+        elapsed = Now() - start;
+    } while(elapsed < BENCH_MIN_SECONDS);
+    printf("  FirFilter %7.1f", ((double)count * iterations) / elapsed * 1e-6);
+
+    iterations = 0;
+    start = Now();
+    do
+    {
+        RunBlock(input, output, count, 256, 0);
+        iterations++;
+        elapsed = Now() - start;
+    } while(elapsed < BENCH_MIN_SECONDS);
+    printf("  FirFilter_Block %7.1f", ((double)count * iterations) / elapsed * 1e-6);
+
+    iterations = 0;
+    start = Now();
+    do
+    {
+        SimdFilter(linear, output, count);
+        iterations++;
+        elapsed = Now() - start;
+    } while(elapsed < BENCH_MIN_SECONDS);
+    printf("  %s %7.1f\n", SIMD_NAME, ((double)count * iterations) / elapsed * 1e-6);
+
+    free(expected);
+    free(output);
+    free(linear);
+    return 0;
+}
+
+/* Pseudo random numbers, fixed seed so every run filters the same traces */
+static uint32 randomState = 0x12345678u;
+
+static uint32 Random(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static size_t LoadTrace(const char *fileName, uint16 **trace)
+{
+    FILE *file = fopen(fileName, "r");
+    size_t count = 0;
+    size_t size = 4096;
+    unsigned long value;
+
+    if(file == NULL)
+    {
+        perror(fileName);
+        exit(1);
+    }
+    *trace = malloc(size * sizeof(uint16));
+    while((*trace != NULL) && (fscanf(file, "%lu", &value) == 1))
+    {
+        if(count == size)
+        {
+            size <<= 1;
+            *trace = realloc(*trace, size * sizeof(uint16));
+            if(*trace == NULL)
+            {
+                break;
+            }
+        }
+        (*trace)[count++] = (uint16)value;
+    }
+    fclose(file);
+    if(*trace == NULL)
+    {
+        printf("FAIL %s: out of memory\n", fileName);
+        exit(1);
+    }
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    static uint16 trace[SYNTHETIC_LENGTH];
+    uint16 *recorded;
+    size_t count;
+    size_t i;
+    int failed = 0;
+
+    /* Full 16-bit range, worst case for the fixed-point sum */
+    for(i = 0; i < SYNTHETIC_LENGTH; i++)
+    {
+        trace[i] = (uint16)Random();
+    }
+    failed |= RunTrace("random", trace, SYNTHETIC_LENGTH);
+
+    /* ADC like signal: offset, 1.2 Hz pulse at 100 sps, 50 Hz pickup, noise */
+    for(i = 0; i < SYNTHETIC_LENGTH; i++)
+    {
+        int32 value = 20000;
+        uint32 phase = (uint32)((i * 12u) % 1000u);
+
+        value += (phase < 300u) ? (int32)(phase * 20u) : (int32)((1000u - phase) * 6u) - 1000;
+        value += ((i & 1u) != 0u) ? 150 : -150;
+        value += (int32)(Random() & 0xFFu) - 128;
+        trace[i] = (uint16)value;
+    }
+    failed |= RunTrace("pulse", trace, SYNTHETIC_LENGTH);
+
+    if(argc > 1)
+    {
+        count = LoadTrace(argv[1], &recorded);
+        failed |= RunTrace(argv[1], recorded, count);
+        free(recorded);
+    }
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
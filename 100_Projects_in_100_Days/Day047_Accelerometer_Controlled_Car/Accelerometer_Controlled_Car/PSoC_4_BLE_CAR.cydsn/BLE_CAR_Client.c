@@ -18,6 +18,7 @@
 #include "BLE_CAR_Client.h"
 #include "LED.h"
 #include "Motor_Control.h"
+#include "ad_parser.h"
 
 
 /* 'connHandle' is a varibale of type 'CYBLE_CONN_HANDLE_T' (defined in 
@@ -34,12 +35,25 @@ CYBLE_API_RESULT_T 		apiResult;
 * BLE_StackGap.h) and is used to store address of the connected device. */
 CYBLE_GAP_BD_ADDR_T connectPeriphDevice;
 
+/* Manufacturer specific data advertised by the Server: company ID followed by
+* the project ID */
+static const uint8 carServerData[] = {COMPANY_LSB, COMPANY_MSB, MAN_SPEC_DATA_LSB, MAN_SPEC_DATA_MSB};
+
+static const AD_RULE_T carServerRules[] = {
+	{MANUFACTURER_SPECIFIC_DATA, AD_MATCH_PREFIX, sizeof(carServerData), carServerData}
+};
+
+/* 'carServerFilter' holds the compiled rules, matched against every report */
+static AD_FILTER_T carServerFilter;
+
 /*******************************************************************************
 * Function Name: FilterScanResponsePackets
 ********************************************************************************
 * Summary:
 *        Function that meets the requirements of the Server (Accelerometer). This
-*		function ensures that it connects only to the Server Project
+*		function ensures that it connects only to the Server Project. The
+*		manufacturer specific data is looked up among all AD structures of the
+*		report, within the length of the report
 *
 * Parameters:
 *  scanReport: Advertisement report received by GAP Central
@@ -52,10 +66,8 @@ CYBLE_GAP_BD_ADDR_T connectPeriphDevice;
 void FilterScanResponsePackets(CYBLE_GAPC_ADV_REPORT_T* scanReport)
 {
 
-	if(scanReport->data[1] == MANUFACTURER_SPECIFIC_DATA && 
-	scanReport->data[2] == COMPANY_LSB && 
-	scanReport->data[3] == COMPANY_MSB && 
-	scanReport->data[4] == MAN_SPEC_DATA_LSB && scanReport->data[5] == MAN_SPEC_DATA_MSB)
+	if(AdFilter_Match(&carServerFilter, scanReport->data, scanReport->dataLen, NULL) == 
+		AD_FILTER_ALL(&carServerFilter))
 	{
 		CyBle_GapcStopScan();
 		
@@ -88,6 +100,9 @@ void ApplicationEventHandler(uint32 event, void *eventparam)
 	switch(event)
 	{
 		case CYBLE_EVT_STACK_ON:
+			/* Compile the scan filter once, before the first report */
+			AdFilter_Compile(&carServerFilter, carServerRules, 
+				sizeof(carServerRules) / sizeof(carServerRules[0]));
 			break;
 		
 		case CYBLE_EVT_GAPC_SCAN_START_STOP:
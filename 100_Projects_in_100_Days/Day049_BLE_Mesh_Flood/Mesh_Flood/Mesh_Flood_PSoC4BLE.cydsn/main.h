@@ -19,6 +19,8 @@
 #include <debug.h>
 #include <ble_process.h>
 #include <WDT.h>
+#include <mesh_cache.h>
+#include <ad_parser.h>
 
 /*****************************************************
 *             Pre-processor Directives
@@ -40,8 +42,16 @@ volatile uint16 current_watchdog_counter;
 #define BLE_PERIPHERAL						1
 #define BLE_CENTRAL							2
 	
+/* Role timing in Watchdog ticks (100 ms). These can be overridden from the
+* compiler command line, e.g. -DCENTRAL_STATE_SPAN=30, so that the flood timing
+* can be tuned without editing this file. */
+#ifndef CENTRAL_STATE_SPAN
 #define CENTRAL_STATE_SPAN					45
+#endif
+
+#ifndef PERIP_RGB_HOLD_TIME
 #define PERIP_RGB_HOLD_TIME					10
+#endif
 
 #define WatchDog_CurrentCount()				(current_watchdog_counter)
 
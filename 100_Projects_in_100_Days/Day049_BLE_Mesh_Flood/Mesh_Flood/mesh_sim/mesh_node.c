@@ -0,0 +1,167 @@
+/*******************************************************************************
+* File Name: mesh_node.c
+*
+* Description:
+*  The unmodified firmware of Mesh_Flood_PSoC4BLE.cydsn, built once for the
+*  host. Every node of the simulation has its own copy of the firmware state
+*  (globals and file statics, the mesh cache included, plus the stack globals
+*  the firmware reads), which is swapped in when the node is selected.
+*
+*******************************************************************************/
+#include <stdlib.h>
+
+/* main() of the firmware never returns, its loop is run by Node_Loop() */
+#define main Firmware_Main
+#include "main.c"
+#undef main
+#include "ble_process.c"
+#include "mesh_cache.c"
+#include "ad_parser.c"
+#include "WDT.c"
+#include "debug.c"
+
+#include "mesh_sim.h"
+
+/* Stack globals, part of the state of each node */
+CYBLE_CONN_HANDLE_T cyBle_connHandle;
+CYBLE_GAPP_DISC_MODE_INFO_T cyBle_discoveryModeInfo;
+
+/* ADV and scan response data configured in the BLE component. The ADV data
+ * only holds the flags, the node adds its counter in InitializeSystem() */
+static CYBLE_GAPP_DISC_DATA_T componentAdvData = {{0x02u, 0x01u, 0x06u}, 3u};
+static CYBLE_GAPP_SCAN_RSP_DATA_T componentScanRspData;
+
+/* Everything which is global or static in the firmware */
+#define NODE_STATE(X)                       \
+    X(RGBData)                              \
+    X(dataADVCounter)                       \
+    X(switch_Role)                          \
+    X(new_advData)                          \
+    X(scan_filter)                          \
+    X(peripAddr)                            \
+    X(clientConnectToDevice)                \
+    X(ble_gap_state)                        \
+    X(deviceConnected)                      \
+    X(restartScanning)                      \
+    X(centralStartedTime)                   \
+    X(current_watchdog_counter)             \
+    X(meshCache)                            \
+    X(cyBle_connHandle)                     \
+    X(cyBle_discoveryModeInfo)
+
+#define STATE_FIELD(name)   uint8 name[sizeof(name)];
+#define STATE_SAVE(name)    memcpy(context->name, (const void *)&name, sizeof(name));
+#define STATE_LOAD(name)    memcpy((void *)&name, context->name, sizeof(name));
+
+typedef struct
+{
+    NODE_STATE(STATE_FIELD)
+} NODE_CONTEXT_T;
+
+static NODE_CONTEXT_T *contexts;
+static uint32 contextCount;
+static uint32 current;
+
+static void Save(NODE_CONTEXT_T *context)
+{
+    NODE_STATE(STATE_SAVE)
+}
+
+static void Load(const NODE_CONTEXT_T *context)
+{
+    NODE_STATE(STATE_LOAD)
+}
+
+int Node_Reset(uint32 count)
+{
+    NODE_CONTEXT_T reset;
+    uint32 node;
+
+    memcpy(componentScanRspData.scanRspData, scan_tag, SCAN_TAG_DATA_LEN);
+    componentScanRspData.scanRspDataLen = SCAN_TAG_DATA_LEN;
+    cyBle_discoveryModeInfo.advData = &componentAdvData;
+    cyBle_discoveryModeInfo.scanRspData = &componentScanRspData;
+
+    /* The firmware globals still hold their initial values */
+    Save(&reset);
+    free(contexts);
+    contexts = malloc(count * sizeof(NODE_CONTEXT_T));
+    if(contexts == NULL)
+    {
+        return 0;
+    }
+    for(node = 0u; node < count; node++)
+    {
+        contexts[node] = reset;
+    }
+    contextCount = count;
+    current = 0u;
+    return 1;
+}
+
+void Node_Select(uint32 node)
+{
+    if(node != current)
+    {
+        Save(&contexts[current]);
+        Load(&contexts[node]);
+        current = node;
+    }
+}
+
+uint32 Node_Current(void)
+{
+    return current;
+}
+
+void Node_Boot(void)
+{
+    InitializeSystem();
+}
+
+int Node_Loop(void)
+{
+    NODE_CONTEXT_T before;
+    NODE_CONTEXT_T after;
+
+    Save(&before);
+
+    /* The body of the for(;;) loop of main() */
+    CyBle_ProcessEvents();
+    SwitchRole();
+    ConnectToPeripheralDevice();
+    RestartCentralScanning();
+
+    Save(&after);
+    return memcmp(&before, &after, sizeof(NODE_CONTEXT_T)) != 0;
+}
+
+void Node_Tick(void)
+{
+    WDT_INT_Handler();
+}
+
+const uint8 *Node_Rgb(void)
+{
+    return RGBData;
+}
+
+uint8 Node_Counter(void)
+{
+    return dataADVCounter;
+}
+
+const CYBLE_GAPP_SCAN_RSP_DATA_T *Node_ScanResponse(void)
+{
+    return cyBle_discoveryModeInfo.scanRspData;
+}
+
+uint32 Node_CentralStateSpan(void)
+{
+    return CENTRAL_STATE_SPAN;
+}
+
+uint32 Node_RgbHoldTime(void)
+{
+    return PERIP_RGB_HOLD_TIME;
+}
@@ -0,0 +1,1364 @@
+/*******************************************************************************
+* File Name: mesh_sim.c
+*
+* Description:
+*  Discrete-event simulator of a Mesh_Flood network. Each node runs the
+*  unmodified firmware of Mesh_Flood_PSoC4BLE.cydsn (see mesh_node.c) on top
+*  of the CyBle_* stack modelled here:
+*   - Nodes are placed at random in a square (or on a grid) and hear the
+*     nodes within range 1. A packet is received with probability -p.
+*   - An advertising node sends an advertising event every -a ms plus a
+*     random 0 to 10 ms delay. Each scanning neighbour receives the ADV
+*     report, one of them (the one whose scan request won) gets the scan
+*     response as well, and a neighbour connecting to the node sends its
+*     connection request.
+*   - A connection has events every -c ms. GATT writes and write responses
+*     are delivered at the next connection event, and a disconnection takes
+*     effect at the next connection event too.
+*   - The Watchdog interrupt of every node fires each 100 ms, with a random
+*     phase. The main loop of a node is run after each event given to it,
+*     until it has nothing left to do.
+*   - For each update a phone connects to the seed node and writes a new
+*     colour to the RGB LED characteristic, as the CySmart app would.
+*
+*  For each update the simulator records when every node first shows its
+*  colour (or a later one) and counts the connections made by the nodes. A
+*  connection is wasted if it wrote no newer colour: the node already had it,
+*  got an older one back, or the link closed before the write.
+*
+*  CENTRAL_STATE_SPAN and PERIP_RGB_HOLD_TIME are compiled into the firmware,
+*  set them in the make command (make CENTRAL_STATE_SPAN=30) or use
+*  make sweep. PERIP_RGB_HOLD_TIME is defined in main.h but ble_process.c
+*  does not use it, so it does not change the results.
+*
+* Usage:
+*  mesh_sim [-n nodes] [-d degree] [-G] [-u updates] [-i seconds]
+*           [-a adv_ms] [-c conn_ms] [-p probability] [-s seed] [-C]
+*   -n: number of nodes, 10 to 10000, 100 by default
+*   -d: mean number of neighbours of a node, 6 by default
+*   -G: place the nodes on a square grid, 8 neighbours each
+*   -u: number of colour updates, 5 by default
+*   -i: seconds between the updates, 60 by default
+*   -a: advertising interval in ms, 20 by default
+*   -c: connection interval in ms, 7.5 by default
+*   -p: probability to receive a packet, 0.9 by default
+*   -s: seed of the random numbers
+*   -C: exit with an error if a reachable node missed an update
+*
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "mesh_sim.h"
+#include "ble_process.h"
+
+#define MIN_NODES                   (10u)
+#define MAX_NODES                   (10000u)
+#define MAX_UPDATES                 (1000u)
+
+#define WDT_PERIOD_US               (100000u)
+#define ADV_DELAY_MAX_US            (10000u)
+#define BOOT_SPREAD_US              (1000000u)
+#define FIRST_UPDATE_US             (5000000u)
+#define CONNECT_DELAY_US            (1250u)
+
+/* Passes of a node main loop after an event, to catch a node looping */
+#define MAX_LOOP_PASSES             (64u)
+#define STACK_QUEUE_SIZE            (16u)
+
+/* The phone which writes the new colour, linked to the seed node */
+#define PHONE                       (UINT32_MAX)
+#define SEED                        (0u)
+
+/* Colour of update k: red and green hold k, then a marker */
+#define COLOUR_MARKER_BLUE          (0x5Au)
+#define COLOUR_MARKER_INTENSITY     (0xFFu)
+
+#define NEVER                       (UINT64_MAX)
+
+typedef uint64_t SIM_TIME_T;
+
+/* Event in the queue of the BLE stack of a node */
+typedef struct
+{
+    uint32 event;
+    uint8 eventType;
+    uint8 bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    uint16 attrHandle;
+    uint8 len;
+    uint8 data[CYBLE_GAP_MAX_ADV_DATA_LEN];
+} STACK_EVENT_T;
+
+typedef struct
+{
+    double x;
+    double y;
+    uint32 firstNeighbour;
+    uint32 neighbourCount;
+    uint8 bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+
+    /* Stack */
+    CYBLE_STATE_T state;
+    CYBLE_CALLBACK_T callback;
+    STACK_EVENT_T queue[STACK_QUEUE_SIZE];
+    uint8 queueHead;
+    uint8 queueCount;
+    uint8 advData[CYBLE_GAP_MAX_ADV_DATA_LEN];
+    uint8 advDataLen;
+    uint32 advGeneration;
+    uint8 advScheduled;
+    uint32 listeners;           /* Neighbours scanning or connecting */
+    uint32 target;              /* Node being connected to */
+    int32 link;
+
+    /* Measurement */
+    uint32 update;              /* Update whose colour the LED shows */
+    uint8 reachable;
+} NODE_T;
+
+typedef struct
+{
+    uint32 central;
+    uint32 peripheral;
+    SIM_TIME_T anchor;
+    uint32 serial;
+    uint32 update;              /* Update held by the central */
+    uint8 handle;
+    uint8 inUse;
+    uint8 closing;
+    uint8 written;
+} LINK_T;
+
+typedef enum
+{
+    EV_BOOT,
+    EV_TICK,
+    EV_ADV,
+    EV_CONNECTED,
+    EV_PACKET,
+    EV_LINK_DOWN,
+    EV_UPDATE
+} SIM_EVENT_TYPE_T;
+
+typedef enum
+{
+    PKT_WRITE_CMD,
+    PKT_WRITE_REQ,
+    PKT_WRITE_RSP
+} PACKET_T;
+
+typedef struct
+{
+    SIM_TIME_T time;
+    uint64_t sequence;
+    uint32 node;
+    uint32 arg;
+    uint32 serial;
+    uint16 attrHandle;
+    uint8 type;
+    uint8 packet;
+    uint8 len;
+    uint8 data[RGB_LED_DATA_LEN];
+} SIM_EVENT_T;
+
+typedef struct
+{
+    uint32 connections;
+    uint32 wasted;
+    uint32 regressions;
+    uint32 reached;
+    SIM_TIME_T injected;
+    SIM_TIME_T *reachTime;      /* Per node, NEVER until the colour is shown */
+} UPDATE_T;
+
+/* Settings */
+static uint32 nodeCount = 100u;
+static double degree = 6.0;
+static int gridPlacement = 0;
+static uint32 updateCount = 5u;
+static double updateInterval = 60.0;
+static SIM_TIME_T advInterval = 20000u;
+static SIM_TIME_T connInterval = 7500u;
+static double receiveProbability = 0.9;
+static uint64_t randomState = 1u;
+
+static NODE_T *nodes;
+static uint32 *neighbours;
+static LINK_T *links;
+static uint32 *candidates;
+static UPDATE_T *updates;
+
+static SIM_EVENT_T *heap;
+static uint32 heapCount;
+static uint32 heapSize;
+static uint64_t sequence;
+static SIM_TIME_T now;
+
+/* Counted by the stack calls which do something, see RunNode() */
+static uint64_t stackActivity;
+static uint32 stackEventsLost;
+static uint32 errorResponses;
+static uint32 linkSerial;
+
+static struct
+{
+    uint32 pending;             /* Last update injected */
+    uint32 written;             /* Last update written to the seed */
+    uint8 waiting;
+    int32 link;
+} phone;
+
+static void RunNode(uint32 node);
+
+
+/*******************************************************************************
+* Random numbers, xorshift64*
+*******************************************************************************/
+static uint64_t Random(void)
+{
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1DULL;
+}
+
+static double RandomUnit(void)
+{
+    return (double)(Random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static SIM_TIME_T RandomBelow(SIM_TIME_T limit)
+{
+    return (limit != 0u) ? (Random() % limit) : 0u;
+}
+
+static int Received(void)
+{
+    return RandomUnit() < receiveProbability;
+}
+
+
+/*******************************************************************************
+* Event queue, a binary heap ordered by time then by insertion
+*******************************************************************************/
+static int Earlier(const SIM_EVENT_T *a, const SIM_EVENT_T *b)
+{
+    return (a->time < b->time) || ((a->time == b->time) && (a->sequence < b->sequence));
+}
+
+static SIM_EVENT_T *Schedule(SIM_TIME_T time, SIM_EVENT_TYPE_T type, uint32 node, uint32 arg)
+{
+    SIM_EVENT_T event;
+    uint32 child;
+    uint32 parent;
+
+    if(heapCount == heapSize)
+    {
+        heapSize = (heapSize != 0u) ? (heapSize * 2u) : 1024u;
+        heap = realloc(heap, heapSize * sizeof(SIM_EVENT_T));
+        if(heap == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    memset(&event, 0, sizeof(event));
+    event.time = time;
+    event.sequence = sequence++;
+    event.type = (uint8)type;
+    event.node = node;
+    event.arg = arg;
+
+    for(child = heapCount++; child != 0u; child = parent)
+    {
+        parent = (child - 1u) / 2u;
+        if(!Earlier(&event, &heap[parent]))
+        {
+            break;
+        }
+        heap[child] = heap[parent];
+    }
+    heap[child] = event;
+    return &heap[child];
+}
+
+static SIM_EVENT_T PopEvent(void)
+{
+    SIM_EVENT_T first = heap[0];
+    SIM_EVENT_T last = heap[--heapCount];
+    uint32 parent = 0u;
+    uint32 child;
+
+    while((child = (2u * parent) + 1u) < heapCount)
+    {
+        if(((child + 1u) < heapCount) && Earlier(&heap[child + 1u], &heap[child]))
+        {
+            child++;
+        }
+        if(!Earlier(&heap[child], &last))
+        {
+            break;
+        }
+        heap[parent] = heap[child];
+        parent = child;
+    }
+    heap[parent] = last;
+    return first;
+}
+
+
+/*******************************************************************************
+* Colours and updates
+*******************************************************************************/
+static void Colour(uint32 update, uint8 *rgb)
+{
+    rgb[RGB_RED_INDEX] = (uint8)update;
+    rgb[RGB_GREEN_INDEX] = (uint8)(update >> 8);
+    rgb[RGB_BLUE_INDEX] = COLOUR_MARKER_BLUE;
+    rgb[RGB_INTENSITY_INDEX] = COLOUR_MARKER_INTENSITY;
+}
+
+static uint32 UpdateOfColour(const uint8 *rgb)
+{
+    if((rgb[RGB_BLUE_INDEX] != COLOUR_MARKER_BLUE) ||
+       (rgb[RGB_INTENSITY_INDEX] != COLOUR_MARKER_INTENSITY))
+    {
+        return 0u;
+    }
+    return (uint32)rgb[RGB_RED_INDEX] | ((uint32)rgb[RGB_GREEN_INDEX] << 8);
+}
+
+/* Records the colour shown by the selected node */
+static void RecordColour(uint32 node)
+{
+    uint32 update = UpdateOfColour(Node_Rgb());
+    uint32 k;
+
+    if(update > nodes[node].update)
+    {
+        for(k = nodes[node].update + 1u; (k <= update) && (k <= phone.pending); k++)
+        {
+            if(updates[k].reachTime[node] == NEVER)
+            {
+                updates[k].reachTime[node] = now;
+                updates[k].reached++;
+            }
+        }
+    }
+    nodes[node].update = update;
+}
+
+
+/*******************************************************************************
+* Stack of the nodes
+*******************************************************************************/
+static int Listening(CYBLE_STATE_T state)
+{
+    return (state == CYBLE_STATE_SCANNING) || (state == CYBLE_STATE_CONNECTING);
+}
+
+static int PhoneWaitsFor(uint32 node)
+{
+    return phone.waiting && (node == SEED);
+}
+
+/* Starts the advertising events of a node, if anyone can hear them. They
+ * are not simulated while no neighbour scans, which changes nothing */
+static void KickAdvertising(uint32 node, SIM_TIME_T delay)
+{
+    NODE_T *n = &nodes[node];
+
+    if((n->state == CYBLE_STATE_ADVERTISING) && !n->advScheduled &&
+       ((n->listeners != 0u) || PhoneWaitsFor(node)))
+    {
+        n->advScheduled = 1u;
+        Schedule(now + delay, EV_ADV, node, n->advGeneration);
+    }
+}
+
+static void SetState(uint32 node, CYBLE_STATE_T state)
+{
+    NODE_T *n = &nodes[node];
+    int wasListening = Listening(n->state);
+    uint32 i;
+
+    if(n->state == CYBLE_STATE_ADVERTISING)
+    {
+        n->advGeneration++;
+        n->advScheduled = 0u;
+    }
+    n->state = state;
+    if(wasListening != Listening(state))
+    {
+        for(i = 0u; i < n->neighbourCount; i++)
+        {
+            NODE_T *neighbour = &nodes[neighbours[n->firstNeighbour + i]];
+
+            if(wasListening)
+            {
+                neighbour->listeners--;
+            }
+            else
+            {
+                neighbour->listeners++;
+                KickAdvertising(neighbours[n->firstNeighbour + i],
+                                RandomBelow(advInterval + ADV_DELAY_MAX_US));
+            }
+        }
+    }
+    stackActivity++;
+}
+
+static STACK_EVENT_T *PushEvent(uint32 node, uint32 event)
+{
+    NODE_T *n = &nodes[node];
+    STACK_EVENT_T *entry;
+
+    if(n->queueCount == STACK_QUEUE_SIZE)
+    {
+        stackEventsLost++;
+        return NULL;
+    }
+    entry = &n->queue[(n->queueHead + n->queueCount) % STACK_QUEUE_SIZE];
+    n->queueCount++;
+    memset(entry, 0, sizeof(STACK_EVENT_T));
+    entry->event = event;
+    stackActivity++;
+    return entry;
+}
+
+static void PushReport(uint32 node, uint32 peer, uint8 eventType, const uint8 *data, uint8 len)
+{
+    STACK_EVENT_T *entry = PushEvent(node, CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT);
+
+    if(entry != NULL)
+    {
+        entry->eventType = eventType;
+        memcpy(entry->bdAddr, nodes[peer].bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+        entry->len = len;
+        memcpy(entry->data, data, len);
+    }
+}
+
+/* Time of the next connection event of a link */
+static SIM_TIME_T NextAnchor(const LINK_T *link)
+{
+    if(now < link->anchor)
+    {
+        return link->anchor;
+    }
+    return link->anchor + ((((now - link->anchor) / connInterval) + 1u) * connInterval);
+}
+
+static LINK_T *LinkOf(uint32 node)
+{
+    int32 index = (node == PHONE) ? phone.link : nodes[node].link;
+
+    return (index >= 0) ? &links[index] : NULL;
+}
+
+static void SendPacket(LINK_T *link, uint32 to, PACKET_T packet, uint16 attrHandle,
+                       const uint8 *data, uint8 len)
+{
+    SIM_EVENT_T *event = Schedule(NextAnchor(link), EV_PACKET, to, (uint32)(link - links));
+
+    event->serial = link->serial;
+    event->packet = (uint8)packet;
+    event->attrHandle = attrHandle;
+    event->len = (len < RGB_LED_DATA_LEN) ? len : RGB_LED_DATA_LEN;
+    if(data != NULL)
+    {
+        memcpy(event->data, data, event->len);
+    }
+    stackActivity++;
+}
+
+static CYBLE_API_RESULT_T Disconnect(uint32 node)
+{
+    LINK_T *link = LinkOf(node);
+
+    if((link == NULL) || link->closing)
+    {
+        return CYBLE_ERROR_INVALID_OPERATION;
+    }
+    link->closing = 1u;
+    Schedule(NextAnchor(link), EV_LINK_DOWN, 0u, (uint32)(link - links))->serial = link->serial;
+    stackActivity++;
+    return CYBLE_ERROR_OK;
+}
+
+/* The central's connection request was received by the peripheral */
+static void LinkUp(uint32 central, uint32 peripheral)
+{
+    LINK_T *link;
+    SIM_TIME_T anchor = now + CONNECT_DELAY_US + RandomBelow(connInterval);
+    uint32 index;
+
+    /* A node has one link at most, so the pool never runs out */
+    for(index = 0u; links[index].inUse; index++)
+    {
+    }
+    link = &links[index];
+    memset(link, 0, sizeof(LINK_T));
+    link->inUse = 1u;
+    link->central = central;
+    link->peripheral = peripheral;
+    link->anchor = anchor;
+    link->serial = ++linkSerial;
+    link->handle = (uint8)((linkSerial % 255u) + 1u);
+
+    nodes[peripheral].link = (int32)index;
+    SetState(peripheral, CYBLE_STATE_CONNECTED);
+    Schedule(anchor, EV_CONNECTED, peripheral, index)->serial = link->serial;
+
+    if(central == PHONE)
+    {
+        phone.link = (int32)index;
+        phone.waiting = 0u;
+        Schedule(anchor, EV_CONNECTED, PHONE, index)->serial = link->serial;
+    }
+    else
+    {
+        link->update = nodes[central].update;
+        nodes[central].link = (int32)index;
+        nodes[central].target = PHONE;
+        updates[link->update].connections++;
+        Schedule(anchor, EV_CONNECTED, central, index)->serial = link->serial;
+    }
+}
+
+CYBLE_API_RESULT_T CyBle_Start(CYBLE_CALLBACK_T callbackFunc)
+{
+    uint32 node = Node_Current();
+
+    nodes[node].callback = callbackFunc;
+    nodes[node].state = CYBLE_STATE_INITIALIZING;
+    PushEvent(node, CYBLE_EVT_STACK_ON);
+    return CYBLE_ERROR_OK;
+}
+
+void CyBle_ProcessEvents(void)
+{
+    uint32 node = Node_Current();
+    NODE_T *n = &nodes[node];
+    STACK_EVENT_T entry;
+    CYBLE_GAPC_ADV_REPORT_T report;
+    CYBLE_GATTS_WRITE_REQ_PARAM_T write;
+
+    while(n->queueCount != 0u)
+    {
+        entry = n->queue[n->queueHead];
+        n->queueHead = (uint8)((n->queueHead + 1u) % STACK_QUEUE_SIZE);
+        n->queueCount--;
+
+        switch(entry.event)
+        {
+            case CYBLE_EVT_STACK_ON:
+                n->state = CYBLE_STATE_DISCONNECTED;
+                n->callback(entry.event, NULL);
+                break;
+
+            case CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT:
+                report.eventType = entry.eventType;
+                report.peerAddrType = 0u;
+                report.peerBdAddr = entry.bdAddr;
+                report.dataLen = entry.len;
+                report.data = entry.data;
+                report.rssi = -70;
+                n->callback(entry.event, &report);
+                break;
+
+            case CYBLE_EVT_GATTS_WRITE_REQ:
+            case CYBLE_EVT_GATTS_WRITE_CMD_REQ:
+                write.connHandle = cyBle_connHandle;
+                write.handleValPair.attrHandle = entry.attrHandle;
+                write.handleValPair.value.val = entry.data;
+                write.handleValPair.value.len = entry.len;
+                write.handleValPair.value.actualLen = entry.len;
+                n->callback(entry.event, &write);
+                break;
+
+            default:
+                n->callback(entry.event, NULL);
+                break;
+        }
+    }
+}
+
+CYBLE_STATE_T CyBle_GetState(void)
+{
+    return nodes[Node_Current()].state;
+}
+
+CYBLE_API_RESULT_T CyBle_GappStartAdvertisement(uint8 advertisingIntervalType)
+{
+    uint32 node = Node_Current();
+    NODE_T *n = &nodes[node];
+
+    (void)advertisingIntervalType;
+    if(n->state != CYBLE_STATE_DISCONNECTED)
+    {
+        return CYBLE_ERROR_INVALID_STATE;
+    }
+    /* The stack takes a copy of the ADV data when advertising starts */
+    n->advDataLen = cyBle_discoveryModeInfo.advData->advDataLen;
+    memcpy(n->advData, cyBle_discoveryModeInfo.advData->advData, n->advDataLen);
+    SetState(node, CYBLE_STATE_ADVERTISING);
+    PushEvent(node, CYBLE_EVT_GAPP_ADVERTISEMENT_START_STOP);
+    KickAdvertising(node, RandomBelow(ADV_DELAY_MAX_US));
+    return CYBLE_ERROR_OK;
+}
+
+void CyBle_GappStopAdvertisement(void)
+{
+    uint32 node = Node_Current();
+
+    if(nodes[node].state == CYBLE_STATE_ADVERTISING)
+    {
+        SetState(node, CYBLE_STATE_DISCONNECTED);
+        PushEvent(node, CYBLE_EVT_GAPP_ADVERTISEMENT_START_STOP);
+    }
+}
+
+CYBLE_API_RESULT_T CyBle_GapcStartScan(uint8 scanningIntervalType)
+{
+    uint32 node = Node_Current();
+
+    (void)scanningIntervalType;
+    if(nodes[node].state != CYBLE_STATE_DISCONNECTED)
+    {
+        return CYBLE_ERROR_INVALID_STATE;
+    }
+    SetState(node, CYBLE_STATE_SCANNING);
+    PushEvent(node, CYBLE_EVT_GAPC_SCAN_START_STOP);
+    return CYBLE_ERROR_OK;
+}
+
+void CyBle_GapcStopScan(void)
+{
+    uint32 node = Node_Current();
+
+    if(nodes[node].state == CYBLE_STATE_SCANNING)
+    {
+        SetState(node, CYBLE_STATE_DISCONNECTED);
+        PushEvent(node, CYBLE_EVT_GAPC_SCAN_START_STOP);
+    }
+}
+
+/* The node addresses are unique in their lower 24 bits */
+static uint32 NodeOfAddress(const uint8 *bdAddr);
+
+CYBLE_API_RESULT_T CyBle_GapcConnectDevice(const CYBLE_GAP_BD_ADDR_T *address)
+{
+    uint32 node = Node_Current();
+    uint32 target = NodeOfAddress(address->bdAddr);
+
+    if(nodes[node].state != CYBLE_STATE_DISCONNECTED)
+    {
+        return CYBLE_ERROR_INVALID_STATE;
+    }
+    if(target >= nodeCount)
+    {
+        return CYBLE_ERROR_INVALID_PARAMETER;
+    }
+    /* The connection is made at the next advertising event of the target
+     * which is received, however long that takes */
+    nodes[node].target = target;
+    SetState(node, CYBLE_STATE_CONNECTING);
+    return CYBLE_ERROR_OK;
+}
+
+CYBLE_API_RESULT_T CyBle_GapDisconnect(uint8 bdHandle)
+{
+    uint32 node = Node_Current();
+    LINK_T *link = LinkOf(node);
+
+    if((nodes[node].state != CYBLE_STATE_CONNECTED) || (link == NULL) || (link->handle != bdHandle))
+    {
+        return CYBLE_ERROR_INVALID_OPERATION;
+    }
+    return Disconnect(node);
+}
+
+CYBLE_API_RESULT_T CyBle_GattcStartDiscovery(CYBLE_CONN_HANDLE_T connHandle)
+{
+    /* ENABLE_CENTRAL_DISCOVERY is not simulated */
+    (void)connHandle;
+    return CYBLE_ERROR_INVALID_OPERATION;
+}
+
+static CYBLE_API_RESULT_T ClientWrite(PACKET_T packet, const CYBLE_GATTC_WRITE_REQ_T *request)
+{
+    uint32 node = Node_Current();
+    LINK_T *link = LinkOf(node);
+
+    if((link == NULL) || link->closing || (link->central != node) ||
+       (nodes[node].state != CYBLE_STATE_CONNECTED))
+    {
+        return CYBLE_ERROR_INVALID_OPERATION;
+    }
+    SendPacket(link, link->peripheral, packet, request->attrHandle,
+               request->value.val, (uint8)request->value.len);
+    return CYBLE_ERROR_OK;
+}
+
+CYBLE_API_RESULT_T CyBle_GattcWriteWithoutResponse(CYBLE_CONN_HANDLE_T connHandle,
+                                                   const CYBLE_GATTC_WRITE_REQ_T *writeCmdReqParam)
+{
+    (void)connHandle;
+    return ClientWrite(PKT_WRITE_CMD, writeCmdReqParam);
+}
+
+CYBLE_API_RESULT_T CyBle_GattcWriteCharacteristicValue(CYBLE_CONN_HANDLE_T connHandle,
+                                                       const CYBLE_GATTC_WRITE_REQ_T *writeReqParam)
+{
+    (void)connHandle;
+    return ClientWrite(PKT_WRITE_REQ, writeReqParam);
+}
+
+CYBLE_API_RESULT_T CyBle_GattsWriteAttributeValue(CYBLE_GATT_HANDLE_VALUE_PAIR_T *handleValuePair,
+                                                  uint16 offset, CYBLE_CONN_HANDLE_T *connHandle,
+                                                  uint8 flags)
+{
+    /* The GATT database is not read back by the nodes */
+    (void)handleValuePair;
+    (void)offset;
+    (void)connHandle;
+    (void)flags;
+    return CYBLE_ERROR_OK;
+}
+
+void CyBle_GattsWriteRsp(CYBLE_CONN_HANDLE_T connHandle)
+{
+    LINK_T *link = LinkOf(Node_Current());
+
+    (void)connHandle;
+    if((link != NULL) && !link->closing)
+    {
+        SendPacket(link, link->central, PKT_WRITE_RSP, 0u, NULL, 0u);
+    }
+}
+
+CYBLE_API_RESULT_T CyBle_GattsErrorRsp(CYBLE_CONN_HANDLE_T connHandle,
+                                       const CYBLE_GATTS_ERR_PARAM_T *errRspParam)
+{
+    (void)connHandle;
+    (void)errRspParam;
+    errorResponses++;
+    return CYBLE_ERROR_OK;
+}
+
+
+/*******************************************************************************
+* Nodes
+*******************************************************************************/
+#define ADDRESS_MULTIPLIER          (0x9E3779u)
+#define ADDRESS_MASK                (0xFFFFFFu)
+
+static uint32 addressInverse;
+
+static void MakeAddress(uint32 node, uint8 *bdAddr)
+{
+    uint32 low = (node * ADDRESS_MULTIPLIER) & ADDRESS_MASK;
+
+    /* Cypress OUI 00:A0:50 in the upper bytes, least significant byte first */
+    bdAddr[0] = (uint8)low;
+    bdAddr[1] = (uint8)(low >> 8);
+    bdAddr[2] = (uint8)(low >> 16);
+    bdAddr[3] = 0x50u;
+    bdAddr[4] = 0xA0u;
+    bdAddr[5] = 0x00u;
+}
+
+static uint32 NodeOfAddress(const uint8 *bdAddr)
+{
+    uint32 low = (uint32)bdAddr[0] | ((uint32)bdAddr[1] << 8) | ((uint32)bdAddr[2] << 16);
+
+    return (low * addressInverse) & ADDRESS_MASK;
+}
+
+/* Runs the main loop of a node until it has nothing left to do */
+static void RunNode(uint32 node)
+{
+    uint32 pass;
+    uint64_t activity;
+    int changed;
+
+    Node_Select(node);
+    for(pass = 0u; pass < MAX_LOOP_PASSES; pass++)
+    {
+        activity = stackActivity;
+        changed = Node_Loop();
+        if(!changed && (activity == stackActivity) && (nodes[node].queueCount == 0u))
+        {
+            break;
+        }
+    }
+    RecordColour(node);
+}
+
+static void Place(void)
+{
+    double side;
+    uint32 columns;
+    uint32 cells;
+    uint32 *cellStart;
+    uint32 *cellNodes;
+    uint32 total = 0u;
+    uint32 capacity = 0u;
+    uint32 node;
+    uint32 i;
+
+    if(gridPlacement)
+    {
+        /* Spacing of 2/3 of the range: each node hears the 8 around it */
+        columns = (uint32)ceil(sqrt((double)nodeCount));
+        for(node = 0u; node < nodeCount; node++)
+        {
+            nodes[node].x = (double)(node % columns) / 1.5;
+            nodes[node].y = (double)(node / columns) / 1.5;
+        }
+        side = (double)columns / 1.5;
+    }
+    else
+    {
+        side = sqrt((double)nodeCount * M_PI / degree);
+        for(node = 0u; node < nodeCount; node++)
+        {
+            nodes[node].x = RandomUnit() * side;
+            nodes[node].y = RandomUnit() * side;
+        }
+    }
+
+    /* Grid of cells of the radio range for the neighbour search */
+    columns = (uint32)side + 1u;
+    cells = columns * columns;
+    cellStart = calloc(cells + 1u, sizeof(uint32));
+    cellNodes = malloc(nodeCount * sizeof(uint32));
+    for(node = 0u; node < nodeCount; node++)
+    {
+        cellStart[((uint32)nodes[node].y * columns) + (uint32)nodes[node].x + 1u]++;
+    }
+    for(i = 0u; i < cells; i++)
+    {
+        cellStart[i + 1u] += cellStart[i];
+    }
+    for(node = 0u; node < nodeCount; node++)
+    {
+        cellNodes[cellStart[((uint32)nodes[node].y * columns) + (uint32)nodes[node].x]++] = node;
+    }
+    for(i = cells; i != 0u; i--)
+    {
+        cellStart[i] = cellStart[i - 1u];
+    }
+    cellStart[0] = 0u;
+
+    for(node = 0u; node < nodeCount; node++)
+    {
+        int cx = (int)nodes[node].x;
+        int cy = (int)nodes[node].y;
+        int x;
+        int y;
+
+        nodes[node].firstNeighbour = total;
+        for(y = cy - 1; y <= cy + 1; y++)
+        {
+            for(x = cx - 1; x <= cx + 1; x++)
+            {
+                uint32 cell;
+
+                if((x < 0) || (y < 0) || (x >= (int)columns) || (y >= (int)columns))
+                {
+                    continue;
+                }
+                cell = ((uint32)y * columns) + (uint32)x;
+                for(i = cellStart[cell]; i < cellStart[cell + 1u]; i++)
+                {
+                    uint32 other = cellNodes[i];
+                    double dx = nodes[other].x - nodes[node].x;
+                    double dy = nodes[other].y - nodes[node].y;
+
+                    if((other != node) && (((dx * dx) + (dy * dy)) <= 1.0))
+                    {
+                        if(total == capacity)
+                        {
+                            capacity = (capacity != 0u) ? (capacity * 2u) : nodeCount;
+                            neighbours = realloc(neighbours, capacity * sizeof(uint32));
+                        }
+                        neighbours[total++] = other;
+                    }
+                }
+            }
+        }
+        nodes[node].neighbourCount = total - nodes[node].firstNeighbour;
+    }
+    free(cellStart);
+    free(cellNodes);
+}
+
+/* Marks the nodes which a colour written to the seed can reach */
+static uint32 MarkReachable(void)
+{
+    uint32 *stack = malloc(nodeCount * sizeof(uint32));
+    uint32 depth = 0u;
+    uint32 count = 1u;
+    uint32 node;
+    uint32 i;
+
+    nodes[SEED].reachable = 1u;
+    stack[depth++] = SEED;
+    while(depth != 0u)
+    {
+        node = stack[--depth];
+        for(i = 0u; i < nodes[node].neighbourCount; i++)
+        {
+            uint32 other = neighbours[nodes[node].firstNeighbour + i];
+
+            if(!nodes[other].reachable)
+            {
+                nodes[other].reachable = 1u;
+                stack[depth++] = other;
+                count++;
+            }
+        }
+    }
+    free(stack);
+    return count;
+}
+
+
+/*******************************************************************************
+* Simulation events
+*******************************************************************************/
+static void AdvertisingEvent(uint32 node, uint32 generation)
+{
+    NODE_T *n = &nodes[node];
+    uint32 heard = 0u;
+    uint32 start;
+    uint32 i;
+
+    if((generation != n->advGeneration) || (n->state != CYBLE_STATE_ADVERTISING) ||
+       ((n->listeners == 0u) && !PhoneWaitsFor(node)))
+    {
+        n->advScheduled = 0u;
+        return;
+    }
+
+    if(PhoneWaitsFor(node) && Received())
+    {
+        LinkUp(PHONE, node);
+        return;
+    }
+
+    /* ADV report to every scanning neighbour which receives the packet */
+    start = (uint32)RandomBelow(n->neighbourCount);
+    for(i = 0u; i < n->neighbourCount; i++)
+    {
+        uint32 other = neighbours[n->firstNeighbour + ((start + i) % n->neighbourCount)];
+
+        if((nodes[other].state == CYBLE_STATE_SCANNING) && Received())
+        {
+            PushReport(other, node, CYBLE_GAPC_CONN_UNDIRECTED_ADV, n->advData, n->advDataLen);
+            RunNode(other);
+            candidates[heard++] = other;
+        }
+    }
+
+    /* A connection request ends the advertising event */
+    for(i = 0u; i < n->neighbourCount; i++)
+    {
+        uint32 other = neighbours[n->firstNeighbour + ((start + i) % n->neighbourCount)];
+
+        if((nodes[other].state == CYBLE_STATE_CONNECTING) && (nodes[other].target == node) &&
+           Received())
+        {
+            LinkUp(other, node);
+            return;
+        }
+    }
+
+    /* One scan request is answered, from a scanner which is still scanning */
+    if(heard != 0u)
+    {
+        uint32 other = candidates[RandomBelow(heard)];
+        const CYBLE_GAPP_SCAN_RSP_DATA_T *scanRsp = Node_ScanResponse();
+
+        if((nodes[other].state == CYBLE_STATE_SCANNING) && Received())
+        {
+            PushReport(other, node, CYBLE_GAPC_SCAN_RSP, scanRsp->scanRspData, scanRsp->scanRspDataLen);
+            RunNode(other);
+        }
+    }
+
+    if((generation == n->advGeneration) && (n->state == CYBLE_STATE_ADVERTISING))
+    {
+        Schedule(now + advInterval + RandomBelow(ADV_DELAY_MAX_US), EV_ADV, node, generation);
+    }
+    else
+    {
+        n->advScheduled = 0u;
+    }
+}
+
+static void Connected(uint32 node, LINK_T *link)
+{
+    uint8 rgb[RGB_LED_DATA_LEN];
+
+    if(node == PHONE)
+    {
+        /* The phone writes the colour only, like the CySmart app */
+        Colour(phone.pending, rgb);
+        phone.written = phone.pending;
+        SendPacket(link, link->peripheral, PKT_WRITE_REQ, CYBLE_RGB_LED_CONTROL_CHAR_HANDLE,
+                   rgb, RGB_LED_DATA_LEN);
+        return;
+    }
+    SetState(node, CYBLE_STATE_CONNECTED);
+    Node_Select(node);
+    cyBle_connHandle.bdHandle = link->handle;
+    PushEvent(node, CYBLE_EVT_GATT_CONNECT_IND);
+    PushEvent(node, CYBLE_EVT_GAP_DEVICE_CONNECTED);
+    RunNode(node);
+}
+
+static void Packet(const SIM_EVENT_T *event, LINK_T *link)
+{
+    STACK_EVENT_T *entry;
+    uint32 before;
+    uint32 carried;
+
+    if(event->node == PHONE)
+    {
+        if(event->packet == PKT_WRITE_RSP)
+        {
+            Disconnect(PHONE);
+        }
+        return;
+    }
+
+    entry = PushEvent(event->node, (event->packet == PKT_WRITE_CMD) ? CYBLE_EVT_GATTS_WRITE_CMD_REQ :
+                                   (event->packet == PKT_WRITE_REQ) ? CYBLE_EVT_GATTS_WRITE_REQ :
+                                   CYBLE_EVT_GATTC_WRITE_RSP);
+    if(entry != NULL)
+    {
+        entry->attrHandle = event->attrHandle;
+        entry->len = event->len;
+        memcpy(entry->data, event->data, event->len);
+    }
+
+    before = nodes[event->node].update;
+    RunNode(event->node);
+
+    /* A colour written by a node: useful only if newer than the one shown */
+    if((event->packet == PKT_WRITE_REQ) && (link->central != PHONE) && !link->written)
+    {
+        link->written = 1u;
+        carried = UpdateOfColour(event->data);
+        if(carried <= before)
+        {
+            updates[link->update].wasted++;
+            if(carried < before)
+            {
+                updates[link->update].regressions++;
+            }
+        }
+    }
+}
+
+static void LinkDown(LINK_T *link)
+{
+    uint32 ends[2];
+    uint32 i;
+
+    ends[0] = link->central;
+    ends[1] = link->peripheral;
+    link->inUse = 0u;
+
+    if(link->central == PHONE)
+    {
+        phone.link = -1;
+        phone.waiting = (phone.written != phone.pending) ? 1u : 0u;
+        KickAdvertising(SEED, 0u);
+    }
+    else if(!link->written)
+    {
+        updates[link->update].wasted++;
+    }
+
+    for(i = 0u; i < 2u; i++)
+    {
+        if(ends[i] == PHONE)
+        {
+            continue;
+        }
+        nodes[ends[i]].link = -1;
+        SetState(ends[i], CYBLE_STATE_DISCONNECTED);
+        Node_Select(ends[i]);
+        cyBle_connHandle.bdHandle = 0u;
+        PushEvent(ends[i], CYBLE_EVT_GATT_DISCONNECT_IND);
+        PushEvent(ends[i], CYBLE_EVT_GAP_DEVICE_DISCONNECTED);
+        RunNode(ends[i]);
+    }
+}
+
+static void InjectUpdate(uint32 update)
+{
+    updates[update].injected = now;
+    phone.pending = update;
+    if(phone.link < 0)
+    {
+        phone.waiting = 1u;
+        KickAdvertising(SEED, 0u);
+    }
+}
+
+static void Dispatch(const SIM_EVENT_T *event)
+{
+    LINK_T *link = ((event->type == EV_CONNECTED) || (event->type == EV_PACKET) ||
+                    (event->type == EV_LINK_DOWN)) ? &links[event->arg] : NULL;
+
+    switch(event->type)
+    {
+        case EV_BOOT:
+            Node_Select(event->node);
+            Node_Boot();
+            RunNode(event->node);
+            Schedule(now + RandomBelow(WDT_PERIOD_US), EV_TICK, event->node, 0u);
+            break;
+
+        case EV_TICK:
+            Node_Select(event->node);
+            Node_Tick();
+            RunNode(event->node);
+            Schedule(now + WDT_PERIOD_US, EV_TICK, event->node, 0u);
+            break;
+
+        case EV_ADV:
+            AdvertisingEvent(event->node, event->arg);
+            break;
+
+        case EV_CONNECTED:
+            if(link->inUse && (link->serial == event->serial))
+            {
+                Connected(event->node, link);
+            }
+            break;
+
+        case EV_PACKET:
+            if(link->inUse && (link->serial == event->serial))
+            {
+                Packet(event, link);
+            }
+            break;
+
+        case EV_LINK_DOWN:
+            if(link->inUse && (link->serial == event->serial))
+            {
+                LinkDown(link);
+            }
+            break;
+
+        default:
+            InjectUpdate(event->arg);
+            break;
+    }
+}
+
+
+/*******************************************************************************
+* Report
+*******************************************************************************/
+static int CompareTime(const void *a, const void *b)
+{
+    SIM_TIME_T x = *(const SIM_TIME_T *)a;
+    SIM_TIME_T y = *(const SIM_TIME_T *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double Percentile(const SIM_TIME_T *sorted, uint32 count, double fraction)
+{
+    uint32 index;
+
+    if(count == 0u)
+    {
+        return NAN;
+    }
+    index = (uint32)ceil(fraction * (double)count);
+    index = (index != 0u) ? (index - 1u) : 0u;
+    return (double)sorted[index] * 1e-6;
+}
+
+/* Prints the latencies and connections, returns the number of times a
+ * reachable node missed an update */
+static uint32 Report(uint32 reachable)
+{
+    SIM_TIME_T *all = malloc((size_t)updateCount * nodeCount * sizeof(SIM_TIME_T));
+    SIM_TIME_T *one = malloc(nodeCount * sizeof(SIM_TIME_T));
+    uint32 allCount = 0u;
+    uint32 missed = 0u;
+    uint32 connections = 0u;
+    uint32 wasted = 0u;
+    uint32 regressions = 0u;
+    uint32 k;
+    uint32 node;
+
+    printf("update  reached   p50 s   p90 s   max s  connections  wasted\n");
+    for(k = 1u; k <= updateCount; k++)
+    {
+        uint32 count = 0u;
+
+        for(node = 0u; node < nodeCount; node++)
+        {
+            if(!nodes[node].reachable)
+            {
+                continue;
+            }
+            if(updates[k].reachTime[node] == NEVER)
+            {
+                missed++;
+                continue;
+            }
+            one[count] = updates[k].reachTime[node] - updates[k].injected;
+            all[allCount++] = one[count++];
+        }
+        qsort(one, count, sizeof(SIM_TIME_T), CompareTime);
+        printf("%6u %8u %7.2f %7.2f %7.2f %12u %7u\n", k, count,
+               Percentile(one, count, 0.5), Percentile(one, count, 0.9),
+               Percentile(one, count, 1.0), updates[k].connections, updates[k].wasted);
+        connections += updates[k].connections;
+        wasted += updates[k].wasted;
+        regressions += updates[k].regressions;
+    }
+    /* Connections made before the first update, if any */
+    connections += updates[0].connections;
+    wasted += updates[0].wasted;
+
+    qsort(all, allCount, sizeof(SIM_TIME_T), CompareTime);
+    printf("latency s: p50 %.2f p90 %.2f p99 %.2f max %.2f, %u of %u node updates missed\n",
+           Percentile(all, allCount, 0.5), Percentile(all, allCount, 0.9),
+           Percentile(all, allCount, 0.99), Percentile(all, allCount, 1.0),
+           missed, reachable * updateCount);
+    printf("connections: %u total, %.1f per update, %.1f wasted per update (%.1f%%), "
+           "%u wrote an older colour back\n",
+           connections, (double)connections / updateCount, (double)wasted / updateCount,
+           (connections != 0u) ? (100.0 * wasted / connections) : 0.0, regressions);
+    if((stackEventsLost != 0u) || (errorResponses != 0u))
+    {
+        printf("stack: %u events lost, %u error responses\n", stackEventsLost, errorResponses);
+    }
+
+    free(all);
+    free(one);
+    return missed;
+}
+
+
+int main(int argc, char *argv[])
+{
+    SIM_TIME_T end;
+    SIM_EVENT_T event;
+    uint32 reachable;
+    uint32 node;
+    uint32 k;
+    uint32 edges = 0u;
+    int strict = 0;
+    int option;
+    uint32 missed;
+
+    while((option = getopt(argc, argv, "n:d:Gu:i:a:c:p:s:C")) != -1)
+    {
+        switch(option)
+        {
+            case 'n': nodeCount = (uint32)strtoul(optarg, NULL, 10); break;
+            case 'd': degree = strtod(optarg, NULL); break;
+            case 'G': gridPlacement = 1; break;
+            case 'u': updateCount = (uint32)strtoul(optarg, NULL, 10); break;
+            case 'i': updateInterval = strtod(optarg, NULL); break;
+            case 'a': advInterval = (SIM_TIME_T)(strtod(optarg, NULL) * 1000.0); break;
+            case 'c': connInterval = (SIM_TIME_T)(strtod(optarg, NULL) * 1000.0); break;
+            case 'p': receiveProbability = strtod(optarg, NULL); break;
+            case 's': randomState = strtoull(optarg, NULL, 10) * 0x9E3779B97F4A7C15ULL + 1u; break;
+            case 'C': strict = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-n nodes] [-d degree] [-G] [-u updates] [-i seconds] "
+                        "[-a adv_ms] [-c conn_ms] [-p probability] [-s seed] [-C]\n", argv[0]);
+                return 2;
+        }
+    }
+    if((nodeCount < MIN_NODES) || (nodeCount > MAX_NODES) || (updateCount == 0u) ||
+       (updateCount > MAX_UPDATES) || (degree <= 0.0) || (updateInterval <= 0.0) ||
+       (advInterval == 0u) || (connInterval == 0u) ||
+       (receiveProbability <= 0.0) || (receiveProbability > 1.0))
+    {
+        fprintf(stderr, "%s: %u to %u nodes, 1 to %u updates, positive times and degree, "
+                "probability in (0, 1]\n", argv[0], MIN_NODES, MAX_NODES, MAX_UPDATES);
+        return 2;
+    }
+
+    /* Inverse of the address multiplier modulo 2^24 */
+    addressInverse = ADDRESS_MULTIPLIER;
+    for(k = 0u; k < 5u; k++)
+    {
+        addressInverse *= 2u - (ADDRESS_MULTIPLIER * addressInverse);
+    }
+    addressInverse &= ADDRESS_MASK;
+
+    nodes = calloc(nodeCount, sizeof(NODE_T));
+    links = calloc(nodeCount + 1u, sizeof(LINK_T));
+    candidates = malloc(nodeCount * sizeof(uint32));
+    updates = calloc(updateCount + 1u, sizeof(UPDATE_T));
+    if((nodes == NULL) || (links == NULL) || (candidates == NULL) || (updates == NULL) ||
+       !Node_Reset(nodeCount))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    for(k = 0u; k <= updateCount; k++)
+    {
+        updates[k].reachTime = malloc(nodeCount * sizeof(SIM_TIME_T));
+        for(node = 0u; node < nodeCount; node++)
+        {
+            updates[k].reachTime[node] = NEVER;
+        }
+    }
+
+    Place();
+    reachable = MarkReachable();
+    for(node = 0u; node < nodeCount; node++)
+    {
+        MakeAddress(node, nodes[node].bdAddr);
+        nodes[node].state = CYBLE_STATE_STOPPED;
+        nodes[node].link = -1;
+        nodes[node].target = PHONE;
+        edges += nodes[node].neighbourCount;
+        Schedule(RandomBelow(BOOT_SPREAD_US), EV_BOOT, node, 0u);
+    }
+    phone.link = -1;
+
+    for(k = 1u; k <= updateCount; k++)
+    {
+        Schedule(FIRST_UPDATE_US + (SIM_TIME_T)((k - 1u) * updateInterval * 1e6), EV_UPDATE, 0u, k);
+    }
+    end = FIRST_UPDATE_US + (SIM_TIME_T)(updateCount * updateInterval * 1e6);
+
+    printf("%u nodes, %.1f neighbours per node, %u reachable from the seed\n",
+           nodeCount, (double)edges / nodeCount, reachable);
+    printf("CENTRAL_STATE_SPAN %u (%.1f s), PERIP_RGB_HOLD_TIME %u, "
+           "%u updates %.0f s apart\n",
+           Node_CentralStateSpan(), Node_CentralStateSpan() * (WDT_PERIOD_US * 1e-6),
+           Node_RgbHoldTime(), updateCount, updateInterval);
+
+    while((heapCount != 0u) && (heap[0].time < end))
+    {
+        event = PopEvent();
+        now = event.time;
+        Dispatch(&event);
+    }
+
+    missed = Report(reachable);
+    return (strict && (missed != 0u)) ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+* File Name: mesh_sim.h
+*
+* Description:
+*  Interface between the simulator (mesh_sim.c) and the firmware of the nodes
+*  (mesh_node.c). All firmware calls act on the node last selected.
+*
+*******************************************************************************/
+#if !defined(MESH_SIM_H)
+#define MESH_SIM_H
+
+#include "project.h"
+
+/* Allocates the firmware state of count nodes, all as after reset */
+int Node_Reset(uint32 count);
+
+/* Makes node the one run by the following calls */
+void Node_Select(uint32 node);
+uint32 Node_Current(void);
+
+/* InitializeSystem() of main.c */
+void Node_Boot(void);
+
+/* One pass of the main loop of main.c. Returns non zero if the pass changed
+ * the state of the firmware */
+int Node_Loop(void);
+
+/* Watchdog interrupt, one tick of 100 ms */
+void Node_Tick(void);
+
+/* Colour last written to the LED and ADV data counter */
+const uint8 *Node_Rgb(void);
+uint8 Node_Counter(void);
+
+/* Scan response data of the BLE component, the service data of scan_tag */
+const CYBLE_GAPP_SCAN_RSP_DATA_T *Node_ScanResponse(void);
+
+/* Role timing compiled into the firmware */
+uint32 Node_CentralStateSpan(void);
+uint32 Node_RgbHoldTime(void);
+
+#endif /* MESH_SIM_H */
@@ -0,0 +1,211 @@
+/* Host stand-in for the PSoC Creator project.h of Mesh_Flood_PSoC4BLE.cydsn,
+ * only what the firmware sources use. The CyBle_* functions are implemented
+ * by the simulated stack in mesh_sim.c, the other components do nothing. */
+#if !defined(PROJECT_H)
+#define PROJECT_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+
+#define CyGlobalIntEnable                   ((void)0)
+#define CyDelay(ms)                         ((void)(ms))
+#define CyDelayUs(us)                       ((void)(us))
+
+/* PrISM, pins and UART */
+#define PrISM_1_Start()                     ((void)0)
+#define PrISM_2_Start()                     ((void)0)
+#define PrISM_1_WritePulse0(value)          ((void)(value))
+#define PrISM_1_WritePulse1(value)          ((void)(value))
+#define PrISM_2_WritePulse0(value)          ((void)(value))
+#define RED_DM_STRONG                       (6u)
+#define GREEN_DM_STRONG                     (6u)
+#define BLUE_DM_STRONG                      (6u)
+#define RED_SetDriveMode(mode)              ((void)(mode))
+#define GREEN_SetDriveMode(mode)            ((void)(mode))
+#define BLUE_SetDriveMode(mode)             ((void)(mode))
+#define UART_Start()                        ((void)0)
+#define UART_UartPutString(string)          ((void)(string))
+#define UART_UartPutChar(c)                 ((void)(c))
+#define UART_UartPutCRLF(c)                 ((void)(c))
+
+/* Watchdog, the simulator calls WDT_INT_Handler() every 100 ms of a node */
+#define CY_SYS_WDT_COUNTER0                 (0u)
+#define CY_SYS_WDT_COUNTER0_MASK            (0x01u)
+#define CY_SYS_WDT_COUNTER0_INT             (0x04u)
+#define CY_SYS_WDT_MODE_INT                 (1u)
+#define CySysWdtUnlock()                    ((void)0)
+#define CySysWdtLock()                      ((void)0)
+#define CySysWdtWriteMode(counter, mode)    ((void)(counter), (void)(mode))
+#define CySysWdtWriteClearOnMatch(counter, enable)  ((void)(counter), (void)(enable))
+#define CySysWdtWriteMatch(counter, match)  ((void)(counter), (void)(match))
+#define CySysWdtEnable(mask)                ((void)(mask))
+#define CySysWdtGetInterruptSource()        (CY_SYS_WDT_COUNTER0_INT)
+#define CySysWdtClearInterrupt(mask)        ((void)(mask))
+#define isr_WDT_StartEx(handler)            ((void)(handler))
+#define isr_WDT_ClearPending()              ((void)0)
+
+/* BLE component */
+#define CYBLE_GAP_BD_ADDR_SIZE              (6u)
+#define CYBLE_GAP_MAX_ADV_DATA_LEN          (31u)
+#define CYBLE_GAP_MAX_SCAN_RSP_DATA_LEN     (31u)
+
+/* Attribute handles of the custom service, as in BLE_custom.h */
+#define CYBLE_RGB_LED_CONTROL_CHAR_HANDLE   (0x000Eu)
+#define CYBLE_RGB_DATA_COUNT_CHAR_HANDLE    (0x0012u)
+
+#define CYBLE_GATT_WRITE_REQ                (0x12u)
+#define CYBLE_GATT_DB_LOCALLY_INITIATED     (0x00u)
+
+typedef enum
+{
+    CYBLE_EVT_STACK_ON = 0x01u,
+    CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT = 0x20u,
+    CYBLE_EVT_GAPP_ADVERTISEMENT_START_STOP,
+    CYBLE_EVT_GAPC_SCAN_START_STOP,
+    CYBLE_EVT_GAP_DEVICE_CONNECTED,
+    CYBLE_EVT_GAP_DEVICE_DISCONNECTED,
+    CYBLE_EVT_GATT_CONNECT_IND = 0x40u,
+    CYBLE_EVT_GATT_DISCONNECT_IND,
+    CYBLE_EVT_GATTC_WRITE_RSP,
+    CYBLE_EVT_GATTS_WRITE_REQ,
+    CYBLE_EVT_GATTS_WRITE_CMD_REQ,
+    CYBLE_EVT_GATTC_DISCOVERY_COMPLETE
+} CYBLE_EVENT_T;
+
+typedef enum
+{
+    CYBLE_STATE_STOPPED,
+    CYBLE_STATE_INITIALIZING,
+    CYBLE_STATE_CONNECTED,
+    CYBLE_STATE_ADVERTISING,
+    CYBLE_STATE_SCANNING,
+    CYBLE_STATE_CONNECTING,
+    CYBLE_STATE_DISCONNECTED
+} CYBLE_STATE_T;
+
+typedef enum
+{
+    CYBLE_ERROR_OK,
+    CYBLE_ERROR_INVALID_PARAMETER,
+    CYBLE_ERROR_INVALID_OPERATION,
+    CYBLE_ERROR_INVALID_STATE = 0x0Bu
+} CYBLE_API_RESULT_T;
+
+#define CYBLE_ADVERTISING_FAST              (0x00u)
+#define CYBLE_SCANNING_FAST                 (0x00u)
+
+#define CYBLE_GAPC_CONN_UNDIRECTED_ADV      (0u)
+#define CYBLE_GAPC_CONN_DIRECTED_ADV        (1u)
+#define CYBLE_GAPC_SCAN_UNDIRECTED_ADV      (2u)
+#define CYBLE_GAPC_NON_CONN_UNDIRECTED_ADV  (3u)
+#define CYBLE_GAPC_SCAN_RSP                 (4u)
+
+typedef uint16 CYBLE_GATT_DB_ATTR_HANDLE_T;
+typedef uint8 CYBLE_GATT_ERR_CODE_T;
+typedef void (*CYBLE_CALLBACK_T)(uint32 eventCode, void *eventParam);
+
+typedef struct
+{
+    uint8 bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+    uint8 type;
+} CYBLE_GAP_BD_ADDR_T;
+
+typedef struct
+{
+    uint8 bdHandle;
+    uint8 attId;
+} CYBLE_CONN_HANDLE_T;
+
+typedef struct
+{
+    uint8 advData[CYBLE_GAP_MAX_ADV_DATA_LEN];
+    uint8 advDataLen;
+} CYBLE_GAPP_DISC_DATA_T;
+
+typedef struct
+{
+    uint8 scanRspData[CYBLE_GAP_MAX_SCAN_RSP_DATA_LEN];
+    uint8 scanRspDataLen;
+} CYBLE_GAPP_SCAN_RSP_DATA_T;
+
+typedef struct
+{
+    uint8 discMode;
+    CYBLE_GAPP_DISC_DATA_T *advData;
+    CYBLE_GAPP_SCAN_RSP_DATA_T *scanRspData;
+    uint16 advTo;
+} CYBLE_GAPP_DISC_MODE_INFO_T;
+
+typedef struct
+{
+    uint8 eventType;
+    uint8 peerAddrType;
+    uint8 *peerBdAddr;
+    uint8 dataLen;
+    uint8 *data;
+    int8 rssi;
+} CYBLE_GAPC_ADV_REPORT_T;
+
+typedef struct
+{
+    uint8 *val;
+    uint16 len;
+    uint16 actualLen;
+} CYBLE_GATT_VALUE_T;
+
+typedef struct
+{
+    CYBLE_GATT_VALUE_T value;
+    CYBLE_GATT_DB_ATTR_HANDLE_T attrHandle;
+} CYBLE_GATT_HANDLE_VALUE_PAIR_T;
+
+typedef CYBLE_GATT_HANDLE_VALUE_PAIR_T CYBLE_GATTC_WRITE_REQ_T;
+
+typedef struct
+{
+    CYBLE_CONN_HANDLE_T connHandle;
+    CYBLE_GATT_HANDLE_VALUE_PAIR_T handleValPair;
+} CYBLE_GATTS_WRITE_REQ_PARAM_T;
+
+typedef CYBLE_GATTS_WRITE_REQ_PARAM_T CYBLE_GATTS_WRITE_CMD_REQ_PARAM_T;
+
+typedef struct
+{
+    CYBLE_GATT_DB_ATTR_HANDLE_T attrHandle;
+    uint8 opcode;
+    CYBLE_GATT_ERR_CODE_T errorCode;
+} CYBLE_GATTS_ERR_PARAM_T;
+
+/* Stack globals, these belong to the node being run */
+extern CYBLE_CONN_HANDLE_T cyBle_connHandle;
+extern CYBLE_GAPP_DISC_MODE_INFO_T cyBle_discoveryModeInfo;
+
+CYBLE_API_RESULT_T CyBle_Start(CYBLE_CALLBACK_T callbackFunc);
+void CyBle_ProcessEvents(void);
+CYBLE_STATE_T CyBle_GetState(void);
+CYBLE_API_RESULT_T CyBle_GappStartAdvertisement(uint8 advertisingIntervalType);
+void CyBle_GappStopAdvertisement(void);
+CYBLE_API_RESULT_T CyBle_GapcStartScan(uint8 scanningIntervalType);
+void CyBle_GapcStopScan(void);
+CYBLE_API_RESULT_T CyBle_GapcConnectDevice(const CYBLE_GAP_BD_ADDR_T *address);
+CYBLE_API_RESULT_T CyBle_GapDisconnect(uint8 bdHandle);
+CYBLE_API_RESULT_T CyBle_GattcStartDiscovery(CYBLE_CONN_HANDLE_T connHandle);
+CYBLE_API_RESULT_T CyBle_GattcWriteWithoutResponse(CYBLE_CONN_HANDLE_T connHandle,
+                                                   const CYBLE_GATTC_WRITE_REQ_T *writeCmdReqParam);
+CYBLE_API_RESULT_T CyBle_GattcWriteCharacteristicValue(CYBLE_CONN_HANDLE_T connHandle,
+                                                       const CYBLE_GATTC_WRITE_REQ_T *writeReqParam);
+CYBLE_API_RESULT_T CyBle_GattsWriteAttributeValue(CYBLE_GATT_HANDLE_VALUE_PAIR_T *handleValuePair,
+                                                  uint16 offset, CYBLE_CONN_HANDLE_T *connHandle,
+                                                  uint8 flags);
+void CyBle_GattsWriteRsp(CYBLE_CONN_HANDLE_T connHandle);
+CYBLE_API_RESULT_T CyBle_GattsErrorRsp(CYBLE_CONN_HANDLE_T connHandle,
+                                       const CYBLE_GATTS_ERR_PARAM_T *errRspParam);
+
+#endif /* PROJECT_H */
@@ -16,18 +16,49 @@
 *******************************************************************************/
 #include <project.h>
 
-#define EDDYSTONE_UID                       (1)
-#define EDDYSTONE_URL                       (2)
+/* Frame interleaving, in advertising events: a frame is sent once every N
+ * events, 0 never sends it. In an event in which no frame is due the frame
+ * sent last is repeated, frames due in the same event go out one after the
+ * other */
+#define EDDYSTONE_UID_PERIOD                (0)
+#define EDDYSTONE_URL_PERIOD                (1)
+#define EDDYSTONE_TLM_PERIOD                (0)
+#define EDDYSTONE_EID_PERIOD                (0)
 
-/* Macros to set the advertisement timeout intervals */
-#define EDDYSTONE_REGULAR_TIMEOUT_SECONDS   (25)   /* Forced to 0 if no TLM */
-#define EDDYSTONE_TLM_TIMEOUT_SECONDS       (5)
+/* TLM telemetry, set to 1 to measure the battery voltage and the die
+ * temperature. Needs in TopDesign, configured as in the BLE_HID_Joystick
+ * project (Day040):
+ *  - ADC_SAR_Seq named SAR_ADC, 12-bit single ended, channel 0 on the pin of
+ *    the SAR bypass capacitor (P1[7]), channel 1 on a TempSensor
+ *  - DieTemp_P4 named DieTemp
+ * With 0 the TLM frame reports the voltage and temperature as not measured */
+#define EDDYSTONE_TLM_MEASURE               (0u)
+#define EDDYSTONE_TLM_VREF_CHANNEL          (0u)
+#define EDDYSTONE_TLM_TEMP_CHANNEL          (1u)
 
-/* Change this macro to decide whether to have TLM packets interleaved or not */
-#define IS_EDDYSTONE_TLM_PRESENT            (0)
+/* Time for the SAR bypass capacitor to charge to the 1.024 V reference */
+#define EDDYSTONE_TLM_VREF_SETTLE_MS        (25u)
 
-/* Change this macro value for corresponding implementation - UID or URL */
-#define EDDYSTONE_IMPLEMENTATION            (EDDYSTONE_URL)
+/* Advertising PDUs counted per advertising event in the TLM frame, one per channel */
+#define EDDYSTONE_ADV_PDUS_PER_EVENT        (3u)
+
+/* Ranging data: calibrated TX power at 0 m in dBm */
+#define EDDYSTONE_TX_POWER                  (-14)
+
+/* UID - SHA-1 hash of the FQDN (cypress.com), its first 10 bytes MSB first as
+ * the Namespace ID, and a randomly created Instance ID */
+#define EDDYSTONE_NAMESPACE_ID              0xCB, 0x6F, 0x15, 0xCE, 0x20, 0x2A, 0xCE, 0x15, 0x6F, 0xCB
+#define EDDYSTONE_INSTANCE_ID               0x01, 0x01, 0x01, 0x01, 0x01, 0x01
+
+/* URL - http://www.cypress.com/, scheme and expansion codes from AdvBuilder.h */
+#define EDDYSTONE_URL_SCHEME                (EDDYSTONE_URL_HTTP_WWW)
+#define EDDYSTONE_ENCODED_URL               'c', 'y', 'p', 'r', 'e', 's', 's', EDDYSTONE_URL_COM_SLASH
+
+/* EID - identity key shared with the resolving service at registration, and
+ * the rotation period of the identifier as a power of 2 seconds (2^10 = 17 min) */
+#define EDDYSTONE_EID_IDENTITY_KEY          0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, \
+                                            0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+#define EDDYSTONE_EID_ROTATION_EXPONENT     (10u)
 
 
 /* [] END OF FILE */
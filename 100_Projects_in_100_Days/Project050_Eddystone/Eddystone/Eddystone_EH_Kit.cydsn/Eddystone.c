@@ -6,7 +6,10 @@
 * Author - udyg@cypress.com
 * 
 * Description:
-*  Application for Eddystone beacon.
+*  Application for Eddystone beacon. The UID, URL, TLM and EID frames are
+*  interleaved while advertising continues: after every advertising event the
+*  frame due, if any, is written into the advertising payload service, which
+*  passes the bytes that differ from the previous frame to the stack.
 *
 ********************************************************************************
 * Copyright 2010-2015, Cypress Semiconductor Corporation.  All rights reserved.
@@ -15,16 +18,240 @@
 * the software package with which this file was provided.
 *******************************************************************************/
 #include <project.h>
-#include <stdbool.h>
+#include <string.h>
 #include "Eddystone.h"
+#include "AdvBuilder.h"
+#include "adv_payload.h"
 #include "WatchdogTimer.h"
 
-static bool isRegularAdvScheduled = true;
+/* ADV packet images, built and length checked at compile time. The TLM and
+ * EID images are updated in place before they are sent */
+static const uint8 uidAdvImage[] = { EDDYSTONE_UID_ADV(EDDYSTONE_TX_POWER, EDDYSTONE_NAMESPACE_ID,
+                                                       EDDYSTONE_INSTANCE_ID) };
+ADV_IMAGE_CHECK_LEN(uidAdvImage, EDDYSTONE_UID_ADV_LEN);
+
+static const uint8 urlAdvImage[] = { EDDYSTONE_URL_ADV(EDDYSTONE_TX_POWER, EDDYSTONE_URL_SCHEME,
+                                                       EDDYSTONE_ENCODED_URL) };
+ADV_IMAGE_CHECK(urlAdvImage);
+
+static uint8 tlmAdvImage[] = { EDDYSTONE_TLM_ADV(EDDYSTONE_TLM_VBATT_NOT_MEASURED, EDDYSTONE_TLM_TEMP_NOT_SUPPORTED,
+                                                 0u, 0u) };
+ADV_IMAGE_CHECK_LEN(tlmAdvImage, EDDYSTONE_TLM_ADV_LEN);
+
+static uint8 eidAdvImage[] = { EDDYSTONE_EID_ADV(EDDYSTONE_TX_POWER, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u) };
+ADV_IMAGE_CHECK_LEN(eidAdvImage, EDDYSTONE_EID_ADV_LEN);
+
+/* Interleaving state of each frame */
+typedef enum
+{
+    FRAME_UID,
+    FRAME_URL,
+    FRAME_TLM,
+    FRAME_EID,
+    FRAME_COUNT
+} EDDYSTONE_FRAME_INDEX_T;
+
+typedef struct
+{
+    const uint8 *image;
+    uint8 length;
+    uint8 period;       /* Advertising events between two frames, 0 if not sent */
+    uint32 due;         /* Advertising event the frame is due in */
+} EDDYSTONE_FRAME_T;
+
+static EDDYSTONE_FRAME_T frames[FRAME_COUNT] =
+{
+    { uidAdvImage, sizeof(uidAdvImage), EDDYSTONE_UID_PERIOD, 0u },
+    { urlAdvImage, sizeof(urlAdvImage), EDDYSTONE_URL_PERIOD, 0u },
+    { tlmAdvImage, sizeof(tlmAdvImage), EDDYSTONE_TLM_PERIOD, 0u },
+    { eidAdvImage, sizeof(eidAdvImage), EDDYSTONE_EID_PERIOD, 0u },
+};
+
+/* Advertising event count at which the last frame was selected */
+static uint32 lastAdvEvent = 0;
+
+#if (EDDYSTONE_EID_PERIOD != 0)
+static const uint8 eidIdentityKey[EDDYSTONE_EID_KEY_LEN] = { EDDYSTONE_EID_IDENTITY_KEY };
+/* Time counter quantum of the EID in the image, 0xFFFFFFFF before the first */
+static uint32 eidQuantum = 0xFFFFFFFFu;
+#endif
+
+
+#if (EDDYSTONE_TLM_MEASURE != 0u)
+/* Reference selection bits of the SAR_CTRL register */
+#define SAR_VREF_MASK                       (0x000000F0Lu)
+
+/* Telemetry of the last measurement */
+static uint16 batteryMv = EDDYSTONE_TLM_VBATT_NOT_MEASURED;
+static uint16 temperature = EDDYSTONE_TLM_TEMP_NOT_SUPPORTED;
+
+/* Scans the ADC channels once and returns the result of one channel */
+static int16 ScanAdcChannel(uint32 channel)
+{
+    SAR_ADC_StartConvert();
+    (void)SAR_ADC_IsEndConversion(SAR_ADC_WAIT_FOR_RESULT);
+    SAR_ADC_StopConvert();
+
+    return SAR_ADC_GetResult16(channel);
+}
+
+/* Measures the die temperature against the 1.024 V reference, then the
+ * charged bypass capacitor against VDD, which gives VDD in mV as
+ * 1024 * 2048 / counts */
+static void MeasureTelemetry(void)
+{
+    int16 counts;
+
+    SAR_ADC_Wakeup();
+
+    SAR_ADC_SAR_CTRL_REG = (SAR_ADC_SAR_CTRL_REG & ~SAR_VREF_MASK) | SAR_ADC_VREF_INTERNAL1024BYPASSED;
+    CyDelay(EDDYSTONE_TLM_VREF_SETTLE_MS);
+    counts = ScanAdcChannel(EDDYSTONE_TLM_TEMP_CHANNEL);
+    temperature = (uint16)(DieTemp_CountsTo_Celsius((int32)counts) * 256);
+
+    SAR_ADC_SAR_CTRL_REG = (SAR_ADC_SAR_CTRL_REG & ~SAR_VREF_MASK) | SAR_ADC_VREF_VDDA;
+    CyDelay(1u);
+    counts = ScanAdcChannel(EDDYSTONE_TLM_VREF_CHANNEL);
+    batteryMv = (counts > 0) ? (uint16)((1024u * 2048u) / (uint32)counts) : EDDYSTONE_TLM_VBATT_NOT_MEASURED;
+
+    SAR_ADC_Sleep();
+}
+#endif
+
+/* Battery voltage in mV for the TLM frame, not measured unless the ADC is
+ * enabled with EDDYSTONE_TLM_MEASURE */
+static uint16 ReadBatteryVoltage(void)
+{
+#if (EDDYSTONE_TLM_MEASURE != 0u)
+    return batteryMv;
+#else
+    return EDDYSTONE_TLM_VBATT_NOT_MEASURED;
+#endif
+}
+
+/* Beacon temperature in 8.8 fixed point degrees Celsius for the TLM frame,
+ * not supported unless the DieTemp is enabled with EDDYSTONE_TLM_MEASURE */
+static uint16 ReadTemperature(void)
+{
+#if (EDDYSTONE_TLM_MEASURE != 0u)
+    return temperature;
+#else
+    return EDDYSTONE_TLM_TEMP_NOT_SUPPORTED;
+#endif
+}
+
+/* Writes a big endian field into a frame image */
+static void WriteBigEndian(uint8 *field, uint32 value, uint8 size)
+{
+    while(size != 0u)
+    {
+        size--;
+        field[size] = LO8(value);
+        value >>= 8u;
+    }
+}
+
+/* Refreshes the TLM frame with the current telemetry */
+static void UpdateTlmFrame(void)
+{
+#if (EDDYSTONE_TLM_MEASURE != 0u)
+    MeasureTelemetry();
+#endif
+    WriteBigEndian(&tlmAdvImage[EDDYSTONE_TLM_VBATT_OFFSET], ReadBatteryVoltage(), 2u);
+    WriteBigEndian(&tlmAdvImage[EDDYSTONE_TLM_TEMP_OFFSET], ReadTemperature(), 2u);
+    WriteBigEndian(&tlmAdvImage[EDDYSTONE_TLM_ADV_CNT_OFFSET], AdvPayloadEventCount() * EDDYSTONE_ADV_PDUS_PER_EVENT, 4u);
+    WriteBigEndian(&tlmAdvImage[EDDYSTONE_TLM_SEC_CNT_OFFSET], WDT_GetUptimeDeciseconds(), 4u);
+}
+
+#if (EDDYSTONE_EID_PERIOD != 0)
+/* Recomputes the ephemeral identifier when the time counter enters a new
+ * quantum of 2^EDDYSTONE_EID_ROTATION_EXPONENT seconds:
+ *  temporary key = AES(identity key, 11 x 0x00, 0xFF, 0x00, 0x00, time[31:16])
+ *  EID           = AES(temporary key, 11 x 0x00, K, time with K low bits clear)[0:7]
+ */
+static void UpdateEidFrame(void)
+{
+    uint8 block[EDDYSTONE_EID_KEY_LEN];
+    uint8 key[EDDYSTONE_EID_KEY_LEN];
+    uint8 result[EDDYSTONE_EID_KEY_LEN];
+    uint32 seconds = WDT_GetUptimeSeconds();
+    uint32 quantum = seconds >> EDDYSTONE_EID_ROTATION_EXPONENT;
+
+    if(quantum == eidQuantum)
+    {
+        return;
+    }
+    eidQuantum = quantum;
+    seconds = quantum << EDDYSTONE_EID_ROTATION_EXPONENT;
+
+    memset(block, 0, sizeof(block));
+    block[11] = 0xFFu;
+    block[14] = HI8(HI16(seconds));
+    block[15] = LO8(HI16(seconds));
+    (void)CyBle_AesEncrypt(block, (uint8 *)eidIdentityKey, key);
+
+    memset(block, 0, sizeof(block));
+    block[11] = EDDYSTONE_EID_ROTATION_EXPONENT;
+    WriteBigEndian(&block[12], seconds, 4u);
+    (void)CyBle_AesEncrypt(block, key, result);
+
+    memcpy(&eidAdvImage[EDDYSTONE_EID_OFFSET], result, EDDYSTONE_EID_LEN);
+}
+#endif
+
+/* Selects the frame due first and writes it into the advertising payload.
+ * When no frame is due the payload is left as it is, so the frame sent last
+ * is repeated and every frame keeps its period. A frame delayed by a whole
+ * period, because others were due in the same events, skips the events it
+ * missed rather than being sent back to back. A frame sent again changes no
+ * bytes, so no update */
+static void ScheduleNextFrame(uint32 advEvent)
+{
+    EDDYSTONE_FRAME_T *next = NULL;
+    uint8 i;
+
+    for(i = 0; i < FRAME_COUNT; i++)
+    {
+        if((frames[i].period != 0u) &&
+           ((next == NULL) || ((int32)(frames[i].due - next->due) < 0)))
+        {
+            next = &frames[i];
+        }
+    }
+
+    if((next == NULL) || ((int32)(next->due - advEvent) > 0))
+    {
+        return;
+    }
+    next->due += next->period;
+    if((int32)(next->due - advEvent) <= 0)
+    {
+        next->due = advEvent + next->period;
+    }
+
+    if(next == &frames[FRAME_TLM])
+    {
+        UpdateTlmFrame();
+    }
+#if (EDDYSTONE_EID_PERIOD != 0)
+    else if(next == &frames[FRAME_EID])
+    {
+        UpdateEidFrame();
+    }
+#endif
+    else
+    {
+        /* UID and URL images are constant */
+    }
+
+    AdvPayloadSetLength(ADV_PAYLOAD_ADV, next->length);
+    AdvPayloadWrite(ADV_PAYLOAD_ADV, 0u, next->image, next->length);
+}
 
 /* BLE stack event handler */
 void BLE_AppEventHandler(uint32 event, void* eventParam)
 {
-    CYBLE_API_RESULT_T apiResult;
+    (void)eventParam;
 
     switch (event)
 	{
@@ -35,34 +262,28 @@ void BLE_AppEventHandler(uint32 event, void* eventParam)
         /* This event is received when component is Started */
         case CYBLE_EVT_STACK_ON: 
             
-            /* Start with a regular UID/URL packet */
-            isRegularAdvScheduled = true;
-            ConfigureAdvPacket(isRegularAdvScheduled);
+        #if (EDDYSTONE_EID_PERIOD != 0)
+            CyBle_AesCcmInit();
+        #endif
+
+            /* Advertise without timeout, frames are switched in place */
+            cyBle_discoveryModeInfo.advTo = 0;
+        #if (EDDYSTONE_TLM_MEASURE != 0u)
+            SAR_ADC_Start();
+            SAR_ADC_Sleep();
+        #endif
+
+            AdvPayloadInit();
+            ScheduleNextFrame(AdvPayloadEventCount());
 
             initCounter = 0;
             WDT_EnableWcoCounter();     /* Enable WDT's WCO counter (counter 0) */
         break;
             
         case CYBLE_EVT_GAPP_ADVERTISEMENT_START_STOP:
-            if(CyBle_GetState() != CYBLE_STATE_ADVERTISING)
+            if((CyBle_GetState() != CYBLE_STATE_ADVERTISING) && (initCounter == 7))
             {
-                /* On advertisement timeout, restart advertisement */
-
-            #if (IS_EDDYSTONE_TLM_PRESENT)
-                if(true == isRegularAdvScheduled)
-                {
-                    /* Configure for TLM packet */
-                    isRegularAdvScheduled = false;
-                }
-                else
-                {
-                    /* Configure for regular UID/URL packet */
-                    isRegularAdvScheduled = true;
-                }
-                
-                ConfigureAdvPacket(isRegularAdvScheduled);
-            #endif
-            
+                /* Advertising is not expected to stop, restart it if it does */
                 CyBle_GappStartAdvertisement(CYBLE_ADVERTISING_CUSTOM);
             }
         break;
@@ -72,140 +293,18 @@ void BLE_AppEventHandler(uint32 event, void* eventParam)
 	}
 }
 
-void ConfigureAdvPacket(bool isPacketRegular)
+/* Called from the main loop before AdvPayloadProcess(). AdvPayloadEventCount()
+ * sees the end of each advertising event, the next frame is then written and
+ * taken over by the AdvPayloadProcess() call which follows, before the next
+ * advertising event starts, so the frame goes out in that event */
+void EddystoneProcess(void)
 {
-    /* Configure Eddystone packets at run-time. */
-    
-    /* Flags are untouched */
-
-    /* Service Solicitation data */
-    cyBle_discoveryData.advData[3] = 0x03;      /* Length */
-    cyBle_discoveryData.advData[4] = 0x03;      /* Complete List of Service UUIDs */
-    cyBle_discoveryData.advData[5] = 0xAA;      /* LSB - Eddystone service */
-    cyBle_discoveryData.advData[6] = 0xFE;      /* MSB - Eddystone service */
+    uint32 advEvents = AdvPayloadEventCount();
 
-    if(isPacketRegular == true)
-    {
-        /* ADV packet timeout */
-    #if (IS_EDDYSTONE_TLM_PRESENT)
-        cyBle_discoveryModeInfo.advTo = EDDYSTONE_REGULAR_TIMEOUT_SECONDS;
-    #else
-        cyBle_discoveryModeInfo.advTo = 0;  /* No timeout */
-    #endif
-        
-    #if (EDDYSTONE_IMPLEMENTATION == EDDYSTONE_UID)
-
-        /* Service Data */
-        cyBle_discoveryData.advData[7] = 0x17;      /* Length */
-        cyBle_discoveryData.advData[8] = 0x16;      /* Service Data */
-        cyBle_discoveryData.advData[9] = 0xAA;      /* LSB - Eddystone Service */
-        cyBle_discoveryData.advData[10] = 0xFE;     /* MSB - Eddystone Service */
-
-        cyBle_discoveryData.advData[11] = 0x00;     /* Signifies Eddystone UID */
-
-        cyBle_discoveryData.advData[12] = 0xF2;     /* Ranging data: -14dB*/
-
-        /* SHA-1 hash of the FQDN (cypress.com) is calculated and its 
-         * first 10 bytes are placed here as the Namespace ID, MSB first.
-         */
-        cyBle_discoveryData.advData[13] = 0xCB;     /* NID[0] */
-        cyBle_discoveryData.advData[14] = 0x6F;     /* NID[1] */
-        cyBle_discoveryData.advData[15] = 0x15;     /* NID[2] */
-        cyBle_discoveryData.advData[16] = 0xCE;     /* NID[3] */
-        cyBle_discoveryData.advData[17] = 0x20;     /* NID[4] */
-        cyBle_discoveryData.advData[18] = 0x2A;     /* NID[5] */
-        cyBle_discoveryData.advData[19] = 0xCE;     /* NID[6] */
-        cyBle_discoveryData.advData[20] = 0x15;     /* NID[7] */
-        cyBle_discoveryData.advData[21] = 0x6F;     /* NID[8] */
-        cyBle_discoveryData.advData[22] = 0xCB;     /* NID[9] */
-
-        /* Instance ID - randomly created */
-        cyBle_discoveryData.advData[23] = 0x01;     /* BID[0] */
-        cyBle_discoveryData.advData[24] = 0x01;     /* BID[1] */
-        cyBle_discoveryData.advData[25] = 0x01;     /* BID[2] */
-        cyBle_discoveryData.advData[26] = 0x01;     /* BID[3] */
-        cyBle_discoveryData.advData[27] = 0x01;     /* BID[4] */
-        cyBle_discoveryData.advData[28] = 0x01;     /* BID[5] */
-        
-        cyBle_discoveryData.advData[29] = 0x00;     /* Reserved */
-        cyBle_discoveryData.advData[30] = 0x00;     /* Reserved */
-        
-        /* ADV packet length */
-        cyBle_discoveryData.advDataLen = 31;
-        
-    #elif (EDDYSTONE_IMPLEMENTATION == EDDYSTONE_URL)
-        
-        /* Service Data */
-        cyBle_discoveryData.advData[7] = 0x0E;      /* Length */
-        cyBle_discoveryData.advData[8] = 0x16;      /* Service Data */
-        cyBle_discoveryData.advData[9] = 0xAA;      /* LSB - Eddystone Service */
-        cyBle_discoveryData.advData[10] = 0xFE;     /* MSB - Eddystone Service */
-
-        cyBle_discoveryData.advData[11] = 0x10;     /* Signifies Eddystone URL */
-
-        cyBle_discoveryData.advData[12] = 0xF2;     /* Ranging data: -14dB*/
-
-        cyBle_discoveryData.advData[13] = 0x00;     /* URL scheme- http://www. */
-
-        cyBle_discoveryData.advData[14] = 0x63;     /* Encoded URL - 'c' */
-        cyBle_discoveryData.advData[15] = 0x79;     /* Encoded URL - 'y' */
-        cyBle_discoveryData.advData[16] = 0x70;     /* Encoded URL - 'p' */
-        cyBle_discoveryData.advData[17] = 0x72;     /* Encoded URL - 'r' */
-        cyBle_discoveryData.advData[18] = 0x65;     /* Encoded URL - 'e' */
-        cyBle_discoveryData.advData[19] = 0x73;     /* Encoded URL - 's' */
-        cyBle_discoveryData.advData[20] = 0x73;     /* Encoded URL - 's' */
-        cyBle_discoveryData.advData[21] = 0x00;     /* Expansion - .com */
-        
-        /* ADV packet length */
-        cyBle_discoveryData.advDataLen = 22;
-
-    #endif
-    }
-
-    else
+    if(advEvents != lastAdvEvent)
     {
-        /* ADV packet timeout */
-        cyBle_discoveryModeInfo.advTo = EDDYSTONE_TLM_TIMEOUT_SECONDS;
-        
-    #if (IS_EDDYSTONE_TLM_PRESENT)
-        
-        /* Telemetry packets */
-    
-        /* Service Data */
-        cyBle_discoveryData.advData[7] = 0x11;      /* Length */
-        cyBle_discoveryData.advData[8] = 0x16;      /* Service Data */
-        cyBle_discoveryData.advData[9] = 0xAA;      /* LSB - Eddystone Service */
-        cyBle_discoveryData.advData[10] = 0xFE;     /* MSB - Eddystone Service */
-
-        cyBle_discoveryData.advData[11] = 0x20;     /* Signifies Eddystone TLM */
-
-        cyBle_discoveryData.advData[12] = 0x00;     /* TLM version */
-        
-        /* Battery voltage in mV (1 mV per bit) */
-        cyBle_discoveryData.advData[13] = 0x00;     
-        cyBle_discoveryData.advData[14] = 0x00;     
-
-        /* Beacon temperature in Celsius (8.8 fixed point notation) */
-        cyBle_discoveryData.advData[15] = 0x80;     
-        cyBle_discoveryData.advData[16] = 0x00;     
-
-        /* Advertising PDU count since power-up or reboot */
-        cyBle_discoveryData.advData[17] = 0x00;     
-        cyBle_discoveryData.advData[18] = 0x00;     
-        cyBle_discoveryData.advData[19] = 0x00;     
-        cyBle_discoveryData.advData[20] = 0x00;     
-        
-        /* Time since power-on or reboot */
-        cyBle_discoveryData.advData[21] = 0x00;     
-        cyBle_discoveryData.advData[22] = 0x00;     
-        cyBle_discoveryData.advData[23] = 0x00;     
-        cyBle_discoveryData.advData[24] = 0x00;     
-        
-        
-        /* ADV packet length */
-        cyBle_discoveryData.advDataLen = 25;
-        
-    #endif /* #if (IS_EDDYSTONE_TLM_PRESENT) */
+        lastAdvEvent = advEvents;
+        ScheduleNextFrame(advEvents);
     }
 }
 
@@ -19,6 +19,6 @@
 #include "Configuration.h"
 
 extern void BLE_AppEventHandler(uint32 event, void* eventParam);
-extern void ConfigureAdvPacket(bool isPacketRegular);
+extern void EddystoneProcess(void);
 
 /* [] END OF FILE */
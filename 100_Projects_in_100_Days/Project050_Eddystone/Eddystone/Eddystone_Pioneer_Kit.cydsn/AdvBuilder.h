@@ -0,0 +1,144 @@
+/*******************************************************************************
+* File Name: AdvBuilder.h
+* 
+* Version 1.0
+*
+* Description:
+*  Macros which build advertising packets at compile time. Each macro expands
+*  to the comma separated bytes of a packet, to be used as the initializer of
+*  a constant array. AD structure lengths are counted by the compiler, so a
+*  packet image is complete once its array is defined and can be handed to
+*  the stack with a single copy.
+*
+*  static const uint8 image[] = { EDDYSTONE_URL_ADV(-14, EDDYSTONE_URL_HTTP_WWW,
+*                                 'c', 'y', 'p', 'r', 'e', 's', 's',
+*                                 EDDYSTONE_URL_COM_SLASH) };
+*  ADV_IMAGE_CHECK(image);
+*
+********************************************************************************
+* Copyright 2010-2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include <project.h>
+
+/* Number of bytes in a comma separated list */
+#define ADV_BYTES_LEN(...)                  (sizeof((const uint8[]){__VA_ARGS__}))
+
+/* Fails the build when an image does not fit into an ADV or SCAN_RSP packet,
+ * or does not have the expected length */
+#define ADV_IMAGE_CHECK(image)              typedef char image##_too_long[(sizeof(image) <= CYBLE_GAP_MAX_ADV_DATA_LEN) ? 1 : -1]
+#define ADV_IMAGE_CHECK_LEN(image, len)     typedef char image##_wrong_length[(sizeof(image) == (len)) ? 1 : -1]
+
+/* Multi-byte fields in big endian order, as used by the beacon formats */
+#define ADV_BE16(value)                     HI8(value), LO8(value)
+#define ADV_BE32(value)                     HI8(HI16(value)), LO8(HI16(value)), HI8(LO16(value)), LO8(LO16(value))
+
+
+/***************************************
+*        AD structures
+***************************************/
+#define ADV_TYPE_FLAGS                      (0x01u)
+#define ADV_TYPE_UUID16_COMPLETE            (0x03u)
+#define ADV_TYPE_SERVICE_DATA16             (0x16u)
+#define ADV_TYPE_MANUFACTURER               (0xFFu)
+
+/* LE General Discoverable, BR/EDR not supported */
+#define ADV_FLAGS_BEACON                    (0x06u)
+
+#define ADV_FLAGS_FIELD(flags)              0x02u, ADV_TYPE_FLAGS, (flags)
+#define ADV_UUID16_FIELD(uuid)              0x03u, ADV_TYPE_UUID16_COMPLETE, LO8(uuid), HI8(uuid)
+#define ADV_SERVICE_DATA16_FIELD(uuid, ...) (uint8)(3u + ADV_BYTES_LEN(__VA_ARGS__)), ADV_TYPE_SERVICE_DATA16, \
+                                            LO8(uuid), HI8(uuid), __VA_ARGS__
+#define ADV_MANUFACTURER_FIELD(company, ...) (uint8)(3u + ADV_BYTES_LEN(__VA_ARGS__)), ADV_TYPE_MANUFACTURER, \
+                                            LO8(company), HI8(company), __VA_ARGS__
+
+
+/***************************************
+*        Eddystone
+***************************************/
+#define EDDYSTONE_SERVICE_UUID              (0xFEAAu)
+
+#define EDDYSTONE_FRAME_UID                 (0x00u)
+#define EDDYSTONE_FRAME_URL                 (0x10u)
+#define EDDYSTONE_FRAME_TLM                 (0x20u)
+#define EDDYSTONE_FRAME_EID                 (0x30u)
+
+/* URL scheme prefixes */
+#define EDDYSTONE_URL_HTTP_WWW              (0x00u)     /* http://www. */
+#define EDDYSTONE_URL_HTTPS_WWW             (0x01u)     /* https://www. */
+#define EDDYSTONE_URL_HTTP                  (0x02u)     /* http:// */
+#define EDDYSTONE_URL_HTTPS                 (0x03u)     /* https:// */
+
+/* URL expansion codes, each replaces the text within the encoded URL */
+#define EDDYSTONE_URL_COM_SLASH             (0x00u)     /* .com/ */
+#define EDDYSTONE_URL_ORG_SLASH             (0x01u)     /* .org/ */
+#define EDDYSTONE_URL_EDU_SLASH             (0x02u)     /* .edu/ */
+#define EDDYSTONE_URL_NET_SLASH             (0x03u)     /* .net/ */
+#define EDDYSTONE_URL_INFO_SLASH            (0x04u)     /* .info/ */
+#define EDDYSTONE_URL_BIZ_SLASH             (0x05u)     /* .biz/ */
+#define EDDYSTONE_URL_GOV_SLASH             (0x06u)     /* .gov/ */
+#define EDDYSTONE_URL_COM                   (0x07u)     /* .com */
+#define EDDYSTONE_URL_ORG                   (0x08u)     /* .org */
+#define EDDYSTONE_URL_EDU                   (0x09u)     /* .edu */
+#define EDDYSTONE_URL_NET                   (0x0Au)     /* .net */
+#define EDDYSTONE_URL_INFO                  (0x0Bu)     /* .info */
+#define EDDYSTONE_URL_BIZ                   (0x0Cu)     /* .biz */
+#define EDDYSTONE_URL_GOV                   (0x0Du)     /* .gov */
+
+/* Flags, service UUID list and the Eddystone service data holding the frame */
+#define EDDYSTONE_ADV(...)                  ADV_FLAGS_FIELD(ADV_FLAGS_BEACON), \
+                                            ADV_UUID16_FIELD(EDDYSTONE_SERVICE_UUID), \
+                                            ADV_SERVICE_DATA16_FIELD(EDDYSTONE_SERVICE_UUID, __VA_ARGS__)
+
+/* UID frame: TX power at 0 m, then the 10 byte namespace and 6 byte instance */
+#define EDDYSTONE_UID_ADV(txPower, ...)     EDDYSTONE_ADV(EDDYSTONE_FRAME_UID, (uint8)(txPower), __VA_ARGS__, \
+                                            0x00u, 0x00u)
+#define EDDYSTONE_UID_ADV_LEN               (31u)
+
+/* URL frame: TX power at 0 m, scheme prefix, then up to 17 bytes of encoded URL */
+#define EDDYSTONE_URL_ADV(txPower, scheme, ...) EDDYSTONE_ADV(EDDYSTONE_FRAME_URL, (uint8)(txPower), (scheme), \
+                                            __VA_ARGS__)
+#define EDDYSTONE_URL_MAX_LEN               (17u)
+
+/* Unencrypted TLM frame: battery in mV, temperature in 8.8 fixed point
+ * degrees Celsius, advertising PDU count and time since power-up in 0.1 s */
+#define EDDYSTONE_TLM_ADV(vbatt, temp, advCount, secCount) EDDYSTONE_ADV(EDDYSTONE_FRAME_TLM, 0x00u, \
+                                            ADV_BE16(vbatt), ADV_BE16(temp), ADV_BE32(advCount), ADV_BE32(secCount))
+#define EDDYSTONE_TLM_ADV_LEN               (25u)
+#define EDDYSTONE_TLM_VBATT_NOT_MEASURED    (0x0000u)
+#define EDDYSTONE_TLM_TEMP_NOT_SUPPORTED    (0x8000u)
+
+/* Offsets of the TLM fields in the image, for the values updated at run-time */
+#define EDDYSTONE_TLM_VBATT_OFFSET          (13u)
+#define EDDYSTONE_TLM_TEMP_OFFSET           (15u)
+#define EDDYSTONE_TLM_ADV_CNT_OFFSET        (17u)
+#define EDDYSTONE_TLM_SEC_CNT_OFFSET        (21u)
+
+/* EID frame: TX power at 0 m, then the 8 byte ephemeral identifier */
+#define EDDYSTONE_EID_ADV(txPower, ...)     EDDYSTONE_ADV(EDDYSTONE_FRAME_EID, (uint8)(txPower), __VA_ARGS__)
+#define EDDYSTONE_EID_ADV_LEN               (21u)
+#define EDDYSTONE_EID_OFFSET                (13u)
+#define EDDYSTONE_EID_LEN                   (8u)
+#define EDDYSTONE_EID_KEY_LEN               (16u)
+
+
+/***************************************
+*        iBeacon and AltBeacon
+***************************************/
+#define IBEACON_COMPANY_ID                  (0x004Cu)
+
+/* iBeacon: major, minor, measured power at 1 m, then the 16 byte proximity UUID */
+#define IBEACON_ADV(major, minor, txPower, ...) ADV_FLAGS_FIELD(ADV_FLAGS_BEACON), \
+                                            ADV_MANUFACTURER_FIELD(IBEACON_COMPANY_ID, 0x02u, 0x15u, __VA_ARGS__, \
+                                            ADV_BE16(major), ADV_BE16(minor), (uint8)(txPower))
+#define IBEACON_ADV_LEN                     (30u)
+
+/* AltBeacon: company ID, reference RSSI at 1 m, reserved byte, then the 20 byte beacon ID */
+#define ALTBEACON_ADV(company, refRssi, reserved, ...) ADV_FLAGS_FIELD(ADV_FLAGS_BEACON), \
+                                            ADV_MANUFACTURER_FIELD(company, 0xBEu, 0xACu, __VA_ARGS__, \
+                                            (uint8)(refRssi), (reserved))
+#define ALTBEACON_ADV_LEN                   (31u)
+
+/* [] END OF FILE */
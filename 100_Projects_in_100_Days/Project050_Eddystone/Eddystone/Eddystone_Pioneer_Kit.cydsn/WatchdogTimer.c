@@ -45,6 +45,10 @@
 
 volatile uint8 initCounter = 0;
 
+/* Upper 32 bits of the uptime, counted when a read finds counter 2 wrapped */
+static uint32 uptimeHigh = 0;
+static uint32 uptimeLast = 0;
+
 /*******************************************************************************
 * Function Name: WDT_Handler
 ********************************************************************************
@@ -181,4 +185,101 @@ void WDT_DisableWcoEcoCounters(void)
     CySysWdtLock();
 }
 
+/*******************************************************************************
+* Function Name: WDT_EnableUptimeCounter
+********************************************************************************
+*
+* Summary:
+*  Starts WDT counter 2 as a free running counter of the WCO, without 
+*  interrupt, so keeping the uptime costs no wakeup. Called once LFCLK is 
+*  driven by the WCO
+*
+* Parameters:  
+*  None
+*
+* Return: 
+*  None
+*******************************************************************************/
+void WDT_EnableUptimeCounter(void)
+{
+    CySysWdtUnlock();
+    
+    CySysWdtWriteMode(UPTIME_COUNTER, CY_SYS_WDT_MODE_NONE);
+    CySysWdtEnable(CY_SYS_WDT_COUNTER2_MASK);
+    
+    CySysWdtLock();
+}
+
+/*******************************************************************************
+* Function Name: WDT_ReadUptime
+********************************************************************************
+*
+* Summary:
+*  Reads the 32-bit counter 2 and extends it to 64 bits. Counter 2 wraps 
+*  every 36 hours, so the uptime must be read at least that often; the TLM 
+*  and EID frames read it every few seconds
+*
+* Parameters:  
+*  high: receives the upper 32 bits of the count
+*
+* Return: 
+*  The lower 32 bits of the count
+*******************************************************************************/
+static uint32 WDT_ReadUptime(uint32 *high)
+{
+    uint32 count = CySysWdtReadCount(UPTIME_COUNTER);
+    
+    if(count < uptimeLast)
+    {
+        uptimeHigh++;
+    }
+    uptimeLast = count;
+    *high = uptimeHigh;
+    
+    return count;
+}
+
+/*******************************************************************************
+* Function Name: WDT_GetUptimeSeconds
+********************************************************************************
+*
+* Summary:
+*  Returns the time since the uptime counter was started
+*
+* Parameters:  
+*  None
+*
+* Return: 
+*  Uptime in seconds
+*******************************************************************************/
+uint32 WDT_GetUptimeSeconds(void)
+{
+    uint32 high;
+    uint32 low = WDT_ReadUptime(&high);
+    
+    return (high << (32u - UPTIME_COUNT_SHIFT)) + (low >> UPTIME_COUNT_SHIFT);
+}
+
+/*******************************************************************************
+* Function Name: WDT_GetUptimeDeciseconds
+********************************************************************************
+*
+* Summary:
+*  Returns the time since the uptime counter was started
+*
+* Parameters:  
+*  None
+*
+* Return: 
+*  Uptime in units of 0.1 s
+*******************************************************************************/
+uint32 WDT_GetUptimeDeciseconds(void)
+{
+    uint32 high;
+    uint32 low = WDT_ReadUptime(&high);
+    
+    return (high * ((1uL << (32u - UPTIME_COUNT_SHIFT)) * 10u)) + ((low >> UPTIME_COUNT_SHIFT) * 10u) +
+           (((low & ((1uL << UPTIME_COUNT_SHIFT) - 1u)) * 10u) >> UPTIME_COUNT_SHIFT);
+}
+
 /* [] END OF FILE */
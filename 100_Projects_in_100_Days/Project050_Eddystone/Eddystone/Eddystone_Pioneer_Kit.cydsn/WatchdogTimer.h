@@ -53,6 +53,8 @@
 #define WDT_INTERRUPT_SOURCE                        CY_SYS_WDT_COUNTER0_INT
 #define ECO_INTERRUPT_SOURCE                        CY_SYS_WDT_COUNTER1_INT
 #define COUNTER_ENABLE                              (1u)
+#define UPTIME_COUNTER                              (2u)     /* Free running, no interrupt */
+#define UPTIME_COUNT_SHIFT                          (15u)    /* 2^15 WCO counts per second */
 
 /***************************************
 *    Function declarations
@@ -61,6 +63,9 @@ void WDT_WcoEcoLpStartSetup(void);
 void WDT_EnableWcoCounter(void);
 void WDT_EnableEcoCounter(void);
 void WDT_DisableWcoEcoCounters(void);
+void WDT_EnableUptimeCounter(void);
+uint32 WDT_GetUptimeSeconds(void);
+uint32 WDT_GetUptimeDeciseconds(void);
 
 extern volatile uint8 initCounter;
 
@@ -0,0 +1,492 @@
+/*******************************************************************************
+* File Name: adv_payload.c
+*
+* Version: 1.0
+*
+* Description:
+*  This file updates the ADV and SCAN_RSP data between advertising events.
+*  The application writes into back images, only the bytes which changed are
+*  marked dirty. When an advertising event closes, the dirty bytes are copied
+*  into the data of the stack and passed to the link layer in one update.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <project.h>
+#include <string.h>
+#include "adv_payload.h"
+
+/* Back images written by the application, and their lengths */
+static uint8 backImage[ADV_PAYLOAD_PACKETS][CYBLE_GAP_MAX_ADV_DATA_LEN];
+static uint8 backLength[ADV_PAYLOAD_PACKETS];
+
+/* Dirty range of each back image, dirtyFirst == dirtyEnd when clean */
+static uint8 dirtyFirst[ADV_PAYLOAD_PACKETS];
+static uint8 dirtyEnd[ADV_PAYLOAD_PACKETS];
+static bool lengthDirty[ADV_PAYLOAD_PACKETS];
+
+/* Advertising events closed, counted in the BLESS interrupt, and the count
+ * already handled by AdvPayloadProcess() */
+static volatile uint32 advEventCount = 0u;
+static uint32 processedEvents = 0u;
+
+/* Advertising event of the first write since the last update */
+static bool pending = false;
+static uint32 pendingSince = 0u;
+
+static ADV_PAYLOAD_STATS_T stats;
+
+#if (ADV_PAYLOAD_BLESS_CALLBACK == 0u)
+static CYBLE_BLESS_STATE_T lastBlessState = CYBLE_BLESS_STATE_ACTIVE;
+#endif
+
+
+/*******************************************************************************
+* Function Name: FrontImage()
+********************************************************************************
+* Summary:
+* Returns the data of a packet as used by the stack.
+*
+* Parameters:
+* uint8 packet: ADV_PAYLOAD_ADV or ADV_PAYLOAD_SCAN_RSP
+* uint8 **length: receives the length field of the packet
+*
+* Return:
+* uint8 *: the packet data, NULL if the packet is not configured
+*
+*******************************************************************************/
+static uint8 *FrontImage(uint8 packet, uint8 **length)
+{
+    if(packet == ADV_PAYLOAD_ADV)
+    {
+        if(cyBle_discoveryModeInfo.advData != NULL)
+        {
+            *length = &cyBle_discoveryModeInfo.advData->advDataLen;
+            return cyBle_discoveryModeInfo.advData->advData;
+        }
+    }
+    else
+    {
+        if(cyBle_discoveryModeInfo.scanRspData != NULL)
+        {
+            *length = &cyBle_discoveryModeInfo.scanRspData->scanRspDataLen;
+            return cyBle_discoveryModeInfo.scanRspData->scanRspData;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*******************************************************************************
+* Function Name: MarkPending()
+********************************************************************************
+* Summary:
+* Records the advertising event of the first change since the last update.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void MarkPending(void)
+{
+    if(!pending)
+    {
+        pending = true;
+        pendingSince = advEventCount;
+    }
+}
+
+
+#if (ADV_PAYLOAD_BLESS_CALLBACK != 0u)
+/*******************************************************************************
+* Function Name: AdvEventClose()
+********************************************************************************
+* Summary:
+* BLESS interrupt callback, called in interrupt context at the end of each
+* advertising event. Only counts the event, the update is made by
+* AdvPayloadProcess() on the wake-up which follows.
+*
+* Parameters:
+* uint32 event: the BLESS interrupt
+* void *eventParam: not used
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void AdvEventClose(uint32 event, void *eventParam)
+{
+    (void)event;
+    (void)eventParam;
+
+    advEventCount++;
+}
+#endif
+
+
+#if (ADV_PAYLOAD_BLESS_CALLBACK == 0u)
+/*******************************************************************************
+* Function Name: PollBlessState()
+********************************************************************************
+* Summary:
+* Counts the end of an advertising event when the BLESS state enters
+* EVENT_CLOSE. Used when the BLESS interrupt callback is not available, and
+* called from both AdvPayloadEventCount() and AdvPayloadProcess(), so that a
+* frame written after the application has seen the end of an event is
+* taken over by the AdvPayloadProcess() call of the same main loop pass.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+static void PollBlessState(void)
+{
+    CYBLE_BLESS_STATE_T blessState = CyBle_GetBleSsState();
+
+    if((CyBle_GetState() == CYBLE_STATE_ADVERTISING) &&
+       (blessState == CYBLE_BLESS_STATE_EVENT_CLOSE) && (lastBlessState != CYBLE_BLESS_STATE_EVENT_CLOSE))
+    {
+        advEventCount++;
+    }
+    lastBlessState = blessState;
+}
+#endif
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadInit()
+********************************************************************************
+* Summary:
+* Takes over the ADV and SCAN_RSP data of the stack as back images and
+* registers for the end of the advertising events. Called after the stack is
+* on, before advertising starts.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void AdvPayloadInit(void)
+{
+    uint8 *front;
+    uint8 *length;
+    uint8 packet;
+
+    for(packet = 0u; packet < ADV_PAYLOAD_PACKETS; packet++)
+    {
+        front = FrontImage(packet, &length);
+        if(front != NULL)
+        {
+            backLength[packet] = *length;
+            memcpy(backImage[packet], front, CYBLE_GAP_MAX_ADV_DATA_LEN);
+        }
+        else
+        {
+            backLength[packet] = 0u;
+            memset(backImage[packet], 0, CYBLE_GAP_MAX_ADV_DATA_LEN);
+        }
+        dirtyFirst[packet] = 0u;
+        dirtyEnd[packet] = 0u;
+        lengthDirty[packet] = false;
+    }
+    pending = false;
+    processedEvents = advEventCount;
+
+#if (ADV_PAYLOAD_BLESS_CALLBACK != 0u)
+    CyBle_RegisterBlessInterruptCallback(CYBLE_ISR_BLESS_ADV_CLOSE, AdvEventClose);
+#endif
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadWrite()
+********************************************************************************
+* Summary:
+* Writes a field into a back image. Bytes equal to the current ones are not
+* marked dirty, so writing an unchanged field causes no update.
+*
+* Parameters:
+* uint8 packet: ADV_PAYLOAD_ADV or ADV_PAYLOAD_SCAN_RSP
+* uint8 offset: offset of the field in the packet
+* const uint8 *data: the field value
+* uint8 length: length of the field
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void AdvPayloadWrite(uint8 packet, uint8 offset, const uint8 *data, uint8 length)
+{
+    uint8 i;
+
+    if((packet >= ADV_PAYLOAD_PACKETS) || (offset > CYBLE_GAP_MAX_ADV_DATA_LEN) ||
+       (length > (CYBLE_GAP_MAX_ADV_DATA_LEN - offset)))
+    {
+        return;
+    }
+
+    for(i = offset; i < (offset + length); i++)
+    {
+        if(backImage[packet][i] != data[i - offset])
+        {
+            backImage[packet][i] = data[i - offset];
+
+            if(dirtyFirst[packet] == dirtyEnd[packet])
+            {
+                dirtyFirst[packet] = i;
+                dirtyEnd[packet] = i + 1u;
+            }
+            else if(i < dirtyFirst[packet])
+            {
+                dirtyFirst[packet] = i;
+            }
+            else if(i >= dirtyEnd[packet])
+            {
+                dirtyEnd[packet] = i + 1u;
+            }
+            else
+            {
+                /* Already in the dirty range */
+            }
+            MarkPending();
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadWriteByte()
+********************************************************************************
+* Summary:
+* Writes a single byte field into a back image.
+*
+* Parameters:
+* uint8 packet: ADV_PAYLOAD_ADV or ADV_PAYLOAD_SCAN_RSP
+* uint8 offset: offset of the byte in the packet
+* uint8 value: the new value
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void AdvPayloadWriteByte(uint8 packet, uint8 offset, uint8 value)
+{
+    AdvPayloadWrite(packet, offset, &value, 1u);
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadSetLength()
+********************************************************************************
+* Summary:
+* Sets the length of a packet, for payloads whose layout changes.
+*
+* Parameters:
+* uint8 packet: ADV_PAYLOAD_ADV or ADV_PAYLOAD_SCAN_RSP
+* uint8 length: the new length
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void AdvPayloadSetLength(uint8 packet, uint8 length)
+{
+    if((packet < ADV_PAYLOAD_PACKETS) && (length <= CYBLE_GAP_MAX_ADV_DATA_LEN) &&
+       (length != backLength[packet]))
+    {
+        backLength[packet] = length;
+        lengthDirty[packet] = true;
+        MarkPending();
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadIsPending()
+********************************************************************************
+* Summary:
+* Tells whether written changes wait for the end of an advertising event.
+*
+* Parameters:
+* None
+*
+* Return:
+* bool: true if an update is pending
+*
+*******************************************************************************/
+bool AdvPayloadIsPending(void)
+{
+    return pending;
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadEventCount()
+********************************************************************************
+* Summary:
+* Returns the number of advertising events closed since power-up. The
+* application compares it with an earlier value to act once per event.
+*
+* Parameters:
+* None
+*
+* Return:
+* uint32: the advertising event count
+*
+*******************************************************************************/
+uint32 AdvPayloadEventCount(void)
+{
+#if (ADV_PAYLOAD_BLESS_CALLBACK == 0u)
+    PollBlessState();
+#endif
+
+    return advEventCount;
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadProcess()
+********************************************************************************
+* Summary:
+* Passes the pending changes to the stack. Called from the main loop after
+* the application has written its fields.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+* Theory:
+* While advertising, the changes are only taken over when an advertising
+* event has closed since the last call, so the link layer never sends a
+* packet which is half old and half new. The dirty ranges are copied into the
+* data of the stack and CyBle_GapUpdateAdvData() is called once for both
+* packets. While not advertising, the changes are copied directly, the stack
+* sends them when advertising starts.
+*
+*******************************************************************************/
+void AdvPayloadProcess(void)
+{
+    uint32 events;
+    uint8 *front;
+    uint8 *length;
+    uint8 packet;
+    uint8 advLength;
+
+#if (ADV_PAYLOAD_BLESS_CALLBACK == 0u)
+    PollBlessState();
+#endif
+
+    events = advEventCount - processedEvents;
+    processedEvents += events;
+    if(events != 0u)
+    {
+        advLength = (cyBle_discoveryModeInfo.advData != NULL) ? cyBle_discoveryModeInfo.advData->advDataLen : 0u;
+        stats.airTimeUs += events * ADV_PAYLOAD_CHANNELS *
+                           ((ADV_PAYLOAD_PDU_OVERHEAD + advLength) * ADV_PAYLOAD_US_PER_BYTE);
+    }
+
+    if(!pending)
+    {
+        return;
+    }
+
+    if((CyBle_GetState() == CYBLE_STATE_ADVERTISING) && (events == 0u))
+    {
+        /* Wait for the end of the advertising event */
+        return;
+    }
+
+    for(packet = 0u; packet < ADV_PAYLOAD_PACKETS; packet++)
+    {
+        front = FrontImage(packet, &length);
+        if(front == NULL)
+        {
+            continue;
+        }
+        if(dirtyFirst[packet] != dirtyEnd[packet])
+        {
+            memcpy(&front[dirtyFirst[packet]], &backImage[packet][dirtyFirst[packet]],
+                   dirtyEnd[packet] - dirtyFirst[packet]);
+            stats.bytesCopied += dirtyEnd[packet] - dirtyFirst[packet];
+        }
+        if(lengthDirty[packet])
+        {
+            *length = backLength[packet];
+        }
+        dirtyFirst[packet] = 0u;
+        dirtyEnd[packet] = 0u;
+        lengthDirty[packet] = false;
+    }
+
+    if(CyBle_GetState() == CYBLE_STATE_ADVERTISING)
+    {
+        (void)CyBle_GapUpdateAdvData(cyBle_discoveryModeInfo.advData, cyBle_discoveryModeInfo.scanRspData);
+    }
+
+    events = advEventCount - pendingSince;
+    stats.updates++;
+    stats.latencyEvents += events;
+    if(events > stats.maxLatencyEvents)
+    {
+        stats.maxLatencyEvents = events;
+    }
+    pending = false;
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadCountWakeup()
+********************************************************************************
+* Summary:
+* Counts one CPU wake-up. Called by the low power code of the application
+* right after CySysPmSleep() or CySysPmDeepSleep() returns, so wakeups /
+* updates of the statistics gives the wake-ups spent per payload update.
+*
+* Parameters:
+* None
+*
+* Return:
+* None
+*
+*******************************************************************************/
+void AdvPayloadCountWakeup(void)
+{
+    stats.wakeups++;
+}
+
+
+/*******************************************************************************
+* Function Name: AdvPayloadGetStats()
+********************************************************************************
+* Summary:
+* Returns the cost of the updates so far, to compare the update patterns.
+*
+* Parameters:
+* None
+*
+* Return:
+* const ADV_PAYLOAD_STATS_T *: the statistics
+*
+*******************************************************************************/
+const ADV_PAYLOAD_STATS_T *AdvPayloadGetStats(void)
+{
+    stats.advEvents = advEventCount;
+
+    return &stats;
+}
+/* [] END OF FILE */
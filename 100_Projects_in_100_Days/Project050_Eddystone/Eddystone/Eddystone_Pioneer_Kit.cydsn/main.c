@@ -19,6 +19,7 @@
 #include "Configuration.h"
 #include "WatchdogTimer.h"
 #include "Eddystone.h"
+#include "adv_payload.h"
 
 void WCO_ECO_LowPowerStart(void)
 {
@@ -33,6 +34,7 @@ void WCO_ECO_LowPowerStart(void)
     (void)CySysClkWcoSetPowerMode(CY_SYS_CLK_WCO_LPM);      /* Switch WCO to the low power mode after startup */
     CySysClkSetLfclkSource(CY_SYS_CLK_LFCLK_SRC_WCO);       /* LFCLK is now driven by WCO */
     CySysClkIloStop();                                      /* WCO is running, shut down the ILO */
+    WDT_EnableUptimeCounter();                              /* Free running counter 2 keeps the uptime */
 
     (void)CySysClkEcoStart(0);  /* It's time to start ECO */
 
@@ -91,6 +93,7 @@ void LowPower(void)
                 if(blessState == CYBLE_BLESS_STATE_ECO_ON || blessState == CYBLE_BLESS_STATE_DEEPSLEEP)
                 {
                     CySysPmDeepSleep(); /* System Deep-Sleep. 1.3uA mode */
+                    AdvPayloadCountWakeup();
                 }
             }
             else if (blessState != CYBLE_BLESS_STATE_EVENT_CLOSE)
@@ -103,6 +106,7 @@ void LowPower(void)
                 
                 /* Put the CPU to Sleep. 1.1mA mode */
                 CySysPmSleep();
+                AdvPayloadCountWakeup();
                 
                 /* Starts execution after waking up, start IMO */
                 CySysClkImoStart();
@@ -139,6 +143,9 @@ int main()
         
         CyBle_ProcessEvents(); /* BLE stack processing state machine interface */
         
+        EddystoneProcess();    /* Load the next frame after each advertising event */
+        AdvPayloadProcess();   /* Pass the changed bytes to the stack */
+        
         LowPower();
     }
 }
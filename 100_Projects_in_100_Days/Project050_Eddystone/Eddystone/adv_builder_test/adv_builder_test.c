@@ -0,0 +1,248 @@
+/*******************************************************************************
+* File Name: adv_builder_test.c
+*
+* Description:
+*  Host test of AdvBuilder.h. Every packet built by the macros is compared
+*  byte for byte with the packet written out by hand from its specification:
+*   - Eddystone UID, URL, TLM and EID frames (github.com/google/eddystone,
+*     Flags and Complete List of 16-bit UUIDs with 0xFEAA, then the frame in
+*     the 0xFEAA Service Data)
+*   - iBeacon (Apple Proximity Beacon Specification, Flags then Apple
+*     manufacturer data 0x02 0x15, UUID, major, minor, measured power)
+*   - AltBeacon (AltBeacon Protocol Specification, Flags then manufacturer
+*     data with beacon code 0xBEAC, 20 byte ID, reference RSSI, reserved)
+*  The images of Configuration.h, as built by Eddystone.c, are checked too.
+*
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <project.h>
+#include "AdvBuilder.h"
+#include "Configuration.h"
+
+static int failures = 0;
+
+static void Check(const char *name, const uint8 *image, size_t length,
+                  const uint8 *expected, size_t expectedLength)
+{
+    size_t i;
+
+    if(length != expectedLength)
+    {
+        printf("FAIL %s: %zu bytes, expected %zu\n", name, length, expectedLength);
+        failures++;
+        return;
+    }
+    for(i = 0; i < length; i++)
+    {
+        if(image[i] != expected[i])
+        {
+            printf("FAIL %s: byte %zu is 0x%02X, expected 0x%02X\n", name, i, image[i], expected[i]);
+            failures++;
+            return;
+        }
+    }
+    if(length > CYBLE_GAP_MAX_ADV_DATA_LEN)
+    {
+        printf("FAIL %s: %zu bytes do not fit into an ADV packet\n", name, length);
+        failures++;
+        return;
+    }
+    printf("ok   %s (%zu bytes)\n", name, length);
+}
+
+#define CHECK(name, image, expected) \
+    Check((name), (image), sizeof(image), (expected), sizeof(expected))
+
+/* AD structures in front of every Eddystone frame */
+#define SPEC_FLAGS              0x02, 0x01, 0x06
+#define SPEC_EDDYSTONE_UUIDS    0x03, 0x03, 0xAA, 0xFE
+
+
+/* Eddystone UID, TX power -18 dBm */
+static const uint8 uidImage[] = { EDDYSTONE_UID_ADV(-18,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F) };
+ADV_IMAGE_CHECK_LEN(uidImage, EDDYSTONE_UID_ADV_LEN);
+static const uint8 uidSpec[] =
+{
+    SPEC_FLAGS, SPEC_EDDYSTONE_UUIDS,
+    0x17, 0x16, 0xAA, 0xFE,
+    0x00,                                               /* Frame type UID */
+    0xEE,                                               /* -18 dBm */
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,     /* Namespace */
+    0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,                 /* Instance */
+    0x00, 0x00                                          /* RFU */
+};
+
+/* Eddystone URL, https://goo.gl/S6zT6P at TX power +4 dBm */
+static const uint8 urlImage[] = { EDDYSTONE_URL_ADV(4, EDDYSTONE_URL_HTTPS,
+    'g', 'o', 'o', '.', 'g', 'l', '/', 'S', '6', 'z', 'T', '6', 'P') };
+ADV_IMAGE_CHECK(urlImage);
+static const uint8 urlSpec[] =
+{
+    SPEC_FLAGS, SPEC_EDDYSTONE_UUIDS,
+    0x13, 0x16, 0xAA, 0xFE,
+    0x10,                                               /* Frame type URL */
+    0x04,                                               /* +4 dBm */
+    0x03,                                               /* https:// */
+    'g', 'o', 'o', '.', 'g', 'l', '/', 'S', '6', 'z', 'T', '6', 'P'
+};
+
+/* Eddystone URL with the longest encoded URL, 17 bytes */
+static const uint8 urlLongImage[] = { EDDYSTONE_URL_ADV(-20, EDDYSTONE_URL_HTTP_WWW,
+    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
+    EDDYSTONE_URL_ORG_SLASH) };
+ADV_IMAGE_CHECK(urlLongImage);
+static const uint8 urlLongSpec[] =
+{
+    SPEC_FLAGS, SPEC_EDDYSTONE_UUIDS,
+    0x17, 0x16, 0xAA, 0xFE,
+    0x10, 0xEC, 0x00,
+    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
+    0x01                                                /* .org/ */
+};
+
+/* Eddystone TLM, 3000 mV, 25.5 degrees Celsius, 0x01020304 PDUs, 0x0A0B0C0D x 0.1 s */
+static const uint8 tlmImage[] = { EDDYSTONE_TLM_ADV(3000u, 0x1980u, 0x01020304u, 0x0A0B0C0Du) };
+ADV_IMAGE_CHECK_LEN(tlmImage, EDDYSTONE_TLM_ADV_LEN);
+static const uint8 tlmSpec[] =
+{
+    SPEC_FLAGS, SPEC_EDDYSTONE_UUIDS,
+    0x11, 0x16, 0xAA, 0xFE,
+    0x20,                                               /* Frame type TLM */
+    0x00,                                               /* Unencrypted, version 0 */
+    0x0B, 0xB8,                                         /* VBATT */
+    0x19, 0x80,                                         /* TEMP */
+    0x01, 0x02, 0x03, 0x04,                             /* ADV_CNT */
+    0x0A, 0x0B, 0x0C, 0x0D                              /* SEC_CNT */
+};
+
+/* Eddystone EID, TX power -8 dBm */
+static const uint8 eidImage[] = { EDDYSTONE_EID_ADV(-8,
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88) };
+ADV_IMAGE_CHECK_LEN(eidImage, EDDYSTONE_EID_ADV_LEN);
+static const uint8 eidSpec[] =
+{
+    SPEC_FLAGS, SPEC_EDDYSTONE_UUIDS,
+    0x0D, 0x16, 0xAA, 0xFE,
+    0x30,                                               /* Frame type EID */
+    0xF8,                                               /* -8 dBm */
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88
+};
+
+/* iBeacon, UUID E2C56DB5-DFFB-48D2-B060-D0F5A71096E0, major 1, minor 2, -59 dBm */
+static const uint8 ibeaconImage[] = { IBEACON_ADV(0x0001u, 0x0002u, -59,
+    0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2,
+    0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0) };
+ADV_IMAGE_CHECK_LEN(ibeaconImage, IBEACON_ADV_LEN);
+static const uint8 ibeaconSpec[] =
+{
+    SPEC_FLAGS,
+    0x1A, 0xFF, 0x4C, 0x00,                             /* Apple */
+    0x02, 0x15,                                         /* iBeacon, 21 bytes */
+    0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2,
+    0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0,
+    0x00, 0x01,                                         /* Major */
+    0x00, 0x02,                                         /* Minor */
+    0xC5                                                /* Measured power */
+};
+
+/* AltBeacon of company 0x0131 (Cypress), reference RSSI -59 dBm */
+static const uint8 altbeaconImage[] = { ALTBEACON_ADV(0x0131u, -59, 0x00u,
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+    0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14) };
+ADV_IMAGE_CHECK_LEN(altbeaconImage, ALTBEACON_ADV_LEN);
+static const uint8 altbeaconSpec[] =
+{
+    SPEC_FLAGS,
+    0x1B, 0xFF, 0x31, 0x01,                             /* Manufacturer ID, little endian */
+    0xBE, 0xAC,                                         /* Beacon code */
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+    0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14,
+    0xC5,                                               /* Reference RSSI */
+    0x00                                                /* Reserved */
+};
+
+/* The images of the project, built as in Eddystone.c */
+static const uint8 projectUidImage[] = { EDDYSTONE_UID_ADV(EDDYSTONE_TX_POWER, EDDYSTONE_NAMESPACE_ID,
+                                                           EDDYSTONE_INSTANCE_ID) };
+ADV_IMAGE_CHECK_LEN(projectUidImage, EDDYSTONE_UID_ADV_LEN);
+static const uint8 projectUrlImage[] = { EDDYSTONE_URL_ADV(EDDYSTONE_TX_POWER, EDDYSTONE_URL_SCHEME,
+                                                           EDDYSTONE_ENCODED_URL) };
+ADV_IMAGE_CHECK(projectUrlImage);
+static const uint8 projectIds[] = { EDDYSTONE_NAMESPACE_ID, EDDYSTONE_INSTANCE_ID };
+static const uint8 projectUrl[] = { EDDYSTONE_ENCODED_URL };
+
+/* Checks the project images field by field against the configuration */
+static void CheckProjectImages(void)
+{
+    uint8 expected[CYBLE_GAP_MAX_ADV_DATA_LEN];
+    const uint8 header[] = { SPEC_FLAGS, SPEC_EDDYSTONE_UUIDS };
+    size_t length;
+
+    memcpy(expected, header, sizeof(header));
+    length = sizeof(header);
+    expected[length++] = 0x17u;
+    expected[length++] = 0x16u;
+    expected[length++] = 0xAAu;
+    expected[length++] = 0xFEu;
+    expected[length++] = 0x00u;
+    expected[length++] = (uint8)EDDYSTONE_TX_POWER;
+    memcpy(&expected[length], projectIds, sizeof(projectIds));
+    length += sizeof(projectIds);
+    expected[length++] = 0x00u;
+    expected[length++] = 0x00u;
+    Check("project UID", projectUidImage, sizeof(projectUidImage), expected, length);
+
+    length = sizeof(header);
+    expected[length++] = (uint8)(6u + sizeof(projectUrl));
+    expected[length++] = 0x16u;
+    expected[length++] = 0xAAu;
+    expected[length++] = 0xFEu;
+    expected[length++] = 0x10u;
+    expected[length++] = (uint8)EDDYSTONE_TX_POWER;
+    expected[length++] = EDDYSTONE_URL_SCHEME;
+    memcpy(&expected[length], projectUrl, sizeof(projectUrl));
+    length += sizeof(projectUrl);
+    Check("project URL", projectUrlImage, sizeof(projectUrlImage), expected, length);
+
+    if(sizeof(projectUrl) > EDDYSTONE_URL_MAX_LEN)
+    {
+        printf("FAIL project URL: %zu encoded bytes, at most %u\n", sizeof(projectUrl), EDDYSTONE_URL_MAX_LEN);
+        failures++;
+    }
+}
+
+/* The TLM offsets used by Eddystone.c to update the frame in place */
+static void CheckTlmOffsets(void)
+{
+    if((tlmImage[EDDYSTONE_TLM_VBATT_OFFSET] != 0x0Bu) ||
+       (tlmImage[EDDYSTONE_TLM_TEMP_OFFSET] != 0x19u) ||
+       (tlmImage[EDDYSTONE_TLM_ADV_CNT_OFFSET] != 0x01u) ||
+       (tlmImage[EDDYSTONE_TLM_SEC_CNT_OFFSET] != 0x0Au) ||
+       (eidImage[EDDYSTONE_EID_OFFSET] != 0x11u) ||
+       ((EDDYSTONE_EID_OFFSET + EDDYSTONE_EID_LEN) != sizeof(eidImage)))
+    {
+        printf("FAIL TLM/EID field offsets\n");
+        failures++;
+        return;
+    }
+    printf("ok   TLM/EID field offsets\n");
+}
+
+int main(void)
+{
+    CHECK("Eddystone UID", uidImage, uidSpec);
+    CHECK("Eddystone URL", urlImage, urlSpec);
+    CHECK("Eddystone URL, 17 bytes", urlLongImage, urlLongSpec);
+    CHECK("Eddystone TLM", tlmImage, tlmSpec);
+    CHECK("Eddystone EID", eidImage, eidSpec);
+    CHECK("iBeacon", ibeaconImage, ibeaconSpec);
+    CHECK("AltBeacon", altbeaconImage, altbeaconSpec);
+    CheckTlmOffsets();
+    CheckProjectImages();
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+    return (failures != 0) ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+/* Host stand-in for the PSoC Creator project.h, only what AdvBuilder.h uses */
+#if !defined(PROJECT_H)
+#define PROJECT_H
+
+#include <stdint.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+
+#define LO8(x)                      ((uint8) ((x) & 0xFFu))
+#define HI8(x)                      ((uint8) ((uint16)(x) >> 8))
+#define LO16(x)                     ((uint16) ((x) & 0xFFFFu))
+#define HI16(x)                     ((uint16) ((uint32)(x) >> 16))
+
+#define CYBLE_GAP_MAX_ADV_DATA_LEN  (31u)
+
+#endif /* PROJECT_H */
@@ -37,15 +37,23 @@ uint16 appExtMemChecksum = 0u;
 
 #if (ENCRYPTION_ENABLED == YES)
     uint8 emiKey[KEY_LENGTH];
+
+    /* MIC of the image written to the external memory */
+    CR_IMAGE_MIC_T appImageMic;
 #endif /*ENCRYPTION_ENABLED == YES*/
 
 /***************************************
 *     Function Prototypes
 ***************************************/
-static cystatus BootloaderEmulator_WritePacket(uint8 status, uint8 buffer[], uint16 size);
+static uint16   BootloaderEmulator_BuildPacket(uint8 status, uint8 buffer[], uint16 size);
 static uint16   BootloaderEmulator_CalcPacketChecksum(const uint8 buffer[], uint16 size);
 static void     BootloaderEmulator_HostLink(uint8 timeOut);
 
+/* Session state of the packet engine, kept between packets */
+static CYBIT  communicationState = BootloaderEmulator_COMMUNICATION_STATE_IDLE;
+static uint16 dataOffset = 0u;
+static uint8  dataBuffer[BootloaderEmulator_SIZEOF_COMMAND_BUFFER];
+
 
 /*******************************************************************************
 * Function Name: BootloaderEmulator_CalcPacketChecksum
@@ -69,45 +77,7 @@ static uint16 BootloaderEmulator_CalcPacketChecksum(const uint8 buffer[], uint16
 {
     #if(0u != BootloaderEmulator_PACKET_CHECKSUM_CRC)
 
-        uint16 CYDATA crc = BootloaderEmulator_CRC_CCITT_INITIAL_VALUE;
-        uint16 CYDATA tmp;
-        uint8  CYDATA i;
-        uint16 CYDATA tmpIndex = size;
-
-        if(0u == size)
-        {
-            crc = ~crc;
-        }
-        else
-        {
-            do
-            {
-                tmp = buffer[tmpIndex - size];
-
-                for (i = 0u; i < 8u; i++)
-                {
-                    if (0u != ((crc & 0x0001u) ^ (tmp & 0x0001u)))
-                    {
-                        crc = (crc >> 1u) ^ BootloaderEmulator_CRC_CCITT_POLYNOMIAL;
-                    }
-                    else
-                    {
-                        crc >>= 1u;
-                    }
-
-                    tmp >>= 1u;
-                }
-
-                size--;
-            }
-            while(0u != size);
-
-            crc = ~crc;
-            tmp = crc;
-            crc = ( uint16 )(crc << 8u) | (tmp >> 8u);
-        }
-
-        return(crc);
+        return(Crc_CalcPacketCrc(buffer, size));
 
     #else
 
@@ -339,21 +309,10 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
 {
     uint16    CYDATA numberRead;
     uint16    CYDATA rspSize;
-    uint8     CYDATA ackCode;
-    uint16    CYDATA pktChecksum;
     cystatus  CYDATA readStat;
-    uint16    CYDATA pktSize    = 0u;
-    uint16    CYDATA dataOffset = 0u;
     uint8     CYDATA timeOutCnt = 10u;
 
-    #if(0u != BootloaderEmulator_FAST_APP_VALIDATION)
-        uint8 CYDATA clearedMetaData = 0u;
-    #endif  /* (0u != BootloaderEmulator_FAST_APP_VALIDATION) */
-
-    CYBIT     communicationState = BootloaderEmulator_COMMUNICATION_STATE_IDLE;
-
     uint8     packetBuffer[BootloaderEmulator_SIZEOF_COMMAND_BUFFER];
-    uint8     dataBuffer  [BootloaderEmulator_SIZEOF_COMMAND_BUFFER];
 
     /* Initialize communications channel. */
     CyBLE_CyBtldrCommStart();
@@ -363,8 +322,6 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
 
     do
     {
-        ackCode = CYRET_SUCCESS;
-
         do
         {
             readStat = CyBLE_CyBtldrCommRead(packetBuffer,
@@ -384,473 +341,563 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
             continue;
         }
 
-        if((numberRead < BootloaderEmulator_MIN_PKT_SIZE) ||
-           (packetBuffer[BootloaderEmulator_SOP_ADDR] != BootloaderEmulator_SOP))
+        rspSize = BootloaderEmulator_ProcessPacket(packetBuffer, numberRead);
+
+        if(0u != rspSize)
+        {
+            /* Reply with acknowledge or not acknowledge packet */
+            (void) CyBLE_CyBtldrCommWrite(packetBuffer, rspSize, &rspSize, 150u);
+        }
+
+    } while ((0u == timeOut) || (BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState));
+}
+
+
+/*******************************************************************************
+* Function Name: BootloaderEmulator_ProcessPacket
+********************************************************************************
+*
+* Summary:
+*  Checks the framing of one host packet, executes the command and builds the
+*  response packet in place. The function does not touch the communication
+*  interface, so any transport that delivers whole packets can drive it.
+*
+* Parameters:
+*  packetBuffer:
+*   The received packet. It is overwritten with the response, so it must be
+*   BootloaderEmulator_SIZEOF_COMMAND_BUFFER bytes long.
+*  numberRead:
+*   The number of bytes received.
+*
+* Return:
+*   The number of response bytes to send back. 0 if no response is expected.
+*
+*******************************************************************************/
+uint16 BootloaderEmulator_ProcessPacket(uint8 packetBuffer[], uint16 numberRead)
+{
+    uint16    CYDATA rspSize;
+    uint8     CYDATA ackCode = CYRET_SUCCESS;
+    uint16    CYDATA pktChecksum;
+    uint16    CYDATA pktSize    = 0u;
+
+    #if(0u != BootloaderEmulator_FAST_APP_VALIDATION)
+        uint8 CYDATA clearedMetaData = 0u;
+    #endif  /* (0u != BootloaderEmulator_FAST_APP_VALIDATION) */
+
+    if((numberRead < BootloaderEmulator_MIN_PKT_SIZE) ||
+       (packetBuffer[BootloaderEmulator_SOP_ADDR] != BootloaderEmulator_SOP))
+    {
+        ackCode = BootloaderEmulator_ERR_DATA;
+    }
+    else
+    {
+        pktSize = ((uint16)((uint16)packetBuffer[BootloaderEmulator_SIZE_ADDR + 1u] << 8u)) |
+                           packetBuffer[BootloaderEmulator_SIZE_ADDR];
+
+        if((pktSize + BootloaderEmulator_MIN_PKT_SIZE) > numberRead)
+        {
+            ackCode = BootloaderEmulator_ERR_LENGTH;
+        }
+        else if(packetBuffer[BootloaderEmulator_EOP_ADDR(pktSize)] != BootloaderEmulator_EOP)
         {
             ackCode = BootloaderEmulator_ERR_DATA;
         }
         else
         {
-            pktSize = ((uint16)((uint16)packetBuffer[BootloaderEmulator_SIZE_ADDR + 1u] << 8u)) |
-                               packetBuffer[BootloaderEmulator_SIZE_ADDR];
-
             pktChecksum = ((uint16)((uint16)packetBuffer[BootloaderEmulator_CHK_ADDR(pktSize) + 1u] << 8u)) |
                                    packetBuffer[BootloaderEmulator_CHK_ADDR(pktSize)];
 
-            if((pktSize + BootloaderEmulator_MIN_PKT_SIZE) > numberRead)
-            {
-                ackCode = BootloaderEmulator_ERR_LENGTH;
-            }
-            else if(packetBuffer[BootloaderEmulator_EOP_ADDR(pktSize)] != BootloaderEmulator_EOP)
-            {
-                ackCode = BootloaderEmulator_ERR_DATA;
-            }
-            else if(pktChecksum != BootloaderEmulator_CalcPacketChecksum(packetBuffer,
-                                                                        pktSize + BootloaderEmulator_DATA_ADDR))
+            if(pktChecksum != BootloaderEmulator_CalcPacketChecksum(packetBuffer,
+                                                                    pktSize + BootloaderEmulator_DATA_ADDR))
             {
                 ackCode = BootloaderEmulator_ERR_CHECKSUM;
             }
-            else
-            {
-                /* Empty section */
-            }
         }
+    }
 
-        rspSize = 0u;
-        if(ackCode == CYRET_SUCCESS)
-        {
-            uint8 CYDATA btldrData = packetBuffer[BootloaderEmulator_DATA_ADDR];
+    rspSize = 0u;
+    if(ackCode == CYRET_SUCCESS)
+    {
+        uint8 CYDATA btldrData = packetBuffer[BootloaderEmulator_DATA_ADDR];
 
-            ackCode = BootloaderEmulator_ERR_DATA;
-            switch(packetBuffer[BootloaderEmulator_CMD_ADDR])
-            {
+        ackCode = BootloaderEmulator_ERR_DATA;
+        switch(packetBuffer[BootloaderEmulator_CMD_ADDR])
+        {
 
-            /***************************************************************************
-            *   Verify checksum
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_CHECKSUM:
+        /***************************************************************************
+        *   Verify checksum
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_CHECKSUM:
 
-                DBG_PRINT_TEXT("\r\nCommand: Checksum");
-                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 0u))
-                {
-                    packetBuffer[BootloaderEmulator_DATA_ADDR] =
-                            (uint8)(BootloaderEmulator_ValidateBootloadable() == CYRET_SUCCESS);
+            DBG_PRINT_TEXT("\r\nCommand: Checksum");
+            if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 0u))
+            {
+                packetBuffer[BootloaderEmulator_DATA_ADDR] =
+                        (uint8)(BootloaderEmulator_ValidateBootloadable() == CYRET_SUCCESS);
 
-                    DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
-                    DBG_PRINT_TEXT("\tVerify Checksum Command:\r\n");
-                    DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
-                    DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("BootloaderEmulator:\r\n");
+                DBG_PRINT_TEXT("\tVerify Checksum Command:\r\n");
+                DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
+                DBG_PRINT_TEXT("\r\n");
 
-                    rspSize = 1u;
-                    ackCode = CYRET_SUCCESS;
-                }
-                break;
+                rspSize = 1u;
+                ackCode = CYRET_SUCCESS;
+            }
+            break;
 
 
-            /***************************************************************************
-            *   Get flash size
-            ***************************************************************************/
+        /***************************************************************************
+        *   Get flash size
+        ***************************************************************************/
 
-            #if(0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL)
+        #if(0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL)
 
-                case BootloaderEmulator_COMMAND_REPORT_SIZE:
+            case BootloaderEmulator_COMMAND_REPORT_SIZE:
 
-                    DBG_PRINT_TEXT("\r\nCommand: Report Size");
-                    if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 1u))
-                    {
-                        packetBuffer[BootloaderEmulator_DATA_ADDR]      = LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
-                        packetBuffer[BootloaderEmulator_DATA_ADDR + 1u] = HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
+                DBG_PRINT_TEXT("\r\nCommand: Report Size");
+                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 1u))
+                {
+                    packetBuffer[BootloaderEmulator_DATA_ADDR]      = LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
+                    packetBuffer[BootloaderEmulator_DATA_ADDR + 1u] = HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY);
 
-                        packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] =
-                                    LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
+                    packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] =
+                                LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
 
-                        packetBuffer[BootloaderEmulator_DATA_ADDR + 3u] =
-                                    HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
+                    packetBuffer[BootloaderEmulator_DATA_ADDR + 3u] =
+                                HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u);
 
-                        rspSize = 4u;
-                        ackCode = CYRET_SUCCESS;
+                    rspSize = 4u;
+                    ackCode = CYRET_SUCCESS;
 
 
-                        DBG_PRINT_TEXT("\r\nFirst Available Row in Array: 0x");
-                        DBG_PRINT_HEX(HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
-                        DBG_PRINT_HEX(LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
-                        DBG_PRINT_TEXT("\r\n");
+                    DBG_PRINT_TEXT("\r\nFirst Available Row in Array: 0x");
+                    DBG_PRINT_HEX(HI8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
+                    DBG_PRINT_HEX(LO8(BootloaderEmulator_FIRST_ROW_IN_ARRAY));
+                    DBG_PRINT_TEXT("\r\n");
 
-                        DBG_PRINT_TEXT("Last Available Row in Array: 0x");
-                        DBG_PRINT_HEX(HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
-                        DBG_PRINT_HEX(LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
-                        DBG_PRINT_TEXT("\r\n");
-                        DBG_PRINT_TEXT("\r\n");
+                    DBG_PRINT_TEXT("Last Available Row in Array: 0x");
+                    DBG_PRINT_HEX(HI8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
+                    DBG_PRINT_HEX(LO8(BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY - 1u));
+                    DBG_PRINT_TEXT("\r\n");
+                    DBG_PRINT_TEXT("\r\n");
 
-                    }
-                    break;
+                }
+                break;
 
-            #endif  /* (0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL) */
+        #endif  /* (0u != BootloaderEmulator_CMD_GET_FLASH_SIZE_AVAIL) */
 
 
-            /***************************************************************************
-            *   Program / Erase row
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_PROGRAM:
+        /***************************************************************************
+        *   Program / Erase row
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_PROGRAM:
 
-            DBG_PRINT_TEXT("\r\n\nCommand: Program. ");
-            /* The btldrData variable holds Flash Array ID */
+        DBG_PRINT_TEXT("\r\n\nCommand: Program. ");
+        /* The btldrData variable holds Flash Array ID */
 
-        #if (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL)
+    #if (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL)
 
-            case BootloaderEmulator_COMMAND_ERASE:
-                DBG_PRINT_TEXT("\r\nCommand: Erase");
-                if (BootloaderEmulator_COMMAND_ERASE == packetBuffer[BootloaderEmulator_CMD_ADDR])
+        case BootloaderEmulator_COMMAND_ERASE:
+            DBG_PRINT_TEXT("\r\nCommand: Erase");
+            if (BootloaderEmulator_COMMAND_ERASE == packetBuffer[BootloaderEmulator_CMD_ADDR])
+            {
+                if ((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
                 {
-                    if ((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
-                    {
-                        /* Size of FLASH row (no ECC available) */
-                        dataOffset = BootloaderEmulator_FROW_SIZE;
+                    /* Size of FLASH row (no ECC available) */
+                    dataOffset = BootloaderEmulator_FROW_SIZE;
 
-                        (void) memset(dataBuffer, 0, (uint32) dataOffset);
-                    }
-                    else
-                    {
-                        break;
-                    }
+                    (void) memset(dataBuffer, 0, (uint32) dataOffset);
                 }
-
-        #endif  /* (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL) */
-
-                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize >= 3u))
+                else
                 {
-                    /* The command may be sent along with the last block of data, to program the row. */
-                    (void) memcpy(&dataBuffer[dataOffset],
-                                &packetBuffer[BootloaderEmulator_DATA_ADDR + 3u],
-                                (uint32) pktSize - 3u);
+                    break;
+                }
+            }
 
-                    dataOffset += (pktSize - 3u);
+    #endif  /* (0u != BootloaderEmulator_CMD_ERASE_ROW_AVAIL) */
 
-                    /* Size of FLASH row (no ECC available) */
-                    pktSize = CY_FLASH_SIZEOF_ROW;
+    #if (0u != BootloaderEmulator_CMD_COPY_ROW_AVAIL)
 
+        case BootloaderEmulator_COMMAND_COPY_ROW:
+            /* Delta update: the host sends only the changed rows and copies
+             * the unchanged ones from the application that is running now.
+             */
+            if (BootloaderEmulator_COMMAND_COPY_ROW == packetBuffer[BootloaderEmulator_CMD_ADDR])
+            {
+                uint32 copyRow = ((uint32) btldrData * BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY) +
+                                 (((uint32) packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] << 8u) |
+                                  packetBuffer[BootloaderEmulator_DATA_ADDR + 1u]);
 
-                    /* Check if we have all data to program */
-                    if(dataOffset == pktSize)
-                    {
-                        uint16 row;
-                        uint8 counter;
-                        uint32 size = CY_FLASH_SIZEOF_ROW;
+                if ((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u) &&
+                    (0u == dataOffset) && (copyRow < CY_FLASH_NUMBER_ROWS))
+                {
+                    (void) memcpy(dataBuffer,
+                                  (const void *) (CY_FLASH_BASE + (copyRow * CY_FLASH_SIZEOF_ROW)),
+                                  CY_FLASH_SIZEOF_ROW);
 
-                        DBG_PRINTF("\n\rHave all the data to program.");
-                        
-                        /* Save 1st bootloadable application flash row number to the metadata in external memory */
-                        if (appSizeInRows == 0u)
-                        {
-                            /* Get Flash row number inside of the array */
-                            dataOffset = ((uint16)((uint16)packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] << 8u)) |
-                                                  packetBuffer[BootloaderEmulator_DATA_ADDR + 1u];
-
-                            /* btldrData  - holds flash array Id sent by host */
-                            /* dataOffset - holds flash row Id sent by host   */
-                            row = (uint16)(btldrData * BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY) + dataOffset;
-
-                            /* Save number of the bootloadable application first flash row */
-                            appFirstRowNum = row;
-                            DBG_PRINTF("\n\rappSizeinRows = 0. appFirstRowNum = %d", appFirstRowNum);
-                        }
-
-                        /* Erase metadata row */
-                        if (appSizeInRows == 0u)
-                        {
-                            /* Erase content of the external memory */
-                            uint8  erase[CY_FLASH_SIZEOF_ROW] = {0u};
-                            #if (DEBUG_UART_ENABLED == YES)
-                                uint8  tmp[CY_FLASH_SIZEOF_ROW];
-                            #endif /* #if (DEBUG_UART_ENABLED == YES) */
-
-                            #if (DEBUG_UART_ENABLED == YES)
-                                (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
-                            #endif /* #if (DEBUG_UART_ENABLED == YES) */
-                            DBG_PRINT_TEXT("\n\r\n\rMetadata Row Before Erase: ");
-                            DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
-                            DBG_PRINT_TEXT("\r\n");
-
-                            /* Erase the entire external memory before writing.
-                             */
-                            DBG_PRINTF("\n\rErasing metadata and entire app...");
-                            (void) EMI_EraseAll();
-
-                            #if (DEBUG_UART_ENABLED == YES)
-                                (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
-                            #endif /* #if (DEBUG_UART_ENABLED == YES) */
-                            DBG_PRINT_TEXT("\n\n\rMetadata Row After Erase: ");
-                            DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
-                            DBG_PRINT_TEXT("\r\n");
-                        }
-
-
-                        /* External memory application checksum calculation */
-                        while (size > 0u)
-                        {
-                            size--;
-                            appExtMemChecksum += dataBuffer[size];
-                        }
-                        DBG_PRINTF("\n\rCalculated checksum of the app row: %x", appExtMemChecksum);
+                    dataOffset = CY_FLASH_SIZEOF_ROW;
+                }
+                else
+                {
+                    ackCode = BootloaderEmulator_ERR_ROW;
+                    break;
+                }
+            }
 
-                        
-                        /* Write row to the external memory */
-                        (void) EMI_WriteData(NOR_FLASH_INSTRUCTION_PP, EMI_APP_ABS_ADDR(appSizeInRows), CY_FLASH_SIZEOF_ROW, dataBuffer);
-                        appSizeInRows++;
+    #endif  /* (0u != BootloaderEmulator_CMD_COPY_ROW_AVAIL) */
 
-                        DBG_PRINT_TEXT("\r\nEMI Address: 0x");
-                        DBG_PRINT_HEX(EMI_APP_ABS_ADDR(appSizeInRows - 1u));
+            if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize >= 3u))
+            {
+                if((dataOffset + (pktSize - 3u)) > BootloaderEmulator_SIZEOF_COMMAND_BUFFER)
+                {
+                    /* The row does not fit the buffer, drop the data queued so far */
+                    dataOffset = 0u;
+                    ackCode = BootloaderEmulator_ERR_LENGTH;
+                    break;
+                }
 
-                        DBG_PRINT_TEXT("\r\nnumOfTxedRows = 0x");
-                        DBG_PRINT_HEX(appSizeInRows - 1u);
+                /* The command may be sent along with the last block of data, to program the row. */
+                (void) memcpy(&dataBuffer[dataOffset],
+                            &packetBuffer[BootloaderEmulator_DATA_ADDR + 3u],
+                            (uint32) pktSize - 3u);
 
-                        ackCode = CYRET_SUCCESS;
+                dataOffset += (pktSize - 3u);
 
-                    }
-                    else
-                    {
-                        ackCode = BootloaderEmulator_ERR_LENGTH;
-                    }
+                /* Size of FLASH row (no ECC available) */
+                pktSize = CY_FLASH_SIZEOF_ROW;
 
-                    dataOffset = 0u;
-                }
-                break;
 
+                /* Check if we have all data to program */
+                if(dataOffset == pktSize)
+                {
+                    uint16 row;
+                    uint8 counter;
+                    uint32 size = CY_FLASH_SIZEOF_ROW;
 
-            /***************************************************************************
-            *   Sync bootloader
-            ***************************************************************************/
-            #if(0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL)
+                    DBG_PRINTF("\n\rHave all the data to program.");
+                    
+                    /* Save 1st bootloadable application flash row number to the metadata in external memory */
+                    if (appSizeInRows == 0u)
+                    {
+                        /* Get Flash row number inside of the array */
+                        dataOffset = ((uint16)((uint16)packetBuffer[BootloaderEmulator_DATA_ADDR + 2u] << 8u)) |
+                                              packetBuffer[BootloaderEmulator_DATA_ADDR + 1u];
 
-            case BootloaderEmulator_COMMAND_SYNC:
+                        /* btldrData  - holds flash array Id sent by host */
+                        /* dataOffset - holds flash row Id sent by host   */
+                        row = (uint16)(btldrData * BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY) + dataOffset;
 
-                DBG_PRINT_TEXT("\r\nCommand: Sync");
-                if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
-                {
-                    /* If something failed the host would send this command to reset the bootloader. */
-                    dataOffset = 0u;
+                        /* Save number of the bootloadable application first flash row */
+                        appFirstRowNum = row;
+                        DBG_PRINTF("\n\rappSizeinRows = 0. appFirstRowNum = %d", appFirstRowNum);
+                    }
 
-                    /* Don't acknowledge the packet, just get ready to accept the next one */
-                    continue;
-                }
-                break;
+                    /* Erase metadata row */
+                    if (appSizeInRows == 0u)
+                    {
+                        /* Erase content of the external memory */
+                        uint8  erase[CY_FLASH_SIZEOF_ROW] = {0u};
+                        #if (DEBUG_UART_ENABLED == YES)
+                            uint8  tmp[CY_FLASH_SIZEOF_ROW];
+                        #endif /* #if (DEBUG_UART_ENABLED == YES) */
+
+                        #if (DEBUG_UART_ENABLED == YES)
+                            (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
+                        #endif /* #if (DEBUG_UART_ENABLED == YES) */
+                        DBG_PRINT_TEXT("\n\r\n\rMetadata Row Before Erase: ");
+                        DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
+                        DBG_PRINT_TEXT("\r\n");
 
-            #endif  /* (0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL) */
+                        /* Erase the entire external memory before writing.
+                         */
+                        DBG_PRINTF("\n\rErasing metadata and entire app...");
+                        (void) EMI_EraseAll();
 
+                        #if (DEBUG_UART_ENABLED == YES)
+                            (void) EMI_ReadData(EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, tmp);
+                        #endif /* #if (DEBUG_UART_ENABLED == YES) */
+                        DBG_PRINT_TEXT("\n\n\rMetadata Row After Erase: ");
+                        DBG_PRINT_ARRAY(tmp, CY_FLASH_SIZEOF_ROW);
+                        DBG_PRINT_TEXT("\r\n");
+                    }
 
-            /***************************************************************************
-            *   Send data
-            ***************************************************************************/
-            #if (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL)
 
-                case BootloaderEmulator_COMMAND_DATA:
-                    DBG_PRINT_TEXT("\r\nCommand: Data. ");
-                    if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
+                    /* External memory application checksum calculation */
+                    while (size > 0u)
                     {
-                        /*  Make sure that dataOffset is valid before copying the data */
-                        if((dataOffset + pktSize) <= BootloaderEmulator_SIZEOF_COMMAND_BUFFER)
-                        {
-                            uint16 i;
-                            
-                            ackCode = CYRET_SUCCESS;
-
-                            #if(CY_PSOC3)
-                                (void) memcpy(&dataBuffer[dataOffset],
-                                              &packetBuffer[BootloaderEmulator_DATA_ADDR],
-                                              ( int16 )pktSize);
-                            #else
-                                (void) memcpy(&dataBuffer[dataOffset],
-                                              &packetBuffer[BootloaderEmulator_DATA_ADDR],
-                                              (uint32) pktSize);
-                            #endif  /* (CY_PSOC3) */
-
-                            dataOffset += pktSize;
-                        }
-                        else
-                        {
-                            ackCode = BootloaderEmulator_ERR_LENGTH;
-                        }
+                        size--;
+                        appExtMemChecksum += dataBuffer[size];
                     }
+                    DBG_PRINTF("\n\rCalculated checksum of the app row: %x", appExtMemChecksum);
 
-                    break;
+                    
+                    /* Write row to the external memory */
+                    (void) EMI_WriteData(NOR_FLASH_INSTRUCTION_PP, EMI_APP_ABS_ADDR(appSizeInRows), CY_FLASH_SIZEOF_ROW, dataBuffer);
 
-            #endif  /* (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL) */
+                    #if (ENCRYPTION_ENABLED == YES)
+                        CR_ImageMicUpdate(&appImageMic, EMI_GetPageMic());
+                    #endif /* (ENCRYPTION_ENABLED == YES) */
+
+                    appSizeInRows++;
 
+                    DBG_PRINT_TEXT("\r\nEMI Address: 0x");
+                    DBG_PRINT_HEX(EMI_APP_ABS_ADDR(appSizeInRows - 1u));
 
-            /***************************************************************************
-            *   Enter bootloader
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_ENTER:
+                    DBG_PRINT_TEXT("\r\nnumOfTxedRows = 0x");
+                    DBG_PRINT_HEX(appSizeInRows - 1u);
+
+                    ackCode = CYRET_SUCCESS;
 
-                DBG_PRINT_TEXT("\r\nCommand: Enter. ");
-                if(pktSize == 0u)
+                }
+                else
                 {
-                    uint32 i;
+                    ackCode = BootloaderEmulator_ERR_LENGTH;
+                }
 
-                    BootloaderEmulator_ENTER CYDATA BtldrVersion =
-                        {CYDEV_CHIP_JTAG_ID, CYDEV_CHIP_REV_EXPECT, BootloaderEmulator_VERSION};
+                dataOffset = 0u;
+            }
+            break;
 
-                    communicationState = BootloaderEmulator_COMMUNICATION_STATE_ACTIVE;
 
-                    rspSize = sizeof(BootloaderEmulator_ENTER);
+        /***************************************************************************
+        *   Sync bootloader
+        ***************************************************************************/
+        #if(0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL)
 
-                    (void) memcpy(&packetBuffer[BootloaderEmulator_DATA_ADDR],
-                                &BtldrVersion,
-                                (uint32) rspSize);
+        case BootloaderEmulator_COMMAND_SYNC:
 
-                    
-                    DBG_PRINTF("\n\rInitializing...");
+            DBG_PRINT_TEXT("\r\nCommand: Sync");
+            if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
+            {
+                /* If something failed the host would send this command to reset the bootloader. */
+                dataOffset = 0u;
 
-                    /* Perform initializations */
-                    appSizeInRows = 0u;
-                    appExtMemChecksum = 0u;
-                    for (i = 0u; i < CY_FLASH_SIZEOF_ROW; i++ )
-                    {
-                        metadata[i] = 0u;
-                    }
+                /* Don't acknowledge the packet, just get ready to accept the next one */
+                return (0u);
+            }
+            break;
 
+        #endif  /* (0u != BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL) */
 
-                    #if (ENCRYPTION_ENABLED == YES)
-                        /*Generate key*/
-                        CR_GenerateKey(emiKey);
-                        DBG_PRINT_TEXT("Generated Key: ");
-                        DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
-                        DBG_PRINT_TEXT("\r\n");
-                        CR_WriteKey(emiKey);
-                        CR_ReadKey(emiKey);
-                        DBG_PRINT_TEXT("Read Key     : ");
-                        DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
-                        DBG_PRINT_TEXT("\r\n");
+
+        /***************************************************************************
+        *   Send data
+        ***************************************************************************/
+        #if (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL)
+
+            case BootloaderEmulator_COMMAND_DATA:
+                DBG_PRINT_TEXT("\r\nCommand: Data. ");
+                if(BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState)
+                {
+                    /*  Make sure that dataOffset is valid before copying the data */
+                    if((dataOffset + pktSize) <= BootloaderEmulator_SIZEOF_COMMAND_BUFFER)
+                    {
+                        uint16 i;
                         
-                    #endif /*(ENCRYPTION_ENABLED == YES)*/
-                    
-                    ackCode = CYRET_SUCCESS;
+                        ackCode = CYRET_SUCCESS;
+
+                        #if(CY_PSOC3)
+                            (void) memcpy(&dataBuffer[dataOffset],
+                                          &packetBuffer[BootloaderEmulator_DATA_ADDR],
+                                          ( int16 )pktSize);
+                        #else
+                            (void) memcpy(&dataBuffer[dataOffset],
+                                          &packetBuffer[BootloaderEmulator_DATA_ADDR],
+                                          (uint32) pktSize);
+                        #endif  /* (CY_PSOC3) */
+
+                        dataOffset += pktSize;
+                    }
+                    else
+                    {
+                        ackCode = BootloaderEmulator_ERR_LENGTH;
+                    }
                 }
+
                 break;
 
+        #endif  /* (0u != BootloaderEmulator_CMD_SEND_DATA_AVAIL) */
 
-            /***************************************************************************
-            *   Verify row
-            ***************************************************************************/
-            #if (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL)
 
-            case BootloaderEmulator_COMMAND_VERIFY:
+        /***************************************************************************
+        *   Enter bootloader
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_ENTER:
 
-                DBG_PRINT_TEXT("\r\nCommand: Verify");
-                if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
-                {
-                    uint8 CYDATA checksum;
-
-                    checksum = BootloaderEmulator_Calc8BitSum(appSizeInRows - 1u);
+            DBG_PRINT_TEXT("\r\nCommand: Enter. ");
+            if(pktSize == 0u)
+            {
+                uint32 i;
 
-                    packetBuffer[BootloaderEmulator_DATA_ADDR] = (uint8)1u + (uint8)(~checksum);
-                    ackCode = CYRET_SUCCESS;
-                    rspSize = 1u;
+                BootloaderEmulator_ENTER CYDATA BtldrVersion =
+                    {CYDEV_CHIP_JTAG_ID, CYDEV_CHIP_REV_EXPECT, BootloaderEmulator_VERSION};
 
-                    DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("\t\tRow Checksum: 0x");
-                    DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
-                    DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("\r\n");
-                }
-                break;
+                communicationState = BootloaderEmulator_COMMUNICATION_STATE_ACTIVE;
 
-            #endif /* (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL) */
+                rspSize = sizeof(BootloaderEmulator_ENTER);
 
+                (void) memcpy(&packetBuffer[BootloaderEmulator_DATA_ADDR],
+                            &BtldrVersion,
+                            (uint32) rspSize);
 
-            /***************************************************************************
-            *   Exit bootloader
-            ***************************************************************************/
-            case BootloaderEmulator_COMMAND_EXIT:
+                
+                DBG_PRINTF("\n\rInitializing...");
 
-                DBG_PRINT_TEXT("\n\r\nCommand: Exit.\n\r");
-                if(CYRET_SUCCESS == BootloaderEmulator_ValidateBootloadable())
+                /* Perform initializations */
+                appSizeInRows = 0u;
+                appExtMemChecksum = 0u;
+                for (i = 0u; i < CY_FLASH_SIZEOF_ROW; i++ )
                 {
-                    BootloaderEmulator_SET_RUN_TYPE(BootloaderEmulator_SCHEDULE_BTLDR);
+                    metadata[i] = 0u;
+                }
 
+
+                #if (ENCRYPTION_ENABLED == YES)
+                    /*Generate key*/
+                    CR_GenerateKey(emiKey);
+                    DBG_PRINT_TEXT("Generated Key: ");
+                    DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
                     DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("Bootloadable Application is valid.\r\n");
-                    metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_VALID;
-                    metadata[EMI_MD_ENCRYPTION_STATUS_ADDR] = ENCRYPTION_ENABLED;
-                }
-                else
-                {
+                    CR_WriteKey(emiKey);
+                    CR_ReadKey(emiKey);
+                    DBG_PRINT_TEXT("Read Key     : ");
+                    DBG_PRINT_ARRAY(emiKey, KEY_LENGTH);
                     DBG_PRINT_TEXT("\r\n");
-                    DBG_PRINT_TEXT("Bootloadable Application is invalid.\r\n");
-                    metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_INVALID;
-                }
 
-                /* Update metadata section and save it to the external memory */
+                    CR_ImageMicStart(&appImageMic);
+                    
+                #endif /*(ENCRYPTION_ENABLED == YES)*/
                 
-                metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR      ]         = LO8(appSizeInRows);
-                metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR + 1u ]         = HI8(appSizeInRows);
-                metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR     ]         = LO8(appFirstRowNum);
-                metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR + 1u]         = HI8(appFirstRowNum);
-                appExtMemChecksum = ( uint16 )1u + ( uint16 )(~appExtMemChecksum);
-                metadata[EMI_MD_APP_EM_CHECKSUM_ADDR     ]           = LO8(appExtMemChecksum);
-                metadata[EMI_MD_APP_EM_CHECKSUM_ADDR + 1u]           = HI8(appExtMemChecksum);
-                metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR     ] = LO8(EMI_EXTERNAL_MEMORY_PAGE_SIZE);
-                metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR + 1u] = HI8(EMI_EXTERNAL_MEMORY_PAGE_SIZE);
-
+                ackCode = CYRET_SUCCESS;
+            }
+            break;
 
-                (void) EMI_WriteData(NOR_FLASH_INSTRUCTION_PP, EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, metadata);
 
+        /***************************************************************************
+        *   Verify row
+        ***************************************************************************/
+        #if (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL)
 
-                DBG_PRINT_TEXT("\t\tApplication Status: 0x");
-                DBG_PRINT_HEX(metadata[EMI_MD_APP_STATUS_ADDR]);
-                DBG_PRINT_TEXT("\r\n");
+        case BootloaderEmulator_COMMAND_VERIFY:
 
-                DBG_PRINT_TEXT("\t\tSize Application in Rows: 0x");
-                DBG_PRINT_HEX(appSizeInRows);
-                DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("\r\nCommand: Verify");
+            if((BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState) && (pktSize == 3u))
+            {
+                uint8 CYDATA checksum;
 
-                DBG_PRINT_TEXT("\t\tFirst Flash Row Number: 0x");
-                DBG_PRINT_HEX(appFirstRowNum);
-                DBG_PRINT_TEXT("\r\n");
+                checksum = BootloaderEmulator_Calc8BitSum(appSizeInRows - 1u);
 
-                DBG_PRINT_TEXT("\t\tExternal Memory Page Size: 0x");
-                DBG_PRINT_HEX(metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR]);
-                DBG_PRINT_TEXT(" KB");
-                DBG_PRINT_TEXT("\r\n");
+                packetBuffer[BootloaderEmulator_DATA_ADDR] = (uint8)1u + (uint8)(~checksum);
+                ackCode = CYRET_SUCCESS;
+                rspSize = 1u;
 
                 DBG_PRINT_TEXT("\r\n");
-                DBG_PRINT_TEXT("\r\n");
-                DBG_PRINT_TEXT("===============================================================================\r\n");
-                DBG_PRINT_TEXT("=    BLE_External_Memory_Bootloadable Application Performs Software Reset     =\r\n");
-                DBG_PRINT_TEXT("===============================================================================\r\n");
+                DBG_PRINT_TEXT("\t\tRow Checksum: 0x");
+                DBG_PRINT_HEX(packetBuffer[BootloaderEmulator_DATA_ADDR]);
                 DBG_PRINT_TEXT("\r\n");
                 DBG_PRINT_TEXT("\r\n");
+            }
+            break;
 
-                CySoftwareReset();
+        #endif /* (0u != BootloaderEmulator_CMD_VERIFY_ROW_AVAIL) */
 
-                /* Will never get here */
-                break;
 
+        /***************************************************************************
+        *   Exit bootloader
+        ***************************************************************************/
+        case BootloaderEmulator_COMMAND_EXIT:
 
-            /***************************************************************************
-            *   Unsupported command
-            ***************************************************************************/
-            default:
-                ackCode = BootloaderEmulator_ERR_CMD;
-                break;
+            DBG_PRINT_TEXT("\n\r\nCommand: Exit.\n\r");
+            if(CYRET_SUCCESS == BootloaderEmulator_ValidateBootloadable())
+            {
+                BootloaderEmulator_SET_RUN_TYPE(BootloaderEmulator_SCHEDULE_BTLDR);
+
+                DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("Bootloadable Application is valid.\r\n");
+                metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_VALID;
+                metadata[EMI_MD_ENCRYPTION_STATUS_ADDR] = ENCRYPTION_ENABLED;
+            }
+            else
+            {
+                DBG_PRINT_TEXT("\r\n");
+                DBG_PRINT_TEXT("Bootloadable Application is invalid.\r\n");
+                metadata[EMI_MD_APP_STATUS_ADDR] = EMI_MD_APP_STATUS_INVALID;
             }
-        }
 
-        /* Reply with acknowledge or not acknowledge packet */
-        (void) BootloaderEmulator_WritePacket(ackCode, packetBuffer, rspSize);
+            /* Update metadata section and save it to the external memory */
+            
+            metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR      ]         = LO8(appSizeInRows);
+            metadata[EMI_MD_APP_SIZE_IN_ROWS_ADDR + 1u ]         = HI8(appSizeInRows);
+            metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR     ]         = LO8(appFirstRowNum);
+            metadata[EMI_MD_APP_FIRST_ROW_NUM_ADDR + 1u]         = HI8(appFirstRowNum);
+            appExtMemChecksum = ( uint16 )1u + ( uint16 )(~appExtMemChecksum);
+            metadata[EMI_MD_APP_EM_CHECKSUM_ADDR     ]           = LO8(appExtMemChecksum);
+            metadata[EMI_MD_APP_EM_CHECKSUM_ADDR + 1u]           = HI8(appExtMemChecksum);
+            metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR     ] = LO8(EMI_EXTERNAL_MEMORY_PAGE_SIZE);
+            metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR + 1u] = HI8(EMI_EXTERNAL_MEMORY_PAGE_SIZE);
+
+
+            #if (ENCRYPTION_ENABLED == YES)
+                CR_ImageMicFinish(&appImageMic, &metadata[EMI_MD_APP_MIC_ADDR]);
+            #endif /* (ENCRYPTION_ENABLED == YES) */
+
+            (void) EMI_WriteData(NOR_FLASH_INSTRUCTION_PP, EMI_MD_BASE_ADDR, CY_FLASH_SIZEOF_ROW, metadata);
+
+
+            DBG_PRINT_TEXT("\t\tApplication Status: 0x");
+            DBG_PRINT_HEX(metadata[EMI_MD_APP_STATUS_ADDR]);
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\t\tSize Application in Rows: 0x");
+            DBG_PRINT_HEX(appSizeInRows);
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\t\tFirst Flash Row Number: 0x");
+            DBG_PRINT_HEX(appFirstRowNum);
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\t\tExternal Memory Page Size: 0x");
+            DBG_PRINT_HEX(metadata[EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR]);
+            DBG_PRINT_TEXT(" KB");
+            DBG_PRINT_TEXT("\r\n");
+
+            DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("===============================================================================\r\n");
+            DBG_PRINT_TEXT("=    BLE_External_Memory_Bootloadable Application Performs Software Reset     =\r\n");
+            DBG_PRINT_TEXT("===============================================================================\r\n");
+            DBG_PRINT_TEXT("\r\n");
+            DBG_PRINT_TEXT("\r\n");
+
+            /* Metadata must be programmed before the reset */
+            (void) EMI_WaitReady();
+            CySoftwareReset();
+
+            /* Will never get here */
+            break;
+
+
+        /***************************************************************************
+        *   Unsupported command
+        ***************************************************************************/
+        default:
+            ackCode = BootloaderEmulator_ERR_CMD;
+            break;
+        }
+    }
 
-    } while ((0u == timeOut) || (BootloaderEmulator_COMMUNICATION_STATE_ACTIVE == communicationState));
+    return (BootloaderEmulator_BuildPacket(ackCode, packetBuffer, rspSize));
 }
 
 
 /*******************************************************************************
-* Function Name: BootloaderEmulator_WritePacket
+* Function Name: BootloaderEmulator_BuildPacket
 ********************************************************************************
 *
 * Summary:
-*  Creates a bootloader response packet and transmits it back to the bootloader
-*  host application over the already established communications protocol.
+*  Creates a bootloader response packet in place. The caller transmits it back
+*  to the bootloader host application.
 *
 * Parameters:
 *  status:
@@ -861,10 +908,10 @@ static void BootloaderEmulator_HostLink(uint8 timeOut)
 *      The number of bytes contained within the buffer to pass back
 *
 * Return:
-*   CYRET_SUCCESS if successful. Any other non-zero value if failure occurred.
+*   The number of bytes in the response packet.
 *
 *******************************************************************************/
-static cystatus BootloaderEmulator_WritePacket(uint8 status, uint8 buffer[], uint16 size)
+static uint16 BootloaderEmulator_BuildPacket(uint8 status, uint8 buffer[], uint16 size)
 {
     uint16 CYDATA checksum;
 
@@ -881,8 +928,7 @@ static cystatus BootloaderEmulator_WritePacket(uint8 status, uint8 buffer[], uin
     buffer[BootloaderEmulator_CHK_ADDR(1u + size)] = HI8(checksum);
     buffer[BootloaderEmulator_EOP_ADDR(size)]     = BootloaderEmulator_EOP;
 
-    /* Start packet transmit. */
-    return(CyBLE_CyBtldrCommWrite(buffer, size + BootloaderEmulator_MIN_PKT_SIZE, &size, 150u));
+    return(size + BootloaderEmulator_MIN_PKT_SIZE);
 }
 
 
@@ -60,6 +60,7 @@
 #define BootloaderEmulator_CMD_SYNC_BOOTLOADER_AVAIL  (0u)
 #define BootloaderEmulator_CMD_SEND_DATA_AVAIL        (1u)
 #define BootloaderEmulator_CMD_GET_METADATA           (0u)  /* Not supported  */
+#define BootloaderEmulator_CMD_COPY_ROW_AVAIL         (1u)  /* Delta update   */
 
 
 /*******************************************************************************
@@ -84,6 +85,7 @@
 void     BootloaderEmulator_Start(void);
 cystatus BootloaderEmulator_ValidateBootloadable(void);
 uint32   BootloaderEmulator_Calc8BitSum(uint32 addr);
+uint16   BootloaderEmulator_ProcessPacket(uint8 packetBuffer[], uint16 numberRead);
 
 
 #endif /* BootloaderEmulator_H */
@@ -17,6 +17,7 @@
 #define CY_BOOTLOADER_BootloaderEmulator_PVT_H
 
 #include "BootloaderEmulator.h"
+#include "Crc.h"
 
 
 typedef struct
@@ -69,6 +70,7 @@ typedef struct
 #define BootloaderEmulator_COMMAND_VERIFY       (0x3Au)    /* Compute flash row checksum for verification        */
 #define BootloaderEmulator_COMMAND_EXIT         (0x3Bu)    /* Exits the bootloader & resets the chip             */
 #define BootloaderEmulator_COMMAND_GET_METADATA (0x3Cu)    /* Reports the metadata for a selected application    */
+#define BootloaderEmulator_COMMAND_COPY_ROW     (0x3Du)    /* Program the row from the running application       */
 
 
 /*******************************************************************************
@@ -103,15 +105,6 @@ typedef struct
 #define BootloaderEmulator_COMMUNICATION_STATE_ACTIVE (1u)
 
 
-/*******************************************************************************
-* BootloaderEmulator_CalcPacketChecksum()
-*******************************************************************************/
-#if(0u != BootloaderEmulator_PACKET_CHECKSUM_CRC)
-    #define BootloaderEmulator_CRC_CCITT_POLYNOMIAL       (0x8408u)       /* x^16 + x^12 + x^5 + 1 */
-    #define BootloaderEmulator_CRC_CCITT_INITIAL_VALUE    (0xffffu)
-#endif /* (0u != BootloaderEmulator_PACKET_CHECKSUM_CRC) */
-
-
 #define BootloaderEmulator_NUMBER_OF_ROWS_IN_ARRAY                ((uint16)(CY_FLASH_SIZEOF_ARRAY/CY_FLASH_SIZEOF_ROW))
 #define BootloaderEmulator_FIRST_ROW_IN_ARRAY                     (0u)
 
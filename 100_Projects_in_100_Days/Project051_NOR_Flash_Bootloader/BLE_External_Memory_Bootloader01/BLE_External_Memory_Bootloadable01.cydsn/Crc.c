@@ -0,0 +1,266 @@
+/*******************************************************************************
+* File Name: Crc.c
+*
+* Version: 1.0
+*
+* Description:
+*  Provides the CRC-CCITT calculation used by the bootloader packet checksum.
+*  Following engines can be selected with CRC_ENGINE in Options.h. All of them
+*  produce the same result:
+*   CRC_ENGINE_BITWISE   - no tables, one iteration per bit.
+*   CRC_ENGINE_TABLE_16  - 32 byte table, one lookup per nibble.
+*   CRC_ENGINE_TABLE_256 - 512 byte table, one lookup per byte.
+*   CRC_ENGINE_SLICE_BY_4/CRC_ENGINE_SLICE_BY_8 - tables built in RAM on first
+*                          use (2/4 KB), 4 or 8 bytes per iteration. Intended
+*                          for host tools and targets with spare RAM.
+*
+* Hardware Dependency:
+*  CY8CKIT-042 BLE
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation. All rights reserved.
+* This software is owned by Cypress Semiconductor Corporation and is protected
+* by and subject to worldwide patent and copyright laws and treaties.
+* Therefore, you may use this software only as provided in the license agreement
+* accompanying the software package from which you obtained this software.
+* CYPRESS AND ITS SUPPLIERS MAKE NO WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+* WITH REGARD TO THIS SOFTWARE, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT,
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+*******************************************************************************/
+
+#include "Crc.h"
+
+
+#if (CRC_ENGINE == CRC_ENGINE_TABLE_16)
+
+/* CRC of the 4-bit values 0 to 15 */
+static const uint16 crcTable16[16u] =
+{
+    0x0000u, 0x1081u, 0x2102u, 0x3183u, 0x4204u, 0x5285u, 0x6306u, 0x7387u,
+    0x8408u, 0x9489u, 0xA50Au, 0xB58Bu, 0xC60Cu, 0xD68Du, 0xE70Eu, 0xF78Fu
+};
+
+#elif (CRC_ENGINE != CRC_ENGINE_BITWISE)
+
+/* CRC of the 8-bit values 0 to 255 */
+static const uint16 crcTable256[256u] =
+{
+    0x0000u, 0x1189u, 0x2312u, 0x329Bu, 0x4624u, 0x57ADu, 0x6536u, 0x74BFu,
+    0x8C48u, 0x9DC1u, 0xAF5Au, 0xBED3u, 0xCA6Cu, 0xDBE5u, 0xE97Eu, 0xF8F7u,
+    0x1081u, 0x0108u, 0x3393u, 0x221Au, 0x56A5u, 0x472Cu, 0x75B7u, 0x643Eu,
+    0x9CC9u, 0x8D40u, 0xBFDBu, 0xAE52u, 0xDAEDu, 0xCB64u, 0xF9FFu, 0xE876u,
+    0x2102u, 0x308Bu, 0x0210u, 0x1399u, 0x6726u, 0x76AFu, 0x4434u, 0x55BDu,
+    0xAD4Au, 0xBCC3u, 0x8E58u, 0x9FD1u, 0xEB6Eu, 0xFAE7u, 0xC87Cu, 0xD9F5u,
+    0x3183u, 0x200Au, 0x1291u, 0x0318u, 0x77A7u, 0x662Eu, 0x54B5u, 0x453Cu,
+    0xBDCBu, 0xAC42u, 0x9ED9u, 0x8F50u, 0xFBEFu, 0xEA66u, 0xD8FDu, 0xC974u,
+    0x4204u, 0x538Du, 0x6116u, 0x709Fu, 0x0420u, 0x15A9u, 0x2732u, 0x36BBu,
+    0xCE4Cu, 0xDFC5u, 0xED5Eu, 0xFCD7u, 0x8868u, 0x99E1u, 0xAB7Au, 0xBAF3u,
+    0x5285u, 0x430Cu, 0x7197u, 0x601Eu, 0x14A1u, 0x0528u, 0x37B3u, 0x263Au,
+    0xDECDu, 0xCF44u, 0xFDDFu, 0xEC56u, 0x98E9u, 0x8960u, 0xBBFBu, 0xAA72u,
+    0x6306u, 0x728Fu, 0x4014u, 0x519Du, 0x2522u, 0x34ABu, 0x0630u, 0x17B9u,
+    0xEF4Eu, 0xFEC7u, 0xCC5Cu, 0xDDD5u, 0xA96Au, 0xB8E3u, 0x8A78u, 0x9BF1u,
+    0x7387u, 0x620Eu, 0x5095u, 0x411Cu, 0x35A3u, 0x242Au, 0x16B1u, 0x0738u,
+    0xFFCFu, 0xEE46u, 0xDCDDu, 0xCD54u, 0xB9EBu, 0xA862u, 0x9AF9u, 0x8B70u,
+    0x8408u, 0x9581u, 0xA71Au, 0xB693u, 0xC22Cu, 0xD3A5u, 0xE13Eu, 0xF0B7u,
+    0x0840u, 0x19C9u, 0x2B52u, 0x3ADBu, 0x4E64u, 0x5FEDu, 0x6D76u, 0x7CFFu,
+    0x9489u, 0x8500u, 0xB79Bu, 0xA612u, 0xD2ADu, 0xC324u, 0xF1BFu, 0xE036u,
+    0x18C1u, 0x0948u, 0x3BD3u, 0x2A5Au, 0x5EE5u, 0x4F6Cu, 0x7DF7u, 0x6C7Eu,
+    0xA50Au, 0xB483u, 0x8618u, 0x9791u, 0xE32Eu, 0xF2A7u, 0xC03Cu, 0xD1B5u,
+    0x2942u, 0x38CBu, 0x0A50u, 0x1BD9u, 0x6F66u, 0x7EEFu, 0x4C74u, 0x5DFDu,
+    0xB58Bu, 0xA402u, 0x9699u, 0x8710u, 0xF3AFu, 0xE226u, 0xD0BDu, 0xC134u,
+    0x39C3u, 0x284Au, 0x1AD1u, 0x0B58u, 0x7FE7u, 0x6E6Eu, 0x5CF5u, 0x4D7Cu,
+    0xC60Cu, 0xD785u, 0xE51Eu, 0xF497u, 0x8028u, 0x91A1u, 0xA33Au, 0xB2B3u,
+    0x4A44u, 0x5BCDu, 0x6956u, 0x78DFu, 0x0C60u, 0x1DE9u, 0x2F72u, 0x3EFBu,
+    0xD68Du, 0xC704u, 0xF59Fu, 0xE416u, 0x90A9u, 0x8120u, 0xB3BBu, 0xA232u,
+    0x5AC5u, 0x4B4Cu, 0x79D7u, 0x685Eu, 0x1CE1u, 0x0D68u, 0x3FF3u, 0x2E7Au,
+    0xE70Eu, 0xF687u, 0xC41Cu, 0xD595u, 0xA12Au, 0xB0A3u, 0x8238u, 0x93B1u,
+    0x6B46u, 0x7ACFu, 0x4854u, 0x59DDu, 0x2D62u, 0x3CEBu, 0x0E70u, 0x1FF9u,
+    0xF78Fu, 0xE606u, 0xD49Du, 0xC514u, 0xB1ABu, 0xA022u, 0x92B9u, 0x8330u,
+    0x7BC7u, 0x6A4Eu, 0x58D5u, 0x495Cu, 0x3DE3u, 0x2C6Au, 0x1EF1u, 0x0F78u
+};
+
+#if defined(CRC_SLICES)
+    /* crcSliceTable[n][i] is the CRC of byte i followed by n zero bytes */
+    static uint16 crcSliceTable[CRC_SLICES][256u];
+    static uint8  crcSliceTableReady = 0u;
+
+    static void Crc_BuildSliceTable(void);
+#endif /* defined(CRC_SLICES) */
+
+#endif /* (CRC_ENGINE == CRC_ENGINE_TABLE_16) */
+
+
+#if defined(CRC_SLICES)
+/*******************************************************************************
+* Function Name: Crc_BuildSliceTable
+********************************************************************************
+*
+* Summary:
+*  Builds the slice tables from the byte table. Called once on first use.
+*
+* Parameters:
+*  None
+*
+* Returns:
+*  None
+*
+*******************************************************************************/
+static void Crc_BuildSliceTable(void)
+{
+    uint32 i;
+    uint32 slice;
+
+    for (i = 0u; i < 256u; i++)
+    {
+        crcSliceTable[0u][i] = crcTable256[i];
+    }
+
+    for (slice = 1u; slice < CRC_SLICES; slice++)
+    {
+        for (i = 0u; i < 256u; i++)
+        {
+            crcSliceTable[slice][i] = (crcSliceTable[slice - 1u][i] >> 8u) ^
+                                      crcTable256[crcSliceTable[slice - 1u][i] & 0xFFu];
+        }
+    }
+
+    crcSliceTableReady = 1u;
+}
+#endif /* defined(CRC_SLICES) */
+
+
+/*******************************************************************************
+* Function Name: Crc_CcittUpdate
+********************************************************************************
+*
+* Summary:
+*  Updates the running CRC-CCITT value with the provided bytes. The data can be
+*  passed in any number of calls; the first call should pass
+*  CRC_CCITT_INITIAL_VALUE as crc.
+*
+* Parameters:
+*  crc:
+*     The CRC value returned by the previous call
+*  buffer:
+*     The buffer containing the data to compute the CRC for
+*  size:
+*     The number of bytes in the buffer
+*
+* Returns:
+*  Updated CRC value. No final inversion is applied.
+*
+*******************************************************************************/
+uint16 Crc_CcittUpdate(uint16 crc, const uint8 buffer[], uint32 size)
+{
+    #if (CRC_ENGINE == CRC_ENGINE_BITWISE)
+
+        uint16 tmp;
+        uint8  i;
+
+        while (0u != size)
+        {
+            tmp = *buffer++;
+
+            for (i = 0u; i < 8u; i++)
+            {
+                if (0u != ((crc & 0x0001u) ^ (tmp & 0x0001u)))
+                {
+                    crc = (crc >> 1u) ^ CRC_CCITT_POLYNOMIAL;
+                }
+                else
+                {
+                    crc >>= 1u;
+                }
+
+                tmp >>= 1u;
+            }
+
+            size--;
+        }
+
+    #elif (CRC_ENGINE == CRC_ENGINE_TABLE_16)
+
+        while (0u != size)
+        {
+            crc = (crc >> 4u) ^ crcTable16[(crc ^ *buffer) & 0x0Fu];
+            crc = (crc >> 4u) ^ crcTable16[(crc ^ (uint16)(*buffer >> 4u)) & 0x0Fu];
+            buffer++;
+            size--;
+        }
+
+    #elif (CRC_ENGINE == CRC_ENGINE_TABLE_256)
+
+        while (0u != size)
+        {
+            crc = (crc >> 8u) ^ crcTable256[(crc ^ *buffer++) & 0xFFu];
+            size--;
+        }
+
+    #else
+
+        if (0u == crcSliceTableReady)
+        {
+            Crc_BuildSliceTable();
+        }
+
+        while (size >= CRC_SLICES)
+        {
+            crc ^= (uint16)((uint16)buffer[1u] << 8u) | buffer[0u];
+
+            #if (CRC_SLICES == 8u)
+                crc = crcSliceTable[7u][crc & 0xFFu] ^ crcSliceTable[6u][crc >> 8u] ^
+                      crcSliceTable[5u][buffer[2u]]  ^ crcSliceTable[4u][buffer[3u]] ^
+                      crcSliceTable[3u][buffer[4u]]  ^ crcSliceTable[2u][buffer[5u]] ^
+                      crcSliceTable[1u][buffer[6u]]  ^ crcSliceTable[0u][buffer[7u]];
+            #else
+                crc = crcSliceTable[3u][crc & 0xFFu] ^ crcSliceTable[2u][crc >> 8u] ^
+                      crcSliceTable[1u][buffer[2u]]  ^ crcSliceTable[0u][buffer[3u]];
+            #endif /* (CRC_SLICES == 8u) */
+
+            buffer += CRC_SLICES;
+            size   -= CRC_SLICES;
+        }
+
+        /* Remaining tail bytes */
+        while (0u != size)
+        {
+            crc = (crc >> 8u) ^ crcTable256[(crc ^ *buffer++) & 0xFFu];
+            size--;
+        }
+
+    #endif /* (CRC_ENGINE == CRC_ENGINE_BITWISE) */
+
+    return (crc);
+}
+
+
+/*******************************************************************************
+* Function Name: Crc_CalcPacketCrc
+********************************************************************************
+*
+* Summary:
+*  Computes the bootloader packet CRC for the provided number of bytes. The
+*  result is the inverted CRC-CCITT with its bytes swapped, as expected by the
+*  bootloader host.
+*
+* Parameters:
+*  buffer:
+*     The buffer containing the data to compute the checksum for
+*  size:
+*     The number of bytes in the buffer to compute the checksum for
+*
+* Returns:
+*  16 bit checksum for the provided data
+*
+*******************************************************************************/
+uint16 Crc_CalcPacketCrc(const uint8 buffer[], uint16 size)
+{
+    uint16 crc;
+
+    crc = (uint16) ~Crc_CcittUpdate(CRC_CCITT_INITIAL_VALUE, buffer, size);
+
+    return ((uint16)(crc << 8u) | (crc >> 8u));
+}
+
+
+/* [] END OF FILE */
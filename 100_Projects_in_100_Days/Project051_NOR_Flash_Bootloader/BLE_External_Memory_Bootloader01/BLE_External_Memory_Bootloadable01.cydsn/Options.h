@@ -36,6 +36,24 @@
 #define DEBUG_UART_ENABLED      (YES)
 #define CI_PACKET_CHECKSUM_CRC  (NO)
 
+
+/*******************************************************************************
+* CRC engine used for the packet checksum when CI_PACKET_CHECKSUM_CRC is YES.
+* All engines give the same result and differ in speed and memory use:
+*  CRC_ENGINE_BITWISE    - no tables
+*  CRC_ENGINE_TABLE_16   - 32 bytes of flash
+*  CRC_ENGINE_TABLE_256  - 512 bytes of flash
+*  CRC_ENGINE_SLICE_BY_4 - 512 bytes of flash and 2 KB of RAM
+*  CRC_ENGINE_SLICE_BY_8 - 512 bytes of flash and 4 KB of RAM
+*******************************************************************************/
+#define CRC_ENGINE_BITWISE      (0u)
+#define CRC_ENGINE_TABLE_16     (1u)
+#define CRC_ENGINE_TABLE_256    (2u)
+#define CRC_ENGINE_SLICE_BY_4   (3u)
+#define CRC_ENGINE_SLICE_BY_8   (4u)
+
+#define CRC_ENGINE              (CRC_ENGINE_TABLE_256)
+
     
 /*******************************************************************************
 * The next option is for configuring row number of SFLASH that will be used
@@ -0,0 +1,54 @@
+/*******************************************************************************
+* File Name: Crc.h
+*
+* Version: 1.0
+*
+* Description:
+*  Provides the API for the CRC-CCITT calculation used by the bootloader packet
+*  checksum. The calculation engine is selected at compile time in Options.h.
+*
+* Hardware Dependency:
+*  CY8CKIT-042 BLE
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation. All rights reserved.
+* This software is owned by Cypress Semiconductor Corporation and is protected
+* by and subject to worldwide patent and copyright laws and treaties.
+* Therefore, you may use this software only as provided in the license agreement
+* accompanying the software package from which you obtained this software.
+* CYPRESS AND ITS SUPPLIERS MAKE NO WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+* WITH REGARD TO THIS SOFTWARE, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT,
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+*******************************************************************************/
+
+#if !defined(Crc_H)
+#define Crc_H
+
+#include "cytypes.h"
+#include "Options.h"
+
+
+/*******************************************************************************
+* CRC-CCITT parameters. The CRC is calculated LSB first, hence the polynomial
+* is given in reversed bit order.
+*******************************************************************************/
+#define CRC_CCITT_POLYNOMIAL        (0x8408u)       /* x^16 + x^12 + x^5 + 1 */
+#define CRC_CCITT_INITIAL_VALUE     (0xffffu)
+
+#if (CRC_ENGINE == CRC_ENGINE_SLICE_BY_8)
+    #define CRC_SLICES              (8u)
+#elif (CRC_ENGINE == CRC_ENGINE_SLICE_BY_4)
+    #define CRC_SLICES              (4u)
+#endif /* (CRC_ENGINE == CRC_ENGINE_SLICE_BY_8) */
+
+
+/***************************************
+*        Function Prototypes
+***************************************/
+uint16 Crc_CcittUpdate(uint16 crc, const uint8 buffer[], uint32 size);
+uint16 Crc_CalcPacketCrc(const uint8 buffer[], uint16 size);
+
+#endif /* Crc_H */
+
+
+/* [] END OF FILE */
@@ -29,6 +29,28 @@
 
 uint8 emiWriteBuffer[EMI_SIZE_OF_WRITE_BUFFER];
 
+/* Read started by EMI_StartRead() and completed by EMI_WaitRead() */
+static uint32 emiReadAddr;
+static uint32 emiReadSize;
+static uint8 *emiReadData;
+static bool   emiReadPending = false;
+
+/* Set while a program or erase started by EMI_WriteData() may be running */
+static bool   emiBusy = false;
+
+/* Status poll interval to start with once the operation is waited for */
+static uint32 emiPollInterval;
+
+static bool EMI_ReadBusyBit(void);
+static void EMI_DelayUs(uint32 delay);
+static uint32 EMI_PutReadHeader(uint32 addressBytes);
+static cystatus EMI_DecryptRead(uint32 addressBytes, uint32 dataSize, uint8 *data);
+
+#if (ENCRYPTION_ENABLED == YES)
+    /* MIC of the last application page written or read */
+    static uint8 emiPageMic[MIC_DATA_LENGTH];
+#endif /* (ENCRYPTION_ENABLED == YES) */
+
 
 
 /*******************************************************************************
@@ -56,7 +78,10 @@ void EMI_Start(void)
 ********************************************************************************
 *
 * Summary:
-*  Write data to the external memory.
+*  Write data to the external memory. The function waits for the previous
+*  program or erase to complete, starts the new one and returns without
+*  waiting for it. Use EMI_IsBusy() to poll for completion or EMI_WaitReady()
+*  to wait for it.
 *
 * Parameters:
 *  uint8 instruction:
@@ -67,7 +92,8 @@ void EMI_Start(void)
 *  uint32 dataSize:
 *   Amount of data to write.
 *  uint8 *data:
-*   Pointer to data that is written to external memory
+*   Pointer to data that is written to external memory. Application pages are
+*   encrypted in the write buffer, the data itself is not modified.
 *
 * Return:
 *  Status
@@ -80,6 +106,8 @@ cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize,
     uint32 i;
     uint32 dataPointer = 1;
 
+    (void) EMI_WaitReady();
+
     /* Enable write on the Serial NOR Flash. */
     {
         EMI_SPIM_SpiUartClearRxBuffer();
@@ -117,24 +145,28 @@ cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize,
         dataPointer += 3;
     }
     
+    /* Data when required to be written - for PP command */
+    if((instruction == NOR_FLASH_INSTRUCTION_PP) && (data != NULL))
+    {
+        for (i = 0; i < dataSize; i++)
+        {        
+            emiWriteBuffer[dataPointer + i] = data[i];   
+        }
+        dataPointer += dataSize;
+    }
+    
     #if (ENCRYPTION_ENABLED == YES)
-        if ((addressBytes >= EMI_APP_BASE_ADDR) && (dataSize>0) && (data != NULL))
+        if ((instruction == NOR_FLASH_INSTRUCTION_PP) && (addressBytes >= EMI_APP_BASE_ADDR) && 
+            (dataSize>0) && (data != NULL))
         {
-            uint8 key[KEY_LENGTH] = {0};
-            uint8 nonce[NONCE_LENGTH] = {0};
-            uint8 encrypted[ENC_BUFFER_SIZE] = {0};
-            uint8 out_mic[MIC_DATA_LENGTH];
             CYBLE_API_RESULT_T result;
             
-            CR_ReadKey(key);
-            CR_ReadNonce(nonce);
-            result = CR_Encrypt(data, dataSize, key, nonce, encrypted, out_mic);
+            /* Encrypt the copy in the write buffer with the nonce of this page,
+               the caller's data is left unchanged */
+            result = CR_EncryptPage(addressBytes, &emiWriteBuffer[dataPointer - dataSize], (uint16) dataSize, 
+                                    emiPageMic);
             
-            if (result == CYBLE_ERROR_OK)
-            {
-                memcpy(data, encrypted, dataSize);
-            }
-            else
+            if (result != CYBLE_ERROR_OK)
             {
                 if (result == CYBLE_ERROR_INVALID_PARAMETER)
                 {
@@ -156,16 +188,6 @@ cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize,
         }
     #endif /* (ENCRYPTION_ENABLED == YES) */
     
-    /* Data when required to be written - for PP command */
-    if((instruction == NOR_FLASH_INSTRUCTION_PP) && (data != NULL))
-    {
-        for (i = 0; i < dataSize; i++)
-        {        
-            emiWriteBuffer[dataPointer + i] = data[i];   
-        }
-        dataPointer += dataSize;
-    }
-    
     /* Clear Rx and Tx Buffers */
     EMI_SPIM_SpiUartClearRxBuffer();
     EMI_SPIM_SpiUartClearTxBuffer();
@@ -188,9 +210,15 @@ cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize,
     /* Pull Slave select high */
     EMI_SPIM_SlaveSelect_Write(1);
     
-    while(EMI_IsBusy())
+    /* The page program/erase operation runs in the background from now on */
+    emiBusy = true;
+    if (instruction == NOR_FLASH_INSTRUCTION_PP)
     {
-        /* Wait while the page program/erase operation is complete. */
+        emiPollInterval = EMI_PP_POLL_INTERVAL_US;
+    }
+    else
+    {
+        emiPollInterval = EMI_ERASE_POLL_INTERVAL_US;
     }
     
     return (CYRET_SUCCESS);
@@ -202,7 +230,9 @@ cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize,
 ********************************************************************************
 *
 * Summary:
-*  Read whether the external memory is busy.
+*  Returns whether the program or erase started by EMI_WriteData() is still
+*  running. The status register is only read while an operation is pending,
+*  so the function is cheap to call from the main loop.
 *
 * Parameters:
 *  None   
@@ -215,6 +245,72 @@ cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize,
 *
 *******************************************************************************/
 bool EMI_IsBusy(void)
+{
+    if (emiBusy)
+    {
+        emiBusy = EMI_ReadBusyBit();
+    }
+    
+    return (emiBusy);
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_WaitReady
+********************************************************************************
+*
+* Summary:
+*  Waits for the program or erase started by EMI_WriteData() to complete. The
+*  status register is polled with an interval that doubles after every poll,
+*  up to EMI_MAX_POLL_INTERVAL_US, so that long erases do not keep the SPI bus
+*  busy.
+*
+* Parameters:
+*  None   
+*
+* Return:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           Successful
+*
+*******************************************************************************/
+cystatus EMI_WaitReady(void)
+{
+    uint32 interval = emiPollInterval;
+    
+    while (EMI_IsBusy())
+    {
+        EMI_DelayUs(interval);
+        
+        interval <<= 1u;
+        if (interval > EMI_MAX_POLL_INTERVAL_US)
+        {
+            interval = EMI_MAX_POLL_INTERVAL_US;
+        }
+    }
+    
+    return (CYRET_SUCCESS);
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_ReadBusyBit
+********************************************************************************
+*
+* Summary:
+*  Reads the busy bit of the status register of the external memory.
+*
+* Parameters:
+*  None   
+*
+* Return:
+*  bool
+*     Value               Description
+*     false                 Not busy
+*     true                  Busy
+*
+*******************************************************************************/
+static bool EMI_ReadBusyBit(void)
 {
     bool status = false;
     uint8 dataPointer = 1;
@@ -268,7 +364,7 @@ bool EMI_IsBusy(void)
 ********************************************************************************
 *
 * Summary:
-*  Read data from the external memory.
+*  Read data from the external memory. Blocks until the data is available.
 *
 * Parameters:
 *  uint32 addressBytes: The address in external memory from where to start.
@@ -288,18 +384,56 @@ bool EMI_IsBusy(void)
 cystatus EMI_ReadData(uint32 addressBytes, uint32 dataSize, uint8 *data)
 {
     cystatus status;
+
+    status = EMI_StartRead(addressBytes, dataSize, data);
+
+    if (CYRET_SUCCESS == status)
+    {
+        status = EMI_WaitRead();
+    }
+
+    return (status);
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_StartRead
+********************************************************************************
+*
+* Summary:
+*  Starts reading data from the external memory and returns once the read
+*  instruction and the dummy bytes are queued to the SPI master. The data is
+*  clocked in the background. EMI_WaitRead() must be called to complete the
+*  read before the data is used or any other external memory function is
+*  called, as the slave select stays asserted until then.
+*
+* Parameters:
+*  uint32 addressBytes: The address in external memory from where to start.
+*   
+*  uint32 dataSize: Amount of data to be read
+*   
+*  uint8 *data:     Data is copied to this array.
+*   
+*
+* Return:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           Successful
+*    Other non-zero          Failure
+*******************************************************************************/
+cystatus EMI_StartRead(uint32 addressBytes, uint32 dataSize, uint8 *data)
+{
     uint32 dataPointer = 1;
     uint32 i = 0;
     
-    /* Instruction to write to the Serial NOR flash */
-    emiWriteBuffer[0] = NOR_FLASH_INSTRUCTION_READ;
-    dataPointer = 1;
+    /* The memory does not accept reads while programming or erasing */
+    (void) EMI_WaitReady();
     
-    /* Address bytes */
-    emiWriteBuffer[1] = (uint8) (addressBytes >> 16u);
-    emiWriteBuffer[2] = (uint8) (addressBytes >> 8u);
-    emiWriteBuffer[3] = (uint8) (addressBytes);
-    dataPointer += 3;
+    emiReadAddr = addressBytes;
+    emiReadSize = dataSize;
+    emiReadData = data;
+    
+    dataPointer = EMI_PutReadHeader(addressBytes);
     
     for(i = 0; i < dataSize; i++)
     {
@@ -316,8 +450,44 @@ cystatus EMI_ReadData(uint32 addressBytes, uint32 dataSize, uint8 *data)
     
     /* Write dummy content so MOSI is busy while MISO takes data */
     EMI_SPIM_SpiUartPutArray(emiWriteBuffer, dataPointer);
+    emiReadPending = true;
     
-    while(dataPointer != EMI_SPIM_SpiUartGetRxBufferSize())
+    return (CYRET_SUCCESS);
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_WaitRead
+********************************************************************************
+*
+* Summary:
+*  Waits for the read started by EMI_StartRead() to complete, releases the
+*  slave select and copies the data out of the SPI RX buffer. The data is
+*  decrypted if encryption is enabled.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           Successful
+*    CYRET_INVALID_STATE     No read was started
+*    Other non-zero          Failure
+*    CYBLE_ERROR_INVALID_PARAMETER - problems with decryption
+*******************************************************************************/
+cystatus EMI_WaitRead(void)
+{
+    cystatus status;
+    uint32 i = 0;
+    
+    if (!emiReadPending)
+    {
+        return (CYRET_INVALID_STATE);
+    }
+    emiReadPending = false;
+    
+    while((emiReadSize + EMI_READ_HEADER_SIZE) != EMI_SPIM_SpiUartGetRxBufferSize())
     {
         /* Wait until the RX FIFO has the same entries as the amount 
          * transmitted - signifies a completed transfer. 
@@ -327,49 +497,196 @@ cystatus EMI_ReadData(uint32 addressBytes, uint32 dataSize, uint8 *data)
     /* Pull Slave select high */
     EMI_SPIM_SlaveSelect_Write(1);
     
-    /* Get the incoming data, except the first 4 bytes */
-    (void) EMI_SPIM_SpiUartReadRxData();
-    (void) EMI_SPIM_SpiUartReadRxData();
-    (void) EMI_SPIM_SpiUartReadRxData();
-    (void) EMI_SPIM_SpiUartReadRxData();
-    for(i = 0; i < dataSize; i++)
+    /* Get the incoming data, except the header bytes */
+    for(i = 0; i < EMI_READ_HEADER_SIZE; i++)
+    {
+        (void) EMI_SPIM_SpiUartReadRxData();
+    }
+    for(i = 0; i < emiReadSize; i++)
     {
-        data[i] = (uint8) EMI_SPIM_SpiUartReadRxData();
+        emiReadData[i] = (uint8) EMI_SPIM_SpiUartReadRxData();
     }
 
-    status = CYRET_SUCCESS;
+    status = EMI_DecryptRead(emiReadAddr, emiReadSize, emiReadData);
+
+    return status;
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_PutReadHeader
+********************************************************************************
+*
+* Summary:
+*  Puts the read instruction, the address and the dummy byte of FAST_READ if
+*  it is used to the start of the write buffer.
+*
+* Parameters:
+*  uint32 addressBytes: The address in external memory from where to start.
+*
+* Return:
+*  Number of the header bytes
+*******************************************************************************/
+static uint32 EMI_PutReadHeader(uint32 addressBytes)
+{
+    #if (EMI_FAST_READ_ENABLED == YES)
+        emiWriteBuffer[0] = NOR_FLASH_INSTRUCTION_FAST_READ;
+        emiWriteBuffer[4] = 0u;
+    #else
+        emiWriteBuffer[0] = NOR_FLASH_INSTRUCTION_READ;
+    #endif /* (EMI_FAST_READ_ENABLED == YES) */
+    
+    /* Address bytes */
+    emiWriteBuffer[1] = (uint8) (addressBytes >> 16u);
+    emiWriteBuffer[2] = (uint8) (addressBytes >> 8u);
+    emiWriteBuffer[3] = (uint8) (addressBytes);
+    
+    return (EMI_READ_HEADER_SIZE);
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_DecryptRead
+********************************************************************************
+*
+* Summary:
+*  Decrypts data read from the application area of the external memory.
+*  Metadata is not encrypted.
+*
+* Parameters:
+*  uint32 addressBytes: The address the data was read from.
+*   
+*  uint32 dataSize: Amount of data
+*   
+*  uint8 *data:     Data to decrypt in place.
+*
+* Return:
+*  Status
+*     Value               Description
+*    CYRET_SUCCESS           Successful
+*    CYBLE_ERROR_INVALID_PARAMETER - problems with decryption
+*******************************************************************************/
+static cystatus EMI_DecryptRead(uint32 addressBytes, uint32 dataSize, uint8 *data)
+{
+    cystatus status = CYRET_SUCCESS;
     
     #if (ENCRYPTION_ENABLED == YES)
-    /*Encrypt data except to metadata*/
-    
     if ((addressBytes >= EMI_APP_BASE_ADDR) && (dataSize>0))
     {
-        uint8 key[KEY_LENGTH] = {0};
-        uint8 nonce[NONCE_LENGTH] = {0};
-        uint8 decrypted[ENC_BUFFER_SIZE] = {0};
-        uint8 out_mic[MIC_DATA_LENGTH]={0};
         CYBLE_API_RESULT_T result;
         
-        CR_ReadKey(key);
-        CR_ReadNonce(nonce);
-        result = CR_Decrypt(data, dataSize, key, nonce, decrypted, out_mic);
-        /* Invalid MIC_AUTH not checked  as it will consume additional memory and 
-           was not required.*/
+        /* Decrypt in place. The page MIC is kept for EMI_GetPageMic(), the
+           caller checks it as part of the image MIC. */
+        result = CR_DecryptPage(addressBytes, data, (uint16) dataSize, emiPageMic);
         if (result == CYBLE_ERROR_INVALID_PARAMETER)
         {
             DBG_PRINT_TEXT("DECRYPTION ERROR: CYBLE_ERROR_INVALID_PARAMETER            \r\n");
             status = CYBLE_ERROR_INVALID_PARAMETER;
         }
-        else
-        {
-            memcpy(data, decrypted, dataSize);
-        }                                            
     }
+    #else
+        (void) addressBytes;
+        (void) dataSize;
+        (void) data;
     #endif /* (ENCRYPTION_ENABLED == YES) */
 
-    return status;
+    return (status);
 }
 
+#if (ENCRYPTION_ENABLED == YES)
+/*******************************************************************************
+* Function Name: EMI_GetPageMic
+********************************************************************************
+*
+* Summary:
+*  Returns the MIC of the last application page written to or read from the
+*  external memory.
+*
+* Parameters:
+*  None
+*
+* Return:
+*  Pointer to the page MIC (MIC_DATA_LENGTH bytes)
+*
+*******************************************************************************/
+const uint8 * EMI_GetPageMic(void)
+{
+    return (emiPageMic);
+}
+#endif /* (ENCRYPTION_ENABLED == YES) */
+
+
+/*******************************************************************************
+* Function Name: EMI_DelayUs
+********************************************************************************
+*
+* Summary:
+*  Delays for the given number of microseconds.
+*
+* Parameters:
+*  uint32 delay: Delay in microseconds
+*
+* Return:
+*  None
+*
+*******************************************************************************/
+static void EMI_DelayUs(uint32 delay)
+{
+    if (delay >= 1000u)
+    {
+        CyDelay(delay / 1000u);
+    }
+    else
+    {
+        CyDelayUs((uint16) delay);
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: EMI_EraseRange
+********************************************************************************
+*
+* Summary:
+*  Erases the sectors of the external memory that hold the given range. 64 kB
+*  block erase is used where a whole block is covered, 4 kB sector erase
+*  elsewhere. The function returns once the last erase is started.
+*
+* Parameters:
+*  uint32 addressBytes: Start address of the range
+*  uint32 size:         Size of the range, in bytes
+*
+* Return:
+*  Status
+*     Value                     Description
+*    CYRET_SUCCESS                  Successful
+*
+*******************************************************************************/
+cystatus EMI_EraseRange(uint32 addressBytes, uint32 size)
+{
+    uint32 endAddress = addressBytes + size;
+    
+    addressBytes &= ~((uint32) EMI_EXTERNAL_MEMORY_SECTOR_SIZE - 1u);
+    
+    while (addressBytes < endAddress)
+    {
+        if ((0u == (addressBytes & ((uint32) EMI_EXTERNAL_MEMORY_BLOCK_SIZE - 1u))) &&
+            ((endAddress - addressBytes) >= EMI_EXTERNAL_MEMORY_BLOCK_SIZE))
+        {
+            (void) EMI_WriteData(NOR_FLASH_INSTRUCTION_BLOCK_ERASE, addressBytes, 0, NULL);
+            addressBytes += EMI_EXTERNAL_MEMORY_BLOCK_SIZE;
+        }
+        else
+        {
+            (void) EMI_WriteData(NOR_FLASH_INSTRUCTION_SECTOR_ERASE, addressBytes, 0, NULL);
+            addressBytes += EMI_EXTERNAL_MEMORY_SECTOR_SIZE;
+        }
+    }
+    
+    return (CYRET_SUCCESS);
+}
+
+
 /*******************************************************************************
 * Function Name: EMI_EraseAll
 ********************************************************************************
@@ -397,12 +714,7 @@ cystatus EMI_EraseAll(void)
      * So erasing four blocks should suffice for 256 kB chips as well.
      * Caution: All data is erased, including metadata.
      */
-    EMI_WriteData(NOR_FLASH_INSTRUCTION_BLOCK_ERASE, 0                                       , 0, NULL);
-    EMI_WriteData(NOR_FLASH_INSTRUCTION_BLOCK_ERASE, 0 + (1 * EMI_EXTERNAL_MEMORY_BLOCK_SIZE), 0, NULL);
-    EMI_WriteData(NOR_FLASH_INSTRUCTION_BLOCK_ERASE, 0 + (2 * EMI_EXTERNAL_MEMORY_BLOCK_SIZE), 0, NULL);
-    EMI_WriteData(NOR_FLASH_INSTRUCTION_BLOCK_ERASE, 0 + (3 * EMI_EXTERNAL_MEMORY_BLOCK_SIZE), 0, NULL);
-    
-    return (CYRET_SUCCESS);
+    return (EMI_EraseRange(0u, 4u * EMI_EXTERNAL_MEMORY_BLOCK_SIZE));
 }
 
 
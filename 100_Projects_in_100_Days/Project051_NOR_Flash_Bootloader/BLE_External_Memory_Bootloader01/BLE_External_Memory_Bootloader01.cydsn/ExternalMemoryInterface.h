@@ -31,11 +31,17 @@
     
 void EMI_Start(void);
 cystatus EMI_EraseAll(void);
+cystatus EMI_EraseRange(uint32 addressBytes, uint32 size);
 cystatus EMI_WriteData(uint8 instruction, uint32 addressBytes, uint32 dataSize, uint8 *data);
 cystatus EMI_ReadData (uint32 addressBytes, uint32 dataSize, uint8 *data);
+cystatus EMI_StartRead(uint32 addressBytes, uint32 dataSize, uint8 *data);
+cystatus EMI_WaitRead (void);
+#if (ENCRYPTION_ENABLED == YES)
+    const uint8 * EMI_GetPageMic(void);
+#endif /* (ENCRYPTION_ENABLED == YES) */
 bool EMI_IsBusy(void);
+cystatus EMI_WaitReady(void);
 
-#define ENC_BUFFER_SIZE (300)
 #define META_DATA_SIZE  (128)
 #define META_DATA_ADDR  (0)
 
@@ -49,6 +55,7 @@ bool EMI_IsBusy(void);
 #define NOR_FLASH_INSTRUCTION_WRITE_DISABLE     (0x04)
 
 #define NOR_FLASH_INSTRUCTION_READ              (0x03)
+#define NOR_FLASH_INSTRUCTION_FAST_READ         (0x0B)
 #define NOR_FLASH_INSTRUCTION_READ_SR1          (0x05)
 
 #define NOR_FLASH_INSTRUCTION_SECTOR_ERASE      (0x20)
@@ -61,6 +68,25 @@ bool EMI_IsBusy(void);
 
 #define EMI_BUSY_BIT_FIELD                      (0x01)
 
+/* FAST_READ adds a dummy byte to every read. It is only needed when the SPI
+ * clock is above the limit of the READ instruction of the part.
+ */
+#define EMI_FAST_READ_ENABLED                   (NO)
+
+#if (EMI_FAST_READ_ENABLED == YES)
+    #define EMI_READ_HEADER_SIZE                (5u)    /* Instruction, address, dummy byte */
+#else
+    #define EMI_READ_HEADER_SIZE                (4u)    /* Instruction, address */
+#endif /* (EMI_FAST_READ_ENABLED == YES) */
+
+/* Status polling while a program or erase runs. The first poll interval is
+ * about a third of the typical page program or sector erase time, then it
+ * doubles up to the maximum.
+ */
+#define EMI_PP_POLL_INTERVAL_US                 (100u)
+#define EMI_ERASE_POLL_INTERVAL_US              (10000u)
+#define EMI_MAX_POLL_INTERVAL_US                (20000u)
+
 /*******************************************************************************
 * External Memory Layout
 *******************************************************************************/
@@ -86,6 +112,7 @@ bool EMI_IsBusy(void);
 /*******************************************************************************
 * External Memory Metadata
 *******************************************************************************/
+#define EMI_MD_APP_MIC_ADDR                     (EMI_MD_BASE_ADDR + 0x18u)
 #define EMI_MD_EXTERNAL_MEMORY_PAGE_SIZE_ADDR   (EMI_MD_BASE_ADDR + 0x14u)
 #define EMI_MD_APP_FIRST_ROW_NUM_ADDR           (EMI_MD_BASE_ADDR + 0x10u)
 #define EMI_MD_APP_SIZE_IN_ROWS_ADDR            (EMI_MD_BASE_ADDR + 0x0Cu)
@@ -37,6 +37,34 @@
 #define CI_PACKET_CHECKSUM_CRC  (NO)
 
 
+/*******************************************************************************
+* CRC engine used for the packet checksum when CI_PACKET_CHECKSUM_CRC is YES.
+* All engines give the same result and differ in speed and memory use:
+*  CRC_ENGINE_BITWISE    - no tables
+*  CRC_ENGINE_TABLE_16   - 32 bytes of flash
+*  CRC_ENGINE_TABLE_256  - 512 bytes of flash
+*  CRC_ENGINE_SLICE_BY_4 - 512 bytes of flash and 2 KB of RAM
+*  CRC_ENGINE_SLICE_BY_8 - 512 bytes of flash and 4 KB of RAM
+*******************************************************************************/
+#define CRC_ENGINE_BITWISE      (0u)
+#define CRC_ENGINE_TABLE_16     (1u)
+#define CRC_ENGINE_TABLE_256    (2u)
+#define CRC_ENGINE_SLICE_BY_4   (3u)
+#define CRC_ENGINE_SLICE_BY_8   (4u)
+
+#define CRC_ENGINE              (CRC_ENGINE_TABLE_256)
+
+
+/*******************************************************************************
+* The image checksum in the external memory is always verified while the image
+* is copied to the internal flash. By default it is also verified before the
+* copy is started, which costs a full read of the image but keeps the current
+* application in the internal flash if the image is corrupted. Set to YES to
+* skip that first pass.
+*******************************************************************************/
+#define CI_VERIFY_ON_COPY_ONLY  (NO)
+
+
 /*******************************************************************************
 * The next option is for configuring row number of SFLASH that will be used
 * for storing of the encryption key that was used for the external memory
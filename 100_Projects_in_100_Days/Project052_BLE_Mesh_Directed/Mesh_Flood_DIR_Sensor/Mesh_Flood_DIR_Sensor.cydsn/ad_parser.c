@@ -0,0 +1,285 @@
+/*******************************************************************************
+* File Name: ad_parser.c
+*
+* Version: 1.0
+*
+* Description:
+* This file contains the definition for the advertising data parser and the
+* scan filter. The parser returns the AD structures of a report one by one as
+* pointers into the report, nothing is copied. Lengths are checked against the
+* report, so a malformed report ends the walk instead of reading past it. The
+* filter groups its rules by AD type when it is compiled, so a report is
+* matched against all rules with a single walk.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include "project.h"
+#include <string.h>
+#include "ad_parser.h"
+
+/*******************************************************************************
+* Function Name: AdParser_Init
+********************************************************************************
+* Summary:
+*        Starts a walk over the AD structures of advertising or scan response
+* data.
+*
+* Parameters:
+*  iter: 		walk to be started
+*  data: 		advertising data of the report
+*  len: 		length of the advertising data
+*
+* Return:
+*  void
+*
+*******************************************************************************/
+void AdParser_Init(AD_ITER_T * iter, const uint8 * data, uint8 len)
+{
+	iter->data = data;
+	iter->len = len;
+	iter->pos = 0;
+}
+
+/*******************************************************************************
+* Function Name: AdParser_Next
+********************************************************************************
+* Summary:
+*        Returns the next AD structure. A zero length ends the significant part
+* of the data. A length running past the data ends the walk as well.
+*
+* Parameters:
+*  iter: 		walk started by AdParser_Init
+*  field: 		receives the AD structure
+*
+* Return:
+*  uint8: TRUE if an AD structure was returned, FALSE at the end of the data
+*
+*******************************************************************************/
+uint8 AdParser_Next(AD_ITER_T * iter, AD_FIELD_T * field)
+{
+	uint8 fieldLen;
+	
+	if(iter->pos >= iter->len)
+	{
+		return FALSE;
+	}
+	
+	fieldLen = iter->data[iter->pos];
+	
+	/* The type byte and the value have to be within the data */
+	if((fieldLen == 0) || (fieldLen >= (uint8)(iter->len - iter->pos)))
+	{
+		iter->pos = iter->len;
+		return FALSE;
+	}
+	
+	field->type = iter->data[iter->pos + 1];
+	field->len = fieldLen - 1;
+	field->value = &iter->data[iter->pos + 2];
+	iter->pos += fieldLen + 1;
+	
+	return TRUE;
+}
+
+/*******************************************************************************
+* Function Name: AdParser_Find
+********************************************************************************
+* Summary:
+*        Finds the first AD structure of the given type.
+*
+* Parameters:
+*  data: 		advertising data of the report
+*  len: 		length of the advertising data
+*  type: 		AD type looked for
+*  field: 		receives the AD structure
+*
+* Return:
+*  uint8: TRUE if the AD structure was found
+*
+*******************************************************************************/
+uint8 AdParser_Find(const uint8 * data, uint8 len, uint8 type, AD_FIELD_T * field)
+{
+	AD_ITER_T iter;
+	
+	AdParser_Init(&iter, data, len);
+	while(AdParser_Next(&iter, field))
+	{
+		if(field->type == type)
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+/*******************************************************************************
+* Function Name: AdFilter_Compile
+********************************************************************************
+* Summary:
+*        Groups the rules by AD type. The rules are referenced, not copied, so
+* they have to stay in place while the filter is used.
+*
+* Parameters:
+*  filter: 		filter to be compiled
+*  rules: 		the rules, rule n sets bit n of the match result
+*  ruleCount: 	number of rules, up to AD_FILTER_MAX_RULES
+*
+* Return:
+*  uint8: TRUE if the rules were compiled, FALSE if they are invalid
+*
+*******************************************************************************/
+uint8 AdFilter_Compile(AD_FILTER_T * filter, const AD_RULE_T * rules, uint8 ruleCount)
+{
+	uint8 rule;
+	uint8 type;
+	uint8 index;
+	
+	memset(filter, 0, sizeof(AD_FILTER_T));
+	
+	if(ruleCount > AD_FILTER_MAX_RULES)
+	{
+		return FALSE;
+	}
+	
+	for(rule = 0; rule < ruleCount; rule++)
+	{
+		/* An empty element would never advance through the value */
+		if((rules[rule].match == AD_MATCH_ELEMENT) && (rules[rule].patternLen == 0))
+		{
+			return FALSE;
+		}
+		
+		type = AD_TYPE_CANONICAL(rules[rule].adType);
+		for(index = 0; (index < filter->typeCount) && (filter->types[index] != type); index++)
+		{
+		}
+		if(index == filter->typeCount)
+		{
+			filter->types[index] = type;
+			filter->typeCount++;
+		}
+		filter->typeRules[index] |= (uint8)(1u << rule);
+		filter->typeBits |= (uint32)1u << (type & 0x1F);
+	}
+	
+	filter->rules = rules;
+	filter->ruleCount = ruleCount;
+	
+	return TRUE;
+}
+
+/*******************************************************************************
+* Function Name: AdFilter_RuleMatches
+********************************************************************************
+* Summary:
+*        Tests one rule against an AD structure of the rule's type.
+*
+* Parameters:
+*  rule: 		the rule
+*  field: 		the AD structure
+*
+* Return:
+*  uint8: TRUE if the AD structure matches the rule
+*
+*******************************************************************************/
+static uint8 AdFilter_RuleMatches(const AD_RULE_T * rule, const AD_FIELD_T * field)
+{
+	uint8 offset;
+	
+	if(rule->match == AD_MATCH_PREFIX)
+	{
+		return ((field->len >= rule->patternLen) &&
+				(memcmp(field->value, rule->pattern, rule->patternLen) == 0)) ? TRUE : FALSE;
+	}
+	
+	if(field->len < rule->patternLen)
+	{
+		return FALSE;
+	}
+	
+	for(offset = 0; offset <= (uint8)(field->len - rule->patternLen); offset += rule->patternLen)
+	{
+		if(memcmp(&field->value[offset], rule->pattern, rule->patternLen) == 0)
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+/*******************************************************************************
+* Function Name: AdFilter_Match
+********************************************************************************
+* Summary:
+*        Matches all rules of a filter against advertising data, walking the
+* AD structures once. AD structures of a type no rule refers to are skipped
+* with a single bit test.
+*
+* Parameters:
+*  filter: 		filter compiled by AdFilter_Compile
+*  data: 		advertising data of the report
+*  len: 		length of the advertising data
+*  matched: 	NULL, or an array of ruleCount entries receiving the AD
+*				structure which matched each rule
+*
+* Return:
+*  uint8: bit n is set if rule n matched
+*
+*******************************************************************************/
+uint8 AdFilter_Match(const AD_FILTER_T * filter, const uint8 * data, uint8 len, AD_FIELD_T * matched)
+{
+	AD_ITER_T iter;
+	AD_FIELD_T field;
+	uint8 result = 0;
+	uint8 type;
+	uint8 index;
+	uint8 rules;
+	uint8 rule;
+	
+	AdParser_Init(&iter, data, len);
+	while(AdParser_Next(&iter, &field))
+	{
+		type = AD_TYPE_CANONICAL(field.type);
+		if((filter->typeBits & ((uint32)1u << (type & 0x1F))) == 0)
+		{
+			continue;
+		}
+		
+		for(index = 0; (index < filter->typeCount) && (filter->types[index] != type); index++)
+		{
+		}
+		if(index == filter->typeCount)
+		{
+			continue;
+		}
+		
+		/* Rules which already matched are not tested again */
+		rules = filter->typeRules[index] & (uint8)~result;
+		for(rule = 0; rules != 0; rule++, rules >>= 1)
+		{
+			if(((rules & 0x01) != 0) && AdFilter_RuleMatches(&filter->rules[rule], &field))
+			{
+				result |= (uint8)(1u << rule);
+				if(matched != NULL)
+				{
+					matched[rule] = field;
+				}
+			}
+		}
+		
+		if(result == AD_FILTER_ALL(filter))
+		{
+			break;
+		}
+	}
+	
+	return result;
+}
+
+/* [] END OF FILE */
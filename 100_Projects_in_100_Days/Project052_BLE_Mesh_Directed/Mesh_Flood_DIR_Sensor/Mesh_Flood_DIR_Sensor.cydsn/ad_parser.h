@@ -0,0 +1,105 @@
+/*******************************************************************************
+* File Name: ad_parser.h
+*
+* Version: 1.0
+*
+* Description:
+*  This file contains the headers and constants for the advertising data
+* parser, which walks the AD structures of a report in place, and for the scan
+* filter, which matches several rules against a report in a single pass.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#if !defined(AD_PARSER_H)
+#define AD_PARSER_H
+#include "project.h"
+
+/*****************************************************
+*                  Enums and macros
+*****************************************************/ 
+#if !defined(TRUE)
+#define TRUE								1
+#define FALSE								0
+#endif
+
+/* AD types used by the filter rules */
+#define AD_TYPE_FLAGS						0x01
+#define AD_TYPE_UUID16_INCOMPLETE			0x02
+#define AD_TYPE_UUID16_COMPLETE				0x03
+#define AD_TYPE_UUID32_INCOMPLETE			0x04
+#define AD_TYPE_UUID32_COMPLETE				0x05
+#define AD_TYPE_UUID128_INCOMPLETE			0x06
+#define AD_TYPE_UUID128_COMPLETE			0x07
+#define AD_TYPE_NAME_SHORT					0x08
+#define AD_TYPE_NAME_COMPLETE				0x09
+#define AD_TYPE_SERVICE_DATA16				0x16
+#define AD_TYPE_SERVICE_DATA128				0x21
+#define AD_TYPE_MANUFACTURER				0xFF
+
+/* The incomplete UUID lists and the short name are matched by the rules of
+* the complete list and complete name */
+#define AD_TYPE_CANONICAL(type)				((((type) >= AD_TYPE_UUID16_INCOMPLETE) && \
+											((type) <= AD_TYPE_NAME_COMPLETE)) ? ((type) | 0x01) : (type))
+
+/* Rule match modes */
+#define AD_MATCH_PREFIX						0	/* Value starts with the pattern */
+#define AD_MATCH_ELEMENT					1	/* Value is a list of pattern sized elements, one equals the pattern */
+
+/* Rules of one filter, bit n of a match result stands for rule n */
+#define AD_FILTER_MAX_RULES					8
+#define AD_FILTER_ALL(filter)				((uint8)((1u << (filter)->ruleCount) - 1u))
+
+/*****************************************************
+*                  Data Types
+*****************************************************/ 
+/* Position in the advertising data being walked */
+typedef struct
+{
+	const uint8 * data;
+	uint8 len;
+	uint8 pos;
+} AD_ITER_T;
+
+/* One AD structure, the value points into the report */
+typedef struct
+{
+	uint8 type;
+	uint8 len;
+	const uint8 * value;
+} AD_FIELD_T;
+
+typedef struct
+{
+	uint8 adType;
+	uint8 match;
+	uint8 patternLen;
+	const uint8 * pattern;
+} AD_RULE_T;
+
+/* Rules grouped by AD type, so every AD structure is only tested against the
+* rules of its type */
+typedef struct
+{
+	const AD_RULE_T * rules;
+	uint8 ruleCount;
+	uint8 typeCount;
+	uint8 types[AD_FILTER_MAX_RULES];
+	uint8 typeRules[AD_FILTER_MAX_RULES];
+	uint32 typeBits;
+} AD_FILTER_T;
+
+/*****************************************************
+*                  Function Declarations
+*****************************************************/
+void AdParser_Init(AD_ITER_T * iter, const uint8 * data, uint8 len);
+uint8 AdParser_Next(AD_ITER_T * iter, AD_FIELD_T * field);
+uint8 AdParser_Find(const uint8 * data, uint8 len, uint8 type, AD_FIELD_T * field);
+uint8 AdFilter_Compile(AD_FILTER_T * filter, const AD_RULE_T * rules, uint8 ruleCount);
+uint8 AdFilter_Match(const AD_FILTER_T * filter, const uint8 * data, uint8 len, AD_FIELD_T * matched);
+
+#endif
+/* [] END OF FILE */
@@ -24,9 +24,6 @@ uint16 node_address = 0;
 
 #ifdef ENABLE_ADV_DATA_COUNTER
 CYBLE_GAPP_DISC_DATA_T  new_advData;
-uint8 potential_node_found = 0;
-uint8 potential_node_bdAddr[6];
-uint8 potential_node_bdAddrType = 0;
 #endif
 
 /* DO NOT CHANGE: This tag allows system to filter the correct nodes and resemble to 
@@ -35,6 +32,17 @@ uint8 scan_tag[SCAN_TAG_DATA_LEN] = {0x13, 0x21, 0x31, 0x01, 0x9B, 0x5F, 0x80, 0
 									0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0xBB, 0xC2, 
 									0x03, 0x00, 0xBB, 0xCB};
 
+/* Manufacturer specific data which marks the advertising data of a node */
+static const uint8 mesh_node_tag[] = {CYPRESS_COMPANY_ID_LSB, CYPRESS_COMPANY_ID_MSB, CUSTOM_ADV_DATA_MARKER};
+
+/* The scan filter matches the node marker and the scan response tag, which is
+* the 128-bit service data held by scan_tag after its length and type bytes */
+static const AD_RULE_T scan_rules[MESH_RULE_COUNT] = {
+	{AD_TYPE_MANUFACTURER, AD_MATCH_PREFIX, sizeof(mesh_node_tag), mesh_node_tag},
+	{AD_TYPE_SERVICE_DATA128, AD_MATCH_PREFIX, SCAN_TAG_DATA_LEN - 2, &scan_tag[2]}
+};
+static AD_FILTER_T scan_filter;
+
 CYBLE_GAP_BD_ADDR_T				peripAddr;
 volatile uint8 clientConnectToDevice = FALSE;
 uint8 ble_gap_state = BLE_PERIPHERAL;
@@ -67,7 +75,9 @@ void GenericEventHandler(uint32 event, void * eventParam)
 	/* Local variables and data structures*/
 	CYBLE_GATTS_WRITE_REQ_PARAM_T 		writeReqData;
 	CYBLE_GATTC_WRITE_REQ_T				writeADVcounterdata;
-	CYBLE_GAPC_ADV_REPORT_T				scan_report;
+	CYBLE_GAPC_ADV_REPORT_T				*scan_report;
+	AD_FIELD_T							scan_fields[MESH_RULE_COUNT];
+	uint8								scan_match;
 	CYBLE_GATTS_WRITE_CMD_REQ_PARAM_T	writeCmdData;
 	CYBLE_API_RESULT_T					apiResult;
 	CYBLE_GATTC_WRITE_REQ_T 			writeRGBdata;
@@ -86,6 +96,9 @@ void GenericEventHandler(uint32 event, void * eventParam)
 			UART_UartPutCRLF(' ');
 			#endif
 			
+			/* Group the scan filter rules once, they are matched on every report */
+			AdFilter_Compile(&scan_filter, scan_rules, MESH_RULE_COUNT);
+			
 			#ifdef RESTART_BLE_STACK
 			if(!stackRestartIssued)
 			{
@@ -429,125 +442,87 @@ void GenericEventHandler(uint32 event, void * eventParam)
 			{
 				/* If we are not connected to any peripheral device, then save the new device  
 				* information so to add it to our list */
-				scan_report = *(CYBLE_GAPC_ADV_REPORT_T*)eventParam;
+				scan_report = (CYBLE_GAPC_ADV_REPORT_T*)eventParam;
 				
 				#if (DEBUG_ENABLED == 1)
 					UART_UartPutString("CYBLE_EVT_GAPC_SCAN_PROGRESS_RESULT ");
 					UART_UartPutCRLF(' ');
 				#endif
 				
+				/* Walk the AD structures of the report once, matching both the node
+				* marker and the scan response tag in place */
+				scan_match = AdFilter_Match(&scan_filter, scan_report->data, scan_report->dataLen, scan_fields);
+				
 				#ifdef ENABLE_ADV_DATA_COUNTER
-				/* If ADV DATA COUNTER is enabled, then the central device would check
-				* if the counter in ADV packet of peripheral is less than its own counter
-				* or not. If yes, then it will consider the peripheral has a older RGB LED
-				* data and treat it as a potential device to connect to.*/
-				if(scan_report.eventType == CYBLE_GAPC_CONN_UNDIRECTED_ADV)
+				/* If ADV DATA COUNTER is enabled, then the central device records the ADV
+				* counter of every node of the network in the mesh cache. When the scan
+				* response of the node is received, the cached counter is compared with the
+				* counter of this device to decide if the node has older RGB LED data and
+				* has to be connected to. */
+				if(scan_report->eventType == CYBLE_GAPC_CONN_UNDIRECTED_ADV)
 				{
-					/* If the scan report received is of advertising nature and the data 
-					* length is as expected... */
-					if(scan_report.dataLen == new_advData.advDataLen)
+					/* If the advertising data carries the custom marker after the company
+					* ID and is followed by the counter, then the peripheral is a node of
+					* the network */
+					if((scan_match & (1u << MESH_RULE_NODE)) &&
+						(scan_fields[MESH_RULE_NODE].len == (MESH_ADV_FIELD_LEN - 2)))
 					{
-						/* If the second last value of the advertising data matches the custom 
-						* marker, then the peripheral is a node of the network */
-						if(scan_report.data[scan_report.dataLen-2] == CUSTOM_ADV_DATA_MARKER)
+						/* Save the ADV counter of the node against its address */
+						MeshCache_Update(scan_report->peerBdAddr, scan_report->peerAddrType,
+											scan_fields[MESH_RULE_NODE].value[MESH_ADV_FIELD_LEN - 3]);
+						
+						#if (DEBUG_ENABLED == 1)
+						if(MESH_COUNTER_IS_NEWER(dataADVCounter, scan_fields[MESH_RULE_NODE].value[MESH_ADV_FIELD_LEN - 3]))
 						{
-							/* If the ADV counter data in Advertising data is less than that of
-							* the value in this scanning device, then the node is a potential node 
-							* whose color has to be updated. */
-							if((scan_report.data[scan_report.dataLen-1] < dataADVCounter) ||
-							((scan_report.data[scan_report.dataLen-1] == 255) && (dataADVCounter == 0)))
-							{
-								/* Potential node found*/
-								potential_node_found = TRUE;
-								/* Save the advertising peripheral address and type*/
-								memcpy(potential_node_bdAddr, scan_report.peerBdAddr, 6);
-								potential_node_bdAddrType = scan_report.peerAddrType;
-								
-								#if (DEBUG_ENABLED == 1)
-								UART_UartPutString("potential_node_found ");
-								UART_UartPutCRLF(' ');
-								#endif
-							}
-							else
-							{
-								/* If the ADV data counter is equal or more than the data counter
-								* in this scanning device, then the node has latest RGB LED data
-								* and does not need to be connected to. Reset the potential node 
-								* address */
-								potential_node_found = FALSE;
-								
-								potential_node_bdAddrType = 0;
-								
-								potential_node_bdAddr[0] = 0x00;
-								potential_node_bdAddr[1] = 0x00;
-								potential_node_bdAddr[2] = 0x00;
-								potential_node_bdAddr[3] = 0x00;
-								potential_node_bdAddr[4] = 0x00;
-								potential_node_bdAddr[5] = 0x00;
-							}
+							UART_UartPutString("potential_node_found ");
+							UART_UartPutCRLF(' ');
 						}
+						#endif
 					}
 				}
 				#endif
 				
-				/* If the received scan data is part of scan response from a peripheral... */
-				if(scan_report.eventType == CYBLE_GAPC_SCAN_RSP)
+				/* If the received scan data is part of scan response from a peripheral
+				* and carries the expected service data (scan_tag)... */
+				if((scan_report->eventType == CYBLE_GAPC_SCAN_RSP) && (scan_match & (1u << MESH_RULE_SCAN_TAG)))
 				{
-					/* If the data lenght of the scan reponse packet is equal to expected
-					* scan response data lenght...*/
-					if(scan_report.dataLen == SCAN_TAG_DATA_LEN)
+					#ifdef ENABLE_ADV_DATA_COUNTER
+					/* If the ADV counter cached for this node, as received in its 
+					* advertising data, is older than the counter of this device, then
+					* the node is a potential node whose color has to be updated. The 
+					* counters are compared with wraparound. */
+					if(MeshCache_IsStale(scan_report->peerBdAddr, scan_report->peerAddrType,
+											dataADVCounter))
 					{
-						#ifdef ENABLE_ADV_DATA_COUNTER
-						/* If a potential node had been found earlier as part of received 
-						* advertising data, then compare the address of stored potential 
-						* node and received address of the scan response */
-						if(potential_node_found)
-						{
-							/* Compare the two addresses and type */
-							if((!memcmp(scan_report.peerBdAddr, potential_node_bdAddr, 6))  
-								&& (potential_node_bdAddrType == scan_report.peerAddrType))
-							{
+					#endif
+						/* Then it is our desired node */
+						#if (DEBUG_ENABLED == 1)
+						UART_UartPutString("Titan Found ");
+						UART_UartPutCRLF(' ');
 						#endif
-								/* If the scan report data matches the expected data (scan_tag),
-								* then it is our desired node */
-								if(!memcmp(scan_report.data, scan_tag, scan_report.dataLen))
-								{
-									#if (DEBUG_ENABLED == 1)
-									UART_UartPutString("Titan Found ");
-									UART_UartPutCRLF(' ');
-									#endif
-									/* Stop existing scan */
-									CyBle_GapcStopScan();
-									
-									#if (DEBUG_ENABLED == 1)
-									UART_UartPutString("Stop Scan called ");
-									UART_UartPutCRLF(' ');
-									#endif
-									
-									/* Save the peripheral BD address and type */
-									peripAddr.type = scan_report.peerAddrType;
-									peripAddr.bdAddr[0] = scan_report.peerBdAddr[0];
-									peripAddr.bdAddr[1] = scan_report.peerBdAddr[1];
-									peripAddr.bdAddr[2] = scan_report.peerBdAddr[2];
-									peripAddr.bdAddr[3] = scan_report.peerBdAddr[3];
-									peripAddr.bdAddr[4] = scan_report.peerBdAddr[4];
-									peripAddr.bdAddr[5] = scan_report.peerBdAddr[5];
-									
-									/* Set the flag to allow application to connect to the
-									* peripheral found */
-									clientConnectToDevice = TRUE;
-									
-									#ifdef ENABLE_ADV_DATA_COUNTER
-									/* Reset the potential node flag*/
-									potential_node_found = FALSE;
-									#endif
-									
-								}
-						#ifdef ENABLE_ADV_DATA_COUNTER
-							}
-						}
+						/* Stop existing scan */
+						CyBle_GapcStopScan();
+						
+						#if (DEBUG_ENABLED == 1)
+						UART_UartPutString("Stop Scan called ");
+						UART_UartPutCRLF(' ');
 						#endif
+						
+						/* Save the peripheral BD address and type */
+						peripAddr.type = scan_report->peerAddrType;
+						peripAddr.bdAddr[0] = scan_report->peerBdAddr[0];
+						peripAddr.bdAddr[1] = scan_report->peerBdAddr[1];
+						peripAddr.bdAddr[2] = scan_report->peerBdAddr[2];
+						peripAddr.bdAddr[3] = scan_report->peerBdAddr[3];
+						peripAddr.bdAddr[4] = scan_report->peerBdAddr[4];
+						peripAddr.bdAddr[5] = scan_report->peerBdAddr[5];
+						
+						/* Set the flag to allow application to connect to the
+						* peripheral found */
+						clientConnectToDevice = TRUE;
+					#ifdef ENABLE_ADV_DATA_COUNTER
 					}
+					#endif
 				}
 			}
 
@@ -648,6 +623,12 @@ void GenericEventHandler(uint32 event, void * eventParam)
 				UART_UartPutCRLF(' ');
 			#endif
 			
+			#ifdef ENABLE_ADV_DATA_COUNTER
+			/* The node now holds the latest data. Record this in the mesh cache so that
+			* scan responses received from it before it switches role are ignored */
+			MeshCache_Update(peripAddr.bdAddr, peripAddr.type, dataADVCounter);
+			#endif
+			
 			/* Disconnect the existing connection and restart scanning */
 			if((cyBle_connHandle.bdHandle != 0))
 			{
@@ -36,6 +36,17 @@
 
 #define CUSTOM_ADV_DATA_MARKER				0x01
 #define ADV_DATA_NAME_START_INDEX			5
+
+/* The ADV data counter is appended to the advertising data as manufacturer
+* specific data: Cypress company ID, CUSTOM_ADV_DATA_MARKER and the counter */
+#define CYPRESS_COMPANY_ID_LSB				0x31
+#define CYPRESS_COMPANY_ID_MSB				0x01
+#define MESH_ADV_FIELD_LEN					6
+
+/* Rules of the scan filter, each sets its bit in the match result */
+#define MESH_RULE_NODE						0
+#define MESH_RULE_SCAN_TAG					1
+#define MESH_RULE_COUNT						2
 	
 #define DATA_NODE_ADDR_TYPE_INDEX			0x00
 #define RESERVED_BYTE_INDEX					0x01
@@ -50,9 +50,6 @@ extern uint8 dataADVCounter;
 
 #ifdef ENABLE_ADV_DATA_COUNTER
 extern CYBLE_GAPP_DISC_DATA_T  new_advData;
-extern uint8 potential_node_found;
-extern uint8 potential_node_bdAddr[6];
-extern uint8 potential_node_bdAddrType;
 #endif
 
 extern volatile uint8 clientConnectToDevice;
@@ -202,15 +199,25 @@ void InitializeSystem(void)
 
 	
 	#ifdef ENABLE_ADV_DATA_COUNTER
+	/* Clear the cache of ADV counters seen from other nodes */
+	MeshCache_Init();
+	
 	new_advData = *cyBle_discoveryModeInfo.advData;
 	
-	if( cyBle_discoveryModeInfo.advData->advDataLen < 29)
+	if( cyBle_discoveryModeInfo.advData->advDataLen <= (CYBLE_GAP_MAX_ADV_DATA_LEN - MESH_ADV_FIELD_LEN))
 	{
 		/* Initialize the DataCounter data in advertisement packet. This is custom data in 
-		* ADV packet and used to track whether the RGB LED data is latest or not */
-		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen] = CUSTOM_ADV_DATA_MARKER;	//length of next packet
-		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen+1] = dataADVCounter;
-		new_advData.advDataLen = cyBle_discoveryModeInfo.advData->advDataLen+2;
+		* ADV packet and used to track whether the RGB LED data is latest or not. It is
+		* added as a manufacturer specific AD structure, with the counter as last byte.
+		* The AD structure takes 6 bytes: an ADV data of more than 25 bytes in the BLE
+		* component leaves no room for it and the node is then not tracked by counter */
+		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen] = MESH_ADV_FIELD_LEN - 1;
+		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen+1] = AD_TYPE_MANUFACTURER;
+		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen+2] = CYPRESS_COMPANY_ID_LSB;
+		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen+3] = CYPRESS_COMPANY_ID_MSB;
+		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen+4] = CUSTOM_ADV_DATA_MARKER;
+		new_advData.advData[cyBle_discoveryModeInfo.advData->advDataLen+5] = dataADVCounter;
+		new_advData.advDataLen = cyBle_discoveryModeInfo.advData->advDataLen+MESH_ADV_FIELD_LEN;
 	}
 	
 	/* Assign the new ADV data to stack */
@@ -21,6 +21,8 @@
 #include <debug.h>
 #include <ble_process.h>
 #include <WDT.h>
+#include <mesh_cache.h>
+#include <ad_parser.h>
 #include <low_power.h>
 #include <WriteUserSFlash.h>
 #include <sensor_process.h>
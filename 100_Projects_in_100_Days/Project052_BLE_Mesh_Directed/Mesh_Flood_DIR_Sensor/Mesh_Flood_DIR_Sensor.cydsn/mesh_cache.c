@@ -0,0 +1,123 @@
+/*******************************************************************************
+* File Name: mesh_cache.c
+*
+* Version: 1.0
+*
+* Description:
+* This file contains the definition for the mesh message cache. The cache is a
+* small direct-mapped table indexed by a hash of the node BD address, so that
+* every lookup costs a single slot comparison irrespective of network size. It
+* remembers the ADV data counter last seen from each node, which lets a scan
+* response be matched to its advertising packet even when reports from other
+* nodes are received in between.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include <main.h>
+
+static MESH_CACHE_ENTRY_T meshCache[MESH_CACHE_SIZE];
+
+/*******************************************************************************
+* Function Name: MeshCache_Slot
+********************************************************************************
+* Summary:
+*        Returns the cache slot for the given BD address. The lower bytes of the
+* address are the most random ones, so they are folded into the index.
+*
+* Parameters:
+*  bdAddr: 		pointer to 6 byte BD address
+*  bdAddrType: 	public or random address type
+*
+* Return:
+*  MESH_CACHE_ENTRY_T *: pointer to the cache slot
+*
+*******************************************************************************/
+static MESH_CACHE_ENTRY_T * MeshCache_Slot(uint8 * bdAddr, uint8 bdAddrType)
+{
+	uint8 hash;
+	
+	hash = bdAddr[0] ^ bdAddr[1] ^ (bdAddr[2] << 1) ^ (bdAddr[3] >> 1) ^ bdAddrType;
+	hash ^= (hash >> 4);
+	
+	return &meshCache[hash & MESH_CACHE_INDEX_MASK];
+}
+
+/*******************************************************************************
+* Function Name: MeshCache_Init
+********************************************************************************
+* Summary:
+*        Clears all the entries of the cache.
+*
+* Parameters:
+*  void
+*
+* Return:
+*  void
+*
+*******************************************************************************/
+void MeshCache_Init(void)
+{
+	memset(meshCache, 0, sizeof(meshCache));
+}
+
+/*******************************************************************************
+* Function Name: MeshCache_IsStale
+********************************************************************************
+* Summary:
+*        Checks if the node with the given address was last seen holding data
+* older than the given counter value. Nodes not present in the cache are not
+* treated as stale, as their counter is not known yet.
+*
+* Parameters:
+*  bdAddr: 		pointer to 6 byte BD address
+*  bdAddrType: 	public or random address type
+*  counter: 	ADV data counter to check against
+*
+* Return:
+*  uint8: TRUE if the node has to be updated, else FALSE
+*
+*******************************************************************************/
+uint8 MeshCache_IsStale(uint8 * bdAddr, uint8 bdAddrType, uint8 counter)
+{
+	MESH_CACHE_ENTRY_T * entry = MeshCache_Slot(bdAddr, bdAddrType);
+	
+	if((entry->valid) && (entry->bdAddrType == bdAddrType) &&
+		(!memcmp(entry->bdAddr, bdAddr, MESH_CACHE_BD_ADDR_LEN)))
+	{
+		return (MESH_COUNTER_IS_NEWER(counter, entry->counter)) ? TRUE : FALSE;
+	}
+	
+	return FALSE;
+}
+
+/*******************************************************************************
+* Function Name: MeshCache_Update
+********************************************************************************
+* Summary:
+*        Records the latest counter value known for a node, either as seen in its
+* advertising data or as written to it over a connection. A different node
+* hashing to the same slot replaces the existing entry.
+*
+* Parameters:
+*  bdAddr: 		pointer to 6 byte BD address
+*  bdAddrType: 	public or random address type
+*  counter: 	ADV data counter held by the node
+*
+* Return:
+*  void
+*
+*******************************************************************************/
+void MeshCache_Update(uint8 * bdAddr, uint8 bdAddrType, uint8 counter)
+{
+	MESH_CACHE_ENTRY_T * entry = MeshCache_Slot(bdAddr, bdAddrType);
+	
+	memcpy(entry->bdAddr, bdAddr, MESH_CACHE_BD_ADDR_LEN);
+	entry->bdAddrType = bdAddrType;
+	entry->counter = counter;
+	entry->valid = TRUE;
+}
+/* [] END OF FILE */
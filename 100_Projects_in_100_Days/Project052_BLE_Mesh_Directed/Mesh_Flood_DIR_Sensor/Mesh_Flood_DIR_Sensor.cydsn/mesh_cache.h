@@ -0,0 +1,53 @@
+/*******************************************************************************
+* File Name: mesh_cache.h
+*
+* Version: 1.0
+*
+* Description:
+*  This file contains the headers and constants for the mesh message cache,
+* which tracks the latest ADV data counter seen from each node and compares
+* counters with wraparound.
+*
+********************************************************************************
+* Copyright 2015, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#if !defined(MESH_CACHE_H)
+#define MESH_CACHE_H
+#include "project.h"
+
+/*****************************************************
+*                  Enums and macros
+*****************************************************/ 
+/* Number of nodes remembered by the cache. Must be a power of 2 */
+#define MESH_CACHE_SIZE						16
+#define MESH_CACHE_INDEX_MASK				(MESH_CACHE_SIZE - 1)
+#define MESH_CACHE_BD_ADDR_LEN				6
+
+/* Serial number comparison of two 8-bit ADV data counters. Counter 'a' is newer
+* than 'b' if it is ahead of 'b' by less than half of the counter range, so the
+* comparison stays correct when the counter wraps from 255 to 0 */
+#define MESH_COUNTER_IS_NEWER(a, b)			((int8)((uint8)(a) - (uint8)(b)) > 0)
+
+/*****************************************************
+*                  Data Types
+*****************************************************/ 
+typedef struct
+{
+	uint8 bdAddr[MESH_CACHE_BD_ADDR_LEN];
+	uint8 bdAddrType;
+	uint8 counter;
+	uint8 valid;
+} MESH_CACHE_ENTRY_T;
+
+/*****************************************************
+*                  Function Declarations
+*****************************************************/
+void MeshCache_Init(void);
+uint8 MeshCache_IsStale(uint8 * bdAddr, uint8 bdAddrType, uint8 counter);
+void MeshCache_Update(uint8 * bdAddr, uint8 bdAddrType, uint8 counter);
+
+#endif
+/* [] END OF FILE */